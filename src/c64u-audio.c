@@ -6,6 +6,88 @@
 #include "c64u-protocol.h"
 #include "c64u-network.h"
 #include "c64u-record.h" // For recording functions
+#include "c64u-capture.h"
+
+// Core callback: output one audio packet to OBS and hand it to the recording writer
+void deliver_audio_packet(void *data, const int16_t *samples, uint32_t count, uint16_t seq_num)
+{
+    struct c64u_source *context = data;
+    UNUSED_PARAMETER(seq_num);
+
+    // Send audio to OBS (192 stereo samples = 384 16-bit values)
+    struct obs_source_audio audio_frame = {0};
+    audio_frame.data[0] = (const uint8_t *)samples;
+    audio_frame.frames = count;
+    audio_frame.speakers = SPEAKERS_STEREO;
+    audio_frame.format = AUDIO_FORMAT_16BIT;
+    audio_frame.samples_per_sec = 48000; // Will be adjusted for PAL/NTSC
+    audio_frame.timestamp = os_gettime_ns();
+
+    // A/V sync test streams (c64u_mock_server --av-sync): the click plays at the timestamp plus its offset
+    int32_t click = c64u_avsync_click_find(samples, count);
+    if (click >= 0 && pthread_mutex_lock(&context->frame_mutex) == 0) {
+        c64u_avsync_audio_mark(&context->avsync, audio_frame.timestamp + (uint64_t)click * 1000000000ULL / 48000);
+        pthread_mutex_unlock(&context->frame_mutex);
+    }
+
+    // Record audio data if recording is enabled
+    if (context->record_video) {
+        record_audio_data(context, (const uint8_t *)samples, count * 2 * 2); // Stereo, 2 bytes per sample
+    }
+
+    obs_source_output_audio(context->source, &audio_frame);
+}
+
+// Log comprehensive audio statistics every 5 seconds; the core's audio counters are per period
+static void log_audio_statistics(struct c64u_source *context)
+{
+    uint64_t audio_now = os_gettime_ns();
+    if (context->audio_log_time == 0) {
+        context->audio_log_time = audio_now;
+        context->audio_log_cpu_ns = c64u_thread_cpu_ns();
+        C64U_LOG_INFO("🎵 Audio statistics tracking initialized");
+    }
+
+    uint64_t audio_time_diff = audio_now - context->audio_log_time;
+    if (audio_time_diff < 5000000000ULL) {
+        return;
+    }
+
+    struct c64u_core_stats *stats = &context->core.stats;
+    double duration = audio_time_diff / 1000000000.0;
+    double bandwidth_mbps = (stats->audio_bytes * 8.0) / (duration * 1000000.0);
+    double pps = stats->audio_packets / duration;
+    double loss_pct = stats->audio_packets > 0 ? (100.0 * stats->audio_seq_gaps) / stats->audio_packets : 0.0;
+    double sample_rate = stats->audio_packets * 192.0 / duration; // 192 samples per packet
+    context->audio_packet_total += stats->audio_packets;
+    uint64_t cpu_ns = c64u_thread_cpu_ns();
+    // Percent of one core; 0 if another thread fed the period's first packet (reconnect, capture replay)
+    double cpu_pct =
+        cpu_ns >= context->audio_log_cpu_ns ? (100.0 * (cpu_ns - context->audio_log_cpu_ns)) / audio_time_diff : 0.0;
+
+    C64U_LOG_INFO("🔊 AUDIO: %.0f Hz | %.2f Mbps | %.0f pps | Loss: %.1f%% | Packets: %u | CPU %.1f%%", sample_rate,
+                  bandwidth_mbps, pps, loss_pct, context->audio_packet_total, cpu_pct);
+
+    // Reset period counters (the video counters belong to the video thread)
+    stats->audio_packets = 0;
+    stats->audio_bytes = 0;
+    stats->audio_seq_gaps = 0;
+    context->audio_log_time = audio_now;
+    context->audio_log_cpu_ns = cpu_ns;
+}
+
+// Process one audio datagram: statistics, recording and output to OBS. Shared by the UDP receiver
+// thread and the capture replay source. Returns false if the datagram is not a C64U audio packet.
+bool process_audio_packet(struct c64u_source *context, const uint8_t *packet, size_t size)
+{
+    // The samples come back through deliver_audio_packet()
+    if (!c64u_core_audio_packet(&context->core, packet, size)) {
+        C64U_LOG_WARNING("Received incomplete audio packet: %zu bytes (expected %d)", size, C64U_AUDIO_PACKET_SIZE);
+        return false;
+    }
+    log_audio_statistics(context);
+    return true;
+}
 
 // Audio thread function
 void *audio_thread_func(void *data)
@@ -32,81 +114,18 @@ void *audio_thread_func(void *data)
             break;
         }
 
-        if (received != C64U_AUDIO_PACKET_SIZE) {
-            C64U_LOG_WARNING("Received incomplete audio packet: " SSIZE_T_FORMAT " bytes (expected %d)",
-                             SSIZE_T_CAST(received), C64U_AUDIO_PACKET_SIZE);
+        // Raw capture sees every datagram exactly as received, including malformed ones
+        uint64_t receive_time = os_gettime_ns();
+        capture_packet(context, C64U_CAPTURE_STREAM_AUDIO, packet, (size_t)received, receive_time);
+
+        if (!process_audio_packet(context, packet, (size_t)received)) {
             continue;
         }
 
         // Update timestamp for timeout detection - UDP packet received successfully
         pthread_mutex_lock(&context->retry_mutex);
-        context->last_udp_packet_time = os_gettime_ns();
+        context->last_udp_packet_time = receive_time;
         pthread_mutex_unlock(&context->retry_mutex);
-
-        // Parse audio packet
-        uint16_t seq_num = *(uint16_t *)(packet);
-        int16_t *audio_data = (int16_t *)(packet + C64U_AUDIO_HEADER_SIZE);
-
-        // Technical statistics tracking - Audio
-        static int audio_packet_count = 0;
-        static uint64_t last_audio_log = 0;
-        static uint32_t audio_bytes_period = 0;
-        static uint32_t audio_packets_period = 0;
-        static uint16_t last_audio_seq = 0;
-        static uint32_t audio_drops = 0;
-        static bool first_audio = true;
-
-        audio_packet_count++;
-        audio_bytes_period += (uint32_t)received; // Cast ssize_t to uint32_t for Windows
-        audio_packets_period++;
-
-        uint64_t audio_now = os_gettime_ns();
-        if (last_audio_log == 0) {
-            last_audio_log = audio_now;
-            C64U_LOG_INFO("🎵 Audio statistics tracking initialized");
-        }
-
-        // Track audio packet drops
-        if (!first_audio && seq_num != (uint16_t)(last_audio_seq + 1)) {
-            audio_drops++;
-        }
-        last_audio_seq = seq_num;
-        first_audio = false;
-
-        // Log comprehensive audio statistics every 5 seconds
-        uint64_t audio_time_diff = audio_now - last_audio_log;
-        if (audio_time_diff >= 5000000000ULL) {
-            double duration = audio_time_diff / 1000000000.0;
-            double bandwidth_mbps = (audio_bytes_period * 8.0) / (duration * 1000000.0);
-            double pps = audio_packets_period / duration;
-            double loss_pct = audio_packets_period > 0 ? (100.0 * audio_drops) / audio_packets_period : 0.0;
-            double sample_rate = audio_packets_period * 192.0 / duration; // 192 samples per packet
-
-            C64U_LOG_INFO("🔊 AUDIO: %.0f Hz | %.2f Mbps | %.0f pps | Loss: %.1f%% | Packets: %u", sample_rate,
-                          bandwidth_mbps, pps, loss_pct, audio_packet_count);
-
-            // Reset period counters
-            audio_bytes_period = 0;
-            audio_packets_period = 0;
-            last_audio_log = audio_now;
-        }
-
-        // Send audio to OBS (192 stereo samples = 384 16-bit values)
-        struct obs_source_audio audio_frame = {0};
-        audio_frame.data[0] = (uint8_t *)audio_data;
-        audio_frame.frames = 192;
-        audio_frame.speakers = SPEAKERS_STEREO;
-        audio_frame.format = AUDIO_FORMAT_16BIT;
-        audio_frame.samples_per_sec = 48000; // Will be adjusted for PAL/NTSC
-        audio_frame.timestamp = os_gettime_ns();
-
-        // Record audio data if recording is enabled
-        if (context->record_video) {
-            record_audio_data(context, (const uint8_t *)audio_data,
-                              192 * 2 * 2); // 192 stereo samples * 2 bytes per sample
-        }
-
-        obs_source_output_audio(context->source, &audio_frame);
     }
 
     C64U_LOG_DEBUG("Audio thread stopped for C64U source '%s'", obs_source_get_name(context->source));
@@ -1,9 +1,19 @@
 #ifndef C64U_AUDIO_H
 #define C64U_AUDIO_H
 
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
 // Forward declaration
 struct c64u_source;
 
+// Core callback (struct c64u_core_callbacks): output one packet's samples to OBS and the recording
+void deliver_audio_packet(void *data, const int16_t *samples, uint32_t count, uint16_t seq_num);
+
+// Packet processing (shared by the UDP receiver thread and the replay source)
+bool process_audio_packet(struct c64u_source *context, const uint8_t *packet, size_t size);
+
 // Audio thread function
 void *audio_thread_func(void *data);
 
@@ -0,0 +1,445 @@
+#include <obs-module.h>
+#include <string.h>
+#include <stdio.h>
+#include "c64u-logging.h"
+#include "c64u-avi.h"
+#include "c64u-recfile.h"
+
+// Header flags and index types (OpenDML AVI File Format Extensions 1.02)
+#define AVIF_HASINDEX 0x00000010
+#define AVIIF_KEYFRAME 0x00000010
+#define AVI_INDEX_OF_INDEXES 0x00
+#define AVI_INDEX_OF_CHUNKS 0x01
+#define AVI_INDEX_DELTA_FRAME 0x80000000u // Standard index dwSize bit: not a keyframe
+
+#define AVI_STRH_SIZE 48
+#define AVI_DMLH_SIZE 248
+#define AVI_SUPER_INDEX_SIZE (24 + 16 * C64U_AVI_SUPER_INDEX_ENTRIES)
+
+// In-memory index entry for one chunk of the current RIFF segment
+struct avi_index_entry {
+    uint32_t offset; // Chunk header position relative to the segment's 'movi' fourcc
+    uint32_t size;   // Chunk payload size
+    uint8_t stream;
+    bool keyframe;
+};
+
+// Super index entry: one standard index (ix##) chunk per stream and segment
+struct avi_super_entry {
+    uint64_t offset; // File position of the ix## chunk
+    uint32_t size;   // Size of the ix## chunk including its header
+    uint32_t duration;
+};
+
+struct avi_stream {
+    struct c64u_avi_stream_info info;
+    uint64_t length_pos;       // File position of strh dwLength
+    uint64_t super_index_pos;  // File position of the reserved indx chunk
+    uint32_t length;           // Total duration written (strh dwLength)
+    uint32_t segment_duration; // Duration written in the current segment
+    struct avi_super_entry *super_entries;
+    uint32_t super_count;
+};
+
+struct c64u_avi_writer {
+    struct c64u_recfile *file;
+    char path[1024];
+    uint64_t pos; // Tracked write position (appended size of the file)
+    bool failed;
+
+    struct avi_stream streams[C64U_AVI_MAX_STREAMS];
+    uint32_t stream_count;
+    uint64_t total_frames_pos; // avih dwTotalFrames (frames in the first RIFF)
+    uint64_t dmlh_frames_pos;  // dmlh dwTotalFrames (frames in the whole file)
+    uint32_t first_riff_frames;
+
+    // Current RIFF segment
+    uint32_t segment;   // 0 = RIFF 'AVI ', then RIFF 'AVIX'
+    uint64_t riff_pos;  // File position of the 'RIFF' fourcc
+    uint64_t movi_pos;  // File position of the 'movi' fourcc (base offset of idx1 and ix## entries)
+    struct avi_index_entry *entries;
+    uint32_t entry_count;
+    uint32_t entry_capacity;
+};
+
+static const uint8_t avi_zeros[256];
+
+// Append to the file; a short write marks the file as failed and logs once
+static void avi_write(struct c64u_avi_writer *avi, const void *data, size_t size)
+{
+    if (avi->failed)
+        return;
+
+    if (!c64u_recfile_write(avi->file, data, size)) {
+        avi->failed = true; // Logged by the file
+        return;
+    }
+    avi->pos += size;
+}
+
+static void avi_write_fourcc(struct c64u_avi_writer *avi, const char *fourcc)
+{
+    avi_write(avi, fourcc, 4);
+}
+
+static void avi_write_u8(struct c64u_avi_writer *avi, uint8_t value)
+{
+    avi_write(avi, &value, 1);
+}
+
+static void avi_write_u16(struct c64u_avi_writer *avi, uint16_t value)
+{
+    avi_write(avi, &value, 2);
+}
+
+static void avi_write_u32(struct c64u_avi_writer *avi, uint32_t value)
+{
+    avi_write(avi, &value, 4);
+}
+
+static void avi_write_u64(struct c64u_avi_writer *avi, uint64_t value)
+{
+    avi_write(avi, &value, 8);
+}
+
+static void avi_write_zeros(struct c64u_avi_writer *avi, size_t size)
+{
+    while (size > 0) {
+        size_t n = size < sizeof(avi_zeros) ? size : sizeof(avi_zeros);
+        avi_write(avi, avi_zeros, n);
+        size -= n;
+    }
+}
+
+// Overwrite data at an earlier file position
+static void avi_patch(struct c64u_avi_writer *avi, uint64_t pos, const void *data, size_t size)
+{
+    if (avi->failed)
+        return;
+
+    if (!c64u_recfile_patch(avi->file, pos, data, size)) {
+        avi->failed = true; // Logged by the file
+    }
+}
+
+static void avi_patch_u32(struct c64u_avi_writer *avi, uint64_t pos, uint32_t value)
+{
+    avi_patch(avi, pos, &value, 4);
+}
+
+// Two-digit stream number as used in chunk and index IDs ("ix00", "ix01")
+static void avi_index_fourcc(char *fourcc, uint32_t stream)
+{
+    fourcc[0] = 'i';
+    fourcc[1] = 'x';
+    fourcc[2] = (char)('0' + stream / 10);
+    fourcc[3] = (char)('0' + stream % 10);
+}
+
+static void write_headers(struct c64u_avi_writer *avi, const struct c64u_avi_info *info)
+{
+    uint32_t strl_sizes[C64U_AVI_MAX_STREAMS];
+    uint32_t hdrl_size = 4 + (8 + 56) + (8 + 4 + 8 + AVI_DMLH_SIZE); // hdrl + avih + LIST odml
+    uint32_t suggested_buffer_size = 0;
+    for (uint32_t i = 0; i < avi->stream_count; i++) {
+        const struct c64u_avi_stream_info *s = &avi->streams[i].info;
+        uint32_t strf_size = s->format_size + (s->format_size & 1);
+        strl_sizes[i] = 4 + (8 + AVI_STRH_SIZE) + (8 + strf_size) + (8 + AVI_SUPER_INDEX_SIZE);
+        hdrl_size += 8 + strl_sizes[i];
+        if (s->suggested_buffer_size > suggested_buffer_size) {
+            suggested_buffer_size = s->suggested_buffer_size;
+        }
+    }
+
+    // RIFF 'AVI ' (size patched when the segment is finished)
+    avi->riff_pos = avi->pos;
+    avi_write_fourcc(avi, "RIFF");
+    avi_write_u32(avi, 0);
+    avi_write_fourcc(avi, "AVI ");
+
+    avi_write_fourcc(avi, "LIST");
+    avi_write_u32(avi, hdrl_size);
+    avi_write_fourcc(avi, "hdrl");
+
+    // Main AVI header (avih)
+    avi_write_fourcc(avi, "avih");
+    avi_write_u32(avi, 56);
+    avi_write_u32(avi, info->micro_sec_per_frame); // dwMicroSecPerFrame
+    avi_write_u32(avi, info->max_bytes_per_sec);   // dwMaxBytesPerSec
+    avi_write_u32(avi, 0);                         // dwPaddingGranularity
+    avi_write_u32(avi, AVIF_HASINDEX);             // dwFlags
+    avi->total_frames_pos = avi->pos;
+    avi_write_u32(avi, 0);                     // dwTotalFrames (frames in the first RIFF, patched later)
+    avi_write_u32(avi, 0);                     // dwInitialFrames
+    avi_write_u32(avi, avi->stream_count);     // dwStreams
+    avi_write_u32(avi, suggested_buffer_size); // dwSuggestedBufferSize
+    avi_write_u32(avi, info->width);           // dwWidth
+    avi_write_u32(avi, info->height);          // dwHeight
+    avi_write_zeros(avi, 16);                  // dwReserved[4]
+
+    for (uint32_t i = 0; i < avi->stream_count; i++) {
+        struct avi_stream *stream = &avi->streams[i];
+        const struct c64u_avi_stream_info *s = &stream->info;
+
+        avi_write_fourcc(avi, "LIST");
+        avi_write_u32(avi, strl_sizes[i]);
+        avi_write_fourcc(avi, "strl");
+
+        // Stream header (strh)
+        avi_write_fourcc(avi, "strh");
+        avi_write_u32(avi, AVI_STRH_SIZE);
+        avi_write(avi, s->type, 4);    // fccType
+        avi_write(avi, s->handler, 4); // fccHandler
+        avi_write_u32(avi, 0);         // dwFlags
+        avi_write_u16(avi, 0);         // wPriority
+        avi_write_u16(avi, 0);         // wLanguage
+        avi_write_u32(avi, 0);         // dwInitialFrames
+        avi_write_u32(avi, s->scale);  // dwScale
+        avi_write_u32(avi, s->rate);   // dwRate
+        avi_write_u32(avi, 0);         // dwStart
+        stream->length_pos = avi->pos;
+        avi_write_u32(avi, 0);                        // dwLength (patched later)
+        avi_write_u32(avi, s->suggested_buffer_size); // dwSuggestedBufferSize
+        avi_write_u32(avi, 0xFFFFFFFF);               // dwQuality (-1 = default)
+        avi_write_u32(avi, s->sample_size);           // dwSampleSize
+
+        // Stream format (strf)
+        avi_write_fourcc(avi, "strf");
+        avi_write_u32(avi, s->format_size);
+        avi_write(avi, s->format, s->format_size);
+        avi_write_zeros(avi, s->format_size & 1);
+
+        // Super index (indx), filled in as segments are finished
+        stream->super_index_pos = avi->pos;
+        avi_write_fourcc(avi, "indx");
+        avi_write_u32(avi, AVI_SUPER_INDEX_SIZE);
+        avi_write_zeros(avi, AVI_SUPER_INDEX_SIZE);
+    }
+
+    // OpenDML extended header: total frame count across all RIFF segments
+    avi_write_fourcc(avi, "LIST");
+    avi_write_u32(avi, 4 + 8 + AVI_DMLH_SIZE);
+    avi_write_fourcc(avi, "odml");
+    avi_write_fourcc(avi, "dmlh");
+    avi_write_u32(avi, AVI_DMLH_SIZE);
+    avi->dmlh_frames_pos = avi->pos;
+    avi_write_zeros(avi, AVI_DMLH_SIZE);
+}
+
+// Open a 'movi' list for the next chunks (size patched when the segment is finished)
+static void begin_movi(struct c64u_avi_writer *avi)
+{
+    avi_write_fourcc(avi, "LIST");
+    avi_write_u32(avi, 0);
+    avi->movi_pos = avi->pos;
+    avi_write_fourcc(avi, "movi");
+    avi->entry_count = 0;
+}
+
+// Standard index (ix##) of one stream's chunks in the current segment, written inside the 'movi' list
+static void write_standard_index(struct c64u_avi_writer *avi, uint32_t stream_index)
+{
+    struct avi_stream *stream = &avi->streams[stream_index];
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < avi->entry_count; i++) {
+        count += avi->entries[i].stream == stream_index;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    if (stream->super_count == C64U_AVI_SUPER_INDEX_ENTRIES) {
+        C64U_LOG_WARNING("AVI super index full, later segments are only reachable by scanning: %s", avi->path);
+        return;
+    }
+
+    char fourcc[4];
+    avi_index_fourcc(fourcc, stream_index);
+    uint32_t size = 24 + 8 * count;
+    struct avi_super_entry *super = &stream->super_entries[stream->super_count++];
+    super->offset = avi->pos;
+    super->size = 8 + size;
+    super->duration = stream->segment_duration;
+
+    avi_write(avi, fourcc, 4);
+    avi_write_u32(avi, size);
+    avi_write_u16(avi, 2);                  // wLongsPerEntry
+    avi_write_u8(avi, 0);                   // bIndexSubType
+    avi_write_u8(avi, AVI_INDEX_OF_CHUNKS); // bIndexType
+    avi_write_u32(avi, count);              // nEntriesInUse
+    avi_write(avi, stream->info.chunk_id, 4); // dwChunkId
+    avi_write_u64(avi, avi->movi_pos);        // qwBaseOffset
+    avi_write_u32(avi, 0);                    // dwReserved
+
+    for (uint32_t i = 0; i < avi->entry_count; i++) {
+        const struct avi_index_entry *e = &avi->entries[i];
+        if (e->stream == stream_index) {
+            avi_write_u32(avi, e->offset + 8); // Points at the chunk data
+            avi_write_u32(avi, e->size | (e->keyframe ? 0 : AVI_INDEX_DELTA_FRAME));
+        }
+    }
+}
+
+// Legacy index (idx1) of the first segment, for players without OpenDML support
+static void write_legacy_index(struct c64u_avi_writer *avi)
+{
+    avi_write_fourcc(avi, "idx1");
+    avi_write_u32(avi, 16 * avi->entry_count);
+    for (uint32_t i = 0; i < avi->entry_count; i++) {
+        const struct avi_index_entry *e = &avi->entries[i];
+        avi_write(avi, avi->streams[e->stream].info.chunk_id, 4);
+        avi_write_u32(avi, e->keyframe ? AVIIF_KEYFRAME : 0);
+        avi_write_u32(avi, e->offset);
+        avi_write_u32(avi, e->size);
+    }
+}
+
+// Patch frame counts, stream lengths and super indexes in the header
+static void patch_headers(struct c64u_avi_writer *avi)
+{
+    avi_patch_u32(avi, avi->total_frames_pos, avi->first_riff_frames);
+    avi_patch_u32(avi, avi->dmlh_frames_pos, avi->streams[0].length);
+
+    for (uint32_t i = 0; i < avi->stream_count; i++) {
+        struct avi_stream *stream = &avi->streams[i];
+        avi_patch_u32(avi, stream->length_pos, stream->length);
+
+        uint8_t header[24] = {0};
+        uint16_t longs_per_entry = 4;
+        memcpy(header, &longs_per_entry, 2);
+        header[2] = 0; // bIndexSubType
+        header[3] = AVI_INDEX_OF_INDEXES;
+        memcpy(header + 4, &stream->super_count, 4);
+        memcpy(header + 8, stream->info.chunk_id, 4);
+        avi_patch(avi, stream->super_index_pos + 8, header, sizeof(header));
+        avi_patch(avi, stream->super_index_pos + 8 + sizeof(header), stream->super_entries,
+                  sizeof(struct avi_super_entry) * stream->super_count);
+    }
+}
+
+// Close the current RIFF segment: write its indexes, patch its sizes and the main headers
+static void finish_segment(struct c64u_avi_writer *avi)
+{
+    for (uint32_t i = 0; i < avi->stream_count; i++) {
+        write_standard_index(avi, i);
+    }
+    avi_patch_u32(avi, avi->movi_pos - 4, (uint32_t)(avi->pos - avi->movi_pos));
+
+    if (avi->segment == 0) {
+        write_legacy_index(avi);
+        avi->first_riff_frames = avi->streams[0].length;
+    }
+    avi_patch_u32(avi, avi->riff_pos + 4, (uint32_t)(avi->pos - avi->riff_pos - 8));
+
+    patch_headers(avi);
+    if (!avi->failed && !c64u_recfile_sync(avi->file)) {
+        avi->failed = true;
+    }
+
+    for (uint32_t i = 0; i < avi->stream_count; i++) {
+        avi->streams[i].segment_duration = 0;
+    }
+}
+
+// Start an extension segment: RIFF 'AVIX' with its own 'movi' list
+static void begin_extension_segment(struct c64u_avi_writer *avi)
+{
+    avi->segment++;
+    avi->riff_pos = avi->pos;
+    avi_write_fourcc(avi, "RIFF");
+    avi_write_u32(avi, 0);
+    avi_write_fourcc(avi, "AVIX");
+    begin_movi(avi);
+}
+
+struct c64u_avi_writer *c64u_avi_create(const char *path, const struct c64u_avi_info *info,
+                                        const struct c64u_avi_stream_info *streams, uint32_t stream_count,
+                                        bool direct_io)
+{
+    if (stream_count == 0 || stream_count > C64U_AVI_MAX_STREAMS) {
+        return NULL;
+    }
+
+    struct c64u_avi_writer *avi = bzalloc(sizeof(struct c64u_avi_writer));
+    snprintf(avi->path, sizeof(avi->path), "%s", path);
+    avi->stream_count = stream_count;
+    avi->entry_capacity = 1024;
+    avi->entries = bmalloc(sizeof(struct avi_index_entry) * avi->entry_capacity);
+    for (uint32_t i = 0; i < stream_count; i++) {
+        avi->streams[i].info = streams[i];
+        avi->streams[i].super_entries = bzalloc(sizeof(struct avi_super_entry) * C64U_AVI_SUPER_INDEX_ENTRIES);
+    }
+
+    avi->file = c64u_recfile_open(path, direct_io);
+    if (!avi->file) {
+        c64u_avi_close(avi);
+        return NULL;
+    }
+
+    write_headers(avi, info);
+    for (uint32_t i = 0; i < stream_count; i++) {
+        avi->streams[i].info.format = NULL; // Only needed for the header
+    }
+    begin_movi(avi);
+    if (avi->failed) {
+        c64u_avi_close(avi);
+        return NULL;
+    }
+    return avi;
+}
+
+bool c64u_avi_write_chunk(struct c64u_avi_writer *avi, uint32_t stream, const void *data, uint32_t size,
+                          bool keyframe, uint32_t duration)
+{
+    if (avi->failed || stream >= avi->stream_count) {
+        return false;
+    }
+
+    // Roll over to a new segment well before the 4 GiB RIFF limit; the indexes fit in the headroom
+    uint64_t chunk_size = 8 + size + (size & 1);
+    if (avi->pos + chunk_size - avi->riff_pos > C64U_AVI_RIFF_SIZE ||
+        avi->entry_count == C64U_AVI_SEGMENT_MAX_CHUNKS) {
+        finish_segment(avi);
+        begin_extension_segment(avi);
+    }
+
+    if (avi->entry_count == avi->entry_capacity) {
+        avi->entry_capacity *= 2;
+        avi->entries = brealloc(avi->entries, sizeof(struct avi_index_entry) * avi->entry_capacity);
+    }
+    struct avi_index_entry *entry = &avi->entries[avi->entry_count++];
+    entry->offset = (uint32_t)(avi->pos - avi->movi_pos);
+    entry->size = size;
+    entry->stream = (uint8_t)stream;
+    entry->keyframe = keyframe;
+
+    avi_write(avi, avi->streams[stream].info.chunk_id, 4);
+    avi_write_u32(avi, size);
+    avi_write(avi, data, size);
+    avi_write_zeros(avi, size & 1); // Chunks are word aligned
+
+    avi->streams[stream].length += duration;
+    avi->streams[stream].segment_duration += duration;
+    return !avi->failed;
+}
+
+bool c64u_avi_close(struct c64u_avi_writer *avi)
+{
+    if (!avi)
+        return false;
+
+    if (avi->file) {
+        finish_segment(avi);
+        if (!c64u_recfile_close(avi->file)) {
+            avi->failed = true; // Logged by the file
+        }
+    }
+
+    bool ok = avi->file && !avi->failed;
+    for (uint32_t i = 0; i < avi->stream_count; i++) {
+        bfree(avi->streams[i].super_entries);
+    }
+    bfree(avi->entries);
+    bfree(avi);
+    return ok;
+}
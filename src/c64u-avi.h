@@ -0,0 +1,52 @@
+#ifndef C64U_AVI_H
+#define C64U_AVI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// OpenDML (AVI 2.0) container writer for recordings: RIFF-AVIX segments, idx1 plus ix##/indx indexes
+#define C64U_AVI_MAX_STREAMS 2
+#define C64U_AVI_RIFF_SIZE (1024u * 1024u * 1024u) // Start a new RIFF-AVIX segment after 1 GiB
+#define C64U_AVI_SEGMENT_MAX_CHUNKS 65536          // ...or this many chunks (bounds the in-memory index)
+#define C64U_AVI_SUPER_INDEX_ENTRIES 1024          // Segments per file, reserved in the header (16KB per stream)
+
+// Stream description, copied into the strh/strf header chunks
+struct c64u_avi_stream_info {
+    char type[4];                   // fccType: "vids" or "auds"
+    char handler[4];                // fccHandler, all zero when not used
+    char chunk_id[4];               // Data chunk ID, e.g. "00db", "00dc" or "01wb"
+    uint32_t scale;                 // dwScale / dwRate = chunk duration units per second
+    uint32_t rate;                  //
+    uint32_t sample_size;           // dwSampleSize (0 for video)
+    uint32_t suggested_buffer_size; // Largest expected chunk
+    const void *format;             // strf payload (BITMAPINFO or WAVEFORMATEX)
+    uint32_t format_size;
+};
+
+// Main header (avih) values
+struct c64u_avi_info {
+    uint32_t micro_sec_per_frame;
+    uint32_t max_bytes_per_sec;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct c64u_avi_writer;
+
+// Create the file and write the headers with space reserved for the indexes. With direct_io the file bypasses
+// the page cache (see c64u-recfile.h). Returns NULL on error.
+struct c64u_avi_writer *c64u_avi_create(const char *path, const struct c64u_avi_info *info,
+                                        const struct c64u_avi_stream_info *streams, uint32_t stream_count,
+                                        bool direct_io);
+
+// Append one data chunk. Writing is append-only: the index is kept in memory and the headers are only patched when
+// a RIFF segment is full and at close (in memory while they are still in the write buffer). duration is in the
+// stream's dwScale/dwRate units (1 for a video frame). Returns false once the file failed; the error is logged once.
+bool c64u_avi_write_chunk(struct c64u_avi_writer *avi, uint32_t stream, const void *data, uint32_t size,
+                          bool keyframe, uint32_t duration);
+
+// Write the last index, patch the headers and close the file. Frees the writer.
+bool c64u_avi_close(struct c64u_avi_writer *avi);
+
+#endif // C64U_AVI_H
@@ -0,0 +1,654 @@
+#include <obs-module.h>
+#include <util/platform.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include "c64u-logging.h"
+#include "c64u-capture.h"
+#include "c64u-record.h"
+#include "c64u-types.h"
+
+// The writer wakes up on this interval (or earlier when the queue fills up) instead of once per datagram
+#define CAPTURE_WRITER_INTERVAL_MS 20
+#define CAPTURE_WAKEUP_THRESHOLD (C64U_CAPTURE_RING_SLOTS / 8)
+#define CAPTURE_FLUSH_INTERVAL_NS 1000000000ULL // Flush to disk once per second so crashes lose little data
+
+// An instant replay save copies this many datagrams out of the ring per lock, so the receive threads only ever
+// wait for a short memcpy
+#define REPLAY_SAVE_BATCH 256
+
+static void write_u16(FILE *file, uint16_t value)
+{
+    fwrite(&value, 2, 1, file);
+}
+
+static void write_u32(FILE *file, uint32_t value)
+{
+    fwrite(&value, 4, 1, file);
+}
+
+static void write_u64(FILE *file, uint64_t value)
+{
+    fwrite(&value, 8, 1, file);
+}
+
+// Write the fixed-size session header; format fields are patched when the capture is closed
+static void write_capture_header(struct c64u_source *context, FILE *file, uint64_t start_time, uint64_t start_unix_ms)
+{
+    char host[64] = {0};
+    char ip[64] = {0};
+    strncpy(host, context->hostname, sizeof(host) - 1);
+    strncpy(ip, context->ip_address, sizeof(ip) - 1);
+
+    uint16_t frame_height = (uint16_t)context->core.detected_frame_height;
+    uint32_t fps_millihertz = (uint32_t)(context->core.expected_fps * 1000.0 + 0.5);
+
+    fwrite(C64U_CAPTURE_MAGIC, 1, 4, file);         // 0: magic
+    write_u16(file, C64U_CAPTURE_VERSION);          // 4: version
+    write_u16(file, C64U_CAPTURE_HEADER_SIZE);      // 6: header size
+    write_u64(file, start_time);                    // 8: monotonic start time (ns)
+    write_u64(file, start_unix_ms);                 // 16: wall clock start time (Unix ms)
+    fwrite(host, 1, sizeof(host), file);            // 24: C64U host as entered
+    fwrite(ip, 1, sizeof(ip), file);                // 88: resolved C64U IP
+    write_u16(file, (uint16_t)context->video_port); // 152: video port
+    write_u16(file, (uint16_t)context->audio_port); // 154: audio port
+    write_u16(file, frame_height);                  // 156: frame height (0 = unknown)
+    write_u16(file, 0);                             // 158: reserved
+    write_u32(file, fps_millihertz);                // 160: frame rate (mHz)
+    write_u32(file, 0);                             // 164: record count (patched at close)
+    write_u32(file, 0);                             // 168: dropped datagrams (patched at close)
+    write_u32(file, 0);                             // 172: reserved
+}
+
+// Patch detected format and totals into the header (only seek in the file's lifetime)
+static void finalize_capture_header(struct c64u_source *context, FILE *file, uint32_t records, uint32_t dropped)
+{
+    fseek(file, 156, SEEK_SET);
+    write_u16(file, (uint16_t)context->core.detected_frame_height);
+    fseek(file, 160, SEEK_SET);
+    write_u32(file, (uint32_t)(context->core.expected_fps * 1000.0 + 0.5));
+    write_u32(file, records);
+    write_u32(file, dropped);
+    fseek(file, 0, SEEK_END);
+}
+
+static bool write_record(FILE *file, const struct capture_slot *slot, uint64_t start_time)
+{
+    uint64_t timestamp = slot->receive_time > start_time ? slot->receive_time - start_time : 0;
+
+    write_u64(file, timestamp);
+    uint8_t stream_flags[2] = {slot->stream_id, 0};
+    fwrite(stream_flags, 1, 2, file);
+    write_u16(file, slot->size);
+    return fwrite(slot->data, 1, slot->size, file) == slot->size;
+}
+
+static void write_capture_record(struct c64u_source *context, const struct capture_slot *slot, uint64_t start_time)
+{
+    if (write_record(context->capture_file, slot, start_time)) {
+        if (slot->stream_id == C64U_CAPTURE_STREAM_GAP) {
+            uint32_t gap;
+            memcpy(&gap, slot->data, sizeof(gap));
+            context->capture_file_dropped += gap;
+        }
+        context->capture_records++;
+        context->capture_bytes += C64U_CAPTURE_RECORD_HEADER_SIZE + slot->size;
+    } else {
+        C64U_LOG_WARNING("Failed to write stream capture record");
+    }
+}
+
+static bool open_capture_file(struct c64u_source *context, uint64_t start_time)
+{
+    // Snapshot the output folder; it may be changed concurrently from the settings thread
+    char save_folder[sizeof(context->save_folder)];
+    pthread_mutex_lock(&context->recording_mutex);
+    memcpy(save_folder, context->save_folder, sizeof(save_folder));
+    pthread_mutex_unlock(&context->recording_mutex);
+
+    if (!create_directory_recursive(save_folder)) {
+        C64U_LOG_ERROR("Failed to create capture folder: %s", save_folder);
+        return false;
+    }
+
+    time_t rawtime = time(NULL);
+    struct tm *timeinfo = localtime(&rawtime);
+    snprintf(context->capture_filename, sizeof(context->capture_filename),
+             "%s/capture_%04d%02d%02d_%02d%02d%02d.c64s", save_folder, timeinfo->tm_year + 1900,
+             timeinfo->tm_mon + 1, timeinfo->tm_mday, timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec);
+
+    context->capture_file = fopen(context->capture_filename, "wb");
+    if (!context->capture_file) {
+        C64U_LOG_ERROR("Failed to create stream capture file: %s", context->capture_filename);
+        return false;
+    }
+
+    // Large stdio buffer: records are small, so let the C library batch them into big writes
+    setvbuf(context->capture_file, NULL, _IOFBF, 256 * 1024);
+
+    context->capture_records = 0;
+    context->capture_file_dropped = 0;
+    context->capture_bytes = C64U_CAPTURE_HEADER_SIZE;
+    write_capture_header(context, context->capture_file, start_time, (uint64_t)time(NULL) * 1000);
+
+    C64U_LOG_INFO("Started raw stream capture: %s", context->capture_filename);
+    return true;
+}
+
+static void close_capture_file(struct c64u_source *context, uint32_t pending_gap, uint64_t start_time)
+{
+    // Datagrams dropped after the last queued record still get their GAP record
+    if (pending_gap > 0) {
+        struct capture_slot gap_slot = {
+            .receive_time = os_gettime_ns(), .size = sizeof(pending_gap), .stream_id = C64U_CAPTURE_STREAM_GAP};
+        memcpy(gap_slot.data, &pending_gap, sizeof(pending_gap));
+        write_capture_record(context, &gap_slot, start_time);
+    }
+
+    finalize_capture_header(context, context->capture_file, context->capture_records, context->capture_file_dropped);
+    fclose(context->capture_file);
+    context->capture_file = NULL;
+
+    C64U_LOG_INFO("Raw stream capture stopped: %s (%u records, %.1f MB, %u datagrams dropped)",
+                  context->capture_filename, context->capture_records, context->capture_bytes / (1024.0 * 1024.0),
+                  context->capture_file_dropped);
+}
+
+// Absolute deadline for pthread_cond_timedwait (which uses the realtime clock)
+static struct timespec capture_deadline(uint32_t timeout_ms)
+{
+    struct timespec deadline;
+    timespec_get(&deadline, TIME_UTC);
+    deadline.tv_nsec += (long)timeout_ms * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+    return deadline;
+}
+
+// Capture writer thread: owns the capture file
+static void *capture_thread_func(void *data)
+{
+    struct c64u_source *context = data;
+    bool open_failed = false;
+    uint64_t start_time = 0; // Timestamp base of the open capture file
+    uint64_t last_flush = os_gettime_ns();
+
+    C64U_LOG_DEBUG("Stream capture writer thread started");
+
+    pthread_mutex_lock(&context->capture_mutex);
+    while (true) {
+        // Open the capture file as requested from the settings thread. Records queued just before capturing
+        // was switched off again still belong to that session, so they open the file too.
+        if (!context->capture_stream && context->capture_count == 0) {
+            open_failed = false;
+        } else if (!context->capture_file && !open_failed &&
+                   (context->capture_count > 0 || !context->capture_shutdown)) {
+            start_time = context->capture_start_time;
+            pthread_mutex_unlock(&context->capture_mutex);
+            open_failed = !open_capture_file(context, start_time);
+            pthread_mutex_lock(&context->capture_mutex);
+            continue;
+        }
+
+        // Write everything queued so far in one batch; producers only append behind it
+        uint32_t count = context->capture_count;
+        if (count > 0) {
+            uint32_t head = context->capture_head;
+            pthread_mutex_unlock(&context->capture_mutex);
+            if (context->capture_file) {
+                for (uint32_t i = 0; i < count; i++) {
+                    const struct capture_slot *slot = &context->capture_ring[(head + i) % C64U_CAPTURE_RING_SLOTS];
+                    write_capture_record(context, slot, start_time);
+                }
+                uint64_t now = os_gettime_ns();
+                if (now - last_flush >= CAPTURE_FLUSH_INTERVAL_NS) {
+                    fflush(context->capture_file);
+                    last_flush = now;
+                }
+            }
+            pthread_mutex_lock(&context->capture_mutex);
+
+            context->capture_head = (head + count) % C64U_CAPTURE_RING_SLOTS;
+            context->capture_count -= count;
+            continue;
+        }
+
+        // Queue is drained - finish the file if capturing was switched off
+        if ((!context->capture_stream || context->capture_shutdown) && context->capture_file) {
+            uint32_t pending_gap = context->capture_pending_gap;
+            context->capture_pending_gap = 0;
+            pthread_mutex_unlock(&context->capture_mutex);
+            close_capture_file(context, pending_gap, start_time);
+            pthread_mutex_lock(&context->capture_mutex);
+            continue;
+        }
+
+        if (context->capture_shutdown) {
+            break;
+        }
+
+        struct timespec deadline = capture_deadline(CAPTURE_WRITER_INTERVAL_MS);
+        pthread_cond_timedwait(&context->capture_cond, &context->capture_mutex, &deadline);
+    }
+    pthread_mutex_unlock(&context->capture_mutex);
+
+    C64U_LOG_DEBUG("Stream capture writer thread stopped");
+    return NULL;
+}
+
+// Allocate the capture ring and start the writer thread on first use
+static void start_capture_writer(struct c64u_source *context)
+{
+    if (context->capture_thread_active) {
+        return;
+    }
+
+    context->capture_ring = bzalloc(sizeof(struct capture_slot) * C64U_CAPTURE_RING_SLOTS);
+    if (!context->capture_ring) {
+        C64U_LOG_ERROR("Failed to allocate stream capture queue");
+        return;
+    }
+
+    if (pthread_create(&context->capture_thread, NULL, capture_thread_func, context) != 0) {
+        C64U_LOG_ERROR("Failed to create stream capture writer thread");
+        bfree(context->capture_ring);
+        context->capture_ring = NULL;
+        return;
+    }
+    context->capture_thread_active = true;
+}
+
+size_t c64u_capture_memory(const struct c64u_source *context)
+{
+    return context->capture_ring ? sizeof(struct capture_slot) * C64U_CAPTURE_RING_SLOTS : 0;
+}
+
+size_t c64u_replay_buffer_memory(const struct c64u_source *context)
+{
+    return sizeof(struct capture_slot) * context->replay_buffer_slots;
+}
+
+// Queue one slot; called with capture_mutex held and at least one free slot
+static void queue_capture_slot(struct c64u_source *context, uint8_t stream_id, const uint8_t *data, size_t size,
+                               uint64_t receive_time)
+{
+    uint32_t tail = (context->capture_head + context->capture_count) % C64U_CAPTURE_RING_SLOTS;
+    struct capture_slot *slot = &context->capture_ring[tail];
+    slot->receive_time = receive_time;
+    slot->stream_id = stream_id;
+    slot->size = (uint16_t)size;
+    memcpy(slot->data, data, size);
+    context->capture_count++;
+}
+
+// Instant replay buffer: overwrite the oldest datagram once the ring is full; called with capture_mutex held
+static void replay_buffer_packet(struct c64u_source *context, uint8_t stream_id, const uint8_t *data, size_t size,
+                                 uint64_t receive_time)
+{
+    if (context->replay_buffer_next - context->replay_buffer_first == context->replay_buffer_slots) {
+        context->replay_buffer_first++;
+    }
+    struct capture_slot *slot =
+        &context->replay_buffer_ring[context->replay_buffer_next % context->replay_buffer_slots];
+    slot->receive_time = receive_time;
+    slot->stream_id = stream_id;
+    slot->size = (uint16_t)size;
+    memcpy(slot->data, data, size);
+    context->replay_buffer_next++;
+}
+
+void capture_packet(struct c64u_source *context, uint8_t stream_id, const uint8_t *data, size_t size,
+                    uint64_t receive_time)
+{
+    if ((!context->capture_stream && !context->replay_buffer) || size == 0 || size > C64U_CAPTURE_MAX_PAYLOAD) {
+        return;
+    }
+
+    if (pthread_mutex_lock(&context->capture_mutex) != 0) {
+        return;
+    }
+
+    if (context->replay_buffer_ring) {
+        replay_buffer_packet(context, stream_id, data, size, receive_time);
+    }
+
+    if (!context->capture_stream || !context->capture_ring) {
+        pthread_mutex_unlock(&context->capture_mutex);
+        return;
+    }
+
+    // Never stall reception: if the writer fell behind, drop and remember the gap for the file
+    uint32_t needed = context->capture_pending_gap > 0 ? 2 : 1;
+    if (context->capture_count + needed > C64U_CAPTURE_RING_SLOTS) {
+        context->capture_pending_gap++;
+        context->capture_dropped++;
+        pthread_mutex_unlock(&context->capture_mutex);
+        return;
+    }
+
+    if (context->capture_pending_gap > 0) {
+        uint32_t gap = context->capture_pending_gap;
+        queue_capture_slot(context, C64U_CAPTURE_STREAM_GAP, (const uint8_t *)&gap, sizeof(gap), receive_time);
+        context->capture_pending_gap = 0;
+    }
+    queue_capture_slot(context, stream_id, data, size, receive_time);
+
+    if (context->capture_count == CAPTURE_WAKEUP_THRESHOLD) {
+        pthread_cond_signal(&context->capture_cond);
+    }
+    pthread_mutex_unlock(&context->capture_mutex);
+}
+
+// Wait until no instant replay save is running. Returns with capture_mutex held.
+static void lock_replay_buffer_idle(struct c64u_source *context)
+{
+    pthread_mutex_lock(&context->capture_mutex);
+    while (context->replay_buffer_save_thread_active) {
+        pthread_t thread = context->replay_buffer_save_thread;
+        context->replay_buffer_save_thread_active = false;
+        pthread_mutex_unlock(&context->capture_mutex);
+        pthread_join(thread, NULL);
+        pthread_mutex_lock(&context->capture_mutex);
+    }
+}
+
+// Instant replay save thread: writes the datagrams that were buffered when the save was triggered while the
+// receive threads keep filling the ring. Datagrams overwritten before the saver got to them become a gap record.
+static void *replay_save_thread_func(void *data)
+{
+    struct c64u_source *context = data;
+    uint64_t start_time = context->replay_buffer_save_start_time;
+    uint64_t last_time = start_time;
+    uint32_t records = 0;
+    uint32_t lost = 0;
+    uint64_t bytes = C64U_CAPTURE_HEADER_SIZE;
+    bool write_failed = false;
+
+    FILE *file = fopen(context->replay_buffer_filename, "wb");
+    struct capture_slot *batch = NULL;
+    if (file) {
+        setvbuf(file, NULL, _IOFBF, 256 * 1024);
+        write_capture_header(context, file, start_time, context->replay_buffer_save_unix_ms);
+        batch = bmalloc(sizeof(struct capture_slot) * REPLAY_SAVE_BATCH);
+    } else {
+        C64U_LOG_ERROR("Failed to create instant replay file: %s", context->replay_buffer_filename);
+    }
+
+    pthread_mutex_lock(&context->capture_mutex);
+    while (file && context->replay_buffer_save_next < context->replay_buffer_save_end) {
+        uint64_t next = context->replay_buffer_save_next;
+        uint64_t end = context->replay_buffer_save_end;
+        uint32_t gap = 0;
+        if (next < context->replay_buffer_first) {
+            uint64_t resume = context->replay_buffer_first < end ? context->replay_buffer_first : end;
+            gap = (uint32_t)(resume - next);
+            next = resume;
+        }
+        uint32_t count = end - next < REPLAY_SAVE_BATCH ? (uint32_t)(end - next) : REPLAY_SAVE_BATCH;
+        for (uint32_t i = 0; i < count; i++) {
+            batch[i] = context->replay_buffer_ring[(next + i) % context->replay_buffer_slots];
+        }
+        context->replay_buffer_save_next = next + count;
+        pthread_mutex_unlock(&context->capture_mutex);
+
+        if (gap > 0) {
+            struct capture_slot gap_slot = {
+                .receive_time = last_time, .size = sizeof(gap), .stream_id = C64U_CAPTURE_STREAM_GAP};
+            memcpy(gap_slot.data, &gap, sizeof(gap));
+            write_failed |= !write_record(file, &gap_slot, start_time);
+            records++;
+            lost += gap;
+            bytes += C64U_CAPTURE_RECORD_HEADER_SIZE + sizeof(gap);
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            write_failed |= !write_record(file, &batch[i], start_time);
+            last_time = batch[i].receive_time > last_time ? batch[i].receive_time : last_time;
+            records++;
+            bytes += C64U_CAPTURE_RECORD_HEADER_SIZE + batch[i].size;
+        }
+
+        pthread_mutex_lock(&context->capture_mutex);
+    }
+    context->replay_buffer_saving = false;
+    pthread_mutex_unlock(&context->capture_mutex);
+
+    if (file) {
+        finalize_capture_header(context, file, records, lost);
+        write_failed |= fclose(file) != 0;
+        if (write_failed) {
+            C64U_LOG_ERROR("Failed to write instant replay file: %s", context->replay_buffer_filename);
+        } else {
+            C64U_LOG_INFO("Instant replay saved: %s (%.1f s, %u records, %.1f MB, %u datagrams lost)",
+                          context->replay_buffer_filename, (last_time - start_time) / 1000000000.0, records,
+                          bytes / (1024.0 * 1024.0), lost);
+        }
+    }
+    bfree(batch);
+    return NULL;
+}
+
+// First buffered sequence number received within the last replay_buffer_seconds of the newest datagram, so a
+// ring sized for the NTSC peak rate doesn't save more than the configured time. Called with capture_mutex held.
+static uint64_t replay_buffer_window_start(struct c64u_source *context)
+{
+    const struct capture_slot *ring = context->replay_buffer_ring;
+    uint32_t slots = context->replay_buffer_slots;
+    uint64_t newest = ring[(context->replay_buffer_next - 1) % slots].receive_time;
+    uint64_t window = (uint64_t)context->replay_buffer_seconds * 1000000000ULL;
+    if (newest <= window) {
+        return context->replay_buffer_first;
+    }
+
+    // Receive times grow along the ring (up to the few microseconds between recv() and taking the lock)
+    uint64_t low = context->replay_buffer_first;
+    uint64_t high = context->replay_buffer_next - 1;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (ring[mid % slots].receive_time < newest - window) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+bool c64u_capture_save_replay(struct c64u_source *context, char *path, size_t path_size)
+{
+    if (path && path_size > 0) {
+        path[0] = '\0';
+    }
+    if (!context->replay_buffer) {
+        C64U_LOG_WARNING("Instant replay buffer is not enabled");
+        return false;
+    }
+
+    // Snapshot the output folder; it may be changed concurrently from the settings thread
+    char save_folder[sizeof(context->save_folder)];
+    pthread_mutex_lock(&context->recording_mutex);
+    memcpy(save_folder, context->save_folder, sizeof(save_folder));
+    pthread_mutex_unlock(&context->recording_mutex);
+
+    if (!create_directory_recursive(save_folder)) {
+        C64U_LOG_ERROR("Failed to create instant replay folder: %s", save_folder);
+        return false;
+    }
+
+    char filename[sizeof(context->replay_buffer_filename)];
+    time_t rawtime = time(NULL);
+    struct tm *timeinfo = localtime(&rawtime);
+    snprintf(filename, sizeof(filename), "%s/replay_%04d%02d%02d_%02d%02d%02d.c64s", save_folder,
+             timeinfo->tm_year + 1900, timeinfo->tm_mon + 1, timeinfo->tm_mday, timeinfo->tm_hour, timeinfo->tm_min,
+             timeinfo->tm_sec);
+
+    pthread_mutex_lock(&context->capture_mutex);
+    if (!context->replay_buffer_ring || context->replay_buffer_saving ||
+        context->replay_buffer_next == context->replay_buffer_first) {
+        bool saving = context->replay_buffer_saving;
+        pthread_mutex_unlock(&context->capture_mutex);
+        C64U_LOG_WARNING("%s", saving ? "Instant replay is still being saved" : "Instant replay buffer is empty");
+        return false;
+    }
+
+    // The previous save has finished (it clears replay_buffer_saving last); reap its thread after unlocking
+    bool join_previous = context->replay_buffer_save_thread_active;
+    pthread_t previous = context->replay_buffer_save_thread;
+
+    uint64_t now = os_gettime_ns();
+    context->replay_buffer_save_next = replay_buffer_window_start(context);
+    context->replay_buffer_save_end = context->replay_buffer_next;
+    context->replay_buffer_save_start_time =
+        context->replay_buffer_ring[context->replay_buffer_save_next % context->replay_buffer_slots].receive_time;
+    uint64_t age_ms = now > context->replay_buffer_save_start_time
+                          ? (now - context->replay_buffer_save_start_time) / 1000000
+                          : 0;
+    context->replay_buffer_save_unix_ms = (uint64_t)rawtime * 1000 - age_ms;
+    memcpy(context->replay_buffer_filename, filename, sizeof(filename));
+
+    // Created under the lock, so a settings change can't free the ring between the check above and the start
+    context->replay_buffer_saving =
+        pthread_create(&context->replay_buffer_save_thread, NULL, replay_save_thread_func, context) == 0;
+    context->replay_buffer_save_thread_active = context->replay_buffer_saving;
+    bool started = context->replay_buffer_saving;
+    pthread_mutex_unlock(&context->capture_mutex);
+
+    if (join_previous) {
+        pthread_join(previous, NULL);
+    }
+    if (!started) {
+        C64U_LOG_ERROR("Failed to create instant replay save thread");
+        return false;
+    }
+
+    C64U_LOG_INFO("Saving instant replay: %s", filename);
+    if (path && path_size > 0) {
+        snprintf(path, path_size, "%s", filename);
+    }
+    return true;
+}
+
+// Enable, disable or resize the instant replay buffer (waits for a running save)
+static void set_replay_buffer(struct c64u_source *context, bool enabled, uint32_t seconds)
+{
+    uint32_t slots = enabled ? seconds * C64U_REPLAY_BUFFER_SLOTS_PER_SECOND : 0;
+
+    // Untouched pages cost nothing, so the ring only takes memory as it fills up
+    struct capture_slot *ring = slots > 0 ? bmalloc(sizeof(struct capture_slot) * slots) : NULL;
+    if (slots > 0 && !ring) {
+        C64U_LOG_ERROR("Failed to allocate %u s instant replay buffer", seconds);
+        slots = 0;
+    }
+
+    lock_replay_buffer_idle(context);
+    struct capture_slot *old_ring = context->replay_buffer_ring;
+    context->replay_buffer_ring = ring;
+    context->replay_buffer_slots = slots;
+    context->replay_buffer_first = 0;
+    context->replay_buffer_next = 0;
+    context->replay_buffer = ring != NULL;
+    context->replay_buffer_seconds = seconds;
+    pthread_mutex_unlock(&context->capture_mutex);
+
+    bfree(old_ring);
+    if (ring) {
+        C64U_LOG_INFO("Instant replay buffer on: last %u s (up to %.0f MB)", seconds,
+                      sizeof(struct capture_slot) * (double)slots / (1024.0 * 1024.0));
+    } else {
+        C64U_LOG_INFO("Instant replay buffer off");
+    }
+}
+
+void c64u_capture_init(struct c64u_source *context)
+{
+    context->capture_stream = false;
+    context->capture_file = NULL;
+    context->capture_filename[0] = '\0';
+    context->capture_thread_active = false;
+    context->capture_shutdown = false;
+    context->capture_ring = NULL;
+    context->capture_head = 0;
+    context->capture_count = 0;
+    context->capture_pending_gap = 0;
+    context->capture_dropped = 0;
+    context->capture_records = 0;
+    context->capture_file_dropped = 0;
+    context->capture_bytes = 0;
+    context->capture_start_time = 0;
+    context->replay_buffer = false;
+    context->replay_buffer_seconds = 0;
+    context->replay_buffer_ring = NULL;
+    context->replay_buffer_slots = 0;
+    context->replay_buffer_first = 0;
+    context->replay_buffer_next = 0;
+    context->replay_buffer_save_thread_active = false;
+    context->replay_buffer_saving = false;
+    context->replay_buffer_filename[0] = '\0';
+
+    if (pthread_mutex_init(&context->capture_mutex, NULL) != 0) {
+        C64U_LOG_ERROR("Failed to initialize capture mutex");
+    }
+    pthread_cond_init(&context->capture_cond, NULL);
+}
+
+void c64u_capture_cleanup(struct c64u_source *context)
+{
+    // Let the writer drain its queue, finalize the file and exit
+    if (context->capture_thread_active) {
+        pthread_mutex_lock(&context->capture_mutex);
+        context->capture_shutdown = true;
+        pthread_cond_signal(&context->capture_cond);
+        pthread_mutex_unlock(&context->capture_mutex);
+
+        pthread_join(context->capture_thread, NULL);
+        context->capture_thread_active = false;
+    }
+
+    bfree(context->capture_ring);
+    context->capture_ring = NULL;
+
+    // Let a running instant replay save finish
+    lock_replay_buffer_idle(context);
+    pthread_mutex_unlock(&context->capture_mutex);
+    bfree(context->replay_buffer_ring);
+    context->replay_buffer_ring = NULL;
+
+    pthread_cond_destroy(&context->capture_cond);
+    pthread_mutex_destroy(&context->capture_mutex);
+}
+
+void c64u_capture_update_settings(struct c64u_source *context, void *settings_ptr)
+{
+    obs_data_t *settings = (obs_data_t *)settings_ptr;
+    bool new_capture_stream = obs_data_get_bool(settings, "capture_stream");
+
+    if (new_capture_stream && !context->capture_thread_active) {
+        start_capture_writer(context);
+    }
+
+    pthread_mutex_lock(&context->capture_mutex);
+    if (new_capture_stream != context->capture_stream) {
+        if (new_capture_stream) {
+            // Timestamps of all records queued from now on are relative to this point
+            context->capture_start_time = os_gettime_ns();
+            context->capture_dropped = 0;
+            context->capture_pending_gap = 0;
+        }
+        context->capture_stream = new_capture_stream;
+        C64U_LOG_INFO("Raw stream capture %s", new_capture_stream ? "started" : "stopping");
+    }
+    pthread_cond_signal(&context->capture_cond);
+    pthread_mutex_unlock(&context->capture_mutex);
+
+    bool new_replay_buffer = obs_data_get_bool(settings, "replay_buffer");
+    uint32_t new_replay_seconds = (uint32_t)obs_data_get_int(settings, "replay_buffer_seconds");
+    if (new_replay_seconds == 0) {
+        new_replay_seconds = C64U_REPLAY_BUFFER_DEFAULT_SECONDS;
+    } else if (new_replay_seconds > C64U_REPLAY_BUFFER_MAX_SECONDS) {
+        new_replay_seconds = C64U_REPLAY_BUFFER_MAX_SECONDS;
+    }
+    if (new_replay_buffer != context->replay_buffer ||
+        (new_replay_buffer && new_replay_seconds != context->replay_buffer_seconds)) {
+        set_replay_buffer(context, new_replay_buffer, new_replay_seconds);
+    }
+}
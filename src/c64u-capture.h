@@ -0,0 +1,53 @@
+#ifndef C64U_CAPTURE_H
+#define C64U_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "c64u-protocol.h"
+
+// Raw stream capture file (.c64s) - see doc/capture-file-format.md
+#define C64U_CAPTURE_MAGIC "C64S"
+#define C64U_CAPTURE_VERSION 1
+#define C64U_CAPTURE_HEADER_SIZE 176                    // Session header at the start of the file
+#define C64U_CAPTURE_RECORD_HEADER_SIZE 12              // Per-datagram record header
+#define C64U_CAPTURE_MAX_PAYLOAD C64U_VIDEO_PACKET_SIZE // Largest datagram
+
+// Record stream IDs (match the C64U stream IDs used in control commands)
+#define C64U_CAPTURE_STREAM_VIDEO 0
+#define C64U_CAPTURE_STREAM_AUDIO 1
+#define C64U_CAPTURE_STREAM_GAP 0xFF // Payload: uint32 number of datagrams lost because the capture queue was full
+
+// Capture queue sizing - about 1.1s of combined video and audio datagrams (3.2MB)
+#define C64U_CAPTURE_RING_SLOTS 4096
+
+// Instant replay buffer: the last N seconds of datagrams kept in memory and saved as a .c64s on demand.
+// NTSC peaks at about 3850 datagrams/s (60 video packets per frame plus 250 audio packets), so one second
+// needs about 3 MB.
+#define C64U_REPLAY_BUFFER_SLOTS_PER_SECOND 3900
+#define C64U_REPLAY_BUFFER_DEFAULT_SECONDS 30
+#define C64U_REPLAY_BUFFER_MAX_SECONDS 300
+
+// Forward declarations
+struct c64u_source;
+
+// Producer side, called from the receive threads right after recv() - never touches disk
+void capture_packet(struct c64u_source *context, uint8_t stream_id, const uint8_t *data, size_t size,
+                    uint64_t receive_time);
+
+// Capture initialization and cleanup functions
+void c64u_capture_init(struct c64u_source *context);
+void c64u_capture_cleanup(struct c64u_source *context);
+void c64u_capture_update_settings(struct c64u_source *context, void *settings);
+
+// Bytes held by the capture ring (while capturing) and the instant replay ring (its full size; pages are only
+// committed as it fills)
+size_t c64u_capture_memory(const struct c64u_source *context);
+size_t c64u_replay_buffer_memory(const struct c64u_source *context);
+
+// Save the instant replay buffer to replay_YYYYMMDD_HHMMSS.c64s in the output folder. Returns immediately; the
+// file is written by a background thread while buffering continues. The file name is stored in path (may be
+// NULL). Returns false if the buffer is off or empty, or a save is still running.
+bool c64u_capture_save_replay(struct c64u_source *context, char *path, size_t path_size);
+
+#endif // C64U_CAPTURE_H
@@ -0,0 +1,893 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L // clock_gettime() with CLOCK_THREAD_CPUTIME_ID
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "c64u-core.h"
+
+// VIC-II color palette (16 colors) in RGBA format
+const uint32_t vic_colors[16] = {
+    0xFF000000, // 0: Black
+    0xFFEFEFEF, // 1: White
+    0xFF342F8D, // 2: Red
+    0xFFCDD46A, // 3: Cyan
+    0xFFA43598, // 4: Purple/Magenta
+    0xFF42B44C, // 5: Green
+    0xFFB1292C, // 6: Blue
+    0xFF5DEFEF, // 7: Yellow
+    0xFF204E98, // 8: Orange
+    0xFF00385B, // 9: Brown
+    0xFF6D67D1, // 10: Light Red
+    0xFF4A4A4A, // 11: Dark Grey
+    0xFF7B7B7B, // 12: Mid Grey
+    0xFF93EF9F, // 13: Light Green
+    0xFFEF6A6D, // 14: Light Blue
+    0xFFB2B2B2  // 15: Light Grey
+};
+
+static c64u_core_log_handler log_handler;
+
+void c64u_core_set_log_handler(c64u_core_log_handler handler)
+{
+    log_handler = handler;
+}
+
+void c64u_core_log(int level, const char *format, ...)
+{
+    if (!log_handler) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    log_handler(level, format, args);
+    va_end(args);
+}
+
+static uint16_t read_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void init_frame_assembly(struct frame_assembly *frame, uint16_t frame_num, uint64_t time)
+{
+    memset(frame, 0, sizeof(struct frame_assembly));
+    frame->frame_num = frame_num;
+    frame->start_time = time;
+}
+
+void c64u_core_init(struct c64u_core *core, const struct c64u_core_callbacks *callbacks)
+{
+    memset(core, 0, sizeof(struct c64u_core));
+    if (callbacks) {
+        core->callbacks = *callbacks;
+    }
+    core->expected_fps = 50.125; // Default to PAL timing until detected
+}
+
+void c64u_core_reset(struct c64u_core *core)
+{
+    memset(&core->current_frame, 0, sizeof(core->current_frame));
+    core->last_completed_frame = 0;
+    core->have_completed_frame = false;
+    core->have_retired_frame = false;
+    core->last_capture_time = 0;
+    core->have_video_seq = false;
+    core->have_audio_seq = false;
+}
+
+bool c64u_core_parse_video_header(const uint8_t *packet, size_t size, struct c64u_video_header *header)
+{
+    if (size != C64U_VIDEO_PACKET_SIZE) {
+        return false;
+    }
+
+    // Little endian fields, like the rest of the C64U protocol
+    uint16_t line = read_u16(packet + 4);
+    header->seq_num = read_u16(packet + 0);
+    header->frame_num = read_u16(packet + 2);
+    header->line_num = line & 0x7FFF;
+    header->last_packet = (line & 0x8000) != 0;
+    header->pixels_per_line = read_u16(packet + 6);
+    header->lines_per_packet = packet[8];
+    header->bits_per_pixel = packet[9];
+    header->encoding = read_u16(packet + 10);
+    return true;
+}
+
+bool c64u_core_parse_audio_packet(const uint8_t *packet, size_t size, uint16_t *seq_num, const uint8_t **samples,
+                                  uint32_t *count)
+{
+    if (size != C64U_AUDIO_PACKET_SIZE) {
+        return false;
+    }
+    *seq_num = read_u16(packet);
+    *samples = packet + C64U_AUDIO_HEADER_SIZE;
+    *count = (C64U_AUDIO_PACKET_SIZE - C64U_AUDIO_HEADER_SIZE) / 4; // 16-bit stereo
+    return true;
+}
+
+bool c64u_core_frame_complete(const struct frame_assembly *frame)
+{
+    return frame->received_packets > 0 && frame->received_packets == frame->expected_packets;
+}
+
+void c64u_core_line_to_rgba(const uint8_t *src, uint32_t *dst, uint32_t pixels)
+{
+    // Convert 4-bit VIC colors to 32-bit RGBA
+    for (uint32_t x = 0; x < pixels / 2; x++) {
+        uint8_t pixel_pair = src[x];
+        dst[x * 2] = vic_colors[pixel_pair & 0x0F];
+        dst[x * 2 + 1] = vic_colors[pixel_pair >> 4];
+    }
+}
+
+void c64u_core_line_to_bgr24(const uint8_t *src, uint8_t *dst, uint32_t pixels)
+{
+    for (uint32_t x = 0; x < pixels / 2; x++) {
+        uint8_t pixel_pair = src[x];
+        uint32_t color1 = vic_colors[pixel_pair & 0x0F];
+        uint32_t color2 = vic_colors[pixel_pair >> 4];
+
+        // vic_colors is 0xAABBGGRR (little endian RGBA); BGR24 wants B, G, R
+        *dst++ = (color1 >> 16) & 0xFF;
+        *dst++ = (color1 >> 8) & 0xFF;
+        *dst++ = color1 & 0xFF;
+        *dst++ = (color2 >> 16) & 0xFF;
+        *dst++ = (color2 >> 8) & 0xFF;
+        *dst++ = color2 & 0xFF;
+    }
+}
+
+void c64u_core_frame_to_rgba(const struct frame_assembly *frame, uint32_t *dst, uint32_t height)
+{
+    for (int i = 0; i < C64U_MAX_PACKETS_PER_FRAME; i++) {
+        const struct frame_packet *packet = &frame->packets[i];
+        if (!packet->received)
+            continue;
+
+        for (uint32_t line = 0; line < packet->lines_per_packet && packet->line_num + line < height; line++) {
+            c64u_core_line_to_rgba(packet->packet_data + line * C64U_BYTES_PER_LINE,
+                                   dst + (size_t)(packet->line_num + line) * C64U_PIXELS_PER_LINE,
+                                   C64U_PIXELS_PER_LINE);
+        }
+    }
+}
+
+void c64u_core_frame_to_indexed(const struct frame_assembly *frame, uint8_t *dst, uint32_t height)
+{
+    // Copy packed 4-bit VIC indices line by line; lines of missing packets stay black (index 0)
+    memset(dst, 0, (size_t)height * C64U_BYTES_PER_LINE);
+
+    for (int i = 0; i < C64U_MAX_PACKETS_PER_FRAME; i++) {
+        const struct frame_packet *packet = &frame->packets[i];
+        if (!packet->received || packet->line_num >= height)
+            continue;
+
+        uint32_t lines = packet->lines_per_packet;
+        if (packet->line_num + lines > height)
+            lines = height - packet->line_num;
+
+        memcpy(dst + (size_t)packet->line_num * C64U_BYTES_PER_LINE, packet->packet_data,
+               (size_t)lines * C64U_BYTES_PER_LINE);
+    }
+}
+
+#define DELAY_SLOT_PIXELS ((size_t)C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT) // Largest frame (PAL)
+
+size_t c64u_delay_queue_bytes(uint32_t capacity)
+{
+    return (DELAY_SLOT_PIXELS * sizeof(uint32_t) + sizeof(uint16_t)) * capacity;
+}
+
+bool c64u_delay_queue_alloc(struct c64u_delay_queue *queue, uint32_t capacity)
+{
+    c64u_delay_queue_free(queue);
+    queue->frames = malloc(DELAY_SLOT_PIXELS * sizeof(uint32_t) * capacity);
+    queue->sequences = malloc(sizeof(uint16_t) * capacity);
+    if (!queue->frames || !queue->sequences) {
+        c64u_delay_queue_free(queue);
+        return false;
+    }
+    queue->capacity = capacity;
+    return true;
+}
+
+void c64u_delay_queue_free(struct c64u_delay_queue *queue)
+{
+    free(queue->frames);
+    free(queue->sequences);
+    memset(queue, 0, sizeof(struct c64u_delay_queue));
+}
+
+void c64u_delay_queue_clear(struct c64u_delay_queue *queue)
+{
+    queue->size = 0;
+    queue->head = 0;
+    queue->tail = 0;
+}
+
+void c64u_delay_queue_push(struct c64u_delay_queue *queue, const struct frame_assembly *frame, uint32_t height,
+                           uint16_t seq_num)
+{
+    // If queue is full, remove oldest frame
+    if (queue->size >= queue->capacity) {
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->size--;
+    }
+
+    // Clear the tail slot first (lines of missing packets stay black), then assemble the frame into it
+    uint32_t *slot = queue->frames + queue->tail * DELAY_SLOT_PIXELS;
+    if (height > C64U_PAL_HEIGHT) {
+        height = C64U_PAL_HEIGHT;
+    }
+    memset(slot, 0, (size_t)height * C64U_PIXELS_PER_LINE * sizeof(uint32_t));
+    c64u_core_frame_to_rgba(frame, slot, height);
+
+    queue->sequences[queue->tail] = seq_num;
+    queue->tail = (queue->tail + 1) % queue->capacity;
+    queue->size++;
+}
+
+bool c64u_delay_queue_pop(struct c64u_delay_queue *queue, uint32_t delay, uint32_t *dst, size_t pixels)
+{
+    // Check if we have enough frames in queue to satisfy delay
+    if (queue->size == 0 || queue->size < delay) {
+        return false;
+    }
+
+    if (pixels > DELAY_SLOT_PIXELS) {
+        pixels = DELAY_SLOT_PIXELS;
+    }
+    memcpy(dst, queue->frames + queue->head * DELAY_SLOT_PIXELS, pixels * sizeof(uint32_t));
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->size--;
+    return true;
+}
+
+void c64u_frame_output_init(struct c64u_frame_output *output, const struct c64u_frame_output_callbacks *callbacks,
+                            uint32_t *front, uint32_t *back)
+{
+    memset(output, 0, sizeof(struct c64u_frame_output));
+    if (callbacks) {
+        output->callbacks = *callbacks;
+    }
+    output->front = front;
+    output->back = back;
+}
+
+void c64u_frame_output_free(struct c64u_frame_output *output)
+{
+    c64u_delay_queue_free(&output->queue);
+}
+
+// Make the back buffer the front one (buffers locked)
+static void frame_output_swap(struct c64u_frame_output *output, uint64_t time)
+{
+    uint32_t *temp = output->front;
+    output->front = output->back;
+    output->back = temp;
+    if (output->callbacks.swapped) {
+        output->callbacks.swapped(output->callbacks.user, time);
+    }
+}
+
+static bool frame_output_lock(bool (*lock)(void *user), void *user)
+{
+    return !lock || lock(user);
+}
+
+static void frame_output_unlock(void (*unlock)(void *user), void *user)
+{
+    if (unlock) {
+        unlock(user);
+    }
+}
+
+bool c64u_frame_output_deliver(struct c64u_frame_output *output, const struct frame_assembly *frame,
+                               uint16_t seq_num, uint64_t time, uint32_t height)
+{
+    const struct c64u_frame_output_callbacks *cb = &output->callbacks;
+    if (height > C64U_PAL_HEIGHT) {
+        height = C64U_PAL_HEIGHT;
+    }
+
+    // No delay: convert straight into the back buffer
+    if (output->delay == 0) {
+        if (!frame_output_lock(cb->lock_buffers, cb->user)) {
+            return false;
+        }
+        c64u_core_frame_to_rgba(frame, output->back, height);
+        frame_output_swap(output, time);
+        frame_output_unlock(cb->unlock_buffers, cb->user);
+        return true;
+    }
+
+    if (!frame_output_lock(cb->lock_queue, cb->user)) {
+        return false;
+    }
+
+    // Each frame is popped right after it was pushed, so the queue never holds more than the delay
+    if (!output->queue.frames && !c64u_delay_queue_alloc(&output->queue, output->delay)) {
+        c64u_core_log(C64U_CORE_LOG_ERROR, "❌ DELAY QUEUE: Failed to allocate %u frames, dropping frame %u",
+                      output->delay, frame->frame_num);
+        frame_output_unlock(cb->unlock_queue, cb->user);
+        return false;
+    }
+    c64u_delay_queue_push(&output->queue, frame, height, seq_num);
+
+    // Release the oldest frame once the queue holds the delay (or is full at a smaller capacity)
+    uint32_t delay = output->delay < output->queue.capacity ? output->delay : output->queue.capacity;
+    bool swapped = false;
+    if (output->queue.size >= delay && frame_output_lock(cb->lock_buffers, cb->user)) {
+        swapped = c64u_delay_queue_pop(&output->queue, delay, output->back, (size_t)C64U_PIXELS_PER_LINE * height);
+        if (swapped) {
+            frame_output_swap(output, time);
+        }
+        frame_output_unlock(cb->unlock_buffers, cb->user);
+    }
+
+    frame_output_unlock(cb->unlock_queue, cb->user);
+    return swapped;
+}
+
+static uint16_t stamp_check(uint32_t counter, uint64_t send_time)
+{
+    uint64_t x = send_time ^ ((uint64_t)counter << 16) ^ counter;
+    return (uint16_t)(x ^ (x >> 16) ^ (x >> 32) ^ (x >> 48) ^ 0x5A5A);
+}
+
+static void stamp_encode_line(uint8_t *line, uint64_t bits)
+{
+    for (uint32_t cell = 0; cell < 64; cell++) {
+        uint8_t value = (bits >> (63 - cell)) & 1 ? 0x11 : 0x00; // White (1) or black (0) pixel pairs
+        memset(line + cell * C64U_STAMP_CELL_PIXELS / 2, value, C64U_STAMP_CELL_PIXELS / 2);
+    }
+}
+
+void c64u_stamp_encode(uint8_t *lines, uint32_t counter, uint64_t send_time)
+{
+    uint64_t header = ((uint64_t)C64U_STAMP_MAGIC << 48) | ((uint64_t)counter << 16) | stamp_check(counter, send_time);
+    stamp_encode_line(lines, header);
+    stamp_encode_line(lines + C64U_BYTES_PER_LINE, send_time);
+}
+
+// Sample the middle of each cell; bright pixels are ones, whatever the channel order
+static uint64_t stamp_decode_line(const uint32_t *line)
+{
+    uint64_t bits = 0;
+    for (uint32_t cell = 0; cell < 64; cell++) {
+        uint32_t pixel = line[cell * C64U_STAMP_CELL_PIXELS + C64U_STAMP_CELL_PIXELS / 2];
+        uint32_t brightness = (pixel & 0xFF) + ((pixel >> 8) & 0xFF) + ((pixel >> 16) & 0xFF);
+        bits = (bits << 1) | (brightness > 3 * 128 ? 1 : 0);
+    }
+    return bits;
+}
+
+bool c64u_stamp_decode(const uint32_t *rgba, uint32_t *counter, uint64_t *send_time)
+{
+    uint64_t header = stamp_decode_line(rgba);
+    if ((header >> 48) != C64U_STAMP_MAGIC) {
+        return false;
+    }
+    uint64_t time = stamp_decode_line(rgba + C64U_PIXELS_PER_LINE);
+    uint32_t count = (uint32_t)(header >> 16);
+    if ((uint16_t)header != stamp_check(count, time)) {
+        return false;
+    }
+    *counter = count;
+    *send_time = time;
+    return true;
+}
+
+void c64u_latency_reset(struct c64u_latency *latency)
+{
+    memset(latency, 0, sizeof(struct c64u_latency));
+}
+
+void c64u_latency_add(struct c64u_latency *latency, uint64_t ns)
+{
+    uint64_t bucket = ns / C64U_LATENCY_BUCKET_NS;
+    latency->buckets[bucket < C64U_LATENCY_BUCKETS ? bucket : C64U_LATENCY_BUCKETS - 1]++;
+    if (latency->count == 0 || ns < latency->min_ns) {
+        latency->min_ns = ns;
+    }
+    if (ns > latency->max_ns) {
+        latency->max_ns = ns;
+    }
+    latency->sum_ns += ns;
+    latency->count++;
+}
+
+uint64_t c64u_latency_percentile(const struct c64u_latency *latency, double p)
+{
+    if (latency->count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(p / 100.0 * latency->count + 0.5);
+    rank = rank < 1 ? 1 : rank;
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < C64U_LATENCY_BUCKETS; b++) {
+        seen += latency->buckets[b];
+        if (seen >= rank && b < C64U_LATENCY_BUCKETS - 1) {
+            // Upper edge of the bucket, but never beyond what was actually measured
+            uint64_t edge = (b + 1) * C64U_LATENCY_BUCKET_NS;
+            return edge < latency->max_ns ? edge : latency->max_ns;
+        }
+    }
+    return latency->max_ns;
+}
+
+void c64u_pattern_encode(uint8_t *lines, uint32_t counter)
+{
+    // Ten colors from red on, one per digit of tools/c64/digit-cycle
+    uint8_t color = (uint8_t)(2 + counter % 10);
+    memset(lines, color | (color << 4), (C64U_LINES_PER_PACKET - 1) * C64U_BYTES_PER_LINE);
+    uint64_t marker = ((uint64_t)C64U_PATTERN_MAGIC << 48) | ((uint64_t)counter << 16) |
+                      stamp_check(counter, C64U_PATTERN_MAGIC);
+    stamp_encode_line(lines + (C64U_LINES_PER_PACKET - 1) * C64U_BYTES_PER_LINE, marker);
+}
+
+static bool pattern_decode_band(const uint32_t *rgba, uint32_t band, uint32_t *counter)
+{
+    uint32_t line = band * C64U_LINES_PER_PACKET + C64U_LINES_PER_PACKET - 1;
+    uint64_t marker = stamp_decode_line(rgba + (size_t)line * C64U_PIXELS_PER_LINE);
+    uint32_t count = (uint32_t)(marker >> 16);
+    if ((marker >> 48) != C64U_PATTERN_MAGIC || (uint16_t)marker != stamp_check(count, C64U_PATTERN_MAGIC)) {
+        return false;
+    }
+    *counter = count;
+    return true;
+}
+
+void c64u_continuity_reset(struct c64u_continuity *continuity)
+{
+    memset(continuity, 0, sizeof(struct c64u_continuity));
+}
+
+enum c64u_continuity_class c64u_continuity_check(struct c64u_continuity *continuity, const uint32_t *rgba,
+                                                 uint32_t height)
+{
+    uint32_t bands = height / C64U_LINES_PER_PACKET;
+    uint32_t marked = 0;
+    uint32_t newest = 0;
+    uint32_t oldest = 0;
+
+    for (uint32_t band = 0; band < bands; band++) {
+        uint32_t counter;
+        if (!pattern_decode_band(rgba, band, &counter)) {
+            continue;
+        }
+        // Counters wrap, so compare by difference
+        if (marked == 0 || (int32_t)(counter - newest) > 0) {
+            newest = counter;
+        }
+        if (marked == 0 || (int32_t)(counter - oldest) < 0) {
+            oldest = counter;
+        }
+        marked++;
+    }
+
+    enum c64u_continuity_class result;
+    if (marked == 0) {
+        result = C64U_CONTINUITY_UNMARKED;
+    } else {
+        int32_t step = continuity->have_last ? (int32_t)(newest - continuity->last_counter) : 1;
+        if (step > 1) {
+            continuity->skipped_frames += (uint32_t)(step - 1);
+        }
+        if (step > 0) {
+            continuity->last_counter = newest;
+            continuity->have_last = true;
+        }
+
+        if (oldest != newest) {
+            result = C64U_CONTINUITY_TORN;
+        } else if (marked < bands) {
+            result = C64U_CONTINUITY_CONCEALED;
+        } else if (step <= 0) {
+            result = C64U_CONTINUITY_REPEATED;
+        } else {
+            result = step == 1 ? C64U_CONTINUITY_IN_ORDER : C64U_CONTINUITY_SKIPPED;
+        }
+    }
+    continuity->counts[result]++;
+    return result;
+}
+
+double c64u_continuity_score(const struct c64u_continuity *continuity)
+{
+    uint64_t scored = continuity->skipped_frames;
+    for (int c = 0; c < C64U_CONTINUITY_UNMARKED; c++) {
+        scored += continuity->counts[c];
+    }
+    return scored > 0 ? 100.0 * continuity->counts[C64U_CONTINUITY_IN_ORDER] / scored : 0.0;
+}
+
+const char *c64u_continuity_class_name(enum c64u_continuity_class result)
+{
+    static const char *names[C64U_CONTINUITY_CLASSES] = {"in-order", "repeated",  "skipped",
+                                                         "torn",     "concealed", "unmarked"};
+    return result < C64U_CONTINUITY_CLASSES ? names[result] : "unknown";
+}
+
+void c64u_avsync_flash_encode(uint8_t *lines, uint32_t mark)
+{
+    uint64_t marker = ((uint64_t)C64U_AVSYNC_MAGIC << 48) | ((uint64_t)mark << 16) |
+                      stamp_check(mark, C64U_AVSYNC_MAGIC);
+    stamp_encode_line(lines + C64U_AVSYNC_FLASH_LINE * C64U_BYTES_PER_LINE, marker);
+}
+
+bool c64u_avsync_flash_decode(const uint32_t *rgba, uint32_t *mark)
+{
+    uint64_t marker = stamp_decode_line(rgba + C64U_AVSYNC_FLASH_LINE * C64U_PIXELS_PER_LINE);
+    uint32_t count = (uint32_t)(marker >> 16);
+    if ((marker >> 48) != C64U_AVSYNC_MAGIC || (uint16_t)marker != stamp_check(count, C64U_AVSYNC_MAGIC)) {
+        return false;
+    }
+    *mark = count;
+    return true;
+}
+
+void c64u_avsync_click_encode(int16_t *samples, uint32_t count, uint32_t offset)
+{
+    if (offset + C64U_AVSYNC_CLICK_SAMPLES > count) {
+        offset = count - C64U_AVSYNC_CLICK_SAMPLES;
+    }
+    for (uint32_t i = 0; i < C64U_AVSYNC_CLICK_SAMPLES; i++) {
+        int16_t value = i % 2 ? INT16_MIN : INT16_MAX;
+        samples[(offset + i) * 2] = value;
+        samples[(offset + i) * 2 + 1] = value;
+    }
+}
+
+int32_t c64u_avsync_click_find(const int16_t *samples, uint32_t count)
+{
+    for (uint32_t start = 0; start + C64U_AVSYNC_CLICK_SAMPLES <= count; start++) {
+        if (samples[start * 2] != INT16_MAX) {
+            continue;
+        }
+        uint32_t i = 0;
+        while (i < C64U_AVSYNC_CLICK_SAMPLES && samples[(start + i) * 2] == (i % 2 ? INT16_MIN : INT16_MAX) &&
+               samples[(start + i) * 2 + 1] == samples[(start + i) * 2]) {
+            i++;
+        }
+        if (i == C64U_AVSYNC_CLICK_SAMPLES) {
+            return (int32_t)start;
+        }
+    }
+    return -1;
+}
+
+void c64u_avsync_reset(struct c64u_avsync *avsync)
+{
+    memset(avsync, 0, sizeof(struct c64u_avsync));
+}
+
+// Both sides of a mark are in: add audio - video to the statistics
+static void avsync_pair(struct c64u_avsync *avsync)
+{
+    double offset_ms = ((double)avsync->audio_mark - (double)avsync->video_mark) / 1e6;
+    if (avsync->count == 0) {
+        avsync->first_time = avsync->video_mark;
+        avsync->min_ms = offset_ms;
+        avsync->max_ms = offset_ms;
+    }
+    double t = (double)(avsync->video_mark - avsync->first_time) / 1e9;
+    avsync->count++;
+    avsync->sum_ms += offset_ms;
+    avsync->sum_sq_ms += offset_ms * offset_ms;
+    avsync->min_ms = offset_ms < avsync->min_ms ? offset_ms : avsync->min_ms;
+    avsync->max_ms = offset_ms > avsync->max_ms ? offset_ms : avsync->max_ms;
+    avsync->sum_t += t;
+    avsync->sum_tt += t * t;
+    avsync->sum_t_ms += t * offset_ms;
+    avsync->last_ms = offset_ms;
+    avsync->video_mark = 0;
+    avsync->audio_mark = 0;
+}
+
+// A mark without its counterpart within C64U_AVSYNC_MAX_OFFSET_NS lost the other half (dropped frame or packet)
+static bool avsync_match(struct c64u_avsync *avsync, uint64_t *mine, uint64_t *other, uint64_t time)
+{
+    if (*other != 0 && (time > *other ? time - *other : *other - time) > C64U_AVSYNC_MAX_OFFSET_NS) {
+        *other = 0;
+        avsync->unpaired++;
+    }
+    if (*mine != 0) {
+        avsync->unpaired++;
+    }
+    *mine = time;
+    if (*other == 0) {
+        return false;
+    }
+    avsync_pair(avsync);
+    return true;
+}
+
+bool c64u_avsync_video_mark(struct c64u_avsync *avsync, uint64_t time)
+{
+    return avsync_match(avsync, &avsync->video_mark, &avsync->audio_mark, time);
+}
+
+bool c64u_avsync_audio_mark(struct c64u_avsync *avsync, uint64_t time)
+{
+    return avsync_match(avsync, &avsync->audio_mark, &avsync->video_mark, time);
+}
+
+double c64u_avsync_mean_ms(const struct c64u_avsync *avsync)
+{
+    return avsync->count > 0 ? avsync->sum_ms / avsync->count : 0.0;
+}
+
+double c64u_avsync_stddev_ms(const struct c64u_avsync *avsync)
+{
+    if (avsync->count < 2) {
+        return 0.0;
+    }
+    double mean = avsync->sum_ms / avsync->count;
+    double variance = avsync->sum_sq_ms / avsync->count - mean * mean;
+    return variance > 0.0 ? sqrt(variance) : 0.0;
+}
+
+double c64u_avsync_drift_ms_per_min(const struct c64u_avsync *avsync)
+{
+    // Least squares slope of the offset over time
+    double n = avsync->count;
+    double denominator = n * avsync->sum_tt - avsync->sum_t * avsync->sum_t;
+    if (avsync->count < 2 || denominator <= 0.0) {
+        return 0.0;
+    }
+    return (n * avsync->sum_t_ms - avsync->sum_t * avsync->sum_ms) / denominator * 60.0;
+}
+
+// Hand a complete frame to the owner, once per frame number
+static void complete_frame(struct c64u_core *core, uint16_t seq_num, uint64_t time)
+{
+    struct frame_assembly *frame = &core->current_frame;
+    if (core->have_completed_frame && core->last_completed_frame == frame->frame_num) {
+        return;
+    }
+
+    c64u_core_log(C64U_CORE_LOG_DEBUG, "✅ FRAME COMPLETE: Frame %u assembled with %u/%u packets", frame->frame_num,
+                  frame->received_packets, frame->expected_packets);
+    core->last_completed_frame = frame->frame_num;
+    core->have_completed_frame = true;
+    core->retired_frame = frame->frame_num;
+    core->have_retired_frame = true;
+    core->stats.frames_complete++;
+    if (core->callbacks.frame) {
+        core->callbacks.frame(core->callbacks.user, frame, seq_num, time);
+    }
+    if (core->output) {
+        uint32_t height = core->format_detected ? core->detected_frame_height : C64U_PAL_HEIGHT;
+        c64u_frame_output_deliver(core->output, frame, seq_num, time, height);
+    }
+}
+
+// Start assembling frame_num, finishing (or abandoning) the frame in progress
+static void start_frame(struct c64u_core *core, uint16_t frame_num, uint16_t seq_num, uint64_t time)
+{
+    struct frame_assembly *frame = &core->current_frame;
+
+    // Log frame transitions to detect skips and duplicates
+    if (frame->frame_num != 0) {
+        uint16_t expected_next = frame->frame_num + 1;
+        int16_t frame_diff = (int16_t)(frame_num - expected_next);
+
+        if (frame_diff > 0) {
+            c64u_core_log(C64U_CORE_LOG_WARNING, "📽️ FRAME SKIP: Expected frame %u, got %u (skipped %d frames)",
+                          expected_next, frame_num, frame_diff);
+        } else if (frame_diff < 0) {
+            c64u_core_log(C64U_CORE_LOG_WARNING, "🔄 FRAME REVERT: Expected frame %u, got %u (went back %d frames)",
+                          expected_next, frame_num, -frame_diff);
+        }
+    }
+
+    // Count expected and captured frames only on new frame start
+    if (core->last_capture_time > 0) {
+        core->stats.frames_expected++;
+    }
+    core->stats.frames_captured++;
+    core->last_capture_time = time;
+
+    // Complete the previous frame if all of it arrived, otherwise drop it; overdue frames are worth a warning
+    if (frame->received_packets > 0) {
+        uint64_t age_ms = (time - frame->start_time) / 1000000;
+        if (c64u_core_frame_complete(frame)) {
+            complete_frame(core, seq_num, time);
+        } else {
+            if (age_ms > C64U_FRAME_TIMEOUT_MS) {
+                c64u_core_log(C64U_CORE_LOG_WARNING,
+                              "⏰ FRAME TIMEOUT: Frame %u dropped with %u/%u packets (%.1f%% complete, age: %llu ms)",
+                              frame->frame_num, frame->received_packets, frame->expected_packets,
+                              frame->expected_packets > 0 ? (frame->received_packets * 100.0f) / frame->expected_packets
+                                                          : 0.0f,
+                              (unsigned long long)age_ms);
+            }
+            core->stats.frame_drops++;
+        }
+        core->retired_frame = frame->frame_num;
+        core->have_retired_frame = true;
+    }
+
+    init_frame_assembly(frame, frame_num, time);
+}
+
+// Detect PAL vs NTSC from the height of a frame, reported by its last packet
+static void detect_format(struct c64u_core *core, uint32_t frame_height)
+{
+    if (core->format_detected && core->detected_frame_height == frame_height) {
+        return;
+    }
+    core->detected_frame_height = frame_height;
+    core->format_detected = true;
+
+    // Calculate expected FPS based on detected format
+    if (frame_height == C64U_PAL_HEIGHT) {
+        core->expected_fps = 50.125; // PAL: 50.125 Hz (actual C64 timing)
+        c64u_core_log(C64U_CORE_LOG_INFO, "🎥 Detected PAL format: 384x%u @ %.3f Hz", frame_height, core->expected_fps);
+    } else if (frame_height == C64U_NTSC_HEIGHT) {
+        core->expected_fps = 59.826; // NTSC: 59.826 Hz (actual C64 timing)
+        c64u_core_log(C64U_CORE_LOG_INFO, "🎥 Detected NTSC format: 384x%u @ %.3f Hz", frame_height, core->expected_fps);
+    } else {
+        // Unknown format, estimate based on packet count
+        core->expected_fps = (frame_height <= 250) ? 59.826 : 50.125;
+        c64u_core_log(C64U_CORE_LOG_WARNING, "⚠️ Unknown video format: 384x%u, assuming %.3f Hz", frame_height,
+                      core->expected_fps);
+    }
+
+    if (core->callbacks.format) {
+        core->callbacks.format(core->callbacks.user, frame_height, core->expected_fps);
+    }
+}
+
+bool c64u_core_video_packet(struct c64u_core *core, const uint8_t *packet, size_t size, uint64_t receive_time)
+{
+    struct c64u_video_header header;
+    if (!c64u_core_parse_video_header(packet, size, &header)) {
+        return false;
+    }
+
+    core->stats.video_packets++;
+    core->stats.video_bytes += size;
+
+    // Track packet drops (seq_num should increment by 1)
+    if (core->have_video_seq && header.seq_num != (uint16_t)(core->last_video_seq + 1)) {
+        uint16_t expected_seq = (uint16_t)(core->last_video_seq + 1);
+        int16_t seq_diff = (int16_t)(header.seq_num - expected_seq);
+
+        core->stats.video_seq_gaps++;
+
+        if (seq_diff > 0) {
+            // Packets skipped - likely packet loss
+            c64u_core_log(C64U_CORE_LOG_WARNING,
+                          "🔴 UDP OUT-OF-SEQUENCE: Expected seq %u, got %u (skipped %d packets) - Frame %u, Line %u",
+                          expected_seq, header.seq_num, seq_diff, header.frame_num, header.line_num);
+        } else {
+            // Negative difference - likely duplicate or severely reordered packet
+            c64u_core_log(C64U_CORE_LOG_WARNING,
+                          "🔄 UDP OUT-OF-ORDER: Expected seq %u, got %u (reorder offset %d) - Frame %u, Line %u",
+                          expected_seq, header.seq_num, seq_diff, header.frame_num, header.line_num);
+        }
+    }
+    core->last_video_seq = header.seq_num;
+    core->have_video_seq = true;
+
+    // Validate packet data
+    if (header.lines_per_packet != C64U_LINES_PER_PACKET || header.pixels_per_line != C64U_PIXELS_PER_LINE ||
+        header.bits_per_pixel != 4) {
+        c64u_core_log(C64U_CORE_LOG_WARNING, "Invalid packet format: lines=%u, pixels=%u, bits=%u",
+                      header.lines_per_packet, header.pixels_per_line, header.bits_per_pixel);
+        core->stats.invalid_packets++;
+        return true;
+    }
+
+    if (core->current_frame.frame_num != header.frame_num) {
+        // A packet of the frame before, reordered behind the next frame's first packets or duplicated, would
+        // otherwise restart assembly of its long gone frame and throw away the frame in progress
+        if (core->have_retired_frame && header.frame_num == core->retired_frame) {
+            c64u_core_log(C64U_CORE_LOG_DEBUG,
+                          "⏪ LATE PACKET: Frame %u, Line %u arrived after the frame ended - seq %u", header.frame_num,
+                          header.line_num, header.seq_num);
+            core->stats.packet_drops++;
+            return true;
+        }
+        start_frame(core, header.frame_num, header.seq_num, receive_time);
+    }
+
+    // Add packet to current frame (calculate packet index from line number). Line numbers come from the network:
+    // a packet must lie within the largest frame, or a crafted last packet could report a height beyond the
+    // PAL-sized frame buffers.
+    struct frame_assembly *frame = &core->current_frame;
+    uint16_t packet_index = header.line_num / header.lines_per_packet;
+    bool in_range = header.line_num + header.lines_per_packet <= C64U_PAL_HEIGHT;
+    if (in_range) {
+        struct frame_packet *fp = &frame->packets[packet_index];
+        if (!fp->received) {
+            fp->line_num = header.line_num;
+            fp->lines_per_packet = header.lines_per_packet;
+            fp->received = true;
+            memcpy(fp->packet_data, packet + C64U_VIDEO_HEADER_SIZE, C64U_VIDEO_PACKET_SIZE - C64U_VIDEO_HEADER_SIZE);
+            frame->received_packets++;
+        } else {
+            // Duplicate packet within same frame - indicates severe packet reordering or duplication
+            c64u_core_log(C64U_CORE_LOG_WARNING, "📦 DUPLICATE PACKET: Frame %u, Line %u (packet_index %u) - seq %u",
+                          header.frame_num, header.line_num, packet_index, header.seq_num);
+            core->stats.packet_drops++; // Count as a drop since we can't use it
+        }
+    } else {
+        // Invalid packet index - packet line number is out of range
+        c64u_core_log(C64U_CORE_LOG_WARNING,
+                      "❌ INVALID PACKET: Frame %u, Line %u out of range (frame height %d) - seq %u", header.frame_num,
+                      header.line_num, C64U_PAL_HEIGHT, header.seq_num);
+        core->stats.packet_drops++;
+    }
+
+    // Update expected packet count and detect video format based on last packet
+    if (header.last_packet && in_range && frame->expected_packets == 0) {
+        frame->expected_packets = packet_index + 1;
+        detect_format(core, header.line_num + header.lines_per_packet);
+    }
+
+    if (c64u_core_frame_complete(frame)) {
+        complete_frame(core, header.seq_num, receive_time);
+
+        // Reset for next frame
+        init_frame_assembly(frame, 0, receive_time);
+    }
+    return true;
+}
+
+bool c64u_core_audio_packet(struct c64u_core *core, const uint8_t *packet, size_t size)
+{
+    uint16_t seq_num;
+    const uint8_t *samples;
+    uint32_t count;
+    if (!c64u_core_parse_audio_packet(packet, size, &seq_num, &samples, &count)) {
+        return false;
+    }
+
+    // The datagram buffer need not be 2-byte aligned; hand the callback an aligned copy of the samples
+    int16_t aligned[(C64U_AUDIO_PACKET_SIZE - C64U_AUDIO_HEADER_SIZE) / 2];
+    memcpy(aligned, samples, sizeof(aligned));
+
+    core->stats.audio_packets++;
+    core->stats.audio_bytes += size;
+
+    // Track audio packet drops
+    if (core->have_audio_seq && seq_num != (uint16_t)(core->last_audio_seq + 1)) {
+        core->stats.audio_seq_gaps++;
+    }
+    core->last_audio_seq = seq_num;
+    core->have_audio_seq = true;
+
+    if (core->callbacks.audio) {
+        core->callbacks.audio(core->callbacks.user, aligned, count, seq_num);
+    }
+    return true;
+}
+
+uint64_t c64u_thread_cpu_ns(void)
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+    uint64_t kernel_100ns = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+    uint64_t user_100ns = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+    return (kernel_100ns + user_100ns) * 100;
+#else
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
@@ -0,0 +1,334 @@
+#ifndef C64U_CORE_H
+#define C64U_CORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include "c64u-protocol.h"
+
+// Headless C64U stream pipeline: datagram parsing, frame assembly, PAL/NTSC detection, VIC-II palette conversion
+// and audio packet parsing. No libobs dependency - the OBS source is an adapter on top of it, and tests and
+// benchmarks drive the same code directly. Results are delivered through callbacks, time comes from the caller
+// (receive timestamps in nanoseconds), so a given packet sequence always produces the same frames.
+
+// Frame packet structure for reordering
+struct frame_packet {
+    uint16_t line_num;
+    uint8_t lines_per_packet;
+    uint8_t packet_data[C64U_VIDEO_PACKET_SIZE - C64U_VIDEO_HEADER_SIZE];
+    bool received;
+};
+
+// Frame assembly structure
+struct frame_assembly {
+    uint16_t frame_num;
+    uint16_t expected_packets;
+    uint16_t received_packets;
+    struct frame_packet packets[C64U_MAX_PACKETS_PER_FRAME];
+    bool complete;
+    uint64_t start_time; // Receive time of the frame's first packet
+};
+
+// Parsed 12-byte video packet header
+struct c64u_video_header {
+    uint16_t seq_num;
+    uint16_t frame_num;
+    uint16_t line_num; // Without the last-packet flag
+    uint16_t pixels_per_line;
+    uint8_t lines_per_packet;
+    uint8_t bits_per_pixel;
+    uint16_t encoding;
+    bool last_packet; // Bit 15 of the line number: last packet of the frame
+};
+
+// Callbacks, all optional. They run on the thread that fed the packet, inside the c64u_core_*_packet() call.
+struct c64u_core_callbacks {
+    // All packets of a frame arrived. frame stays valid until the callback returns; seq_num and time belong to
+    // the packet that completed it. Runs before the frame goes to the core's output, if it has one.
+    void (*frame)(void *user, struct frame_assembly *frame, uint16_t seq_num, uint64_t time);
+    // The frame height changed (first frame, or PAL <-> NTSC switch); fps is the matching C64 refresh rate. The
+    // height comes from the stream but never exceeds C64U_PAL_HEIGHT.
+    void (*format)(void *user, uint32_t height, double fps);
+    // One audio packet: count interleaved 16-bit stereo samples at 48kHz, valid until the callback returns
+    void (*audio)(void *user, const int16_t *samples, uint32_t count, uint16_t seq_num);
+    void *user;
+};
+
+// Counters since c64u_core_init(); the owner may zero them to measure periods
+struct c64u_core_stats {
+    uint32_t video_packets;   // Well-sized video datagrams
+    uint64_t video_bytes;     //
+    uint32_t video_seq_gaps;  // Video datagrams out of sequence (lost, reordered or duplicated)
+    uint32_t invalid_packets; // Video datagrams with an unexpected format (ignored)
+    uint32_t frames_expected; // Frame starts after the first one
+    uint32_t frames_captured; // Frame starts
+    uint32_t frames_complete; // Frames handed to the frame callback
+    uint32_t frame_drops;     // Incomplete frames abandoned when the next frame started
+    uint32_t packet_drops;    // Duplicate, late or out of range video packets
+    uint32_t audio_packets;   // Well-sized audio datagrams
+    uint64_t audio_bytes;     //
+    uint32_t audio_seq_gaps;  // Audio datagrams out of sequence
+};
+
+// Stream state. Video and audio may be fed from different threads; each direction must be serialized by the
+// caller.
+struct c64u_core {
+    struct c64u_core_callbacks callbacks;
+    struct c64u_core_stats stats;
+    struct c64u_frame_output *output; // Optional (set after c64u_core_init()): complete frames are delivered to it
+
+    // Frame assembly (video)
+    struct frame_assembly current_frame;
+    uint16_t last_completed_frame;
+    bool have_completed_frame; // Frame numbers start at 0 and wrap, so 0 is a valid last_completed_frame
+    uint16_t retired_frame;    // The last frame completed or abandoned; its late packets are dropped
+    bool have_retired_frame;
+    uint64_t last_capture_time; // Receive time of the last frame start
+    uint16_t last_video_seq;
+    bool have_video_seq;
+
+    // Dynamic video format detection
+    uint32_t detected_frame_height;
+    bool format_detected;
+    double expected_fps; // PAL timing until detected
+
+    // Audio
+    uint16_t last_audio_seq;
+    bool have_audio_seq;
+};
+
+// Log levels passed to the log handler
+#define C64U_CORE_LOG_ERROR 0
+#define C64U_CORE_LOG_WARNING 1
+#define C64U_CORE_LOG_INFO 2
+#define C64U_CORE_LOG_DEBUG 3
+
+// Route the core's diagnostics (sequence gaps, frame skips and timeouts, format changes). Without a handler the
+// core is silent. Process-wide; set it once before feeding packets.
+typedef void (*c64u_core_log_handler)(int level, const char *format, va_list args);
+void c64u_core_set_log_handler(c64u_core_log_handler handler);
+
+// Log through the handler; also used by the other headless modules (c64u-resolve.c)
+#if defined(__GNUC__)
+__attribute__((format(printf, 2, 3)))
+#endif
+void c64u_core_log(int level, const char *format, ...);
+
+// VIC-II color palette (16 colors) as 0xAABBGGRR, i.e. RGBA bytes in memory
+extern const uint32_t vic_colors[16];
+
+// Initialize (and reset) the stream state. callbacks may be NULL.
+void c64u_core_init(struct c64u_core *core, const struct c64u_core_callbacks *callbacks);
+
+// Forget the frame being assembled and the sequence numbers, e.g. after a reconnect. Keeps the detected format
+// and the counters.
+void c64u_core_reset(struct c64u_core *core);
+
+// Parse and validate datagram headers. Return false if the datagram has the wrong size for a C64U packet. The
+// audio samples are count interleaved 16-bit stereo samples as bytes within the packet, which need not be 2-byte
+// aligned: copy them before reading them as int16_t.
+bool c64u_core_parse_video_header(const uint8_t *packet, size_t size, struct c64u_video_header *header);
+bool c64u_core_parse_audio_packet(const uint8_t *packet, size_t size, uint16_t *seq_num, const uint8_t **samples,
+                                  uint32_t *count);
+
+// Feed one datagram received at receive_time (ns, any monotonic clock). Returns false if it is not a C64U
+// packet (wrong size); packets with an unsupported format count as C64U packets but are ignored.
+bool c64u_core_video_packet(struct c64u_core *core, const uint8_t *packet, size_t size, uint64_t receive_time);
+bool c64u_core_audio_packet(struct c64u_core *core, const uint8_t *packet, size_t size);
+
+// Frame helpers. Lines of missing packets are left untouched by the RGBA conversion and black (index 0) in the
+// indexed copy; both stop at height lines.
+bool c64u_core_frame_complete(const struct frame_assembly *frame);
+void c64u_core_frame_to_rgba(const struct frame_assembly *frame, uint32_t *dst, uint32_t height);
+void c64u_core_frame_to_indexed(const struct frame_assembly *frame, uint8_t *dst, uint32_t height);
+
+// Convert one line of packed 4-bit VIC indices (low nibble is the left pixel) to RGBA or BGR24, pixels pixels long
+void c64u_core_line_to_rgba(const uint8_t *src, uint32_t *dst, uint32_t pixels);
+void c64u_core_line_to_bgr24(const uint8_t *src, uint8_t *dst, uint32_t pixels);
+
+// Render delay queue: a ring of frames converted to RGBA, released once it holds the configured delay. Not
+// thread-safe; the owner locks around it.
+struct c64u_delay_queue {
+    uint32_t *frames;      // capacity slots of C64U_PIXELS_PER_LINE x C64U_PAL_HEIGHT RGBA pixels (NULL = freed)
+    uint16_t *sequences;   // Sequence number of the packet that completed each queued frame
+    uint32_t capacity;
+    uint32_t size;
+    uint32_t head;
+    uint32_t tail;
+};
+
+// Allocate room for capacity frames (any previous buffers are freed). Returns false if out of memory.
+bool c64u_delay_queue_alloc(struct c64u_delay_queue *queue, uint32_t capacity);
+void c64u_delay_queue_free(struct c64u_delay_queue *queue);
+void c64u_delay_queue_clear(struct c64u_delay_queue *queue);
+
+// Bytes c64u_delay_queue_alloc() takes for capacity frames
+size_t c64u_delay_queue_bytes(uint32_t capacity);
+
+// Convert the frame (height lines) into the tail slot. A full queue drops its oldest frame.
+void c64u_delay_queue_push(struct c64u_delay_queue *queue, const struct frame_assembly *frame, uint32_t height,
+                           uint16_t seq_num);
+
+// Copy the oldest frame (pixels RGBA pixels) to dst and release it, if the queue holds at least delay frames
+bool c64u_delay_queue_pop(struct c64u_delay_queue *queue, uint32_t delay, uint32_t *dst, size_t pixels);
+
+// Frame output callbacks, all optional. A lock callback returning false skips the step it guards.
+struct c64u_frame_output_callbacks {
+    bool (*lock_queue)(void *user); // Around the delay queue
+    void (*unlock_queue)(void *user);
+    bool (*lock_buffers)(void *user); // Around the back buffer and the swap; taken inside the queue lock
+    void (*unlock_buffers)(void *user);
+    // A new frame is in front, buffers still locked. time is the receive time of the packet that completed it.
+    void (*swapped)(void *user, uint64_t time);
+    void *user;
+};
+
+// Frame output: converts complete frames to RGBA and double buffers them, straight into the back buffer without a
+// delay, otherwise through the delay queue. The renderer reads front under the buffer lock.
+struct c64u_frame_output {
+    struct c64u_frame_output_callbacks callbacks;
+    uint32_t *front; // Caller-owned C64U_PIXELS_PER_LINE x C64U_PAL_HEIGHT RGBA buffers, swapped on delivery
+    uint32_t *back;
+    struct c64u_delay_queue queue; // Allocated on the first delayed frame for the delay (at least one frame)
+    uint32_t delay;                // Render delay in frames, set by the owner, e.g. from the core's frame callback
+};
+
+// Initialize the output with its buffers; the delay starts at 0. callbacks may be NULL.
+void c64u_frame_output_init(struct c64u_frame_output *output, const struct c64u_frame_output_callbacks *callbacks,
+                            uint32_t *front, uint32_t *back);
+
+// Free the delay queue (the buffers belong to the caller)
+void c64u_frame_output_free(struct c64u_frame_output *output);
+
+// Deliver a complete frame of height lines. Returns true if a frame was swapped to the front: this one, or with a
+// delay the oldest queued one once the queue holds the delay. A queue allocated for a smaller delay is full at its
+// capacity; free it to have it reallocated on the next frame.
+bool c64u_frame_output_deliver(struct c64u_frame_output *output, const struct frame_assembly *frame,
+                               uint16_t seq_num, uint64_t time, uint32_t height);
+
+// Latency stamp: a test stream (c64u_mock_server --stamp) codes a frame counter and the frame's send time as black
+// and white cells into its top C64U_STAMP_LINES border lines, so the frame that reaches the render stage tells when
+// it left the sender. Line 0 holds the magic number, the counter and a check word, line 1 the send time (ns); 64
+// cells of C64U_STAMP_CELL_PIXELS pixels per line, most significant bit first. Cells survive RGBA conversion and
+// the delay queue unchanged.
+#define C64U_STAMP_LINES 2
+#define C64U_STAMP_CELL_PIXELS 6
+#define C64U_STAMP_MAGIC 0xC64Au
+
+// Code the stamp into C64U_STAMP_LINES lines of packed 4-bit pixels (C64U_BYTES_PER_LINE bytes each)
+void c64u_stamp_encode(uint8_t *lines, uint32_t counter, uint64_t send_time);
+
+// Read the stamp from an RGBA frame (C64U_PIXELS_PER_LINE wide). Returns false if there is no intact stamp.
+bool c64u_stamp_decode(const uint32_t *rgba, uint32_t *counter, uint64_t *send_time);
+
+// Latency distribution in C64U_LATENCY_BUCKET_NS buckets; anything beyond the last bucket counts into it
+#define C64U_LATENCY_BUCKET_NS 100000ULL // 0.1ms
+#define C64U_LATENCY_BUCKETS 5000        // Up to 500ms
+struct c64u_latency {
+    uint32_t count;
+    uint64_t sum_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint32_t buckets[C64U_LATENCY_BUCKETS];
+};
+
+void c64u_latency_reset(struct c64u_latency *latency);
+void c64u_latency_add(struct c64u_latency *latency, uint64_t ns);
+
+// Latency that p percent (0-100) of the samples stay at or below, at bucket resolution (0 without samples)
+uint64_t c64u_latency_percentile(const struct c64u_latency *latency, double p);
+
+// Continuity pattern: the test stream's stand-in for tools/c64/digit-cycle (c64u_mock_server --pattern). Each
+// packet's lines take one of ten colors by frame counter, like the cycling digits, and its last line carries the
+// frame counter as cells (magic number, counter, check word), so every band of C64U_LINES_PER_PACKET lines in a
+// delivered frame tells which frame it came from. Compatible with the latency stamp, which uses lines 0 and 1.
+#define C64U_PATTERN_MAGIC 0xD16Cu
+
+// Code the pattern into the C64U_LINES_PER_PACKET lines of one packet (packed 4-bit pixels)
+void c64u_pattern_encode(uint8_t *lines, uint32_t counter);
+
+// What a delivered frame looks like next to the one before it
+enum c64u_continuity_class {
+    C64U_CONTINUITY_IN_ORDER,  // The next frame
+    C64U_CONTINUITY_REPEATED,  // The previous frame again, or an older one
+    C64U_CONTINUITY_SKIPPED,   // A later frame: the ones in between were never delivered
+    C64U_CONTINUITY_TORN,      // Bands from different frames, e.g. stale lines where packets were missing
+    C64U_CONTINUITY_CONCEALED, // Bands without a pattern: missing lines cleared or filled in
+    C64U_CONTINUITY_UNMARKED,  // No pattern at all (not a pattern stream); not scored
+    C64U_CONTINUITY_CLASSES,
+};
+
+struct c64u_continuity {
+    uint32_t counts[C64U_CONTINUITY_CLASSES];
+    uint32_t skipped_frames; // Frames never delivered
+    uint32_t last_counter;   // Newest frame counter seen
+    bool have_last;
+};
+
+void c64u_continuity_reset(struct c64u_continuity *continuity);
+
+// Classify one delivered RGBA frame (C64U_PIXELS_PER_LINE wide, height lines) and count it
+enum c64u_continuity_class c64u_continuity_check(struct c64u_continuity *continuity, const uint32_t *rgba,
+                                                 uint32_t height);
+
+// Smoothness: percent of frames that should have been shown and were shown in order, counting never delivered
+// frames as misses (0 without pattern frames)
+double c64u_continuity_score(const struct c64u_continuity *continuity);
+
+const char *c64u_continuity_class_name(enum c64u_continuity_class result);
+
+// A/V sync marks (c64u_mock_server --av-sync): at regular intervals the test stream sends a white flash frame and,
+// at the same device time, an audio click. The flash frame carries a mark counter coded like the latency stamp in
+// line C64U_AVSYNC_FLASH_LINE; the click is C64U_AVSYNC_CLICK_SAMPLES stereo samples alternating between full
+// scale positive and negative on both channels, which C64 audio does not produce.
+#define C64U_AVSYNC_MAGIC 0xF1A5u
+#define C64U_AVSYNC_FLASH_LINE 2
+#define C64U_AVSYNC_CLICK_SAMPLES 8
+#define C64U_AVSYNC_MAX_OFFSET_NS 400000000ULL // Marks further apart than this are not paired
+
+// Code the mark counter into line C64U_AVSYNC_FLASH_LINE of the frame's top packet (packed 4-bit pixels)
+void c64u_avsync_flash_encode(uint8_t *lines, uint32_t mark);
+
+// Read the mark from an RGBA frame (C64U_PIXELS_PER_LINE wide). Returns false if it is not a flash frame.
+bool c64u_avsync_flash_decode(const uint32_t *rgba, uint32_t *mark);
+
+// Write the click into count interleaved stereo samples at sample offset (moved back to fit into the packet)
+void c64u_avsync_click_encode(int16_t *samples, uint32_t count, uint32_t offset);
+
+// Sample offset of the click in count interleaved stereo samples, or -1
+int32_t c64u_avsync_click_find(const int16_t *samples, uint32_t count);
+
+// Offsets of paired marks (audio time - video time, positive = audio late) with a least squares drift
+struct c64u_avsync {
+    uint64_t video_mark; // Waiting for its counterpart (0 = none)
+    uint64_t audio_mark; //
+    uint32_t count;      // Pairs
+    uint32_t unpaired;   // Marks whose counterpart never arrived
+    double sum_ms;
+    double sum_sq_ms;
+    double min_ms;
+    double max_ms;
+    double last_ms;
+    uint64_t first_time; // Video time of the first pair; drift is measured from here
+    double sum_t;
+    double sum_tt;
+    double sum_t_ms;
+};
+
+void c64u_avsync_reset(struct c64u_avsync *avsync);
+
+// Report when the flash was shown or the click plays (ns, same clock for both). Return true if this completed a
+// pair.
+bool c64u_avsync_video_mark(struct c64u_avsync *avsync, uint64_t time);
+bool c64u_avsync_audio_mark(struct c64u_avsync *avsync, uint64_t time);
+
+double c64u_avsync_mean_ms(const struct c64u_avsync *avsync);
+double c64u_avsync_stddev_ms(const struct c64u_avsync *avsync);
+double c64u_avsync_drift_ms_per_min(const struct c64u_avsync *avsync);
+
+// CPU time (user + system, ns) the calling thread has used so far, 0 if the platform cannot tell. The difference
+// between two calls over the wall time between them is the thread's share of one core.
+uint64_t c64u_thread_cpu_ns(void);
+
+#endif // C64U_CORE_H
@@ -0,0 +1,346 @@
+#include <string.h>
+#include "c64u-flac.h"
+
+#define FLAC_MAX_FIXED_ORDER 4
+#define FLAC_MAX_PARTITION_ORDER 8 // 16 samples per partition for a full block
+#define FLAC_MAX_RICE_PARAM 14     // 4-bit Rice parameters, 15 is the escape code
+
+// Subframe types (FLAC format, SUBFRAME_HEADER)
+#define FLAC_SUBFRAME_CONSTANT 0x00
+#define FLAC_SUBFRAME_VERBATIM 0x01
+#define FLAC_SUBFRAME_FIXED 0x08 // | predictor order
+
+// Channel assignments (FLAC format, FRAME_HEADER)
+#define FLAC_CHANNELS_INDEPENDENT 1 // 2 channels, left and right
+#define FLAC_CHANNELS_LEFT_SIDE 8
+#define FLAC_CHANNELS_SIDE_RIGHT 9
+#define FLAC_CHANNELS_MID_SIDE 10
+
+// MSB-first bit writer
+struct bit_writer {
+    uint8_t *data;
+    size_t pos;
+    uint64_t acc;
+    uint32_t bits;
+};
+
+static void put_bits(struct bit_writer *bw, uint32_t value, uint32_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    bw->acc = (bw->acc << count) | (count < 32 ? value & ((1u << count) - 1) : value);
+    bw->bits += count;
+    while (bw->bits >= 8) {
+        bw->bits -= 8;
+        bw->data[bw->pos++] = (uint8_t)(bw->acc >> bw->bits);
+    }
+}
+
+// Pad to the next byte boundary with zero bits
+static void align_bits(struct bit_writer *bw)
+{
+    if (bw->bits > 0) {
+        put_bits(bw, 0, 8 - bw->bits);
+    }
+}
+
+static void put_rice(struct bit_writer *bw, int32_t residual, uint32_t param)
+{
+    uint32_t folded = ((uint32_t)residual << 1) ^ (uint32_t)(residual >> 31); // Zigzag: 0, -1, 1, -2, ...
+    uint32_t quotient = folded >> param;
+    while (quotient >= 32) {
+        put_bits(bw, 0, 32);
+        quotient -= 32;
+    }
+    put_bits(bw, 1, quotient + 1); // quotient zeros and the stop bit
+    put_bits(bw, folded, param);
+}
+
+static uint8_t crc8(const uint8_t *data, size_t size)
+{
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (uint8_t)((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t *data, size_t size)
+{
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= (uint16_t)(data[i] << 8);
+        for (int b = 0; b < 8; b++) {
+            crc = (uint16_t)((crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Fixed predictor residual of sample i (i >= order)
+static inline int32_t fixed_residual(const int32_t *x, uint32_t i, uint32_t order)
+{
+    switch (order) {
+    case 0:
+        return x[i];
+    case 1:
+        return x[i] - x[i - 1];
+    case 2:
+        return x[i] - 2 * x[i - 1] + x[i - 2];
+    case 3:
+        return x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+    default:
+        return x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4];
+    }
+}
+
+// How a channel is coded, chosen by analyze_channel
+struct subframe_plan {
+    uint64_t bits;
+    uint32_t type;
+    uint32_t order;
+    uint32_t partition_order;
+    uint8_t params[1 << FLAC_MAX_PARTITION_ORDER];
+};
+
+// Bits of a Rice partition with the best parameter. sum(folded >> k) <= sum >> k, so the estimate is an upper
+// bound of what put_rice writes.
+static uint64_t rice_partition_bits(uint64_t sum, uint32_t count, uint8_t *param)
+{
+    uint64_t best = UINT64_MAX;
+    for (uint32_t k = 0; k <= FLAC_MAX_RICE_PARAM; k++) {
+        uint64_t bits = (uint64_t)count * (k + 1) + (sum >> k);
+        if (bits < best) {
+            best = bits;
+            *param = (uint8_t)k;
+        }
+    }
+    return best + 4;
+}
+
+// Find the partition order and Rice parameters for the fixed predictor of the given order
+static uint64_t plan_residual(const int32_t *x, uint32_t count, uint32_t order, struct subframe_plan *plan)
+{
+    // Finest partitioning the block size allows: equal partitions, the first one longer than the warm-up
+    uint32_t max_porder = 0;
+    while (max_porder < FLAC_MAX_PARTITION_ORDER && (count & (1u << max_porder)) == 0 &&
+           (count >> (max_porder + 1)) > order) {
+        max_porder++;
+    }
+
+    uint64_t sums[1 << FLAC_MAX_PARTITION_ORDER];
+    uint32_t partitions = 1u << max_porder;
+    uint32_t partition_size = count >> max_porder;
+    for (uint32_t p = 0; p < partitions; p++) {
+        uint64_t sum = 0;
+        uint32_t start = p == 0 ? order : p * partition_size;
+        for (uint32_t i = start; i < (p + 1) * partition_size; i++) {
+            int32_t r = fixed_residual(x, i, order);
+            sum += ((uint32_t)r << 1) ^ (uint32_t)(r >> 31);
+        }
+        sums[p] = sum;
+    }
+
+    // Merge neighbouring partitions order by order and keep the cheapest partitioning
+    uint64_t best = UINT64_MAX;
+    uint8_t params[1 << FLAC_MAX_PARTITION_ORDER];
+    for (int32_t porder = (int32_t)max_porder; porder >= 0; porder--) {
+        partitions = 1u << porder;
+        partition_size = count >> porder;
+        if (porder < (int32_t)max_porder) {
+            for (uint32_t p = 0; p < partitions; p++) {
+                sums[p] = sums[2 * p] + sums[2 * p + 1];
+            }
+        }
+
+        uint64_t bits = 2 + 4; // Coding method and partition order
+        for (uint32_t p = 0; p < partitions; p++) {
+            uint32_t samples = p == 0 ? partition_size - order : partition_size;
+            bits += rice_partition_bits(sums[p], samples, &params[p]);
+        }
+        if (bits < best) {
+            best = bits;
+            plan->partition_order = (uint32_t)porder;
+            memcpy(plan->params, params, partitions);
+        }
+    }
+    return best;
+}
+
+// Pick the cheapest subframe type for one channel of bps bits per sample
+static void analyze_channel(const int32_t *x, uint32_t count, uint32_t bps, struct subframe_plan *plan)
+{
+    bool constant = true;
+    for (uint32_t i = 1; i < count && constant; i++) {
+        constant = x[i] == x[0];
+    }
+    if (constant) {
+        plan->type = FLAC_SUBFRAME_CONSTANT;
+        plan->bits = 8 + bps;
+        return;
+    }
+
+    plan->type = FLAC_SUBFRAME_VERBATIM;
+    plan->bits = 8 + (uint64_t)bps * count;
+
+    struct subframe_plan candidate;
+    for (uint32_t order = 0; order <= FLAC_MAX_FIXED_ORDER && order < count; order++) {
+        uint64_t bits = 8 + (uint64_t)bps * order + plan_residual(x, count, order, &candidate);
+        if (bits < plan->bits) {
+            plan->bits = bits;
+            plan->type = FLAC_SUBFRAME_FIXED | order;
+            plan->order = order;
+            plan->partition_order = candidate.partition_order;
+            memcpy(plan->params, candidate.params, 1u << candidate.partition_order);
+        }
+    }
+}
+
+static void write_subframe(struct bit_writer *bw, const int32_t *x, uint32_t count, uint32_t bps,
+                           const struct subframe_plan *plan)
+{
+    put_bits(bw, plan->type << 1, 8); // Zero padding bit, type, no wasted bits
+
+    if (plan->type == FLAC_SUBFRAME_CONSTANT) {
+        put_bits(bw, (uint32_t)x[0], bps);
+        return;
+    }
+    if (plan->type == FLAC_SUBFRAME_VERBATIM) {
+        for (uint32_t i = 0; i < count; i++) {
+            put_bits(bw, (uint32_t)x[i], bps);
+        }
+        return;
+    }
+
+    uint32_t order = plan->order;
+    for (uint32_t i = 0; i < order; i++) {
+        put_bits(bw, (uint32_t)x[i], bps); // Warm-up samples
+    }
+    put_bits(bw, 0, 2); // Rice coding with 4-bit parameters
+    put_bits(bw, plan->partition_order, 4);
+
+    uint32_t partitions = 1u << plan->partition_order;
+    uint32_t partition_size = count >> plan->partition_order;
+    for (uint32_t p = 0; p < partitions; p++) {
+        uint32_t param = plan->params[p];
+        put_bits(bw, param, 4);
+        uint32_t start = p == 0 ? order : p * partition_size;
+        for (uint32_t i = start; i < (p + 1) * partition_size; i++) {
+            put_rice(bw, fixed_residual(x, i, order), param);
+        }
+    }
+}
+
+static uint32_t sample_rate_code(uint32_t sample_rate)
+{
+    switch (sample_rate) {
+    case 44100:
+        return 9;
+    case 48000:
+        return 10;
+    case 96000:
+        return 11;
+    default:
+        return 0; // Taken from STREAMINFO
+    }
+}
+
+void c64u_flac_write_header(uint8_t *dst, uint32_t sample_rate, uint32_t min_frame_size, uint32_t max_frame_size,
+                            uint64_t total_samples)
+{
+    struct bit_writer bw = {.data = dst};
+    put_bits(&bw, 0x664C6143, 32); // "fLaC"
+    put_bits(&bw, 0x80, 8);        // Last metadata block, type 0 (STREAMINFO)
+    put_bits(&bw, 34, 24);         // Block length
+    put_bits(&bw, C64U_FLAC_BLOCK_SIZE, 16);
+    put_bits(&bw, C64U_FLAC_BLOCK_SIZE, 16);
+    put_bits(&bw, min_frame_size, 24);
+    put_bits(&bw, max_frame_size, 24);
+    put_bits(&bw, sample_rate, 20);
+    put_bits(&bw, 2 - 1, 3);  // Channels - 1
+    put_bits(&bw, 16 - 1, 5); // Bits per sample - 1
+    put_bits(&bw, (uint32_t)(total_samples >> 32) & 0x0F, 4);
+    put_bits(&bw, (uint32_t)total_samples, 32);
+    for (int i = 0; i < 4; i++) {
+        put_bits(&bw, 0, 32); // MD5 of the unencoded audio, not computed
+    }
+}
+
+size_t c64u_flac_encode_frame(uint8_t *dst, const int16_t *samples, uint32_t count, uint32_t frame_number,
+                              uint32_t sample_rate)
+{
+    // Left, right, mid and side channels
+    int32_t channels[4][C64U_FLAC_BLOCK_SIZE];
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t left = samples[i * 2];
+        int32_t right = samples[i * 2 + 1];
+        channels[0][i] = left;
+        channels[1][i] = right;
+        channels[2][i] = (left + right) >> 1;
+        channels[3][i] = left - right;
+    }
+
+    // The side channel needs one extra bit
+    static const uint32_t bps[4] = {16, 16, 16, 17};
+    struct subframe_plan plans[4];
+    for (uint32_t c = 0; c < 4; c++) {
+        analyze_channel(channels[c], count, bps[c], &plans[c]);
+    }
+
+    // Stereo decorrelation: code the cheapest pair of channels
+    static const uint32_t modes[4][3] = {
+        {FLAC_CHANNELS_INDEPENDENT, 0, 1},
+        {FLAC_CHANNELS_LEFT_SIDE, 0, 3},
+        {FLAC_CHANNELS_SIDE_RIGHT, 3, 1},
+        {FLAC_CHANNELS_MID_SIDE, 2, 3},
+    };
+    uint32_t mode = 0;
+    for (uint32_t m = 1; m < 4; m++) {
+        if (plans[modes[m][1]].bits + plans[modes[m][2]].bits <
+            plans[modes[mode][1]].bits + plans[modes[mode][2]].bits) {
+            mode = m;
+        }
+    }
+
+    // Frame header
+    struct bit_writer bw = {.data = dst};
+    uint32_t block_size_code = count == C64U_FLAC_BLOCK_SIZE ? 12 : count <= 256 ? 6 : 7;
+    put_bits(&bw, 0xFFF8, 16); // Sync code, fixed block size stream
+    put_bits(&bw, block_size_code, 4);
+    put_bits(&bw, sample_rate_code(sample_rate), 4);
+    put_bits(&bw, modes[mode][0], 4);
+    put_bits(&bw, 4, 3); // 16 bits per sample
+    put_bits(&bw, 0, 1);
+
+    // Frame number, UTF-8 style variable length coding
+    // Value bits with n continuation bytes: 7 for one byte, then 5 * n + 6
+    uint32_t continuation = frame_number < 0x80 ? 0 : 1;
+    while (continuation > 0 && continuation < 5 && frame_number >> (5 * continuation + 6) != 0) {
+        continuation++;
+    }
+    uint32_t lead = continuation == 0 ? 0 : (0xFFu << (7 - continuation)) & 0xFF;
+    put_bits(&bw, lead | (frame_number >> (6 * continuation)), 8);
+    for (int32_t i = (int32_t)continuation - 1; i >= 0; i--) {
+        put_bits(&bw, 0x80 | ((frame_number >> (6 * i)) & 0x3F), 8);
+    }
+
+    if (block_size_code == 6) {
+        put_bits(&bw, count - 1, 8);
+    } else if (block_size_code == 7) {
+        put_bits(&bw, count - 1, 16);
+    }
+    put_bits(&bw, crc8(dst, bw.pos), 8);
+
+    for (uint32_t s = 1; s <= 2; s++) {
+        uint32_t c = modes[mode][s];
+        write_subframe(&bw, channels[c], count, bps[c], &plans[c]);
+    }
+
+    align_bits(&bw);
+    put_bits(&bw, crc16(dst, bw.pos), 16);
+    return bw.pos;
+}
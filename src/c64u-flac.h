@@ -0,0 +1,30 @@
+#ifndef C64U_FLAC_H
+#define C64U_FLAC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Built-in FLAC encoder for 16-bit stereo recordings: fixed predictors, Rice coded residuals and the best of
+// the four stereo decorrelation modes per frame. Every frame starts with a sync code and ends with a CRC, so
+// a file cut short by a crash still decodes up to its last complete frame.
+#define C64U_FLAC_BLOCK_SIZE 4096 // Stereo samples per frame (~85ms at 48kHz)
+#define C64U_FLAC_HEADER_SIZE 42  // "fLaC" marker plus the STREAMINFO metadata block
+
+// Worst-case encoded size of a frame of count stereo samples: frame header, two verbatim subframes (the side
+// channel needs 17 bits per sample) and the CRC-16 footer
+#define C64U_FLAC_MAX_FRAME_SIZE(count) (((count) * 2 * 17 + 7) / 8 + 32)
+
+// Write the stream marker and STREAMINFO for 16-bit stereo at sample_rate into dst (C64U_FLAC_HEADER_SIZE
+// bytes). Zero frame sizes and total_samples mean "unknown", which is valid while the file is being written;
+// the MD5 signature is always left unset.
+void c64u_flac_write_header(uint8_t *dst, uint32_t sample_rate, uint32_t min_frame_size, uint32_t max_frame_size,
+                            uint64_t total_samples);
+
+// Encode count (1..C64U_FLAC_BLOCK_SIZE) interleaved stereo samples as frame frame_number. Only the last
+// frame of a stream may be shorter than C64U_FLAC_BLOCK_SIZE. dst must hold C64U_FLAC_MAX_FRAME_SIZE(count)
+// bytes. Works on a ~70KB stack copy of the block. Returns the number of bytes written.
+size_t c64u_flac_encode_frame(uint8_t *dst, const int16_t *samples, uint32_t count, uint32_t frame_number,
+                              uint32_t sample_rate);
+
+#endif // C64U_FLAC_H
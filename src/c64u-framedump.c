@@ -0,0 +1,299 @@
+#include <obs-module.h>
+#include <util/platform.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdio.h>
+#include "c64u-logging.h"
+#include "c64u-framedump.h"
+#include "c64u-record.h"
+#include "c64u-types.h"
+#include "c64u-video.h"
+#include "c64u-protocol.h"
+#include "c64u-rle.h"
+
+#define BMP_HEADER_SIZE (14 + 40) // BITMAPFILEHEADER + BITMAPINFOHEADER
+
+// Largest file a worker builds: 24-bit PAL frame (RLE output and palettized frames are smaller)
+#define FRAMEDUMP_MAX_FILE_SIZE (BMP_HEADER_SIZE + 16 * 4 + C64U_PIXELS_PER_LINE * 3 * C64U_PAL_HEIGHT)
+
+static void put_u16(uint8_t *p, uint16_t value)
+{
+    memcpy(p, &value, 2);
+}
+
+static void put_u32(uint8_t *p, uint32_t value)
+{
+    memcpy(p, &value, 4);
+}
+
+// Build a complete bottom-up BMP file from the slot's packed indices. Returns the file size.
+static size_t encode_bmp(const struct framedump_slot *slot, uint32_t format, uint8_t *buffer)
+{
+    uint32_t width = slot->width;
+    uint32_t height = slot->height;
+    uint16_t bit_count = format == C64U_FRAMEDUMP_FORMAT_BMP24 ? 24 : 4;
+    uint32_t compression = format == C64U_FRAMEDUMP_FORMAT_RLE4 ? C64U_BI_RLE4 : 0;
+    uint32_t colors_used = bit_count == 4 ? 16 : 0;
+    uint32_t data_offset = BMP_HEADER_SIZE + colors_used * 4;
+    uint32_t row_size = ((width * bit_count + 31) / 32) * 4;
+    uint8_t *pixels = buffer + data_offset;
+    size_t image_size;
+
+    if (format == C64U_FRAMEDUMP_FORMAT_RLE4) {
+        image_size = c64u_rle_encode_frame(pixels, slot->indexed_data, NULL, width, height, C64U_BYTES_PER_LINE, 4);
+    } else {
+        image_size = (size_t)row_size * height;
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *src = slot->indexed_data + y * C64U_BYTES_PER_LINE;
+            uint8_t *dst = pixels + (height - 1 - y) * row_size;
+            memset(dst, 0, row_size);
+            if (bit_count == 24) {
+                c64u_core_line_to_bgr24(src, dst, width);
+            } else {
+                // 4-bit DIBs keep the left pixel in the high nibble, the C64U stream in the low nibble
+                for (uint32_t x = 0; x < width / 2; x++) {
+                    dst[x] = (uint8_t)((src[x] << 4) | (src[x] >> 4));
+                }
+            }
+        }
+    }
+
+    // BITMAPFILEHEADER
+    buffer[0] = 'B';
+    buffer[1] = 'M';
+    put_u32(buffer + 2, (uint32_t)(data_offset + image_size)); // bfSize
+    put_u32(buffer + 6, 0);                                    // bfReserved1/2
+    put_u32(buffer + 10, data_offset);                         // bfOffBits
+
+    // BITMAPINFOHEADER
+    put_u32(buffer + 14, 40);                   // biSize
+    put_u32(buffer + 18, width);                // biWidth
+    put_u32(buffer + 22, height);               // biHeight (positive = bottom-up)
+    put_u16(buffer + 26, 1);                    // biPlanes
+    put_u16(buffer + 28, bit_count);            // biBitCount
+    put_u32(buffer + 30, compression);          // biCompression (0 = BI_RGB, 2 = BI_RLE4)
+    put_u32(buffer + 34, (uint32_t)image_size); // biSizeImage
+    put_u32(buffer + 38, 0);                    // biXPelsPerMeter
+    put_u32(buffer + 42, 0);                    // biYPelsPerMeter
+    put_u32(buffer + 46, colors_used);          // biClrUsed
+    put_u32(buffer + 50, colors_used);          // biClrImportant
+
+    // RGBQUAD palette (blue, green, red, reserved) with the VIC-II colors
+    for (uint32_t i = 0; i < colors_used; i++) {
+        uint8_t *quad = buffer + BMP_HEADER_SIZE + i * 4;
+        quad[0] = (vic_colors[i] >> 16) & 0xFF;
+        quad[1] = (vic_colors[i] >> 8) & 0xFF;
+        quad[2] = vic_colors[i] & 0xFF;
+        quad[3] = 0;
+    }
+
+    return data_offset + image_size;
+}
+
+// Write one frame as frames/NNNNN/frame_<capture ms>_<sequence>.bmp. batch_folder caches the last batch
+// folder this worker created, so directories are only created once per C64U_FRAMEDUMP_FRAMES_PER_FOLDER frames.
+static bool dump_frame(struct c64u_source *context, const struct framedump_slot *slot, uint32_t format,
+                       uint8_t *buffer, char *batch_folder, size_t batch_folder_size)
+{
+    char session_folder[sizeof(context->session_folder)];
+    if (!record_get_session_folder(context, session_folder, sizeof(session_folder))) {
+        C64U_LOG_WARNING("Failed to create recording session for frame saving");
+        return false;
+    }
+
+    char folder[1024];
+    snprintf(folder, sizeof(folder), "%s/frames/%05u", session_folder,
+             slot->sequence / C64U_FRAMEDUMP_FRAMES_PER_FOLDER);
+    if (strcmp(folder, batch_folder) != 0) {
+        if (!create_directory_recursive(folder)) {
+            C64U_LOG_WARNING("Failed to create frames subfolder: %s", folder);
+            return false;
+        }
+        snprintf(batch_folder, batch_folder_size, "%s", folder);
+    }
+
+    // Timestamp is the frame's capture time
+    char filename[1100];
+    snprintf(filename, sizeof(filename), "%s/frame_%llu_%05u.bmp", folder,
+             (unsigned long long)(slot->capture_time / 1000000), slot->sequence);
+
+    size_t size = encode_bmp(slot, format, buffer);
+
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        C64U_LOG_WARNING("Failed to create frame file: %s", filename);
+        return false;
+    }
+    bool ok = fwrite(buffer, 1, size, file) == size;
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        C64U_LOG_WARNING("Failed to write frame file: %s", filename);
+    }
+    return ok;
+}
+
+// Frame dump worker: takes queued slots in order and writes them; several workers run in parallel
+static void *framedump_thread_func(void *data)
+{
+    struct c64u_source *context = data;
+    uint8_t *buffer = bmalloc(FRAMEDUMP_MAX_FILE_SIZE);
+    char batch_folder[1024] = "";
+
+    pthread_mutex_lock(&context->recording_mutex);
+    while (true) {
+        while (context->framedump_pending_count == 0 && !context->framedump_shutdown) {
+            pthread_cond_wait(&context->framedump_cond, &context->recording_mutex);
+        }
+        if (context->framedump_pending_count == 0) {
+            break; // Shutdown with the queue drained
+        }
+
+        uint32_t index = context->framedump_pending[context->framedump_pending_head];
+        context->framedump_pending_head = (context->framedump_pending_head + 1) % C64U_FRAMEDUMP_SLOTS;
+        context->framedump_pending_count--;
+        context->framedump_busy_count++;
+        uint32_t format = context->framedump_format;
+        pthread_mutex_unlock(&context->recording_mutex);
+
+        bool ok = dump_frame(context, &context->framedump_slots[index], format, buffer, batch_folder,
+                             sizeof(batch_folder));
+
+        pthread_mutex_lock(&context->recording_mutex);
+        context->framedump_free[context->framedump_free_count++] = index;
+        context->framedump_busy_count--;
+        if (ok) {
+            context->framedump_written++;
+        } else {
+            context->framedump_failed++;
+        }
+
+        // Let the recording writer end the session once the last frame is out
+        if (!context->save_frames && context->framedump_pending_count == 0 && context->framedump_busy_count == 0) {
+            pthread_cond_signal(&context->record_cond);
+        }
+    }
+    pthread_mutex_unlock(&context->recording_mutex);
+
+    bfree(buffer);
+    return NULL;
+}
+
+// Allocate the slots and start the worker pool on first use (called with recording_mutex held)
+static void start_framedump_workers(struct c64u_source *context)
+{
+    if (context->framedump_thread_count > 0) {
+        return;
+    }
+
+    if (!context->framedump_slots) {
+        context->framedump_slots = bzalloc(sizeof(struct framedump_slot) * C64U_FRAMEDUMP_SLOTS);
+        if (!context->framedump_slots) {
+            C64U_LOG_ERROR("Failed to allocate frame dump queue");
+            return;
+        }
+        for (uint32_t i = 0; i < C64U_FRAMEDUMP_SLOTS; i++) {
+            context->framedump_free[i] = i;
+        }
+        context->framedump_free_count = C64U_FRAMEDUMP_SLOTS;
+    }
+
+    context->framedump_shutdown = false;
+    for (uint32_t i = 0; i < C64U_FRAMEDUMP_WORKERS; i++) {
+        if (pthread_create(&context->framedump_threads[i], NULL, framedump_thread_func, context) != 0) {
+            C64U_LOG_ERROR("Failed to create frame dump worker thread");
+            break;
+        }
+        context->framedump_thread_count++;
+    }
+}
+
+size_t c64u_framedump_memory(const struct c64u_source *context)
+{
+    return context->framedump_slots ? sizeof(struct framedump_slot) * C64U_FRAMEDUMP_SLOTS : 0;
+}
+
+void framedump_submit_frame(struct c64u_source *context, struct frame_assembly *frame)
+{
+    if (pthread_mutex_lock(&context->recording_mutex) != 0) {
+        return;
+    }
+
+    // Never wait for the disk: if every slot is queued or being written, this frame is not dumped
+    if (context->framedump_thread_count == 0 || context->framedump_free_count == 0) {
+        context->framedump_dropped++;
+        pthread_mutex_unlock(&context->recording_mutex);
+        return;
+    }
+
+    uint32_t index = context->framedump_free[--context->framedump_free_count];
+    struct framedump_slot *slot = &context->framedump_slots[index];
+
+    uint32_t height = context->height;
+    if (height > C64U_PAL_HEIGHT) {
+        height = C64U_PAL_HEIGHT;
+    }
+    c64u_core_frame_to_indexed(frame, slot->indexed_data, height);
+    slot->width = C64U_PIXELS_PER_LINE;
+    slot->height = height;
+    slot->sequence = context->saved_frame_count++;
+    slot->capture_time = os_gettime_ns();
+
+    uint32_t tail = (context->framedump_pending_head + context->framedump_pending_count) % C64U_FRAMEDUMP_SLOTS;
+    context->framedump_pending[tail] = index;
+    context->framedump_pending_count++;
+
+    pthread_cond_signal(&context->framedump_cond);
+    pthread_mutex_unlock(&context->recording_mutex);
+}
+
+void c64u_framedump_init(struct c64u_source *context)
+{
+    // Worker threads and their slots are created when frame saving is first enabled
+    context->framedump_format = C64U_FRAMEDUMP_FORMAT_BMP4;
+    context->framedump_thread_count = 0;
+    context->framedump_shutdown = false;
+    context->framedump_slots = NULL;
+    context->framedump_pending_head = 0;
+    context->framedump_pending_count = 0;
+    context->framedump_free_count = 0;
+    context->framedump_busy_count = 0;
+    context->framedump_written = 0;
+    context->framedump_dropped = 0;
+    context->framedump_failed = 0;
+    pthread_cond_init(&context->framedump_cond, NULL);
+}
+
+void c64u_framedump_cleanup(struct c64u_source *context)
+{
+    // Let the workers write the queued frames and exit
+    pthread_mutex_lock(&context->recording_mutex);
+    context->framedump_shutdown = true;
+    pthread_cond_broadcast(&context->framedump_cond);
+    pthread_mutex_unlock(&context->recording_mutex);
+
+    for (uint32_t i = 0; i < context->framedump_thread_count; i++) {
+        pthread_join(context->framedump_threads[i], NULL);
+    }
+    context->framedump_thread_count = 0;
+
+    bfree(context->framedump_slots);
+    context->framedump_slots = NULL;
+    pthread_cond_destroy(&context->framedump_cond);
+}
+
+void c64u_framedump_update_settings(struct c64u_source *context, void *settings_ptr)
+{
+    obs_data_t *settings = (obs_data_t *)settings_ptr;
+
+    pthread_mutex_lock(&context->recording_mutex);
+    context->framedump_format = (uint32_t)obs_data_get_int(settings, "save_frames_format");
+    if (context->framedump_format > C64U_FRAMEDUMP_FORMAT_BMP24) {
+        context->framedump_format = C64U_FRAMEDUMP_FORMAT_BMP4;
+    }
+    if (context->save_frames) {
+        start_framedump_workers(context);
+    }
+    pthread_mutex_unlock(&context->recording_mutex);
+}
@@ -0,0 +1,34 @@
+#ifndef C64U_FRAMEDUMP_H
+#define C64U_FRAMEDUMP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Frame dump worker pool sizing
+#define C64U_FRAMEDUMP_WORKERS 2
+#define C64U_FRAMEDUMP_SLOTS 16               // ~0.3s of PAL frames (16 x 52KB indexed)
+#define C64U_FRAMEDUMP_FRAMES_PER_FOLDER 1000 // Frames are batched into frames/NNNNN/ subfolders
+
+// Frame dump image formats (all bottom-up BMPs; indexed formats carry the VIC-II palette)
+#define C64U_FRAMEDUMP_FORMAT_BMP4 0  // 4-bit palettized, 52KB per PAL frame (the received indices as-is)
+#define C64U_FRAMEDUMP_FORMAT_RLE4 1  // 4-bit palettized with BI_RLE4 compression, typically a few KB
+#define C64U_FRAMEDUMP_FORMAT_BMP24 2 // 24-bit BGR, 313KB per PAL frame
+
+// Forward declarations
+struct c64u_source;
+struct frame_assembly;
+
+// Producer side, called from the video thread - copies the frame into a free slot or drops it
+void framedump_submit_frame(struct c64u_source *context, struct frame_assembly *frame);
+
+// Frame dump initialization and cleanup functions (init after c64u_record_init, cleanup before
+// c64u_record_cleanup: the workers use the recording mutex and session folder)
+void c64u_framedump_init(struct c64u_source *context);
+void c64u_framedump_cleanup(struct c64u_source *context);
+void c64u_framedump_update_settings(struct c64u_source *context, void *settings);
+
+// Bytes held by the frame dump slots (allocated when frame saving starts, 0 before)
+size_t c64u_framedump_memory(const struct c64u_source *context);
+
+#endif // C64U_FRAMEDUMP_H
@@ -0,0 +1,254 @@
+#include <obs-module.h>
+#include <pthread.h>
+#include <string.h>
+#include "c64u-logging.h"
+#include "c64u-memory.h"
+#include "c64u-types.h"
+#include "c64u-capture.h"
+#include "c64u-framedump.h"
+#include "c64u-record.h"
+#include "c64u-video.h"
+
+#define MB (1024.0 * 1024.0)
+
+// Registered sources; the lock is taken before any source's delay_mutex, never while holding one
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct c64u_source *registry;
+static bool registry_over_budget; // Last rebalance left nothing for delay queues
+
+void c64u_memory_usage(const struct c64u_source *context, struct c64u_memory_usage *usage)
+{
+    size_t frame_size = (size_t)C64U_PAL_WIDTH * C64U_PAL_HEIGHT * 4; // RGBA, see c64u_init_frame_pipeline()
+
+    usage->frame_assembly = sizeof(context->core.current_frame);
+    usage->source = sizeof(struct c64u_source) - usage->frame_assembly;
+    usage->frame_buffers = (context->output.front ? frame_size : 0) + (context->output.back ? frame_size : 0);
+    usage->delay_queue = c64u_delay_queue_bytes(context->output.queue.capacity);
+    usage->recording = c64u_record_memory(context);
+    usage->frame_dump = c64u_framedump_memory(context);
+    usage->capture = c64u_capture_memory(context);
+    usage->replay_buffer = c64u_replay_buffer_memory(context);
+    usage->total = usage->source + usage->frame_assembly + usage->frame_buffers + usage->delay_queue +
+                   usage->recording + usage->frame_dump + usage->capture + usage->replay_buffer;
+}
+
+uint32_t c64u_memory_render_delay(const struct c64u_source *context)
+{
+    uint32_t limit = context->delay_queue_limit;
+    return context->render_delay_frames < limit ? context->render_delay_frames : limit;
+}
+
+// Smallest non-zero budget setting in bytes, 0 if no source sets one (registry_mutex held)
+static uint64_t registry_budget(void)
+{
+    uint32_t budget_mb = 0;
+    for (struct c64u_source *source = registry; source; source = source->memory_next) {
+        if (source->memory_budget_mb > 0 && (budget_mb == 0 || source->memory_budget_mb < budget_mb)) {
+            budget_mb = source->memory_budget_mb;
+        }
+    }
+    return budget_mb * 1024ULL * 1024ULL;
+}
+
+// Sum of all sources' usage and of their delay queues (registry_mutex held)
+static size_t registry_total(uint32_t *sources, size_t *delay_queues)
+{
+    size_t total = 0;
+    *sources = 0;
+    *delay_queues = 0;
+    for (struct c64u_source *source = registry; source; source = source->memory_next) {
+        struct c64u_memory_usage usage;
+        c64u_memory_usage(source, &usage);
+        total += usage.total;
+        *delay_queues += usage.delay_queue;
+        (*sources)++;
+    }
+    return total;
+}
+
+// Delay frames the sources use if each gets at most level frames
+static uint64_t frames_at_level(uint32_t level)
+{
+    uint64_t frames = 0;
+    for (struct c64u_source *source = registry; source; source = source->memory_next) {
+        frames += source->render_delay_frames < level ? source->render_delay_frames : level;
+    }
+    return frames;
+}
+
+static void set_delay_queue_limit(struct c64u_source *context, uint32_t limit)
+{
+    uint32_t old_delay = c64u_memory_render_delay(context);
+    if (pthread_mutex_lock(&context->delay_mutex) != 0) {
+        return;
+    }
+    context->delay_queue_limit = limit;
+    uint32_t delay = c64u_memory_render_delay(context);
+    if (context->output.queue.frames && context->output.queue.capacity != delay) {
+        c64u_delay_queue_free(&context->output.queue); // Reallocated for the new delay on the next frame
+    }
+    pthread_mutex_unlock(&context->delay_mutex);
+
+    if (delay < old_delay) {
+        C64U_LOG_WARNING("🧠 MEMORY BUDGET: Render delay of '%s' capped to %u of %u frames",
+                         obs_source_get_name(context->source), delay, context->render_delay_frames);
+    } else if (delay > old_delay) {
+        C64U_LOG_INFO("🧠 MEMORY BUDGET: Render delay of '%s' raised to %u of %u frames",
+                      obs_source_get_name(context->source), delay, context->render_delay_frames);
+    }
+}
+
+void c64u_memory_rebalance(void)
+{
+    pthread_mutex_lock(&registry_mutex);
+
+    uint64_t budget = registry_budget();
+    if (budget == 0) {
+        registry_over_budget = false;
+        for (struct c64u_source *source = registry; source; source = source->memory_next) {
+            set_delay_queue_limit(source, UINT32_MAX);
+        }
+        pthread_mutex_unlock(&registry_mutex);
+        return;
+    }
+
+    // Everything but the delay queues is fixed; the rest of the budget buys delay frames
+    uint64_t fixed = 0;
+    for (struct c64u_source *source = registry; source; source = source->memory_next) {
+        struct c64u_memory_usage usage;
+        c64u_memory_usage(source, &usage);
+        fixed += usage.total - usage.delay_queue;
+    }
+    uint64_t frames = budget > fixed ? (budget - fixed) / c64u_delay_queue_bytes(1) : 0;
+
+    // Highest per-source level whose frames fit (each source's limit is its delay or the level, whichever is less)
+    uint32_t low = 0;
+    uint32_t high = C64U_MAX_RENDER_DELAY_FRAMES;
+    while (low < high) {
+        uint32_t level = (low + high + 1) / 2;
+        if (frames_at_level(level) <= frames) {
+            low = level;
+        } else {
+            high = level - 1;
+        }
+    }
+    for (struct c64u_source *source = registry; source; source = source->memory_next) {
+        set_delay_queue_limit(source, low);
+    }
+
+    bool over_budget = fixed >= budget;
+    if (over_budget && !registry_over_budget) {
+        C64U_LOG_WARNING("🧠 MEMORY BUDGET: %.0f MB budget used up by %.2f MB of other buffers, render delay is off",
+                         budget / MB, fixed / MB);
+    }
+    registry_over_budget = over_budget;
+
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+void c64u_memory_register(struct c64u_source *context)
+{
+    context->delay_queue_limit = UINT32_MAX;
+    context->memory_reported = 0;
+
+    pthread_mutex_lock(&registry_mutex);
+    context->memory_next = registry;
+    registry = context;
+    pthread_mutex_unlock(&registry_mutex);
+
+    c64u_memory_rebalance();
+}
+
+void c64u_memory_unregister(struct c64u_source *context)
+{
+    pthread_mutex_lock(&registry_mutex);
+    for (struct c64u_source **link = &registry; *link; link = &(*link)->memory_next) {
+        if (*link == context) {
+            *link = context->memory_next;
+            break;
+        }
+    }
+    context->memory_next = NULL;
+    pthread_mutex_unlock(&registry_mutex);
+
+    c64u_memory_rebalance(); // The remaining sources may get the freed share
+}
+
+void c64u_memory_set_budget(struct c64u_source *context, uint32_t budget_mb)
+{
+    if (budget_mb == context->memory_budget_mb) {
+        return;
+    }
+    pthread_mutex_lock(&registry_mutex);
+    context->memory_budget_mb = budget_mb;
+    pthread_mutex_unlock(&registry_mutex);
+
+    if (budget_mb > 0) {
+        C64U_LOG_INFO("Memory budget of '%s' set to %u MB", obs_source_get_name(context->source), budget_mb);
+    } else {
+        C64U_LOG_INFO("Memory budget of '%s' removed", obs_source_get_name(context->source));
+    }
+    c64u_memory_rebalance();
+}
+
+void c64u_memory_report(struct c64u_source *context)
+{
+    struct c64u_memory_usage usage;
+    c64u_memory_usage(context, &usage);
+    if (usage.total == context->memory_reported) {
+        return;
+    }
+    context->memory_reported = usage.total;
+
+    pthread_mutex_lock(&registry_mutex);
+    uint32_t sources;
+    size_t all_delay_queues;
+    size_t all_sources = registry_total(&sources, &all_delay_queues);
+    uint64_t budget = registry_budget();
+    pthread_mutex_unlock(&registry_mutex);
+
+    C64U_LOG_INFO("🧠 MEMORY: %.2f MB | Source %.2f | Assembly %.2f | Frame buffers %.2f | Delay queue %.2f "
+                  "(%u frames) | Recording %.2f | Frame dump %.2f | Capture %.2f | Replay buffer %.2f",
+                  usage.total / MB, usage.source / MB, usage.frame_assembly / MB, usage.frame_buffers / MB,
+                  usage.delay_queue / MB, context->output.queue.capacity, usage.recording / MB,
+                  usage.frame_dump / MB, usage.capture / MB, usage.replay_buffer / MB);
+    if (budget > 0) {
+        C64U_LOG_INFO("🧠 MEMORY: All %u sources %.2f MB of %.0f MB budget | Delay queues %.2f | Other buffers %.2f "
+                      "(counted, not limited)",
+                      sources, all_sources / MB, budget / MB, all_delay_queues / MB,
+                      (all_sources - all_delay_queues) / MB);
+    } else {
+        C64U_LOG_INFO("🧠 MEMORY: All %u sources %.2f MB (no budget)", sources, all_sources / MB);
+    }
+
+    // Recording, frame dumps, capture and the replay buffer change what the budget leaves for delay queues
+    c64u_memory_rebalance();
+}
+
+void c64u_memory_proc_get(void *data, calldata_t *cd)
+{
+    struct c64u_source *context = data;
+    struct c64u_memory_usage usage;
+    c64u_memory_usage(context, &usage);
+
+    pthread_mutex_lock(&registry_mutex);
+    uint32_t sources;
+    size_t all_delay_queues;
+    size_t all_sources = registry_total(&sources, &all_delay_queues);
+    uint64_t budget = registry_budget();
+    pthread_mutex_unlock(&registry_mutex);
+
+    calldata_set_int(cd, "total", (long long)usage.total);
+    calldata_set_int(cd, "source", (long long)usage.source);
+    calldata_set_int(cd, "frame_assembly", (long long)usage.frame_assembly);
+    calldata_set_int(cd, "frame_buffers", (long long)usage.frame_buffers);
+    calldata_set_int(cd, "delay_queue", (long long)usage.delay_queue);
+    calldata_set_int(cd, "recording", (long long)usage.recording);
+    calldata_set_int(cd, "frame_dump", (long long)usage.frame_dump);
+    calldata_set_int(cd, "capture", (long long)usage.capture);
+    calldata_set_int(cd, "replay_buffer", (long long)usage.replay_buffer);
+    calldata_set_int(cd, "all_sources", (long long)all_sources);
+    calldata_set_int(cd, "all_delay_queues", (long long)all_delay_queues);
+    calldata_set_int(cd, "all_other_buffers", (long long)(all_sources - all_delay_queues));
+    calldata_set_int(cd, "budget", (long long)budget);
+}
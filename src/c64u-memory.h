@@ -0,0 +1,62 @@
+#ifndef C64U_MEMORY_H
+#define C64U_MEMORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Memory accounting and the memory budget. Every source with a frame pipeline is registered; the budget shared by
+// all of them is the smallest non-zero "memory_budget_mb" setting. What the other buffers leave of it goes to the
+// render delay queues, and a source whose delay doesn't fit renders with fewer delay frames. The other buffers
+// (recording, frame dumps, capture, the replay buffer) count against the budget but are never limited.
+
+#define C64U_MEMORY_BUDGET_MAX_MB 4096 // Largest budget setting (MB, 0 = no limit)
+
+// Script procedure on each live source (calldata integers in bytes; budget 0 = no limit). all_delay_queues is what
+// the budget limits, all_other_buffers what it counts without limiting.
+#define C64U_MEMORY_PROC                                                                                   \
+    "void get_memory(out int total, out int source, out int frame_assembly, out int frame_buffers, "       \
+    "out int delay_queue, out int recording, out int frame_dump, out int capture, out int replay_buffer, " \
+    "out int all_sources, out int all_delay_queues, out int all_other_buffers, out int budget)"
+
+// Forward declarations
+struct c64u_source;
+struct calldata;
+
+// Bytes one source holds, by component
+struct c64u_memory_usage {
+    size_t source;         // struct c64u_source without the frame assembly (sockets, statistics, queue state)
+    size_t frame_assembly; // Frame being assembled, 4-bit pixels of the largest (PAL) frame
+    size_t frame_buffers;  // RGBA front and back buffers
+    size_t delay_queue;    // Render delay queue (allocated on the first delayed frame)
+    size_t recording;      // Recording queues and writer buffers
+    size_t frame_dump;     // Frame dump slots
+    size_t capture;        // Raw stream capture ring
+    size_t replay_buffer;  // Instant replay ring
+    size_t total;
+};
+
+// Source registry, called by c64u_init_frame_pipeline() and c64u_free_frame_pipeline()
+void c64u_memory_register(struct c64u_source *context);
+void c64u_memory_unregister(struct c64u_source *context);
+
+void c64u_memory_usage(const struct c64u_source *context, struct c64u_memory_usage *usage);
+
+// Change this source's budget setting (MB, 0 = no limit) and rebalance
+void c64u_memory_set_budget(struct c64u_source *context, uint32_t budget_mb);
+
+// Recompute the delay queue limits of all sources: the budget minus all other buffers is shared out in whole
+// frames, evenly, except that a source needing less than an even share keeps its full delay. Queues whose size
+// changes are freed and reallocated on their next frame. Takes each source's delay_mutex; don't hold one.
+void c64u_memory_rebalance(void);
+
+// Render delay in frames after the budget's cap
+uint32_t c64u_memory_render_delay(const struct c64u_source *context);
+
+// Log the 🧠 MEMORY lines and rebalance if this source's usage changed since the last report (video statistics)
+void c64u_memory_report(struct c64u_source *context);
+
+// get_memory procedure (C64U_MEMORY_PROC), data is the c64u_source
+void c64u_memory_proc_get(void *data, struct calldata *cd);
+
+#endif // C64U_MEMORY_H
@@ -0,0 +1,329 @@
+#include <obs-module.h>
+#include <util/platform.h>
+#include <string.h>
+#include <stdio.h>
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/opt.h>
+#include "c64u-logging.h"
+#include "c64u-mkv.h"
+#include "c64u-record.h"
+#include "c64u-core.h"
+#include "c64u-protocol.h"
+
+struct c64u_mkv_writer {
+    AVFormatContext *format;
+    AVCodecContext *encoder;
+    AVStream *video_stream;
+    AVStream *audio_stream;
+    AVFrame *frame;      // Reused for every frame (0RGB32, made writable before filling)
+    AVPacket *packet;    // Reused for every packet handed to the muxer
+    uint32_t colors[16]; // VIC-II palette as 0RGB32 pixels
+    int64_t video_pts;   // Frame periods written (encoded or repeated)
+    int64_t repeated;    // Frame periods repeated since the last encoded frame
+    int64_t audio_pts;   // Stereo samples written
+    char path[1024];
+    bool header_written;
+    bool failed;
+};
+
+// Mark the file as failed and log the first error only
+static void mkv_fail(struct c64u_mkv_writer *mkv, const char *what, int error)
+{
+    if (!mkv->failed) {
+        char message[AV_ERROR_MAX_STRING_SIZE];
+        av_strerror(error, message, sizeof(message));
+        C64U_LOG_ERROR("Failed to %s Matroska recording %s: %s", what, mkv->path, message);
+    }
+    mkv->failed = true;
+}
+
+// Hand every packet the encoder has finished to the muxer. Returns the bytes written.
+static size_t drain_encoder(struct c64u_mkv_writer *mkv)
+{
+    size_t written = 0;
+    while (!mkv->failed) {
+        int ret = avcodec_receive_packet(mkv->encoder, mkv->packet);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            break;
+        }
+        if (ret < 0) {
+            mkv_fail(mkv, "encode video for", ret);
+            break;
+        }
+
+        written += (size_t)mkv->packet->size;
+        av_packet_rescale_ts(mkv->packet, mkv->encoder->time_base, mkv->video_stream->time_base);
+        mkv->packet->stream_index = mkv->video_stream->index;
+        ret = av_interleaved_write_frame(mkv->format, mkv->packet); // Takes over the packet data
+        if (ret < 0) {
+            mkv_fail(mkv, "write", ret);
+        }
+    }
+    return written;
+}
+
+// FFV1 level 3 with the range coder: intra-only, lossless, CRC-protected slices that encode in parallel
+static bool open_video_encoder(struct c64u_mkv_writer *mkv, uint32_t width, uint32_t height, double fps)
+{
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_FFV1);
+    if (!codec) {
+        C64U_LOG_ERROR("FFmpeg has no FFV1 encoder, cannot record %s", mkv->path);
+        return false;
+    }
+
+    mkv->encoder = avcodec_alloc_context3(codec);
+    if (!mkv->encoder) {
+        return false;
+    }
+
+    // Leave one core for OBS rendering and one for the receive threads
+    int threads = os_get_logical_cores() - 2;
+    if (threads < 1) {
+        threads = 1;
+    } else if (threads > C64U_MKV_MAX_THREADS) {
+        threads = C64U_MKV_MAX_THREADS;
+    }
+
+    AVCodecContext *encoder = mkv->encoder;
+    encoder->width = (int)width;
+    encoder->height = (int)height;
+    encoder->pix_fmt = AV_PIX_FMT_0RGB32;
+    encoder->time_base = (AVRational){1000, (int)(fps * 1000.0 + 0.5)}; // Detected refresh rate, rounded
+    encoder->framerate = (AVRational){encoder->time_base.den, encoder->time_base.num};
+    encoder->gop_size = C64U_MKV_KEYFRAME_INTERVAL;
+    encoder->level = 3;
+    encoder->slices = C64U_MKV_SLICES;
+    encoder->thread_type = FF_THREAD_SLICE;
+    encoder->thread_count = threads;
+    av_opt_set(encoder->priv_data, "coder", "range_def", 0);
+    av_opt_set_int(encoder->priv_data, "context", 1, 0); // Large context model, smaller files for flat areas
+    if (mkv->format->oformat->flags & AVFMT_GLOBALHEADER) {
+        encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    int ret = avcodec_open2(encoder, codec, NULL);
+    if (ret < 0) {
+        mkv_fail(mkv, "open FFV1 encoder for", ret);
+        return false;
+    }
+
+    mkv->video_stream = avformat_new_stream(mkv->format, NULL);
+    if (!mkv->video_stream) {
+        return false;
+    }
+    ret = avcodec_parameters_from_context(mkv->video_stream->codecpar, encoder);
+    if (ret < 0) {
+        mkv_fail(mkv, "set up video stream for", ret);
+        return false;
+    }
+    mkv->video_stream->time_base = encoder->time_base;
+    mkv->video_stream->avg_frame_rate = encoder->framerate;
+
+    mkv->frame = av_frame_alloc();
+    if (!mkv->frame) {
+        return false;
+    }
+    mkv->frame->format = encoder->pix_fmt;
+    mkv->frame->width = encoder->width;
+    mkv->frame->height = encoder->height;
+    ret = av_frame_get_buffer(mkv->frame, 0);
+    if (ret < 0) {
+        mkv_fail(mkv, "allocate frame for", ret);
+        return false;
+    }
+
+    C64U_LOG_INFO("FFV1 encoder: %d slices, %d threads", C64U_MKV_SLICES, threads);
+    return true;
+}
+
+// 16-bit stereo PCM, muxed as is (no encoder needed)
+static bool add_audio_stream(struct c64u_mkv_writer *mkv)
+{
+    mkv->audio_stream = avformat_new_stream(mkv->format, NULL);
+    if (!mkv->audio_stream) {
+        return false;
+    }
+
+    AVCodecParameters *par = mkv->audio_stream->codecpar;
+    par->codec_type = AVMEDIA_TYPE_AUDIO;
+    par->codec_id = AV_CODEC_ID_PCM_S16LE;
+    par->format = AV_SAMPLE_FMT_S16;
+    par->sample_rate = C64U_RECORD_AUDIO_SAMPLE_RATE;
+    av_channel_layout_default(&par->ch_layout, 2);
+    par->bits_per_coded_sample = 16;
+    par->block_align = C64U_RECORD_AUDIO_FRAME_SIZE;
+    par->bit_rate = (int64_t)C64U_RECORD_AUDIO_SAMPLE_RATE * C64U_RECORD_AUDIO_FRAME_SIZE * 8;
+    mkv->audio_stream->time_base = (AVRational){1, C64U_RECORD_AUDIO_SAMPLE_RATE};
+    return true;
+}
+
+struct c64u_mkv_writer *c64u_mkv_create(const char *path, uint32_t width, uint32_t height, double fps,
+                                        bool audio)
+{
+    struct c64u_mkv_writer *mkv = bzalloc(sizeof(struct c64u_mkv_writer));
+    snprintf(mkv->path, sizeof(mkv->path), "%s", path);
+    for (uint32_t i = 0; i < 16; i++) {
+        uint32_t r = vic_colors[i] & 0xFF;
+        uint32_t g = (vic_colors[i] >> 8) & 0xFF;
+        uint32_t b = (vic_colors[i] >> 16) & 0xFF;
+        mkv->colors[i] = (r << 16) | (g << 8) | b;
+    }
+
+    int ret = avformat_alloc_output_context2(&mkv->format, NULL, "matroska", path);
+    if (ret < 0) {
+        mkv_fail(mkv, "create", ret);
+        c64u_mkv_close(mkv);
+        return NULL;
+    }
+
+    mkv->packet = av_packet_alloc();
+    if (!mkv->packet || !open_video_encoder(mkv, width, height, fps) || (audio && !add_audio_stream(mkv))) {
+        c64u_mkv_close(mkv);
+        return NULL;
+    }
+
+    ret = avio_open(&mkv->format->pb, path, AVIO_FLAG_WRITE);
+    if (ret < 0) {
+        mkv_fail(mkv, "open", ret);
+        c64u_mkv_close(mkv);
+        return NULL;
+    }
+
+    ret = avformat_write_header(mkv->format, NULL);
+    if (ret < 0) {
+        mkv_fail(mkv, "write header of", ret);
+        c64u_mkv_close(mkv);
+        return NULL;
+    }
+    mkv->header_written = true;
+    return mkv;
+}
+
+bool c64u_mkv_write_video(struct c64u_mkv_writer *mkv, const uint8_t *indexed, uint32_t lines,
+                          size_t *encoded_size)
+{
+    *encoded_size = 0;
+    if (mkv->failed) {
+        return false;
+    }
+
+    // Slice threads may still reference the previous frame's buffer
+    int ret = av_frame_make_writable(mkv->frame);
+    if (ret < 0) {
+        mkv_fail(mkv, "allocate frame for", ret);
+        return false;
+    }
+
+    uint32_t width = (uint32_t)mkv->encoder->width;
+    uint32_t height = (uint32_t)mkv->encoder->height;
+    for (uint32_t y = 0; y < height; y++) {
+        uint32_t *dst = (uint32_t *)(mkv->frame->data[0] + (size_t)y * mkv->frame->linesize[0]);
+        if (y >= lines) {
+            memset(dst, 0, width * 4);
+            continue;
+        }
+        const uint8_t *src = indexed + y * C64U_BYTES_PER_LINE;
+        for (uint32_t x = 0; x < width / 2; x++) {
+            dst[x * 2] = mkv->colors[src[x] & 0x0F];
+            dst[x * 2 + 1] = mkv->colors[src[x] >> 4];
+        }
+    }
+
+    mkv->frame->pts = mkv->video_pts++;
+    mkv->repeated = 0;
+    ret = avcodec_send_frame(mkv->encoder, mkv->frame);
+    if (ret < 0) {
+        mkv_fail(mkv, "encode video for", ret);
+        return false;
+    }
+    *encoded_size = drain_encoder(mkv);
+    return !mkv->failed;
+}
+
+void c64u_mkv_repeat_video(struct c64u_mkv_writer *mkv)
+{
+    if (mkv->video_pts > 0) {
+        mkv->video_pts++;
+        mkv->repeated++;
+    }
+}
+
+bool c64u_mkv_write_audio(struct c64u_mkv_writer *mkv, const uint8_t *pcm, uint32_t size)
+{
+    if (mkv->failed || !mkv->audio_stream) {
+        return false;
+    }
+
+    int ret = av_new_packet(mkv->packet, (int)size);
+    if (ret < 0) {
+        mkv_fail(mkv, "allocate audio packet for", ret);
+        return false;
+    }
+    memcpy(mkv->packet->data, pcm, size);
+
+    // Audio timestamps follow from the sample count, like in the AVI
+    int64_t samples = size / C64U_RECORD_AUDIO_FRAME_SIZE;
+    AVRational sample_time_base = {1, C64U_RECORD_AUDIO_SAMPLE_RATE};
+    mkv->packet->pts = mkv->audio_pts;
+    mkv->packet->dts = mkv->audio_pts;
+    mkv->packet->duration = samples;
+    mkv->packet->flags |= AV_PKT_FLAG_KEY;
+    mkv->packet->stream_index = mkv->audio_stream->index;
+    av_packet_rescale_ts(mkv->packet, sample_time_base, mkv->audio_stream->time_base);
+    mkv->audio_pts += samples;
+
+    ret = av_interleaved_write_frame(mkv->format, mkv->packet);
+    if (ret < 0) {
+        mkv_fail(mkv, "write", ret);
+    }
+    return !mkv->failed;
+}
+
+bool c64u_mkv_close(struct c64u_mkv_writer *mkv)
+{
+    if (!mkv)
+        return false;
+
+    if (mkv->header_written && !mkv->failed) {
+        // Repeats at the end have no following frame to stretch the last one to: encode it once more at the
+        // last timestamp so the file keeps its full duration (the frame buffer still holds the last frame)
+        int ret = 0;
+        if (mkv->repeated > 0) {
+            mkv->frame->pts = mkv->video_pts - 1;
+            ret = avcodec_send_frame(mkv->encoder, mkv->frame);
+            if (ret < 0) {
+                mkv_fail(mkv, "encode video for", ret);
+            }
+            drain_encoder(mkv);
+        }
+
+        // Flush frames still in the slice threads, then write cues and durations
+        ret = avcodec_send_frame(mkv->encoder, NULL);
+        if (ret < 0) {
+            mkv_fail(mkv, "encode video for", ret);
+        }
+        drain_encoder(mkv);
+
+        ret = av_write_trailer(mkv->format);
+        if (ret < 0) {
+            mkv_fail(mkv, "finish", ret);
+        }
+    }
+
+    if (mkv->format && mkv->format->pb) {
+        int ret = avio_closep(&mkv->format->pb);
+        if (ret < 0) {
+            mkv_fail(mkv, "close", ret);
+        }
+    }
+
+    bool ok = mkv->header_written && !mkv->failed;
+    av_frame_free(&mkv->frame);
+    av_packet_free(&mkv->packet);
+    avcodec_free_context(&mkv->encoder);
+    avformat_free_context(mkv->format);
+    bfree(mkv);
+    return ok;
+}
@@ -0,0 +1,37 @@
+#ifndef C64U_MKV_H
+#define C64U_MKV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Lossless Matroska recording writer: FFV1 video and PCM audio via FFmpeg (libavcodec/libavformat).
+// Only built when the plugin is configured with ENABLE_FFV1_RECORDING (defines C64U_HAVE_FFMPEG).
+#define C64U_MKV_SLICES 4             // FFV1 slices per frame, encoded in parallel by the slice threads
+#define C64U_MKV_MAX_THREADS 4        // Encoder threads, limited to the cores left over by OBS and the receivers
+#define C64U_MKV_KEYFRAME_INTERVAL 50 // ~1s, FFV1 resets its context model on keyframes
+
+struct c64u_mkv_writer;
+
+// Create the file and write the Matroska header for a width x height video at fps and, with audio, a 48kHz
+// 16-bit stereo PCM stream. Returns NULL on error (logged).
+struct c64u_mkv_writer *c64u_mkv_create(const char *path, uint32_t width, uint32_t height, double fps,
+                                        bool audio);
+
+// Encode one frame of packed 4-bit VIC indices (C64U_BYTES_PER_LINE per line, low nibble is the left pixel).
+// Lines from lines to the recorded height stay black. encoded_size receives the compressed size handed to the
+// muxer. Returns false once the file failed; the error is logged once.
+bool c64u_mkv_write_video(struct c64u_mkv_writer *mkv, const uint8_t *indexed, uint32_t lines,
+                          size_t *encoded_size);
+
+// Show the previous frame one frame period longer instead of encoding an identical frame: only the timestamps
+// of the following frames move on (variable frame rate)
+void c64u_mkv_repeat_video(struct c64u_mkv_writer *mkv);
+
+// Append interleaved 16-bit stereo PCM samples (size in bytes)
+bool c64u_mkv_write_audio(struct c64u_mkv_writer *mkv, const uint8_t *pcm, uint32_t size);
+
+// Flush the encoder, write the Matroska trailer (cues and durations) and close the file. Frees the writer.
+bool c64u_mkv_close(struct c64u_mkv_writer *mkv);
+
+#endif // C64U_MKV_H
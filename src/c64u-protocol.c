@@ -5,6 +5,7 @@
 #include "c64u-logging.h"
 #include "c64u-protocol.h"
 #include "c64u-network.h"
+#include "c64u-resolve.h"
 #include "c64u-source.h"
 #include "c64u-types.h"
 #include "c64u-video.h"
@@ -99,7 +100,7 @@ void init_async_retry_system(struct c64u_source *context)
     pthread_mutex_init(&context->retry_mutex, NULL);
     pthread_cond_init(&context->retry_cond, NULL);
     context->retry_thread_active = false;
-    context->needs_retry = false;
+    context->needs_retry = true; // Connect right away instead of after C64U_FRAME_TIMEOUT_NS without packets
     context->retry_count = 0;
     context->retry_shutdown = false;
     context->last_udp_packet_time = os_gettime_ns();
@@ -129,6 +130,74 @@ void shutdown_async_retry_system(struct c64u_source *context)
     pthread_cond_destroy(&context->retry_cond);
 }
 
+// Wait on retry_cond (retry_mutex held) until signaled or timeout_ms passed
+static void wait_for_retry_signal(struct c64u_source *context, uint32_t timeout_ms)
+{
+    // The deadline is wall clock time: os_gettime_ns() is monotonic, and a deadline taken from it lies in the past,
+    // which turned this wait into a busy loop costing most of a core per source
+    struct timespec timeout_spec;
+    timespec_get(&timeout_spec, TIME_UTC);
+    uint64_t nsec = (uint64_t)timeout_spec.tv_nsec + timeout_ms * 1000000ULL;
+    timeout_spec.tv_sec += (time_t)(nsec / 1000000000ULL); // Carry into seconds
+    timeout_spec.tv_nsec = (long)(nsec % 1000000000ULL);   // Remaining nanoseconds
+    pthread_cond_timedwait(&context->retry_cond, &context->retry_mutex, &timeout_spec);
+}
+
+// Resolve context->hostname (retry_mutex held, released during the lookup). Returns with the mutex held.
+static void resolve_pending_host(struct c64u_source *context)
+{
+    char hostname[sizeof(context->hostname)];
+    char dns_server[sizeof(context->dns_server_ip)];
+    char ip[sizeof(context->ip_address)];
+    memcpy(hostname, context->hostname, sizeof(hostname));
+    memcpy(dns_server, context->dns_server_ip, sizeof(dns_server));
+    context->host_resolve_pending = false;
+    pthread_mutex_unlock(&context->retry_mutex);
+
+    uint64_t start = os_gettime_ns();
+    bool resolved = c64u_resolve_hostname_with_dns(hostname, dns_server, ip, sizeof(ip));
+    double resolve_ms = (os_gettime_ns() - start) / 1000000.0;
+
+    pthread_mutex_lock(&context->retry_mutex);
+    if (context->host_resolve_pending) {
+        return; // Changed by c64u_update() meanwhile; the next pass resolves the new host
+    }
+    if (resolved) {
+        memcpy(context->ip_address, ip, sizeof(ip));
+        context->needs_retry = true;
+        C64U_LOG_INFO("Resolved C64U host '%s' to IP: %s (%.0f ms)", hostname, ip, resolve_ms);
+    } else {
+        context->host_resolve_pending = true;
+        C64U_LOG_WARNING("Could not resolve hostname '%s' (%.0f ms), trying again in %d s", hostname, resolve_ms,
+                         C64U_RESOLVE_RETRY_MS / 1000);
+        wait_for_retry_signal(context, C64U_RESOLVE_RETRY_MS);
+    }
+}
+
+// Detect this machine's IP address for the start commands (retry_mutex held, released during the interface scan).
+// Falls back to localhost and saves the address to the settings, as before. Returns with the mutex held.
+static void detect_pending_local_ip(struct c64u_source *context)
+{
+    char ip[sizeof(context->obs_ip_address)];
+    context->local_ip_detect_pending = false;
+    pthread_mutex_unlock(&context->retry_mutex);
+
+    bool detected = c64u_detect_local_ip(ip, sizeof(ip));
+    if (detected) {
+        C64U_LOG_INFO("Successfully detected OBS IP address: %s", ip);
+    } else {
+        C64U_LOG_WARNING("Failed to detect OBS IP address, using localhost as fallback");
+        snprintf(ip, sizeof(ip), "%s", "127.0.0.1");
+    }
+    obs_data_t *settings = obs_source_get_settings(context->source);
+    obs_data_set_string(settings, "obs_ip_address", ip);
+    obs_data_release(settings);
+
+    pthread_mutex_lock(&context->retry_mutex);
+    memcpy(context->obs_ip_address, ip, sizeof(ip));
+    context->initial_ip_detected = detected;
+}
+
 void *async_retry_thread(void *data)
 {
     struct c64u_source *context = (struct c64u_source *)data;
@@ -144,6 +213,18 @@ void *async_retry_thread(void *data)
             break;
         }
 
+        // The local address and a new hostname are resolved before anything else; connection attempts need both
+        if (context->local_ip_detect_pending) {
+            detect_pending_local_ip(context);
+            pthread_mutex_unlock(&context->retry_mutex);
+            continue;
+        }
+        if (context->host_resolve_pending) {
+            resolve_pending_host(context);
+            pthread_mutex_unlock(&context->retry_mutex);
+            continue;
+        }
+
         // Check if we need to retry based on timeout or explicit request
         uint64_t now = os_gettime_ns();
         uint64_t time_since_udp = now - context->last_udp_packet_time;
@@ -165,10 +246,12 @@ void *async_retry_thread(void *data)
                           context->streaming ? "sending start commands" : "starting streaming");
 
             bool tcp_success = false;
+            bool started = false;
             if (!context->streaming) {
                 // Not streaming - need to create UDP sockets and threads
                 c64u_start_streaming(context);
                 tcp_success = true; // c64u_start_streaming handles TCP commands internally
+                started = context->streaming;
             } else {
                 // Already streaming - send start commands and check for success
                 socket_t test_sock = create_tcp_socket(context->ip_address, C64U_CONTROL_PORT);
@@ -199,15 +282,12 @@ void *async_retry_thread(void *data)
                 C64U_LOG_DEBUG("TCP connection failed (%u consecutive), using %ums retry delay",
                                context->consecutive_failures, retry_delay);
             }
-            os_sleep_ms(retry_delay);
+            if (!started) {
+                os_sleep_ms(retry_delay); // After starting, the queued start commands go out on the next pass
+            }
         } else {
             // Wait up to 100ms for signal, then check timeout again
-            // Use absolute time for better cross-platform compatibility
-            struct timespec timeout_spec;
-            uint64_t now_ns = os_gettime_ns();
-            timeout_spec.tv_sec = (now_ns + 100000000ULL) / 1000000000ULL;  // Convert to seconds
-            timeout_spec.tv_nsec = (now_ns + 100000000ULL) % 1000000000ULL; // Remaining nanoseconds
-            pthread_cond_timedwait(&context->retry_cond, &context->retry_mutex, &timeout_spec);
+            wait_for_retry_signal(context, 100);
             pthread_mutex_unlock(&context->retry_mutex);
         }
     }
@@ -13,6 +13,7 @@
 #define C64U_DEFAULT_VIDEO_PORT 11000
 #define C64U_DEFAULT_AUDIO_PORT 11001
 #define C64U_DEFAULT_HOST "c64u"
+#define C64U_RESOLVE_RETRY_MS 5000 // Wait before resolving a hostname again after a failed lookup
 
 // Video format constants
 #define C64U_PAL_WIDTH 384
@@ -0,0 +1,259 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // O_DIRECT, fallocate()
+#endif
+
+#include <obs-module.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "c64u-logging.h"
+#include "c64u-recfile.h"
+
+struct c64u_recfile {
+    int fd;         // Appends (O_DIRECT with direct I/O on Linux)
+    int patch_fd;   // Patches of already written blocks; a second, buffered descriptor for O_DIRECT files
+    uint8_t *block; // bmalloc'ed buffer, aligned to C64U_RECFILE_ALIGNMENT in buffer
+    uint8_t *buffer;
+    size_t buffered;    // Bytes in buffer
+    uint64_t flushed;   // File position of buffer[0], always aligned
+    uint64_t allocated; // Preallocated up to here
+    bool direct;
+    bool failed;
+    char path[1024];
+};
+
+static void recfile_fail(struct c64u_recfile *file, const char *what)
+{
+    if (!file->failed) {
+        C64U_LOG_ERROR("Failed to %s recording file %s: %s", what, file->path, strerror(errno));
+    }
+    file->failed = true;
+}
+
+static bool sys_pwrite(int fd, const void *data, size_t size, uint64_t pos)
+{
+#ifdef _WIN32
+    return _lseeki64(fd, (__int64)pos, SEEK_SET) >= 0 && _write(fd, data, (unsigned int)size) == (int)size;
+#else
+    const uint8_t *p = data;
+    while (size > 0) {
+        ssize_t n = pwrite(fd, p, size, (off_t)pos);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        pos += (uint64_t)n;
+        size -= (size_t)n;
+    }
+    return true;
+#endif
+}
+
+// Reserve disk space ahead of the writes, so the file system can lay the file out contiguously and a full
+// disk shows up early. Best effort: not every platform and file system supports it.
+static void preallocate(struct c64u_recfile *file, uint64_t end)
+{
+    if (end <= file->allocated) {
+        return;
+    }
+    uint64_t length = C64U_RECFILE_PREALLOCATE;
+#if defined(__linux__)
+    // Keep the file size, so a crash doesn't leave a tail of zeros
+    fallocate(file->fd, FALLOC_FL_KEEP_SIZE, (off_t)file->allocated, (off_t)length);
+#elif defined(__APPLE__)
+    fstore_t store = {F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, (off_t)length, 0};
+    if (fcntl(file->fd, F_PREALLOCATE, &store) == -1) {
+        store.fst_flags = F_ALLOCATEALL;
+        fcntl(file->fd, F_PREALLOCATE, &store);
+    }
+#endif
+    file->allocated += length;
+}
+
+// Write size bytes (a multiple of the alignment, except without direct I/O) from the buffer at flushed
+static bool write_blocks(struct c64u_recfile *file, size_t size)
+{
+    if (file->failed) {
+        return false;
+    }
+    preallocate(file, file->flushed + size);
+
+    if (sys_pwrite(file->fd, file->buffer, size, file->flushed)) {
+        return true;
+    }
+#ifdef O_DIRECT
+    // Some file systems accept O_DIRECT at open but not for writes; continue buffered
+    if (file->direct && errno == EINVAL) {
+        C64U_LOG_WARNING("Direct I/O not supported for %s, using buffered writes", file->path);
+        file->direct = false;
+        fcntl(file->fd, F_SETFL, fcntl(file->fd, F_GETFL) & ~O_DIRECT);
+        if (sys_pwrite(file->fd, file->buffer, size, file->flushed)) {
+            return true;
+        }
+    }
+#endif
+    recfile_fail(file, "write");
+    return false;
+}
+
+static int open_file(const char *path, int extra_flags)
+{
+#ifdef _WIN32
+    return _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY | extra_flags, _S_IREAD | _S_IWRITE);
+#else
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC | extra_flags, 0644);
+#endif
+}
+
+struct c64u_recfile *c64u_recfile_open(const char *path, bool direct_io)
+{
+    struct c64u_recfile *file = bzalloc(sizeof(struct c64u_recfile));
+    snprintf(file->path, sizeof(file->path), "%s", path);
+    file->fd = -1;
+    file->patch_fd = -1;
+
+#ifdef O_DIRECT
+    if (direct_io) {
+        file->fd = open_file(path, O_DIRECT);
+        file->patch_fd = file->fd >= 0 ? open(path, O_WRONLY) : -1;
+        if (file->patch_fd >= 0) {
+            file->direct = true;
+        } else {
+            C64U_LOG_WARNING("Direct I/O not supported for %s, using buffered writes", path);
+            if (file->fd >= 0) {
+                close(file->fd);
+                file->fd = -1;
+            }
+        }
+    }
+#endif
+    if (file->fd < 0) {
+        file->fd = open_file(path, 0);
+#ifdef F_NOCACHE
+        if (file->fd >= 0 && direct_io) {
+            file->direct = fcntl(file->fd, F_NOCACHE, 1) != -1;
+        }
+#endif
+    }
+    if (file->patch_fd < 0) {
+        file->patch_fd = file->fd;
+    }
+    if (file->fd < 0) {
+        recfile_fail(file, "create");
+        c64u_recfile_close(file);
+        return NULL;
+    }
+
+    file->block = bmalloc(C64U_RECFILE_BUFFER_SIZE + C64U_RECFILE_ALIGNMENT);
+    file->buffer = (uint8_t *)(((uintptr_t)file->block + C64U_RECFILE_ALIGNMENT - 1) &
+                               ~(uintptr_t)(C64U_RECFILE_ALIGNMENT - 1));
+    return file;
+}
+
+bool c64u_recfile_write(struct c64u_recfile *file, const void *data, size_t size)
+{
+    const uint8_t *p = data;
+    while (size > 0 && !file->failed) {
+        size_t n = C64U_RECFILE_BUFFER_SIZE - file->buffered;
+        if (n > size) {
+            n = size;
+        }
+        memcpy(file->buffer + file->buffered, p, n);
+        file->buffered += n;
+        p += n;
+        size -= n;
+
+        if (file->buffered == C64U_RECFILE_BUFFER_SIZE && write_blocks(file, C64U_RECFILE_BUFFER_SIZE)) {
+            file->flushed += C64U_RECFILE_BUFFER_SIZE;
+            file->buffered = 0;
+        }
+    }
+    return !file->failed;
+}
+
+bool c64u_recfile_patch(struct c64u_recfile *file, uint64_t pos, const void *data, size_t size)
+{
+    if (file->failed) {
+        return false;
+    }
+
+    // The part still in the buffer is patched in memory, the part already on disk through patch_fd, whose
+    // blocks are never written again by the appends
+    const uint8_t *p = data;
+    if (pos < file->flushed) {
+        size_t n = pos + size > file->flushed ? (size_t)(file->flushed - pos) : size;
+        if (!sys_pwrite(file->patch_fd, p, n, pos)) {
+            recfile_fail(file, "update");
+            return false;
+        }
+        p += n;
+        pos += n;
+        size -= n;
+    }
+    if (size > 0) {
+        memcpy(file->buffer + (pos - file->flushed), p, size);
+    }
+    return true;
+}
+
+bool c64u_recfile_sync(struct c64u_recfile *file)
+{
+    if (file->buffered == 0) {
+        return !file->failed;
+    }
+
+    // Direct I/O can only write whole blocks: pad the tail and rewrite it from flushed next time
+    size_t size = file->buffered;
+    if (file->direct) {
+        size = (size + C64U_RECFILE_ALIGNMENT - 1) & ~(size_t)(C64U_RECFILE_ALIGNMENT - 1);
+        memset(file->buffer + file->buffered, 0, size - file->buffered);
+    }
+    return write_blocks(file, size);
+}
+
+uint64_t c64u_recfile_size(const struct c64u_recfile *file)
+{
+    return file->flushed + file->buffered;
+}
+
+bool c64u_recfile_close(struct c64u_recfile *file)
+{
+    if (!file)
+        return false;
+
+    if (file->fd >= 0) {
+        c64u_recfile_sync(file);
+#ifdef _WIN32
+        if (_chsize_s(file->fd, (__int64)c64u_recfile_size(file)) != 0) {
+#else
+        if (ftruncate(file->fd, (off_t)c64u_recfile_size(file)) != 0) {
+#endif
+            recfile_fail(file, "finish");
+        }
+#ifdef _WIN32
+        _close(file->fd);
+#else
+        if (file->patch_fd != file->fd) {
+            close(file->patch_fd);
+        }
+        if (close(file->fd) != 0) {
+            recfile_fail(file, "close");
+        }
+#endif
+    }
+
+    bool ok = file->fd >= 0 && !file->failed;
+    bfree(file->block);
+    bfree(file);
+    return ok;
+}
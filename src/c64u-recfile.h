@@ -0,0 +1,38 @@
+#ifndef C64U_RECFILE_H
+#define C64U_RECFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Append-mostly recording file: data is collected in an aligned buffer and written in whole blocks, the disk
+// space is preallocated ahead of the writes, and with direct I/O the writes bypass the page cache (O_DIRECT on
+// Linux, F_NOCACHE on macOS, plain buffered I/O elsewhere).
+#define C64U_RECFILE_ALIGNMENT 4096                     // Write offset/size granularity (and buffer alignment)
+#define C64U_RECFILE_BUFFER_SIZE (1024u * 1024u)        // Bytes collected before a write
+#define C64U_RECFILE_PREALLOCATE (64ull * 1024u * 1024u) // Disk space reserved ahead of the writes
+
+struct c64u_recfile;
+
+// Create or truncate the file. Direct I/O falls back to buffered I/O if the file system doesn't support it.
+// Returns NULL on error (logged).
+struct c64u_recfile *c64u_recfile_open(const char *path, bool direct_io);
+
+// Append data. Returns false once the file failed; the error is logged once.
+bool c64u_recfile_write(struct c64u_recfile *file, const void *data, size_t size);
+
+// Overwrite data that was appended before (headers, sizes, indexes)
+bool c64u_recfile_patch(struct c64u_recfile *file, uint64_t pos, const void *data, size_t size);
+
+// Write out everything appended so far, so the file is complete on disk up to here (the last block is padded
+// with zeros until more data or the close replaces the padding)
+bool c64u_recfile_sync(struct c64u_recfile *file);
+
+// Bytes appended so far
+uint64_t c64u_recfile_size(const struct c64u_recfile *file);
+
+// Write the remaining data, cut the file to its size (releasing the preallocated space) and close it.
+// Frees the file.
+bool c64u_recfile_close(struct c64u_recfile *file);
+
+#endif // C64U_RECFILE_H
@@ -10,6 +10,15 @@
 #include "c64u-logging.h"
 #include "c64u-record.h"
 #include "c64u-types.h"
+#include "c64u-video.h"
+#include "c64u-protocol.h"
+#include "c64u-rle.h"
+#include "c64u-avi.h"
+#include "c64u-framedump.h"
+#include "c64u-flac.h"
+#ifdef C64U_HAVE_FFMPEG
+#include "c64u-mkv.h"
+#endif
 
 #ifndef S_ISDIR
 #ifdef _WIN32
@@ -18,7 +27,7 @@
 #endif
 
 // Helper function to create directories recursively (cross-platform)
-static bool create_directory_recursive(const char *path)
+bool create_directory_recursive(const char *path)
 {
     char tmp[1024];
     char *p = NULL;
@@ -26,6 +35,8 @@ static bool create_directory_recursive(const char *path)
 
     snprintf(tmp, sizeof(tmp), "%s", path);
     len = strlen(tmp);
+    if (len == 0)
+        return false;
     if (tmp[len - 1] == '/' || tmp[len - 1] == '\\')
         tmp[len - 1] = 0;
 
@@ -65,192 +76,215 @@ static bool create_directory_recursive(const char *path)
     return true;
 }
 
-// Helper function to write minimal, standard-compliant AVI header
-static void write_avi_header(FILE *file, uint32_t width, uint32_t height, double fps)
+// Bits per pixel of the DIB frames written for a recording format
+static uint16_t record_format_bit_count(uint32_t format)
 {
-    uint32_t frame_size = width * height * 3; // BGR24 bytes per frame
-    uint32_t zero = 0;
+    switch (format) {
+    case C64U_RECORD_FORMAT_PAL8:
+    case C64U_RECORD_FORMAT_RLE8:
+        return 8;
+    case C64U_RECORD_FORMAT_PAL4:
+    case C64U_RECORD_FORMAT_RLE4:
+        return 4;
+    default:
+        return 24;
+    }
+}
+
+// DIB compression (biCompression) of a recording format
+static uint32_t record_format_compression(uint32_t format)
+{
+    switch (format) {
+    case C64U_RECORD_FORMAT_RLE8:
+        return C64U_BI_RLE8;
+    case C64U_RECORD_FORMAT_RLE4:
+        return C64U_BI_RLE4;
+    default:
+        return 0; // BI_RGB
+    }
+}
 
-    // Calculate precise frame period in microseconds
-    uint32_t frame_period = (uint32_t)(1000000.0 / fps + 0.5); // Round to nearest microsecond
-
-    // RIFF header (will update file size later)
-    fwrite("RIFF", 1, 4, file);
-    uint32_t file_size_placeholder = 0;
-    fwrite(&file_size_placeholder, 4, 1, file);
-    fwrite("AVI ", 1, 4, file);
-
-    // LIST hdrl chunk
-    fwrite("LIST", 1, 4, file);
-    uint32_t hdrl_size = 4 + 56 + (4 + 48 + 4 + 40); // hdrl + avih + video_strl (NO AUDIO)
-    fwrite(&hdrl_size, 4, 1, file);
-    fwrite("hdrl", 1, 4, file);
-
-    // Main AVI header (avih)
-    fwrite("avih", 1, 4, file);
-    uint32_t avih_size = 56;
-    fwrite(&avih_size, 4, 1, file);
-
-    uint32_t max_bytes_per_sec = (uint32_t)(frame_size * fps);
-
-    fwrite(&frame_period, 4, 1, file);      // dwMicroSecPerFrame
-    fwrite(&max_bytes_per_sec, 4, 1, file); // dwMaxBytesPerSec
-    fwrite(&zero, 4, 1, file);              // dwPaddingGranularity
-    fwrite(&zero, 4, 1, file);              // dwFlags
-    fwrite(&zero, 4, 1, file);              // dwTotalFrames (update later)
-    fwrite(&zero, 4, 1, file);              // dwInitialFrames
-    uint32_t one = 1;
-    fwrite(&one, 4, 1, file);        // dwStreams (video only)
-    fwrite(&frame_size, 4, 1, file); // dwSuggestedBufferSize
-    fwrite(&width, 4, 1, file);      // dwWidth
-    fwrite(&height, 4, 1, file);     // dwHeight
-    fwrite(&zero, 4, 1, file);       // dwReserved[0]
-    fwrite(&zero, 4, 1, file);       // dwReserved[1]
-    fwrite(&zero, 4, 1, file);       // dwReserved[2]
-    fwrite(&zero, 4, 1, file);       // dwReserved[3]
-
-    // LIST strl chunk (stream list)
-    fwrite("LIST", 1, 4, file);
-    uint32_t strl_size = 4 + 48 + 4 + 40; // strl + strh + strf + BITMAPINFOHEADER
-    fwrite(&strl_size, 4, 1, file);
-    fwrite("strl", 1, 4, file);
-
-    // Stream header (strh)
-    fwrite("strh", 1, 4, file);
-    uint32_t strh_size = 48;
-    fwrite(&strh_size, 4, 1, file);
-    fwrite("vids", 1, 4, file);     // fccType (video)
-    fwrite("\0\0\0\0", 1, 4, file); // fccHandler (uncompressed)
-    fwrite(&zero, 4, 1, file);      // dwFlags
-    uint16_t priority = 0;
-    fwrite(&priority, 2, 1, file); // wPriority
-    uint16_t language = 0;
-    fwrite(&language, 2, 1, file); // wLanguage
-    fwrite(&zero, 4, 1, file);     // dwInitialFrames
-    // Use detected refresh rate for scale/rate
-    uint32_t scale = 1000000;
-    fwrite(&scale, 4, 1, file);                        // dwScale
-    uint32_t rate = (uint32_t)(fps * 1000000.0 + 0.5); // Rate in scale units, rounded
-    fwrite(&rate, 4, 1, file);                         // dwRate
-    fwrite(&zero, 4, 1, file);                         // dwStart
-    fwrite(&zero, 4, 1, file);                         // dwLength (update later)
-    fwrite(&frame_size, 4, 1, file);                   // dwSuggestedBufferSize
-    uint32_t quality = 0xFFFFFFFF;
-    fwrite(&quality, 4, 1, file); // dwQuality (-1 = default)
-    fwrite(&zero, 4, 1, file);    // dwSampleSize (0 for video)
-
-    // Stream format (strf) - BITMAPINFOHEADER
-    fwrite("strf", 1, 4, file);
-    uint32_t strf_size = 40; // BITMAPINFOHEADER size
-    fwrite(&strf_size, 4, 1, file);
-
-    // BITMAPINFOHEADER
-    fwrite(&strf_size, 4, 1, file); // biSize
-    fwrite(&width, 4, 1, file);     // biWidth
-    int32_t negative_height = -(int32_t)height;
-    fwrite(&negative_height, 4, 1, file); // biHeight (negative = top-down)
+// Bytes per uncompressed DIB frame (rows padded to 4 bytes as required for BI_RGB bitmaps); for the RLE
+// formats this is the decoded size, which is what players allocate per frame
+static uint32_t record_format_frame_size(uint32_t format, uint32_t width, uint32_t height)
+{
+    uint32_t row_size = ((width * record_format_bit_count(format) + 31) / 32) * 4;
+    return row_size * height;
+}
+
+// Create video.avi with the video stream in the given format and, with audio, the PCM audio stream interleaved
+// (OpenDML, see c64u-avi.h)
+static struct c64u_avi_writer *create_avi_file(const char *path, uint32_t width, uint32_t height, double fps,
+                                               uint32_t format, bool audio_stream, bool direct_io)
+{
+    uint32_t frame_size = record_format_frame_size(format, width, height);
+    uint16_t bit_count = record_format_bit_count(format);
+    uint32_t compression = record_format_compression(format);
+    uint32_t colors_used = bit_count <= 8 ? 16 : 0; // VIC-II palette as RGBQUADs
+
+    // Stream format (strf) - BITMAPINFO (header + palette for indexed formats)
+    uint8_t bitmap_info[40 + 16 * 4];
+    uint8_t *p = bitmap_info;
+    uint32_t bih_size = 40;
+    // BGR24 is stored top-down; indexed frames bottom-up, which every decoder accepts for palettized DIBs
+    // (and RLE bitmaps can only be bottom-up)
+    int32_t dib_height = bit_count == 24 ? -(int32_t)height : (int32_t)height;
     uint16_t planes = 1;
-    fwrite(&planes, 2, 1, file); // biPlanes
-    uint16_t bit_count = 24;
-    fwrite(&bit_count, 2, 1, file); // biBitCount
-    fwrite(&zero, 4, 1, file);      // biCompression (0 = uncompressed)
-    uint32_t image_size = frame_size;
-    fwrite(&image_size, 4, 1, file); // biSizeImage
-    fwrite(&zero, 4, 1, file);       // biXPelsPerMeter
-    fwrite(&zero, 4, 1, file);       // biYPelsPerMeter
-    fwrite(&zero, 4, 1, file);       // biClrUsed
-    fwrite(&zero, 4, 1, file);       // biClrImportant
+    uint32_t zero = 0;
+    memcpy(p, &bih_size, 4);         // biSize
+    memcpy(p + 4, &width, 4);        // biWidth
+    memcpy(p + 8, &dib_height, 4);   // biHeight (negative = top-down)
+    memcpy(p + 12, &planes, 2);      // biPlanes
+    memcpy(p + 14, &bit_count, 2);   // biBitCount
+    memcpy(p + 16, &compression, 4); // biCompression (0 = BI_RGB, 1 = BI_RLE8, 2 = BI_RLE4)
+    memcpy(p + 20, &frame_size, 4);  // biSizeImage
+    memcpy(p + 24, &zero, 4);        // biXPelsPerMeter
+    memcpy(p + 28, &zero, 4);        // biYPelsPerMeter
+    memcpy(p + 32, &colors_used, 4); // biClrUsed
+    memcpy(p + 36, &colors_used, 4); // biClrImportant
+
+    // RGBQUAD palette (blue, green, red, reserved) with the VIC-II colors
+    for (uint32_t i = 0; i < colors_used; i++) {
+        uint8_t *quad = p + 40 + i * 4;
+        quad[0] = (vic_colors[i] >> 16) & 0xFF;
+        quad[1] = (vic_colors[i] >> 8) & 0xFF;
+        quad[2] = vic_colors[i] & 0xFF;
+        quad[3] = 0;
+    }
+
+    struct c64u_avi_stream_info video = {
+        .type = {'v', 'i', 'd', 's'},
+        .scale = 1000000,
+        .rate = (uint32_t)(fps * 1000000.0 + 0.5), // Detected refresh rate in scale units, rounded
+        .sample_size = 0,
+        .suggested_buffer_size = frame_size,
+        .format = bitmap_info,
+        .format_size = 40 + colors_used * 4,
+    };
+    memcpy(video.handler, compression ? "mrle" : "\0\0\0\0", 4); // Microsoft RLE or uncompressed
+    memcpy(video.chunk_id, compression ? "00dc" : "00db", 4);   // Stream 0, compressed or uncompressed DIB
+
+    // Audio stream format (strf) - WAVEFORMATEX, 16-bit stereo PCM
+    uint8_t wave_format[18] = {0};
+    uint16_t format_tag = 1; // WAVE_FORMAT_PCM
+    uint16_t channels = 2;
+    uint32_t sample_rate = C64U_RECORD_AUDIO_SAMPLE_RATE;
+    uint32_t byte_rate = sample_rate * C64U_RECORD_AUDIO_FRAME_SIZE;
+    uint16_t block_align = C64U_RECORD_AUDIO_FRAME_SIZE;
+    uint16_t bits_per_sample = 16;
+    memcpy(wave_format, &format_tag, 2);           // wFormatTag
+    memcpy(wave_format + 2, &channels, 2);         // nChannels
+    memcpy(wave_format + 4, &sample_rate, 4);      // nSamplesPerSec
+    memcpy(wave_format + 8, &byte_rate, 4);        // nAvgBytesPerSec
+    memcpy(wave_format + 12, &block_align, 2);     // nBlockAlign
+    memcpy(wave_format + 14, &bits_per_sample, 2); // wBitsPerSample (cbSize stays 0)
+
+    // Audio timestamps follow from the sample count: one dwScale unit is one stereo sample
+    struct c64u_avi_stream_info audio = {
+        .type = {'a', 'u', 'd', 's'},
+        .chunk_id = {'0', '1', 'w', 'b'},
+        .scale = block_align,
+        .rate = byte_rate,
+        .sample_size = block_align,
+        .suggested_buffer_size = C64U_RECORD_AUDIO_CHUNK_SIZE,
+        .format = wave_format,
+        .format_size = sizeof(wave_format),
+    };
+
+    struct c64u_avi_info info = {
+        .micro_sec_per_frame = (uint32_t)(1000000.0 / fps + 0.5), // Round to nearest microsecond
+        .max_bytes_per_sec = (uint32_t)(frame_size * fps) + (audio_stream ? byte_rate : 0),
+        .width = width,
+        .height = height,
+    };
 
-    // LIST movi chunk (where frame data goes - VIDEO ONLY)
-    fwrite("LIST", 1, 4, file);
-    fwrite(&zero, 4, 1, file); // movi size (update later)
-    fwrite("movi", 1, 4, file);
+    struct c64u_avi_stream_info streams[2] = {video, audio};
+    return c64u_avi_create(path, &info, streams, audio_stream ? 2 : 1, direct_io);
 }
 
-static void update_avi_header(FILE *file, uint32_t frame_count, uint32_t audio_samples_written)
+// Create audio.flac with a STREAMINFO that leaves the length open, so the file is valid while it grows
+static FILE *create_flac_file(const char *path)
 {
-    UNUSED_PARAMETER(audio_samples_written);
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return NULL;
+    }
 
-    if (!file)
-        return;
+    uint8_t header[C64U_FLAC_HEADER_SIZE];
+    c64u_flac_write_header(header, C64U_RECORD_AUDIO_SAMPLE_RATE, 0, 0, 0);
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+        fclose(file);
+        return NULL;
+    }
+    return file;
+}
 
-    long current_pos = ftell(file);
-    uint32_t file_size = current_pos - 8; // Total file size minus RIFF header
-
-    // Update RIFF file size
-    fseek(file, 4, SEEK_SET);
-    fwrite(&file_size, 4, 1, file);
-
-    // Update total frames in main AVI header (avih)
-    // RIFF(4) + size(4) + AVI(4) + LIST(4) + size(4) + hdrl(4) + avih(4) + size(4) + period(4) + maxbytes(4) + pad(4) + flags(4) = 48
-    fseek(file, 48, SEEK_SET);
-    fwrite(&frame_count, 4, 1, file);
-
-    // Seek back to end
-    fseek(file, current_pos, SEEK_SET);
-    fflush(file); // Ensure changes are written to disk
-} // Helper function to convert RGBA to BGR24
-static void convert_rgba_to_bgr24(uint32_t *rgba_buffer, uint8_t *bgr_buffer, uint32_t width, uint32_t height)
-{
-    for (uint32_t i = 0; i < width * height; i++) {
-        uint32_t pixel = rgba_buffer[i];
-        // RGBA is typically: 0xAABBGGRR (little endian)
-        // We need BGR24: B, G, R
-        uint8_t r = pixel & 0xFF;
-        uint8_t g = (pixel >> 8) & 0xFF;
-        uint8_t b = (pixel >> 16) & 0xFF;
-
-        bgr_buffer[i * 3 + 0] = b; // Blue
-        bgr_buffer[i * 3 + 1] = g; // Green
-        bgr_buffer[i * 3 + 2] = r; // Red
-    }
-}
-
-// Helper function to write WAV file header
-static void write_wav_header(FILE *file, uint32_t sample_rate, uint16_t channels, uint16_t bits_per_sample)
-{
-    uint32_t byte_rate = sample_rate * channels * bits_per_sample / 8;
-    uint16_t block_align = channels * bits_per_sample / 8;
-
-    // WAV header (44 bytes) - we'll update sizes later
-    fwrite("RIFF", 1, 4, file); // ChunkID
-    uint32_t chunk_size = 36;   // ChunkSize (to be updated later)
-    fwrite(&chunk_size, 4, 1, file);
-    fwrite("WAVE", 1, 4, file);   // Format
-    fwrite("fmt ", 1, 4, file);   // Subchunk1ID
-    uint32_t subchunk1_size = 16; // Subchunk1Size (PCM)
-    fwrite(&subchunk1_size, 4, 1, file);
-    uint16_t audio_format = 1; // AudioFormat (PCM)
-    fwrite(&audio_format, 2, 1, file);
-    fwrite(&channels, 2, 1, file);        // NumChannels
-    fwrite(&sample_rate, 4, 1, file);     // SampleRate
-    fwrite(&byte_rate, 4, 1, file);       // ByteRate
-    fwrite(&block_align, 2, 1, file);     // BlockAlign
-    fwrite(&bits_per_sample, 2, 1, file); // BitsPerSample
-    fwrite("data", 1, 4, file);           // Subchunk2ID
-    uint32_t subchunk2_size = 0;          // Subchunk2Size (to be updated later)
-    fwrite(&subchunk2_size, 4, 1, file);
-}
-
-// Helper function to finalize WAV header with correct file sizes
-static void finalize_wav_header(FILE *file, uint32_t data_size)
-{
-    if (!file)
-        return;
+// Encode the collected samples as one FLAC frame and append it. Each frame is flushed right away, so a crash
+// only loses the audio still being collected (up to C64U_FLAC_BLOCK_SIZE samples).
+static bool write_flac_frame(struct c64u_source *context)
+{
+    uint32_t count = context->record_flac_block_samples;
+    context->record_flac_block_samples = 0;
+    if (count == 0 || context->record_flac_failed) {
+        return !context->record_flac_failed;
+    }
 
-    // Update ChunkSize (file size - 8)
-    fseek(file, 4, SEEK_SET);
-    uint32_t chunk_size = data_size + 36;
-    fwrite(&chunk_size, 4, 1, file);
+    size_t size = c64u_flac_encode_frame(context->record_flac_frame, context->record_flac_block, count,
+                                         context->record_flac_frames, C64U_RECORD_AUDIO_SAMPLE_RATE);
+    if (fwrite(context->record_flac_frame, 1, size, context->audio_flac) != size ||
+        fflush(context->audio_flac) != 0) {
+        C64U_LOG_ERROR("Failed to write FLAC audio recording");
+        context->record_flac_failed = true;
+        return false;
+    }
 
-    // Update Subchunk2Size (data size)
-    fseek(file, 40, SEEK_SET);
-    fwrite(&data_size, 4, 1, file);
+    context->record_flac_frames++;
+    context->record_flac_samples += count;
+    context->record_segment_bytes += size;
+    if (context->record_flac_min_frame_size == 0 || size < context->record_flac_min_frame_size) {
+        context->record_flac_min_frame_size = (uint32_t)size;
+    }
+    if (size > context->record_flac_max_frame_size) {
+        context->record_flac_max_frame_size = (uint32_t)size;
+    }
+    return true;
 }
 
-// Fast BMP file saving function (minimal CPU overhead)
-// Session management: Create session folder if none exists
-static void ensure_recording_session(struct c64u_source *context)
+// Append 16-bit little endian stereo PCM to audio.flac, one frame per C64U_FLAC_BLOCK_SIZE samples
+static bool write_flac_audio(struct c64u_source *context, const uint8_t *pcm, uint32_t size)
+{
+    for (uint32_t i = 0; i + C64U_RECORD_AUDIO_FRAME_SIZE <= size; i += C64U_RECORD_AUDIO_FRAME_SIZE) {
+        int16_t *dst = context->record_flac_block + context->record_flac_block_samples * 2;
+        dst[0] = (int16_t)(pcm[i] | (pcm[i + 1] << 8));
+        dst[1] = (int16_t)(pcm[i + 2] | (pcm[i + 3] << 8));
+        if (++context->record_flac_block_samples == C64U_FLAC_BLOCK_SIZE) {
+            write_flac_frame(context);
+        }
+    }
+    return !context->record_flac_failed;
+}
+
+// Write the last (short) frame, fill in the length and frame sizes in STREAMINFO and close audio.flac
+static void finish_flac_file(struct c64u_source *context)
+{
+    write_flac_frame(context);
+
+    if (!context->record_flac_failed) {
+        uint8_t header[C64U_FLAC_HEADER_SIZE];
+        c64u_flac_write_header(header, C64U_RECORD_AUDIO_SAMPLE_RATE, context->record_flac_min_frame_size,
+                               context->record_flac_max_frame_size, context->record_flac_samples);
+        if (fseek(context->audio_flac, 0, SEEK_SET) != 0 ||
+            fwrite(header, 1, sizeof(header), context->audio_flac) != sizeof(header)) {
+            C64U_LOG_WARNING("Failed to update FLAC audio recording header");
+        }
+    }
+
+    fclose(context->audio_flac);
+    context->audio_flac = NULL;
+}
+
+// Session management: Create session folder if none exists (called with session_mutex held)
+static void ensure_recording_session(struct c64u_source *context, const char *save_folder)
 {
     // If session already exists, do nothing
     if (context->session_folder[0] != '\0') {
@@ -263,7 +297,7 @@ static void ensure_recording_session(struct c64u_source *context)
     struct tm *timeinfo = localtime(&rawtime);
 
     snprintf(context->session_folder, sizeof(context->session_folder), "%s/session_%04d%02d%02d_%02d%02d%02d",
-             context->save_folder, timeinfo->tm_year + 1900, timeinfo->tm_mon + 1, timeinfo->tm_mday, timeinfo->tm_hour,
+             save_folder, timeinfo->tm_year + 1900, timeinfo->tm_mon + 1, timeinfo->tm_mday, timeinfo->tm_hour,
              timeinfo->tm_min, timeinfo->tm_sec);
 
     // Create the session directory recursively (cross-platform)
@@ -276,306 +310,687 @@ static void ensure_recording_session(struct c64u_source *context)
     }
 }
 
+bool record_get_session_folder(struct c64u_source *context, char *folder, size_t size)
+{
+    // Snapshot the output folder; it may be changed concurrently from the settings thread
+    char save_folder[sizeof(context->save_folder)];
+    pthread_mutex_lock(&context->recording_mutex);
+    memcpy(save_folder, context->save_folder, sizeof(save_folder));
+    pthread_mutex_unlock(&context->recording_mutex);
+
+    pthread_mutex_lock(&context->session_mutex);
+    ensure_recording_session(context, save_folder);
+    snprintf(folder, size, "%s", context->session_folder);
+    pthread_mutex_unlock(&context->session_mutex);
+    return folder[0] != '\0';
+}
+
+// Whether the writer has a video file (AVI or Matroska) open
+static bool video_file_open(struct c64u_source *context)
+{
+    return context->video_avi || context->video_mkv;
+}
+
+// Account the time spent encoding one recorded frame (reported in the recording statistics)
+static void record_encode_time(struct c64u_source *context, uint64_t duration_ns)
+{
+    context->record_encode_time_ns += duration_ns;
+    if (duration_ns > context->record_encode_time_max_ns) {
+        context->record_encode_time_max_ns = duration_ns;
+    }
+}
+
 // Check if any recording is active
 static bool any_recording_active(struct c64u_source *context)
 {
     return context->save_frames || context->record_video;
 }
 
-// Clear session if no recording is active
-static void cleanup_session_if_needed(struct c64u_source *context)
+// Whether the recording is split into numbered segment files
+static bool recording_segmented(struct c64u_source *context)
 {
-    if (!any_recording_active(context)) {
-        context->session_folder[0] = '\0';
-        C64U_LOG_INFO("Recording session ended");
+    return context->recording_segment_minutes > 0 || context->recording_segment_mb > 0;
+}
+
+// Close the video (and FLAC) file of the current segment. Audio collected for the next frame is kept, it goes
+// into the next segment together with that frame.
+static void close_segment_files(struct c64u_source *context)
+{
+    if (context->video_avi) {
+        // Writes the last index and the final frame counts
+        c64u_avi_close(context->video_avi);
+        context->video_avi = NULL;
+    }
+#ifdef C64U_HAVE_FFMPEG
+    if (context->video_mkv) {
+        // Flushes the encoder and writes the cues
+        c64u_mkv_close(context->video_mkv);
+        context->video_mkv = NULL;
+    }
+#endif
+    if (context->audio_flac) {
+        finish_flac_file(context);
     }
 }
 
-void save_frame_as_bmp(struct c64u_source *context, uint32_t *frame_buffer)
+// Open the video (and FLAC) file of the current segment: video.avi, or video_000.avi, video_001.avi, ... when
+// segmented. Every segment starts with a keyframe and plays on its own.
+static bool open_segment_files(struct c64u_source *context, const char *session_folder)
 {
-    if (!context->save_frames || !frame_buffer) {
-        return;
+    bool matroska = context->recording_format == C64U_RECORD_FORMAT_FFV1;
+    bool flac = context->recording_audio_format == C64U_RECORD_AUDIO_FLAC;
+
+    char suffix[16] = "";
+    if (recording_segmented(context)) {
+        snprintf(suffix, sizeof(suffix), "_%03u", context->record_segment);
+    }
+    char video_filename[950], audio_filename[950];
+    snprintf(video_filename, sizeof(video_filename), "%s/video%s.%s", session_folder, suffix,
+             matroska ? "mkv" : "avi");
+    snprintf(audio_filename, sizeof(audio_filename), "%s/audio%s.flac", session_folder, suffix);
+
+    // The headers are written with the detected frame rate
+    if (matroska) {
+#ifdef C64U_HAVE_FFMPEG
+        context->video_mkv = c64u_mkv_create(video_filename, context->recording_width,
+                                             context->recording_height, context->core.expected_fps, !flac);
+#endif
+    } else {
+        context->video_avi = create_avi_file(video_filename, context->recording_width, context->recording_height,
+                                             context->core.expected_fps, context->recording_format, !flac,
+                                             context->recording_direct_io);
+    }
+    if (flac) {
+        context->audio_flac = create_flac_file(audio_filename);
     }
 
-    // Ensure we have a recording session
-    ensure_recording_session(context);
-    if (context->session_folder[0] == '\0') {
-        C64U_LOG_WARNING("Failed to create recording session for frame saving");
-        return;
+    if (!video_file_open(context) || (flac && !context->audio_flac)) {
+        C64U_LOG_ERROR("Failed to create recording files: %s", video_filename);
+        if (context->audio_flac) {
+            fclose(context->audio_flac);
+            context->audio_flac = NULL;
+        }
+        close_segment_files(context);
+        return false;
+    }
+
+    context->record_segment_first_frame = context->recorded_frames;
+    context->record_segment_bytes = 0;
+    context->record_rle_have_previous = false; // First RLE frame is a keyframe
+    context->record_have_last_hash = false;    // ...and no segment starts with a duplicate
+    context->record_flac_block_samples = 0;
+    context->record_flac_frames = 0;
+    context->record_flac_min_frame_size = 0;
+    context->record_flac_max_frame_size = 0;
+    context->record_flac_samples = 0;
+    context->record_flac_failed = false;
+
+    if (context->timing_file && recording_segmented(context)) {
+        fprintf(context->timing_file, "# Segment %u: video%s.%s from frame %u\n", context->record_segment, suffix,
+                matroska ? "mkv" : "avi", context->recorded_frames);
+    }
+    C64U_LOG_INFO("Started video recording: %s", video_filename);
+    return true;
+}
+
+// Video recording functions (writer thread only)
+static bool start_video_recording(struct c64u_source *context)
+{
+    // Ensure we have a recording session (creates if needed, joins if exists)
+    char session_folder[sizeof(context->session_folder)];
+    if (!record_get_session_folder(context, session_folder, sizeof(session_folder))) {
+        C64U_LOG_ERROR("Failed to create recording session for video recording");
+        return false;
     }
 
-    // Create frames subfolder within session folder
-    char frames_folder[900];
-    snprintf(frames_folder, sizeof(frames_folder), "%s/frames", context->session_folder);
+    context->recording_width = context->width;
+    context->recording_height = context->height;
+    pthread_mutex_lock(&context->recording_mutex);
+    context->recording_format = context->record_format;
+    context->recording_audio_format = context->record_audio_format;
+    context->recording_segment_minutes = context->record_segment_minutes;
+    context->recording_segment_mb = context->record_segment_mb;
+    context->recording_direct_io = context->record_direct_io;
+    context->recording_skip_duplicates = context->record_skip_duplicates;
+    pthread_mutex_unlock(&context->recording_mutex);
+    bool matroska = context->recording_format == C64U_RECORD_FORMAT_FFV1;
+    bool flac = context->recording_audio_format == C64U_RECORD_AUDIO_FLAC;
 
-    if (!create_directory_recursive(frames_folder)) {
-        C64U_LOG_WARNING("Failed to create frames subfolder: %s", frames_folder);
-        return;
+    char timing_filename[950];
+    snprintf(timing_filename, sizeof(timing_filename), "%s/timing.txt", session_folder);
+    context->timing_file = fopen(timing_filename, "w");
+    if (!context->timing_file) {
+        C64U_LOG_ERROR("Failed to create recording files: %s", timing_filename);
+        return false;
     }
 
-    // Create timestamped filename in frames subfolder
     uint64_t timestamp_ms = os_gettime_ns() / 1000000;
-    char filename[900];
-    snprintf(filename, sizeof(filename), "%s/frames/frame_%llu_%05u.bmp", context->session_folder,
-             (unsigned long long)timestamp_ms, context->saved_frame_count++);
+    context->recording_start_time = timestamp_ms;
+    context->recorded_frames = 0;
+    context->recorded_audio_samples = 0;
+    context->record_audio_chunk_size = 0;
+    context->record_segment = 0;
+
+    // Write header info to timing file
+    fprintf(context->timing_file, "# C64U Video Recording Session\n");
+    fprintf(context->timing_file, "# Session Folder: %s\n", session_folder);
+    fprintf(context->timing_file, "# Start Time: %llu ms\n", (unsigned long long)timestamp_ms);
+    static const char *format_names[] = {"Uncompressed BGR24", "8-bit palettized", "4-bit palettized",
+                                         "8-bit RLE", "4-bit RLE", "FFV1 lossless"};
+    const char *container = matroska ? "Matroska" : "AVI";
+    fprintf(context->timing_file, "# Video Format: %s (%s), %ux%u pixels @ %.3ffps\n", container,
+            format_names[context->recording_format], context->recording_width, context->recording_height,
+            context->core.expected_fps);
+    if (flac) {
+        fprintf(context->timing_file, "# Audio Format: FLAC 48kHz 16-bit stereo (audio.flac)\n");
+    } else {
+        fprintf(context->timing_file, "# Audio Format: PCM 48kHz 16-bit stereo, interleaved in the %s (stream 1)\n",
+                container);
+    }
+    if (recording_segmented(context)) {
+        fprintf(context->timing_file, "# Segments: new file every %u minutes / %u MB (0 = no limit)\n",
+                context->recording_segment_minutes, context->recording_segment_mb);
+    }
+    if (context->recording_skip_duplicates) {
+        fprintf(context->timing_file, "# Duplicate frames: not stored again, listed with frame_size_bytes 0\n");
+    }
+    fprintf(context->timing_file,
+            "# Columns: frame_number, calculated_timestamp_ms, capture_timestamp_ms, frame_size_bytes, fps\n");
 
-    FILE *file = fopen(filename, "wb");
-    if (!file) {
-        C64U_LOG_WARNING("Failed to create frame file: %s", filename);
+    if (!open_segment_files(context, session_folder)) {
+        fclose(context->timing_file);
+        context->timing_file = NULL;
+        return false;
+    }
+    fflush(context->timing_file);
+    return true;
+}
+
+// Continue in the next segment file once the current one reached its duration or size. Called before a frame
+// is written, so every frame and the audio preceding it end up in exactly one segment.
+static void rotate_segment_if_due(struct c64u_source *context)
+{
+    uint32_t frames = context->recorded_frames - context->record_segment_first_frame;
+    if (!recording_segmented(context) || frames == 0) {
         return;
     }
 
-    uint32_t width = context->width;
-    uint32_t height = context->height;
-    uint32_t row_padded = (width * 3 + 3) & (~3); // 4-byte alignment for BMP
-    uint32_t image_size = row_padded * height;
-    uint32_t file_size = 54 + image_size; // BMP header + image data
-
-    // BMP Header (54 bytes total)
-    uint8_t header[54] = {
-        'B',
-        'M', // Signature
-        file_size & 0xFF,
-        (file_size >> 8) & 0xFF,
-        (file_size >> 16) & 0xFF,
-        (file_size >> 24) & 0xFF, // File size
-        0,
-        0,
-        0,
-        0, // Reserved
-        54,
-        0,
-        0,
-        0, // Data offset
-        40,
-        0,
-        0,
-        0, // Header size
-        width & 0xFF,
-        (width >> 8) & 0xFF,
-        (width >> 16) & 0xFF,
-        (width >> 24) & 0xFF, // Width
-        height & 0xFF,
-        (height >> 8) & 0xFF,
-        (height >> 16) & 0xFF,
-        (height >> 24) & 0xFF, // Height
-        1,
-        0, // Planes
-        24,
-        0, // Bits per pixel
-        0,
-        0,
-        0,
-        0, // Compression
-        image_size & 0xFF,
-        (image_size >> 8) & 0xFF,
-        (image_size >> 16) & 0xFF,
-        (image_size >> 24) & 0xFF, // Image size
-        0,
-        0,
-        0,
-        0, // X pixels per meter
-        0,
-        0,
-        0,
-        0, // Y pixels per meter
-        0,
-        0,
-        0,
-        0, // Colors used
-        0,
-        0,
-        0,
-        0 // Colors important
-    };
+    bool time_due = context->recording_segment_minutes > 0 &&
+                    frames >= (uint32_t)(context->recording_segment_minutes * 60.0 * context->core.expected_fps);
+    bool size_due = context->recording_segment_mb > 0 &&
+                    context->record_segment_bytes >= (uint64_t)context->recording_segment_mb * 1024 * 1024;
+    if (!time_due && !size_due) {
+        return;
+    }
 
-    fwrite(header, 1, 54, file);
+    char session_folder[sizeof(context->session_folder)];
+    close_segment_files(context);
+    context->record_segment++;
+    if (!record_get_session_folder(context, session_folder, sizeof(session_folder)) ||
+        !open_segment_files(context, session_folder)) {
+        // Frames are skipped until recording is switched off (the timing file stays open)
+        C64U_LOG_ERROR("Failed to start recording segment %u", context->record_segment);
+    }
+}
 
-    // Write image data (BMP stores bottom-to-top, convert RGBA to BGR)
-    uint8_t *row_buffer = malloc(row_padded);
-    if (row_buffer) {
-        for (int y = height - 1; y >= 0; y--) { // Bottom-to-top
-            uint32_t *src_row = frame_buffer + (y * width);
-            uint8_t *dst = row_buffer;
+// 64-bit content hash of a frame's indexed payload, a multiply-xorshift step per 8-byte word. Each step is a
+// bijection of the running hash, so frames that differ in a single word never collide.
+static uint64_t hash_indexed_frame(const struct record_frame_slot *slot)
+{
+    const uint8_t *data = slot->indexed_data;
+    size_t size = (size_t)slot->height * C64U_BYTES_PER_LINE; // Lines are 192 bytes, a multiple of 8
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ slot->height;
+    for (size_t i = 0; i < size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
 
-            for (uint32_t x = 0; x < width; x++) {
-                uint32_t pixel = src_row[x];
-                *dst++ = (pixel >> 16) & 0xFF; // B
-                *dst++ = (pixel >> 8) & 0xFF;  // G
-                *dst++ = pixel & 0xFF;         // R
+// Encode a queued frame into the writer's scratch buffer as one DIB in the recording format
+static size_t encode_frame_dib(struct c64u_source *context, const struct record_frame_slot *slot)
+{
+    // Encode at the size announced in the AVI header; lines the frame does not have stay black
+    uint32_t format = context->recording_format;
+    uint32_t width = context->recording_width;
+    uint32_t height = context->recording_height;
+    size_t frame_size = record_format_frame_size(format, width, height);
+    size_t line_size = frame_size / height;
+    uint8_t *dib = context->record_scratch;
+
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *src = slot->indexed_data + (y * C64U_BYTES_PER_LINE);
+        bool have_line = y < slot->height;
+
+        if (format == C64U_RECORD_FORMAT_BGR24) {
+            // Top-down RGB frame
+            uint8_t *dst = dib + y * line_size;
+            if (have_line) {
+                c64u_core_line_to_bgr24(src, dst, width);
+            } else {
+                memset(dst, 0, line_size);
             }
-
-            // Pad to 4-byte boundary
-            while ((dst - row_buffer) % 4 != 0) {
-                *dst++ = 0;
+        } else {
+            // Bottom-up indexed frame, taken straight from the received 4-bit payload
+            uint8_t *dst = dib + (height - 1 - y) * line_size;
+            if (!have_line) {
+                memset(dst, 0, line_size);
+            } else if (format == C64U_RECORD_FORMAT_PAL8) {
+                for (uint32_t x = 0; x < width / 2; x++) {
+                    dst[x * 2] = src[x] & 0x0F;
+                    dst[x * 2 + 1] = src[x] >> 4;
+                }
+            } else {
+                // 4-bit DIBs keep the left pixel in the high nibble, the C64U stream in the low nibble
+                for (uint32_t x = 0; x < width / 2; x++) {
+                    dst[x] = (uint8_t)((src[x] << 4) | (src[x] >> 4));
+                }
             }
-
-            fwrite(row_buffer, 1, row_padded, file);
         }
-        free(row_buffer);
     }
 
-    fclose(file);
+    return frame_size;
 }
 
-// Video recording functions (raw uncompressed format for minimal CPU overhead)
-void start_video_recording(struct c64u_source *context)
+// Encode a queued frame into the writer's scratch buffer as one BI_RLE8/BI_RLE4 frame. Returns the encoded
+// size and whether it is a keyframe; delta frames only describe the lines that changed since the last frame.
+static size_t encode_frame_rle(struct c64u_source *context, const struct record_frame_slot *slot, bool *keyframe)
 {
-    if (!context->record_video || context->video_file) {
-        return; // Already recording or not enabled
+    uint32_t width = context->recording_width;
+    uint32_t height = context->recording_height;
+    size_t line_size = width / 2;
+
+    // Packed copy at the recorded size; lines the frame does not have stay black like the uncompressed formats
+    for (uint32_t y = 0; y < height; y++) {
+        uint8_t *dst = context->record_rle_frame + y * line_size;
+        if (y < slot->height) {
+            memcpy(dst, slot->indexed_data + (y * C64U_BYTES_PER_LINE), line_size);
+        } else {
+            memset(dst, 0, line_size);
+        }
     }
 
-    if (pthread_mutex_lock(&context->recording_mutex) != 0) {
-        return;
-    }
+    *keyframe = !context->record_rle_have_previous ||
+                context->recorded_frames % C64U_RECORD_RLE_KEYFRAME_INTERVAL == 0;
+    const uint8_t *previous = *keyframe ? NULL : context->record_rle_previous;
+    return c64u_rle_encode_frame(context->record_scratch, context->record_rle_frame, previous, width, height,
+                                 (uint32_t)line_size, record_format_bit_count(context->recording_format));
+}
 
-    // Ensure we have a recording session (creates if needed, joins if exists)
-    ensure_recording_session(context);
-    if (context->session_folder[0] == '\0') {
-        C64U_LOG_ERROR("Failed to create recording session for video recording");
-        pthread_mutex_unlock(&context->recording_mutex);
+// Write the audio collected since the last video frame as one 01wb chunk (or Matroska block, or FLAC samples)
+static void flush_audio_chunk(struct c64u_source *context)
+{
+    uint32_t size = context->record_audio_chunk_size;
+    if (size == 0) {
         return;
     }
 
-    // Create filenames in the session folder
-    char video_filename[950], audio_filename[950], timing_filename[950];
-    snprintf(video_filename, sizeof(video_filename), "%s/video.avi", context->session_folder);
-    snprintf(audio_filename, sizeof(audio_filename), "%s/audio.wav", context->session_folder);
-    snprintf(timing_filename, sizeof(timing_filename), "%s/timing.txt", context->session_folder);
-
-    // Open files for recording
-    context->video_file = fopen(video_filename, "wb");
-    context->audio_file = fopen(audio_filename, "wb");
-    context->timing_file = fopen(timing_filename, "w");
-
-    if (!context->video_file || !context->audio_file || !context->timing_file) {
-        C64U_LOG_ERROR("Failed to create recording files");
-        if (context->video_file) {
-            fclose(context->video_file);
-            context->video_file = NULL;
-        }
-        if (context->audio_file) {
-            fclose(context->audio_file);
-            context->audio_file = NULL;
-        }
-        if (context->timing_file) {
-            fclose(context->timing_file);
-            context->timing_file = NULL;
+    uint32_t samples = size / C64U_RECORD_AUDIO_FRAME_SIZE;
+    bool written = false;
+    if (context->video_avi && !context->audio_flac) {
+        written = c64u_avi_write_chunk(context->video_avi, 1, context->record_audio_chunk, size, true, samples);
+    }
+#ifdef C64U_HAVE_FFMPEG
+    if (context->video_mkv) {
+        written = c64u_mkv_write_audio(context->video_mkv, context->record_audio_chunk, size);
+    }
+#endif
+    if (context->audio_flac) {
+        written = write_flac_audio(context, context->record_audio_chunk, size);
+    }
+    if (written) {
+        context->recorded_audio_samples += samples;
+        if (!context->audio_flac) {
+            context->record_segment_bytes += size; // FLAC counts its encoded frames
         }
-    } else {
-        uint64_t timestamp_ms = os_gettime_ns() / 1000000;
-        context->recording_start_time = timestamp_ms;
-        context->recorded_frames = 0;
-        context->recorded_audio_samples = 0;
-
-        // Write AVI header with detected frame rate
-        write_avi_header(context->video_file, context->width, context->height, context->expected_fps);
-
-        // Write WAV header to audio file
-        write_wav_header(context->audio_file, 48000, 2, 16); // 48kHz stereo 16-bit
+    }
+    context->record_audio_chunk_size = 0;
+}
 
-        // Write header info to timing file
-        fprintf(context->timing_file, "# C64U Video Recording Session\n");
-        fprintf(context->timing_file, "# Session Folder: %s\n", context->session_folder);
-        fprintf(context->timing_file, "# Start Time: %llu ms\n", (unsigned long long)timestamp_ms);
-        fprintf(context->timing_file, "# Video Format: AVI (Uncompressed BGR24), %ux%u pixels @ 50fps\n",
-                context->width, context->height);
-        fprintf(context->timing_file, "# Audio Format: WAV PCM 48kHz 16-bit stereo\n");
-        fprintf(context->timing_file, "# Columns: frame_number, timestamp_ms, frame_size_bytes\n");
-        fflush(context->timing_file);
+// Encode and write one frame to the AVI. Returns the frame size in the file, 0 if it could not be written.
+static size_t write_frame_avi(struct c64u_source *context, const struct record_frame_slot *slot)
+{
+    uint64_t encode_start = os_gettime_ns();
+    bool compressed = record_format_compression(context->recording_format) != 0;
+    bool keyframe = true;
+    size_t frame_size = compressed ? encode_frame_rle(context, slot, &keyframe) : encode_frame_dib(context, slot);
+    record_encode_time(context, os_gettime_ns() - encode_start);
+
+    // Interleave: the audio received since the previous frame goes right before this frame
+    flush_audio_chunk(context);
+
+    // Append-only: the AVI writer indexes the chunk in memory and patches headers only at segment ends
+    if (!c64u_avi_write_chunk(context->video_avi, 0, context->record_scratch, (uint32_t)frame_size, keyframe, 1)) {
+        // The AVI writer logs the failure once. A delta against a frame that is not in the file would corrupt
+        // every frame up to the next keyframe.
+        context->record_rle_have_previous = false;
+        return 0;
+    }
 
-        C64U_LOG_INFO("Started video recording: %s", video_filename);
+    // The frame just written becomes the reference for the next delta frame
+    if (compressed) {
+        uint8_t *previous = context->record_rle_previous;
+        context->record_rle_previous = context->record_rle_frame;
+        context->record_rle_frame = previous;
+        context->record_rle_have_previous = true;
     }
+    return frame_size;
+}
 
-    pthread_mutex_unlock(&context->recording_mutex);
+#ifdef C64U_HAVE_FFMPEG
+// Encode one frame into the Matroska file (the slice threads of the encoder run in parallel to this thread)
+static size_t write_frame_mkv(struct c64u_source *context, const struct record_frame_slot *slot)
+{
+    flush_audio_chunk(context);
+
+    uint64_t encode_start = os_gettime_ns();
+    size_t frame_size = 0;
+    bool written = c64u_mkv_write_video(context->video_mkv, slot->indexed_data, slot->height, &frame_size);
+    record_encode_time(context, os_gettime_ns() - encode_start);
+    return written ? frame_size : 0;
 }
+#endif
 
-void record_video_frame(struct c64u_source *context, uint32_t *frame_buffer)
+// Write a frame identical to the last one written: an empty (drop) chunk in the AVI, which players show as a
+// repeat of the previous frame, or just one more frame period of the previous frame in Matroska
+static bool write_duplicate_frame(struct c64u_source *context)
 {
-    if (!context->record_video || !context->video_file || !frame_buffer) {
-        return;
+    flush_audio_chunk(context);
+    if (context->video_avi) {
+        return c64u_avi_write_chunk(context->video_avi, 0, NULL, 0, false, 1);
     }
-
-    if (pthread_mutex_lock(&context->recording_mutex) != 0) {
-        return;
+#ifdef C64U_HAVE_FFMPEG
+    if (context->video_mkv) {
+        c64u_mkv_repeat_video(context->video_mkv);
+        return true;
     }
+#endif
+    return false;
+}
 
+// Write one frame to the open video file; returns false if it could not be written
+static bool record_video_frame(struct c64u_source *context, const struct record_frame_slot *slot)
+{
     // Calculate consistent frame timestamp based on detected FPS
     // Each frame gets the exact timestamp it should have for perfectly regular timing
-    double frame_interval_ms = 1000.0 / context->expected_fps;
+    double frame_interval_ms = 1000.0 / context->core.expected_fps;
     uint64_t calculated_timestamp_ms =
         context->recording_start_time + (uint64_t)(context->recorded_frames * frame_interval_ms);
 
-    // Write AVI frame chunk with proper header
-    size_t frame_size = context->width * context->height * 3; // BGR24
-    uint8_t *bgr_buffer = malloc(frame_size);
-    if (bgr_buffer) {
-        // Check if frame_buffer has non-zero data
-        uint32_t non_zero_pixels = 0;
-        for (uint32_t i = 0; i < context->width * context->height && i < 100; i++) {
-            if (frame_buffer[i] != 0)
-                non_zero_pixels++;
-        }
+    rotate_segment_if_due(context);
+
+    // Static screens (menus, BASIC) repeat the same frame for seconds: store it once and keep the frame slots
+    uint64_t hash = 0;
+    bool duplicate = false;
+    if (context->recording_skip_duplicates) {
+        hash = hash_indexed_frame(slot);
+        // The hash only preselects: a false match would freeze a frame in the recording, so compare the pixels
+        duplicate = context->record_have_last_hash && hash == context->record_last_hash &&
+                    slot->height == context->record_last_height &&
+                    memcmp(slot->indexed_data, context->record_last_frame,
+                           (size_t)slot->height * C64U_BYTES_PER_LINE) == 0;
+    }
 
-        // Log actual C64 video data stats (debug level)
-        C64U_LOG_DEBUG("Recording frame %u: %ux%u, non_zero=%u/100, fps=%.3f", context->recorded_frames, context->width,
-                       context->height, non_zero_pixels, context->expected_fps);
+    size_t frame_size = 0;
+    bool written = false;
+    if (duplicate) {
+        written = write_duplicate_frame(context);
+    } else {
+        if (context->video_avi) {
+            frame_size = write_frame_avi(context, slot);
+        }
+#ifdef C64U_HAVE_FFMPEG
+        if (context->video_mkv) {
+            frame_size = write_frame_mkv(context, slot);
+        }
+#endif
+        written = frame_size > 0;
+
+        // A duplicate may only refer to a frame that is in the file
+        context->record_last_hash = hash;
+        context->record_have_last_hash = written && context->recording_skip_duplicates;
+        if (context->record_have_last_hash) {
+            memcpy(context->record_last_frame, slot->indexed_data, (size_t)slot->height * C64U_BYTES_PER_LINE);
+            context->record_last_height = slot->height;
+        }
+    }
 
-        convert_rgba_to_bgr24(frame_buffer, bgr_buffer, context->width, context->height);
+    if (written) {
+        context->recorded_frames++;
+        context->record_segment_bytes += frame_size;
+        if (duplicate) {
+            context->record_frames_duplicate++;
+        }
 
-        // For 60Hz sessions, dump first 16 bytes of BGR frame data for debugging
-        if ((int)(context->expected_fps + 0.5) == 60) {
-            char hexbuf[49]; // 16 bytes * 3 chars + null
-            for (int i = 0; i < 16; i++) {
-                sprintf(hexbuf + i * 3, "%02X ", bgr_buffer[i]);
-            }
-            hexbuf[48] = '\0';
-            C64U_LOG_DEBUG("Frame %u BGR[0..15]: %s", context->recorded_frames, hexbuf);
+        // Log timing information with both calculated and capture timestamps
+        if (context->timing_file) {
+            uint64_t capture_timestamp_ms = slot->capture_time / 1000000;
+            fprintf(context->timing_file, "%u,%llu,%llu,%zu,%.3f\n", context->recorded_frames,
+                    (unsigned long long)calculated_timestamp_ms, (unsigned long long)capture_timestamp_ms, frame_size,
+                    context->core.expected_fps);
+            fflush(context->timing_file);
         }
+    }
+    return written;
+}
+
+// Collect audio packets so the AVI gets about one audio chunk per video frame instead of one per packet
+static void write_audio_slot(struct c64u_source *context, const struct record_audio_slot *slot)
+{
+    if (context->record_audio_chunk_size + slot->size > C64U_RECORD_AUDIO_CHUNK_SIZE) {
+        flush_audio_chunk(context);
+    }
+    memcpy(context->record_audio_chunk + context->record_audio_chunk_size, slot->data, slot->size);
+    context->record_audio_chunk_size += slot->size;
+}
 
-        // Write AVI frame chunk header ("00db" = stream 0, uncompressed DIB)
-        fwrite("00db", 1, 4, context->video_file);
-        uint32_t chunk_size = (uint32_t)frame_size;
-        fwrite(&chunk_size, 4, 1, context->video_file);
+static void stop_video_recording(struct c64u_source *context)
+{
+    // Close recording files and finalize formats
+    flush_audio_chunk(context);
+    close_segment_files(context);
+    if (context->timing_file) {
+        fclose(context->timing_file);
+        context->timing_file = NULL;
+    }
 
-        // Write frame data
-        size_t written = fwrite(bgr_buffer, 1, frame_size, context->video_file);
+    C64U_LOG_INFO("Recording stopped. Frames: %u, Audio samples: %llu", context->recorded_frames,
+                  (unsigned long long)context->recorded_audio_samples);
+}
 
-        // Ensure word alignment (AVI requirement)
-        if (frame_size % 2) {
-            uint8_t pad = 0;
-            fwrite(&pad, 1, 1, context->video_file);
+// Recording writer thread: owns the session folder and all recording files
+static void *record_thread_func(void *data)
+{
+    struct c64u_source *context = data;
+    bool open_failed = false;
+
+    C64U_LOG_DEBUG("Recording writer thread started");
+
+    pthread_mutex_lock(&context->recording_mutex);
+    while (true) {
+        // Open or close the recording files as requested from the settings thread. The timing file stays open
+        // for the whole recording, the video files change with every segment.
+        if (!context->record_video) {
+            open_failed = false;
+        } else if (!context->timing_file && !open_failed && !context->record_shutdown) {
+            pthread_mutex_unlock(&context->recording_mutex);
+            open_failed = !start_video_recording(context);
+            pthread_mutex_lock(&context->recording_mutex);
+            continue;
         }
 
-        free(bgr_buffer);
+        struct record_frame_slot *frame_slot =
+            context->record_frame_count > 0 ? &context->record_frame_ring[context->record_frame_head] : NULL;
+        struct record_audio_slot *audio_slot =
+            context->record_audio_count > 0 ? &context->record_audio_ring[context->record_audio_head] : NULL;
 
-        if (written == frame_size) {
-            context->recorded_frames++;
+        if (frame_slot || audio_slot) {
+            // Slots at the ring heads are not touched by producers, so they can be written unlocked
+            pthread_mutex_unlock(&context->recording_mutex);
+            bool frame_written = frame_slot && video_file_open(context) && record_video_frame(context, frame_slot);
+            if (audio_slot && video_file_open(context)) {
+                write_audio_slot(context, audio_slot);
+            }
+            pthread_mutex_lock(&context->recording_mutex);
+
+            if (frame_slot) {
+                context->record_frame_head = (context->record_frame_head + 1) % C64U_RECORD_FRAME_SLOTS;
+                context->record_frame_count--;
+                if (frame_written) {
+                    context->record_frames_written++;
+                } else {
+                    context->record_frames_discarded++; // No open file (open failed) or the write failed
+                }
+            }
+            if (audio_slot) {
+                context->record_audio_head = (context->record_audio_head + 1) % C64U_RECORD_AUDIO_SLOTS;
+                context->record_audio_count--;
+            }
+            pthread_cond_broadcast(&context->record_space_cond);
+            continue;
+        }
 
-            // Update AVI header with current frame count (video-only)
-            update_avi_header(context->video_file, context->recorded_frames, 0);
+        // Queues are drained - finish the recording files if recording was switched off
+        if ((!context->record_video || context->record_shutdown) && context->timing_file) {
+            pthread_mutex_unlock(&context->recording_mutex);
+            stop_video_recording(context);
+            pthread_mutex_lock(&context->recording_mutex);
+            continue;
+        }
 
-            // Log timing information with both actual and calculated timestamps
-            if (context->timing_file) {
-                uint64_t actual_timestamp_ms = os_gettime_ns() / 1000000;
-                fprintf(context->timing_file, "%u,%llu,%llu,%zu,%.3f\n", context->recorded_frames,
-                        (unsigned long long)calculated_timestamp_ms, (unsigned long long)actual_timestamp_ms,
-                        frame_size, context->expected_fps);
-                fflush(context->timing_file);
+        // Clear session if no recording is active and the frame dump workers are done with it
+        if (!any_recording_active(context) && context->framedump_pending_count == 0 &&
+            context->framedump_busy_count == 0) {
+            pthread_mutex_lock(&context->session_mutex);
+            if (context->session_folder[0] != '\0') {
+                context->session_folder[0] = '\0';
+                C64U_LOG_INFO("Recording session ended");
             }
-        } else {
-            C64U_LOG_WARNING("Failed to write video frame to recording");
+            pthread_mutex_unlock(&context->session_mutex);
         }
-    } else {
-        C64U_LOG_ERROR("Failed to allocate BGR conversion buffer");
+
+        if (context->record_shutdown) {
+            break;
+        }
+
+        pthread_cond_wait(&context->record_cond, &context->recording_mutex);
+    }
+    pthread_mutex_unlock(&context->recording_mutex);
+
+    C64U_LOG_DEBUG("Recording writer thread stopped");
+    return NULL;
+}
+
+// Allocate the recording rings and start the writer thread on first use. Recording is already on, so the receive
+// threads may be queueing: everything is allocated into locals first and published under recording_mutex.
+static void start_record_writer(struct c64u_source *context)
+{
+    if (context->record_thread_active) {
+        return;
     }
 
+    struct record_frame_slot *frame_ring = bzalloc(sizeof(struct record_frame_slot) * C64U_RECORD_FRAME_SLOTS);
+    struct record_audio_slot *audio_ring = bzalloc(sizeof(struct record_audio_slot) * C64U_RECORD_AUDIO_SLOTS);
+    uint8_t *scratch = bmalloc(C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT * 3); // One BGR24 PAL frame
+    uint8_t *audio_chunk = bmalloc(C64U_RECORD_AUDIO_CHUNK_SIZE);
+    uint8_t *rle_frame = bmalloc(C64U_BYTES_PER_LINE * C64U_PAL_HEIGHT);
+    uint8_t *rle_previous = bmalloc(C64U_BYTES_PER_LINE * C64U_PAL_HEIGHT);
+    uint8_t *last_frame = bmalloc(C64U_BYTES_PER_LINE * C64U_PAL_HEIGHT);
+    int16_t *flac_block = bmalloc(C64U_FLAC_BLOCK_SIZE * C64U_RECORD_AUDIO_FRAME_SIZE);
+    uint8_t *flac_frame = bmalloc(C64U_FLAC_MAX_FRAME_SIZE(C64U_FLAC_BLOCK_SIZE));
+    if (!frame_ring || !audio_ring || !scratch || !audio_chunk || !rle_frame || !rle_previous || !last_frame ||
+        !flac_block || !flac_frame) {
+        C64U_LOG_ERROR("Failed to allocate recording queues");
+        goto fail;
+    }
+
+    // The receive threads read and advance the rings and indices under recording_mutex
+    pthread_mutex_lock(&context->recording_mutex);
+    context->record_frame_ring = frame_ring;
+    context->record_audio_ring = audio_ring;
+    context->record_scratch = scratch;
+    context->record_audio_chunk = audio_chunk;
+    context->record_rle_frame = rle_frame;
+    context->record_rle_previous = rle_previous;
+    context->record_last_frame = last_frame;
+    context->record_flac_block = flac_block;
+    context->record_flac_frame = flac_frame;
+    context->record_frame_head = 0;
+    context->record_frame_count = 0;
+    context->record_audio_head = 0;
+    context->record_audio_count = 0;
+    context->record_shutdown = false;
     pthread_mutex_unlock(&context->recording_mutex);
+
+    if (pthread_create(&context->record_thread, NULL, record_thread_func, context) != 0) {
+        C64U_LOG_ERROR("Failed to create recording writer thread");
+        pthread_mutex_lock(&context->recording_mutex);
+        context->record_frame_ring = NULL;
+        context->record_audio_ring = NULL;
+        context->record_scratch = NULL;
+        context->record_audio_chunk = NULL;
+        context->record_rle_frame = NULL;
+        context->record_rle_previous = NULL;
+        context->record_last_frame = NULL;
+        context->record_flac_block = NULL;
+        context->record_flac_frame = NULL;
+        context->record_frame_count = 0;
+        context->record_audio_count = 0;
+        pthread_mutex_unlock(&context->recording_mutex);
+        goto fail;
+    }
+    context->record_thread_active = true;
+    return;
+
+fail:
+    bfree(frame_ring);
+    bfree(audio_ring);
+    bfree(scratch);
+    bfree(audio_chunk);
+    bfree(rle_frame);
+    bfree(rle_previous);
+    bfree(last_frame);
+    bfree(flac_block);
+    bfree(flac_frame);
 }
 
-void record_audio_data(struct c64u_source *context, const uint8_t *audio_data, size_t data_size)
+size_t c64u_record_memory(const struct c64u_source *context)
 {
-    if (!context->record_video || !context->audio_file || !audio_data) {
+    if (!context->record_frame_ring) {
+        return 0;
+    }
+    return sizeof(struct record_frame_slot) * C64U_RECORD_FRAME_SLOTS +
+           sizeof(struct record_audio_slot) * C64U_RECORD_AUDIO_SLOTS + C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT * 3 +
+           C64U_RECORD_AUDIO_CHUNK_SIZE + 3 * C64U_BYTES_PER_LINE * C64U_PAL_HEIGHT +
+           C64U_FLAC_BLOCK_SIZE * C64U_RECORD_AUDIO_FRAME_SIZE + C64U_FLAC_MAX_FRAME_SIZE(C64U_FLAC_BLOCK_SIZE);
+}
+
+// Wait for a free slot (block policy) or give up (drop policy); called with recording_mutex held
+static bool wait_for_record_slot(struct c64u_source *context, const uint32_t *count, uint32_t capacity)
+{
+    if (*count < capacity) {
+        return true;
+    }
+
+    if (context->record_overflow_policy == C64U_RECORD_OVERFLOW_BLOCK) {
+        context->record_block_waits++;
+        while (*count >= capacity && !context->record_shutdown &&
+               context->record_overflow_policy == C64U_RECORD_OVERFLOW_BLOCK) {
+            pthread_cond_wait(&context->record_space_cond, &context->recording_mutex);
+        }
+    }
+
+    return *count < capacity;
+}
+
+void record_submit_frame(struct c64u_source *context, struct frame_assembly *frame)
+{
+    if (context->save_frames) {
+        framedump_submit_frame(context, frame);
+    }
+    if (!context->record_video) {
         return;
     }
 
@@ -583,52 +998,60 @@ void record_audio_data(struct c64u_source *context, const uint8_t *audio_data, s
         return;
     }
 
-    // Write audio data to separate WAV file (preserve original behavior)
-    size_t wav_written = fwrite(audio_data, 1, data_size, context->audio_file);
+    if (!context->record_frame_ring || !wait_for_record_slot(context, &context->record_frame_count,
+                                                             C64U_RECORD_FRAME_SLOTS)) {
+        context->record_frames_dropped++;
+        pthread_mutex_unlock(&context->recording_mutex);
+        return;
+    }
 
-    // Note: Audio is only written to separate WAV file, not to AVI (video-only AVI)
+    uint32_t tail = (context->record_frame_head + context->record_frame_count) % C64U_RECORD_FRAME_SLOTS;
+    struct record_frame_slot *slot = &context->record_frame_ring[tail];
 
-    if (wav_written == data_size) {
-        context->recorded_audio_samples += (uint32_t)(data_size / 4); // 16-bit stereo = 4 bytes per sample
-        // Note: No AVI header update needed since audio is not in AVI file
-    } else {
-        C64U_LOG_WARNING("Failed to write audio data to WAV recording");
+    uint32_t height = context->height;
+    if (height > C64U_PAL_HEIGHT) {
+        height = C64U_PAL_HEIGHT;
+    }
+    c64u_core_frame_to_indexed(frame, slot->indexed_data, height);
+    slot->width = C64U_PIXELS_PER_LINE;
+    slot->height = height;
+    slot->frame_num = frame->frame_num;
+    slot->capture_time = os_gettime_ns();
+
+    context->record_frame_count++;
+    context->record_frames_queued++;
+    if (context->record_frame_count > context->record_queue_high_water) {
+        context->record_queue_high_water = context->record_frame_count;
     }
 
+    pthread_cond_signal(&context->record_cond);
     pthread_mutex_unlock(&context->recording_mutex);
 }
 
-void stop_video_recording(struct c64u_source *context)
+void record_audio_data(struct c64u_source *context, const uint8_t *audio_data, size_t data_size)
 {
-    if (!context->video_file) {
-        return; // Not recording
+    if (!context->record_video || !audio_data || data_size > C64U_AUDIO_PACKET_SIZE - C64U_AUDIO_HEADER_SIZE) {
+        return;
     }
 
     if (pthread_mutex_lock(&context->recording_mutex) != 0) {
         return;
     }
 
-    // Close recording files and finalize formats
-    if (context->video_file) {
-        // Update AVI header with final frame count
-        // Final header update is not needed since we update continuously
-        fclose(context->video_file);
-        context->video_file = NULL;
-    }
-    if (context->audio_file) {
-        // Update WAV header with final file size
-        finalize_wav_header(context->audio_file, context->recorded_audio_samples * 2); // samples * 2 bytes
-        fclose(context->audio_file);
-        context->audio_file = NULL;
-    }
-    if (context->timing_file) {
-        fclose(context->timing_file);
-        context->timing_file = NULL;
+    if (!context->record_audio_ring || !wait_for_record_slot(context, &context->record_audio_count,
+                                                             C64U_RECORD_AUDIO_SLOTS)) {
+        context->record_audio_dropped++;
+        pthread_mutex_unlock(&context->recording_mutex);
+        return;
     }
 
-    C64U_LOG_INFO("Recording stopped. Frames: %u, Audio samples: %llu", context->recorded_frames,
-                  (unsigned long long)context->recorded_audio_samples);
+    uint32_t tail = (context->record_audio_head + context->record_audio_count) % C64U_RECORD_AUDIO_SLOTS;
+    struct record_audio_slot *slot = &context->record_audio_ring[tail];
+    memcpy(slot->data, audio_data, data_size);
+    slot->size = (uint32_t)data_size;
+    context->record_audio_count++;
 
+    pthread_cond_signal(&context->record_cond);
     pthread_mutex_unlock(&context->recording_mutex);
 }
 
@@ -643,43 +1066,84 @@ void c64u_record_init(struct c64u_source *context)
 
     // Initialize video recording
     context->record_video = false;
-    context->video_file = NULL;
-    context->audio_file = NULL;
+    context->video_avi = NULL;
+    context->video_mkv = NULL;
+    context->audio_flac = NULL;
     context->timing_file = NULL;
     context->recording_start_time = 0;
     context->recorded_frames = 0;
     context->recorded_audio_samples = 0;
 
-    // Initialize recording mutex
+    // Writer thread and its queues are created when recording is first enabled
+    context->record_thread_active = false;
+    context->record_shutdown = false;
+    context->record_frame_ring = NULL;
+    context->record_audio_ring = NULL;
+    context->record_scratch = NULL;
+    context->record_rle_frame = NULL;
+    context->record_rle_previous = NULL;
+    context->record_last_frame = NULL;
+    context->record_audio_chunk = NULL;
+    context->record_flac_block = NULL;
+    context->record_flac_frame = NULL;
+    context->record_rle_have_previous = false;
+    context->record_overflow_policy = C64U_RECORD_OVERFLOW_DROP;
+    context->record_format = C64U_RECORD_FORMAT_BGR24;
+    context->record_audio_format = C64U_RECORD_AUDIO_PCM;
+    context->record_segment_minutes = 0;
+    context->record_segment_mb = 0;
+    context->record_direct_io = false;
+    context->record_skip_duplicates = false;
+    context->record_have_last_hash = false;
+
+    // Initialize recording mutex and writer signaling
     if (pthread_mutex_init(&context->recording_mutex, NULL) != 0) {
         C64U_LOG_ERROR("Failed to initialize recording mutex");
     }
+    pthread_mutex_init(&context->session_mutex, NULL);
+    pthread_cond_init(&context->record_cond, NULL);
+    pthread_cond_init(&context->record_space_cond, NULL);
 }
 
 // Recording cleanup function
 void c64u_record_cleanup(struct c64u_source *context)
 {
-    // Stop recording if active
-    if (context->record_video) {
-        if (pthread_mutex_lock(&context->recording_mutex) == 0) {
-            if (context->video_file) {
-                fclose(context->video_file);
-                context->video_file = NULL;
-            }
-            if (context->audio_file) {
-                fclose(context->audio_file);
-                context->audio_file = NULL;
-            }
-            if (context->timing_file) {
-                fclose(context->timing_file);
-                context->timing_file = NULL;
-            }
-            pthread_mutex_unlock(&context->recording_mutex);
-        }
+    // Let the writer drain its queues, finalize open files and exit
+    if (context->record_thread_active) {
+        pthread_mutex_lock(&context->recording_mutex);
+        context->record_shutdown = true;
+        pthread_cond_signal(&context->record_cond);
+        pthread_cond_broadcast(&context->record_space_cond);
+        pthread_mutex_unlock(&context->recording_mutex);
+
+        pthread_join(context->record_thread, NULL);
+        context->record_thread_active = false;
     }
 
-    // Clean up recording mutex
+    bfree(context->record_frame_ring);
+    bfree(context->record_audio_ring);
+    bfree(context->record_scratch);
+    bfree(context->record_rle_frame);
+    bfree(context->record_rle_previous);
+    bfree(context->record_last_frame);
+    bfree(context->record_audio_chunk);
+    bfree(context->record_flac_block);
+    bfree(context->record_flac_frame);
+    context->record_frame_ring = NULL;
+    context->record_audio_ring = NULL;
+    context->record_scratch = NULL;
+    context->record_rle_frame = NULL;
+    context->record_rle_previous = NULL;
+    context->record_last_frame = NULL;
+    context->record_audio_chunk = NULL;
+    context->record_flac_block = NULL;
+    context->record_flac_frame = NULL;
+
+    // Clean up recording mutex and writer signaling
+    pthread_cond_destroy(&context->record_cond);
+    pthread_cond_destroy(&context->record_space_cond);
     pthread_mutex_destroy(&context->recording_mutex);
+    pthread_mutex_destroy(&context->session_mutex);
 }
 
 // Recording settings update function
@@ -687,8 +1151,9 @@ void c64u_record_update_settings(struct c64u_source *context, void *settings_ptr
 {
     obs_data_t *settings = (obs_data_t *)settings_ptr;
 
+    pthread_mutex_lock(&context->recording_mutex);
+
     // Update frame saving settings
-    context->save_frames = obs_data_get_bool(settings, "save_frames");
     const char *new_save_folder = obs_data_get_string(settings, "save_folder");
     if (new_save_folder && strlen(new_save_folder) > 0) {
         if (strcmp(context->save_folder, new_save_folder) != 0) {
@@ -699,27 +1164,51 @@ void c64u_record_update_settings(struct c64u_source *context, void *settings_ptr
         }
     }
 
-    // Update frame saving (check if we need session cleanup)
-    bool old_save_frames = context->save_frames;
     context->save_frames = obs_data_get_bool(settings, "save_frames");
-    if (old_save_frames && !context->save_frames) {
-        // Frame saving stopped, cleanup session if no other recording active
-        cleanup_session_if_needed(context);
+    context->record_overflow_policy = (uint32_t)obs_data_get_int(settings, "record_overflow_policy");
+    context->record_format = (uint32_t)obs_data_get_int(settings, "record_format");
+#ifdef C64U_HAVE_FFMPEG
+    uint32_t max_format = C64U_RECORD_FORMAT_FFV1;
+#else
+    uint32_t max_format = C64U_RECORD_FORMAT_RLE4; // FFV1 needs a plugin built with FFmpeg
+#endif
+    if (context->record_format > max_format) {
+        context->record_format = C64U_RECORD_FORMAT_BGR24;
+    }
+    context->record_segment_minutes = (uint32_t)obs_data_get_int(settings, "record_segment_minutes");
+    context->record_segment_mb = (uint32_t)obs_data_get_int(settings, "record_segment_mb");
+    context->record_direct_io = obs_data_get_bool(settings, "record_direct_io");
+    context->record_skip_duplicates = obs_data_get_bool(settings, "record_skip_duplicates");
+    context->record_audio_format = (uint32_t)obs_data_get_int(settings, "record_audio_format");
+    if (context->record_audio_format > C64U_RECORD_AUDIO_FLAC) {
+        context->record_audio_format = C64U_RECORD_AUDIO_PCM;
     }
 
-    // Update video recording settings
+    // Update video recording settings - the writer thread opens/closes the files
     bool new_record_video = obs_data_get_bool(settings, "record_video");
     if (new_record_video != context->record_video) {
         context->record_video = new_record_video;
-
         if (new_record_video) {
-            // Start recording (will join/create session)
-            start_video_recording(context);
-            C64U_LOG_INFO("Video recording started");
-        } else {
-            // Stop recording
-            stop_video_recording(context);
-            cleanup_session_if_needed(context);
+            context->record_frames_queued = 0;
+            context->record_frames_written = 0;
+            context->record_frames_duplicate = 0;
+            context->record_frames_discarded = 0;
+            context->record_frames_dropped = 0;
+            context->record_audio_dropped = 0;
+            context->record_block_waits = 0;
+            context->record_queue_high_water = 0;
+            context->record_encode_time_ns = 0;
+            context->record_encode_time_max_ns = 0;
         }
+        C64U_LOG_INFO("Video recording %s", new_record_video ? "started" : "stopping");
+    }
+
+    // Release producers blocked on a full queue if the policy was switched to drop
+    pthread_cond_broadcast(&context->record_space_cond);
+    pthread_cond_signal(&context->record_cond);
+    pthread_mutex_unlock(&context->recording_mutex);
+
+    if (any_recording_active(context)) {
+        start_record_writer(context);
     }
 }
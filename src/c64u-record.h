@@ -3,20 +3,57 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+// Recording queue sizing - preallocated when recording is first enabled
+#define C64U_RECORD_FRAME_SLOTS 32  // ~0.64s of PAL frames (32 x 52KB indexed)
+#define C64U_RECORD_AUDIO_SLOTS 512 // ~2s of audio packets (512 x 768 bytes)
+
+// Recorded audio: 16-bit stereo PCM, interleaved with the video in the AVI as ~1 chunk per video frame
+#define C64U_RECORD_AUDIO_SAMPLE_RATE 48000
+#define C64U_RECORD_AUDIO_FRAME_SIZE 4          // Bytes per stereo sample
+#define C64U_RECORD_AUDIO_CHUNK_SIZE (16 * 768) // Largest audio chunk (16 packets, ~64ms)
+
+// Recording queue overflow policy (what the receive threads do when the writer can't keep up)
+#define C64U_RECORD_OVERFLOW_DROP 0  // Drop the new frame/packet and count it (protects the live stream)
+#define C64U_RECORD_OVERFLOW_BLOCK 1 // Wait for a free slot (lossless recording, may cause UDP drops)
+
+// Recorded video formats (AVI unless noted; indexed formats carry the VIC-II palette in strf)
+#define C64U_RECORD_FORMAT_BGR24 0 // 24-bit BGR, 313KB per PAL frame
+#define C64U_RECORD_FORMAT_PAL8 1  // 8-bit indexed, 104KB per PAL frame
+#define C64U_RECORD_FORMAT_PAL4 2  // 4-bit indexed, 52KB per PAL frame (same as the stream payload)
+#define C64U_RECORD_FORMAT_RLE8 3  // BI_RLE8 compressed, typically a few KB per PAL frame
+#define C64U_RECORD_FORMAT_RLE4 4  // BI_RLE4 compressed, typically a few KB per PAL frame
+#define C64U_RECORD_FORMAT_FFV1 5  // Lossless FFV1 in Matroska (video.mkv), only with C64U_HAVE_FFMPEG
+
+// Recorded audio formats
+#define C64U_RECORD_AUDIO_PCM 0  // 16-bit PCM interleaved in the video file
+#define C64U_RECORD_AUDIO_FLAC 1 // Separate audio.flac (c64u-flac.h), typically 2-3x smaller, survives crashes
+
+// RLE formats write a full frame every N frames and only changed lines in between
+#define C64U_RECORD_RLE_KEYFRAME_INTERVAL 50 // ~1s, bounds seek cost and damage from a corrupt frame
 
 // Forward declarations
 struct c64u_source;
+struct frame_assembly;
 
-// Frame saving and recording functions
-void save_frame_as_bmp(struct c64u_source *context, uint32_t *frame_buffer);
-void start_video_recording(struct c64u_source *context);
-void record_video_frame(struct c64u_source *context, uint32_t *frame_buffer);
+// Producer side, called from the receive threads - only copies into the recording queues, never touches disk
+void record_submit_frame(struct c64u_source *context, struct frame_assembly *frame);
 void record_audio_data(struct c64u_source *context, const uint8_t *audio_data, size_t data_size);
-void stop_video_recording(struct c64u_source *context);
+
+// Create a directory and all missing parents (shared with the stream capture writer)
+bool create_directory_recursive(const char *path);
+
+// Copy the current session folder into folder, creating a new timestamped session if none is active.
+// Called from the recording writer and the frame dump workers. Returns false if it couldn't be created.
+bool record_get_session_folder(struct c64u_source *context, char *folder, size_t size);
 
 // Recording initialization and cleanup functions
 void c64u_record_init(struct c64u_source *context);
 void c64u_record_cleanup(struct c64u_source *context);
 void c64u_record_update_settings(struct c64u_source *context, void *settings);
 
+// Bytes held by the recording queues and writer buffers (allocated on first recording, 0 before)
+size_t c64u_record_memory(const struct c64u_source *context);
+
 #endif // C64U_RECORD_H
@@ -0,0 +1,309 @@
+#include <obs-module.h>
+#include <util/platform.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdio.h>
+#include "c64u-logging.h"
+#include "c64u-replay.h"
+#include "c64u-capture.h"
+#include "c64u-source.h"
+#include "c64u-types.h"
+#include "c64u-video.h"
+#include "c64u-audio.h"
+#include "c64u-record.h"
+#include "c64u-framedump.h"
+
+static uint16_t read_u16(const uint8_t *p)
+{
+    uint16_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint64_t read_u64(const uint8_t *p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Open a capture file and position it at the first record. Returns the header size, or 0 on error.
+static uint16_t open_replay_file(struct c64u_source *context, FILE **file_out)
+{
+    FILE *file = fopen(context->replay_path, "rb");
+    if (!file) {
+        C64U_LOG_ERROR("Failed to open replay file: %s", context->replay_path);
+        return 0;
+    }
+
+    uint8_t header[C64U_CAPTURE_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, C64U_CAPTURE_MAGIC, 4) != 0) {
+        C64U_LOG_ERROR("Not a C64U stream capture file: %s", context->replay_path);
+        fclose(file);
+        return 0;
+    }
+
+    uint16_t version = read_u16(header + 4);
+    uint16_t header_size = read_u16(header + 6);
+    if (version != C64U_CAPTURE_VERSION || header_size < C64U_CAPTURE_HEADER_SIZE) {
+        C64U_LOG_ERROR("Unsupported capture file version %u (header %u bytes): %s", version, header_size,
+                       context->replay_path);
+        fclose(file);
+        return 0;
+    }
+
+    char host[65] = {0};
+    memcpy(host, header + 24, 64);
+    C64U_LOG_INFO("Replaying %s: captured from '%s', 384x%u @ %.3f Hz, %u records, %u datagrams lost in capture",
+                  context->replay_path, host, read_u16(header + 156), read_u32(header + 160) / 1000.0,
+                  read_u32(header + 164), read_u32(header + 168));
+
+    fseek(file, header_size, SEEK_SET);
+    *file_out = file;
+    return header_size;
+}
+
+// Sleep until the given os_gettime_ns() time in short steps, so the replay can be stopped at any point
+static void replay_wait_until(struct c64u_source *context, uint64_t target)
+{
+    uint64_t now = os_gettime_ns();
+    while (context->thread_active && now < target) {
+        uint64_t remaining = target - now;
+        os_sleepto_ns(now + (remaining < C64U_REPLAY_MAX_SLEEP_NS ? remaining : C64U_REPLAY_MAX_SLEEP_NS));
+        now = os_gettime_ns();
+    }
+}
+
+// Replay thread: reads records and feeds them to the same packet processing as the UDP receiver threads
+static void *replay_thread_func(void *data)
+{
+    struct c64u_source *context = data;
+    FILE *file = NULL;
+    uint16_t header_size = open_replay_file(context, &file);
+    if (header_size == 0) {
+        return NULL;
+    }
+
+    uint8_t record_header[C64U_CAPTURE_RECORD_HEADER_SIZE];
+    uint8_t payload[C64U_CAPTURE_MAX_PAYLOAD];
+    uint64_t replay_start = os_gettime_ns();
+    uint32_t records = 0;
+
+    C64U_LOG_DEBUG("Replay thread started (speed %.2fx, loop %s)", context->replay_speed,
+                   context->replay_loop ? "on" : "off");
+
+    while (context->thread_active) {
+        uint64_t timestamp = 0;
+        uint8_t stream_id = 0;
+        uint16_t length = 0;
+        bool have_record = fread(record_header, 1, sizeof(record_header), file) == sizeof(record_header);
+        if (have_record) {
+            timestamp = read_u64(record_header);
+            stream_id = record_header[8];
+            length = read_u16(record_header + 10);
+
+            // A truncated last record (capture not closed cleanly) ends the replay like end-of-file
+            if (length > sizeof(payload) || fread(payload, 1, length, file) != length) {
+                C64U_LOG_WARNING("Replay file ends with a truncated record after %u records", records);
+                have_record = false;
+            }
+        }
+
+        if (!have_record) {
+            if (!context->replay_loop || records == 0) {
+                C64U_LOG_INFO("Replay finished: %u records", records);
+                break;
+            }
+            context->replay_loops++;
+            C64U_LOG_DEBUG("Replay loop %u complete (%u records), restarting", context->replay_loops, records);
+            fseek(file, header_size, SEEK_SET);
+            replay_start = os_gettime_ns();
+            records = 0;
+            continue;
+        }
+
+        // Pace by the recorded arrival times, scaled by the playback speed
+        if (context->replay_speed > C64U_REPLAY_SPEED_UNLIMITED) {
+            replay_wait_until(context, replay_start + (uint64_t)(timestamp / context->replay_speed));
+        }
+
+        switch (stream_id) {
+        case C64U_CAPTURE_STREAM_VIDEO:
+            process_video_packet(context, payload, length);
+            break;
+        case C64U_CAPTURE_STREAM_AUDIO:
+            process_audio_packet(context, payload, length);
+            break;
+        case C64U_CAPTURE_STREAM_GAP:
+            C64U_LOG_DEBUG("Replay: %u datagrams were lost while capturing", read_u32(payload));
+            break;
+        default:
+            // Unknown record types from newer capture versions carry no C64U datagram
+            break;
+        }
+        records++;
+    }
+
+    fclose(file);
+    C64U_LOG_DEBUG("Replay thread stopped");
+    return NULL;
+}
+
+static void start_replay(struct c64u_source *context)
+{
+    if (context->replay_path[0] == '\0') {
+        return;
+    }
+
+    context->thread_active = true;
+    context->streaming = true;
+    init_delay_queue(context);
+
+    if (pthread_create(&context->replay_thread, NULL, replay_thread_func, context) != 0) {
+        C64U_LOG_ERROR("Failed to create replay thread");
+        context->thread_active = false;
+        context->streaming = false;
+        return;
+    }
+    context->replay_thread_active = true;
+}
+
+static void stop_replay(struct c64u_source *context)
+{
+    context->streaming = false;
+    context->thread_active = false;
+
+    if (context->replay_thread_active) {
+        pthread_join(context->replay_thread, NULL);
+        context->replay_thread_active = false;
+    }
+
+    c64u_reset_frame_pipeline(context);
+}
+
+void *c64u_replay_create(obs_data_t *settings, obs_source_t *source)
+{
+    C64U_LOG_INFO("Creating C64U replay source");
+
+    struct c64u_source *context = bzalloc(sizeof(struct c64u_source));
+    if (!context) {
+        C64U_LOG_ERROR("Failed to allocate memory for replay source context");
+        return NULL;
+    }
+
+    context->source = source;
+
+    // Frame buffers, format detection and delay queue
+    if (!c64u_init_frame_pipeline(context)) {
+        bfree(context);
+        return NULL;
+    }
+
+    // No retry thread, but the renderer signals it when frames time out
+    pthread_mutex_init(&context->retry_mutex, NULL);
+    pthread_cond_init(&context->retry_cond, NULL);
+
+    // The packet processing hands frames and audio to the recorder, which stays idle for replays
+    c64u_record_init(context);
+    c64u_framedump_init(context);
+
+    c64u_replay_update(context, settings);
+    return context;
+}
+
+void c64u_replay_destroy(void *data)
+{
+    struct c64u_source *context = data;
+    if (!context)
+        return;
+
+    C64U_LOG_INFO("Destroying C64U replay source");
+
+    stop_replay(context);
+    c64u_framedump_cleanup(context);
+    c64u_record_cleanup(context);
+
+    if (context->logo_texture) {
+        gs_texture_destroy(context->logo_texture);
+        context->logo_texture = NULL;
+    }
+
+    pthread_mutex_destroy(&context->retry_mutex);
+    pthread_cond_destroy(&context->retry_cond);
+    c64u_free_frame_pipeline(context);
+    bfree(context);
+}
+
+void c64u_replay_update(void *data, obs_data_t *settings)
+{
+    struct c64u_source *context = data;
+    if (!context)
+        return;
+
+    // Restart from the beginning of the file with the new settings
+    stop_replay(context);
+
+    const char *path = obs_data_get_string(settings, "replay_file");
+    strncpy(context->replay_path, path ? path : "", sizeof(context->replay_path) - 1);
+    context->replay_path[sizeof(context->replay_path) - 1] = '\0';
+    context->replay_speed = obs_data_get_double(settings, "replay_speed");
+    context->replay_loop = obs_data_get_bool(settings, "replay_loop");
+    context->replay_loops = 0;
+    c64u_set_render_delay(context, (uint32_t)obs_data_get_int(settings, "render_delay_frames"));
+
+    start_replay(context);
+}
+
+const char *c64u_replay_get_name(void *unused)
+{
+    UNUSED_PARAMETER(unused);
+    return obs_module_text("C64UReplay");
+}
+
+obs_properties_t *c64u_replay_properties(void *data)
+{
+    UNUSED_PARAMETER(data);
+
+    obs_properties_t *props = obs_properties_create();
+
+    obs_property_t *file_prop = obs_properties_add_path(props, "replay_file", "Capture File", OBS_PATH_FILE,
+                                                        "C64U stream captures (*.c64s);;All files (*.*)", NULL);
+    obs_property_set_long_description(file_prop,
+                                      "Raw stream capture (.c64s) recorded with Capture Raw Stream on a C64U source");
+
+    obs_property_t *speed_prop = obs_properties_add_list(props, "replay_speed", "Playback Speed", OBS_COMBO_TYPE_LIST,
+                                                         OBS_COMBO_FORMAT_FLOAT);
+    obs_property_list_add_float(speed_prop, "Real time (1x)", 1.0);
+    obs_property_list_add_float(speed_prop, "2x", 2.0);
+    obs_property_list_add_float(speed_prop, "4x", 4.0);
+    obs_property_list_add_float(speed_prop, "As fast as possible", C64U_REPLAY_SPEED_UNLIMITED);
+    obs_property_set_long_description(
+        speed_prop, "Packets are replayed with their recorded arrival timing, scaled by this factor. Faster than real "
+                    "time is meant for profiling; audio is only meaningful at 1x");
+
+    obs_property_t *loop_prop = obs_properties_add_bool(props, "replay_loop", "Loop");
+    obs_property_set_long_description(loop_prop, "Start again from the beginning when the end of the file is reached");
+
+    obs_property_t *delay_prop = obs_properties_add_int_slider(props, "render_delay_frames", "Render Delay (frames)", 0,
+                                                               C64U_MAX_RENDER_DELAY_FRAMES, 1);
+    obs_property_set_long_description(
+        delay_prop, "Delay frames before rendering to smooth UDP packet loss/reordering (default: 3)");
+
+    return props;
+}
+
+void c64u_replay_defaults(obs_data_t *settings)
+{
+    obs_data_set_default_string(settings, "replay_file", "");
+    obs_data_set_default_double(settings, "replay_speed", 1.0);
+    obs_data_set_default_bool(settings, "replay_loop", false);
+    obs_data_set_default_int(settings, "render_delay_frames", C64U_DEFAULT_RENDER_DELAY_FRAMES);
+}
@@ -0,0 +1,19 @@
+#ifndef C64U_REPLAY_H
+#define C64U_REPLAY_H
+
+#include <obs-module.h>
+
+// Replay pacing
+#define C64U_REPLAY_SPEED_UNLIMITED 0.0     // Feed records as fast as the pipeline accepts them
+#define C64U_REPLAY_MAX_SLEEP_NS 50000000ULL // Longest single sleep, so stopping a replay stays responsive
+
+// OBS source interface for the capture replay source ("c64u_replay_source"). Rendering and size
+// callbacks are shared with the live source (c64u_render, c64u_get_width, c64u_get_height).
+void *c64u_replay_create(obs_data_t *settings, obs_source_t *source);
+void c64u_replay_destroy(void *data);
+void c64u_replay_update(void *data, obs_data_t *settings);
+const char *c64u_replay_get_name(void *unused);
+obs_properties_t *c64u_replay_properties(void *data);
+void c64u_replay_defaults(obs_data_t *settings);
+
+#endif // C64U_REPLAY_H
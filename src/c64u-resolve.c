@@ -0,0 +1,349 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L // getaddrinfo(), struct addrinfo under -std=c17
+#endif
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE // NI_MAXHOST, inet_aton() and res_ninit() on glibc
+#endif
+#if defined(__APPLE__) && !defined(_DARWIN_C_SOURCE)
+#define _DARWIN_C_SOURCE // The same on macOS, which hides them under _POSIX_C_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c64u-core.h"
+#include "c64u-network.h"
+#include "c64u-resolve.h"
+
+// Additional includes for enhanced hostname resolution
+#if !defined(_WIN32)
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <resolv.h>
+#include <arpa/nameser.h>
+#endif
+
+// Enhanced DNS resolution functions (Linux/macOS)
+#if !defined(_WIN32)
+/**
+ * Direct DNS query to a specific DNS server (like dig @192.168.1.1)
+ * This bypasses systemd-resolved and queries the router/DNS server directly
+ */
+static bool resolve_hostname_direct_dns(const char *hostname, const char *dns_server, char *ip_buffer,
+                                        size_t buffer_size)
+{
+    if (!hostname || !dns_server || !ip_buffer || buffer_size < 16) {
+        return false;
+    }
+
+    struct __res_state res;
+    unsigned char answer[NS_PACKETSZ];
+    ns_msg msg;
+    ns_rr rr;
+
+    c64u_core_log(C64U_CORE_LOG_DEBUG, "Direct DNS query to %s for hostname: %s", dns_server, hostname);
+
+    // Initialize resolver
+    if (res_ninit(&res) != 0) {
+        c64u_core_log(C64U_CORE_LOG_DEBUG, "res_ninit failed for DNS server %s", dns_server);
+        return false;
+    }
+
+    // Set custom DNS server ("ip" or "ip:port")
+    struct sockaddr_in dns_addr;
+    memset(&dns_addr, 0, sizeof(dns_addr));
+    dns_addr.sin_family = AF_INET;
+    dns_addr.sin_port = htons(53);
+
+    char server_ip[64];
+    snprintf(server_ip, sizeof(server_ip), "%s", dns_server);
+    char *colon = strchr(server_ip, ':');
+    if (colon) {
+        *colon = '\0';
+        int port = atoi(colon + 1);
+        dns_addr.sin_port = htons((uint16_t)(port > 0 && port < 65536 ? port : 53));
+    }
+
+    if (inet_aton(server_ip, &dns_addr.sin_addr) == 0) {
+        c64u_core_log(C64U_CORE_LOG_DEBUG, "Invalid DNS server IP: %s", dns_server);
+        res_nclose(&res);
+        return false;
+    }
+
+    // Clear existing DNS servers and set our custom one. One try with a short timeout: the resolver's default of
+    // 5s and 2 attempts per server made a silent server cost 10s, and up to four servers are tried twice.
+    res.nscount = 1;
+    memcpy(&res.nsaddr_list[0], &dns_addr, sizeof(dns_addr));
+    res.retrans = C64U_DNS_TIMEOUT_S;
+    res.retry = 1;
+
+    // Perform DNS query for A record
+    int len = res_nquery(&res, hostname, ns_c_in, ns_t_a, answer, sizeof(answer));
+    if (len < 0) {
+        c64u_core_log(C64U_CORE_LOG_DEBUG, "Direct DNS query failed for %s via %s (h_errno: %d)", hostname,
+                      dns_server, h_errno);
+        res_nclose(&res);
+        return false;
+    }
+
+    // Parse DNS response
+    if (ns_initparse(answer, len, &msg) < 0) {
+        c64u_core_log(C64U_CORE_LOG_DEBUG, "DNS response parsing failed for %s", hostname);
+        res_nclose(&res);
+        return false;
+    }
+
+    int ancount = ns_msg_count(msg, ns_s_an);
+    if (ancount == 0) {
+        c64u_core_log(C64U_CORE_LOG_DEBUG, "No A record found for %s via %s", hostname, dns_server);
+        res_nclose(&res);
+        return false;
+    }
+
+    // Get the first A record
+    for (int i = 0; i < ancount; i++) {
+        if (ns_parserr(&msg, ns_s_an, i, &rr) < 0)
+            continue;
+
+        if (ns_rr_type(rr) == ns_t_a && ns_rr_rdlen(rr) == 4) {
+            struct in_addr addr;
+            memcpy(&addr, ns_rr_rdata(rr), sizeof(addr));
+            char ip_str[INET_ADDRSTRLEN]; // Not inet_ntoa(): sources resolve on their own threads
+
+            if (inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str)) && strlen(ip_str) < buffer_size) {
+                strcpy(ip_buffer, ip_str);
+                c64u_core_log(C64U_CORE_LOG_INFO, "Direct DNS resolved %s -> %s (via %s)", hostname, ip_str,
+                              dns_server);
+                res_nclose(&res);
+                return true;
+            }
+        }
+    }
+
+    res_nclose(&res);
+    return false;
+}
+
+/**
+ * Try multiple common DNS servers for hostname resolution
+ */
+static bool resolve_hostname_with_fallback_dns(const char *hostname, const char *custom_dns, char *ip_buffer,
+                                               size_t buffer_size)
+{
+    if (!hostname || !ip_buffer || buffer_size < 16) {
+        return false;
+    }
+
+    // List of DNS servers to try (configured DNS first, then fallback to common routers)
+    const char *dns_servers[8];
+    int dns_count = 0;
+
+    // Add configured DNS server first if provided and not empty
+    if (custom_dns && strlen(custom_dns) > 0) {
+        dns_servers[dns_count++] = custom_dns;
+        c64u_core_log(C64U_CORE_LOG_DEBUG, "Using configured DNS server: %s", custom_dns);
+    }
+
+    // Add common router DNS servers as fallback
+    dns_servers[dns_count++] = "192.168.0.1";
+    dns_servers[dns_count++] = "10.0.0.1";
+    dns_servers[dns_count++] = "172.16.0.1";
+    dns_servers[dns_count] = NULL;
+
+    for (int i = 0; i < dns_count; i++) {
+        if (resolve_hostname_direct_dns(hostname, dns_servers[i], ip_buffer, buffer_size)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+#endif
+
+// Function to detect local machine's IP address
+bool c64u_detect_local_ip(char *ip_buffer, size_t buffer_size)
+{
+    if (!ip_buffer || buffer_size < 16) {
+        return false;
+    }
+
+    // Initialize buffer
+    strncpy(ip_buffer, "127.0.0.1", buffer_size - 1);
+    ip_buffer[buffer_size - 1] = '\0';
+
+#ifdef _WIN32
+    // Windows implementation using GetAdaptersInfo
+    PIP_ADAPTER_INFO adapter_info = NULL;
+    ULONG out_buf_len = 0;
+    DWORD ret_val = 0;
+
+    // Get buffer size needed
+    ret_val = GetAdaptersInfo(adapter_info, &out_buf_len);
+    if (ret_val == ERROR_BUFFER_OVERFLOW) {
+        adapter_info = (IP_ADAPTER_INFO *)malloc(out_buf_len);
+        if (adapter_info != NULL) {
+            ret_val = GetAdaptersInfo(adapter_info, &out_buf_len);
+            if (ret_val == NO_ERROR) {
+                PIP_ADAPTER_INFO adapter = adapter_info;
+                while (adapter) {
+                    // Skip loopback and inactive adapters
+                    if (adapter->Type != MIB_IF_TYPE_LOOPBACK &&
+                        strcmp(adapter->IpAddressList.IpAddress.String, "0.0.0.0") != 0) {
+                        strncpy(ip_buffer, adapter->IpAddressList.IpAddress.String, buffer_size - 1);
+                        ip_buffer[buffer_size - 1] = '\0';
+                        c64u_core_log(C64U_CORE_LOG_INFO, "Detected Windows IP address: %s (adapter: %s)",
+                                      ip_buffer, adapter->AdapterName);
+                        free(adapter_info);
+                        return true;
+                    }
+                    adapter = adapter->Next;
+                }
+            }
+            free(adapter_info);
+        }
+    }
+    c64u_core_log(C64U_CORE_LOG_WARNING, "Failed to detect Windows IP address, using fallback");
+    return false;
+
+#elif defined(__APPLE__) || defined(__linux__)
+    // Unix/Linux/macOS implementation using getifaddrs
+    struct ifaddrs *ifaddrs_ptr, *ifa;
+    char host[NI_MAXHOST];
+
+    if (getifaddrs(&ifaddrs_ptr) == -1) {
+        c64u_core_log(C64U_CORE_LOG_WARNING, "getifaddrs failed: %s", strerror(errno));
+        return false;
+    }
+
+    for (ifa = ifaddrs_ptr; ifa != NULL; ifa = ifa->ifa_next) {
+        if (ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_INET) {
+            continue;
+        }
+
+        // Skip loopback interface
+        if (strcmp(ifa->ifa_name, "lo") == 0 || strcmp(ifa->ifa_name, "lo0") == 0) {
+            continue;
+        }
+
+        int result = getnameinfo(ifa->ifa_addr, sizeof(struct sockaddr_in), host, NI_MAXHOST, NULL, 0, NI_NUMERICHOST);
+        if (result != 0) {
+            continue;
+        }
+
+        // Skip if it's a localhost address
+        if (strcmp(host, "127.0.0.1") == 0) {
+            continue;
+        }
+
+        // We found a valid IP address
+        strncpy(ip_buffer, host, buffer_size - 1);
+        ip_buffer[buffer_size - 1] = '\0';
+        c64u_core_log(C64U_CORE_LOG_INFO, "Detected %s IP address: %s (interface: %s)",
+#ifdef __APPLE__
+                      "macOS",
+#else
+                      "Linux",
+#endif
+                      ip_buffer, ifa->ifa_name);
+        freeifaddrs(ifaddrs_ptr);
+        return true;
+    }
+
+    freeifaddrs(ifaddrs_ptr);
+    c64u_core_log(C64U_CORE_LOG_WARNING, "No suitable network interface found, using fallback");
+    return false;
+
+#else
+    // Fallback for other platforms
+    c64u_core_log(C64U_CORE_LOG_WARNING, "IP detection not implemented for this platform, using fallback");
+    return false;
+#endif
+}
+
+// Enhanced hostname resolution with custom DNS server support
+bool c64u_resolve_hostname(const char *hostname, char *ip_buffer, size_t buffer_size)
+{
+    return c64u_resolve_hostname_with_dns(hostname, NULL, ip_buffer, buffer_size);
+}
+
+// Resolve hostname to IP address with custom DNS server option
+bool c64u_resolve_hostname_with_dns(const char *hostname, const char *custom_dns_server, char *ip_buffer,
+                                    size_t buffer_size)
+{
+    if (!hostname || !ip_buffer || buffer_size < 16) {
+        return false;
+    }
+
+    // If it's already an IP address, copy it directly
+    struct sockaddr_in sa;
+    if (inet_pton(AF_INET, hostname, &sa.sin_addr) == 1) {
+        strncpy(ip_buffer, hostname, buffer_size - 1);
+        ip_buffer[buffer_size - 1] = '\0';
+        c64u_core_log(C64U_CORE_LOG_DEBUG, "Input '%s' is already an IP address", hostname);
+        return true;
+    }
+
+    c64u_core_log(C64U_CORE_LOG_DEBUG, "Attempting to resolve hostname: %s", hostname);
+
+    // Try system DNS resolution first (works for public hostnames and properly configured local DNS)
+    struct addrinfo hints, *result = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET; // IPv4 only
+    hints.ai_socktype = SOCK_STREAM;
+
+    int status = getaddrinfo(hostname, NULL, &hints, &result);
+    if (status == 0 && result != NULL) {
+        struct sockaddr_in *addr_in = (struct sockaddr_in *)result->ai_addr;
+        if (inet_ntop(AF_INET, &addr_in->sin_addr, ip_buffer, buffer_size) != NULL) {
+            c64u_core_log(C64U_CORE_LOG_INFO, "System DNS resolved '%s' to IP: %s", hostname, ip_buffer);
+            freeaddrinfo(result);
+            return true;
+        }
+    }
+
+    if (result) {
+        freeaddrinfo(result);
+    }
+
+    // Try with FQDN (dot suffix)
+    char hostname_with_dot[256];
+    snprintf(hostname_with_dot, sizeof(hostname_with_dot), "%s.", hostname);
+
+    c64u_core_log(C64U_CORE_LOG_DEBUG, "Trying FQDN resolution: %s", hostname_with_dot);
+
+    status = getaddrinfo(hostname_with_dot, NULL, &hints, &result);
+    if (status == 0 && result != NULL) {
+        struct sockaddr_in *addr_in = (struct sockaddr_in *)result->ai_addr;
+        if (inet_ntop(AF_INET, &addr_in->sin_addr, ip_buffer, buffer_size) != NULL) {
+            c64u_core_log(C64U_CORE_LOG_INFO, "FQDN resolved '%s' to IP: %s", hostname_with_dot, ip_buffer);
+            freeaddrinfo(result);
+            return true;
+        }
+    }
+
+    if (result) {
+        freeaddrinfo(result);
+    }
+
+#if !defined(_WIN32)
+    // On Linux/macOS: Try direct DNS server queries (bypasses systemd-resolved issues)
+    c64u_core_log(C64U_CORE_LOG_DEBUG, "System DNS failed, trying direct DNS server queries");
+
+    if (resolve_hostname_with_fallback_dns(hostname, custom_dns_server, ip_buffer, buffer_size)) {
+        return true;
+    }
+
+    // Also try FQDN with direct DNS
+    if (resolve_hostname_with_fallback_dns(hostname_with_dot, custom_dns_server, ip_buffer, buffer_size)) {
+        return true;
+    }
+#endif
+
+    c64u_core_log(C64U_CORE_LOG_WARNING, "Failed to resolve hostname '%s' using all available methods", hostname);
+    return false;
+}
+
+bool c64u_is_ip_address(const char *host)
+{
+    struct in_addr addr;
+    return host && inet_pton(AF_INET, host, &addr) == 1;
+}
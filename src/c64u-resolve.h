@@ -0,0 +1,26 @@
+#ifndef C64U_RESOLVE_H
+#define C64U_RESOLVE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// C64U host name resolution and local address detection. No libobs dependency, so tests and benchmarks run the
+// plugin's lookups; diagnostics go to the c64u-core log handler. Both calls block (resolution for seconds when a
+// DNS server does not answer): the OBS source runs them on its retry thread, never on OBS's loading or UI thread.
+
+// Seconds to wait for each direct DNS query before trying the next server
+#define C64U_DNS_TIMEOUT_S 2
+
+// First IPv4 address of a non-loopback interface; "127.0.0.1" and false if there is none
+bool c64u_detect_local_ip(char *ip_buffer, size_t buffer_size);
+
+// Resolve hostname to an IPv4 address (an address is copied as is): system resolver, then as FQDN, then direct
+// queries to custom_dns_server ("ip" or "ip:port", may be NULL or empty) and common router addresses.
+bool c64u_resolve_hostname(const char *hostname, char *ip_buffer, size_t buffer_size);
+bool c64u_resolve_hostname_with_dns(const char *hostname, const char *custom_dns_server, char *ip_buffer,
+                                    size_t buffer_size);
+
+// True if host is an IPv4 address, i.e. needs no resolution
+bool c64u_is_ip_address(const char *host);
+
+#endif // C64U_RESOLVE_H
@@ -0,0 +1,181 @@
+#include <string.h>
+#include "c64u-rle.h"
+
+// Longest run or absolute block a single RLE code can describe
+#define RLE_MAX_COUNT 255
+
+static inline uint8_t pixel_at(const uint8_t *line, uint32_t x)
+{
+    return (line[x >> 1] >> ((x & 1) * 4)) & 0x0F;
+}
+
+// Encoded mode: count pixels of one color
+static uint8_t *emit_run(uint8_t *out, uint32_t count, uint8_t color, uint16_t bit_count)
+{
+    *out++ = (uint8_t)count;
+    *out++ = bit_count == 4 ? (uint8_t)((color << 4) | color) : color;
+    return out;
+}
+
+// Absolute mode: 3..255 literal pixels, padded to a 16-bit boundary
+static uint8_t *emit_absolute(uint8_t *out, const uint8_t *line, uint32_t x, uint32_t count, uint16_t bit_count)
+{
+    *out++ = 0;
+    *out++ = (uint8_t)count;
+
+    uint32_t bytes;
+    if (bit_count == 4) {
+        // RLE4 packs the left pixel into the high nibble
+        bytes = (count + 1) / 2;
+        for (uint32_t i = 0; i < count; i += 2) {
+            uint8_t hi = pixel_at(line, x + i);
+            uint8_t lo = i + 1 < count ? pixel_at(line, x + i + 1) : 0;
+            *out++ = (uint8_t)((hi << 4) | lo);
+        }
+    } else {
+        bytes = count;
+        for (uint32_t i = 0; i < count; i++) {
+            *out++ = pixel_at(line, x + i);
+        }
+    }
+
+    if (bytes & 1) {
+        *out++ = 0;
+    }
+    return out;
+}
+
+// Literal pixels; blocks shorter than 3 pixels can't use absolute mode (0/1/2 are escape codes)
+static uint8_t *emit_literal(uint8_t *out, const uint8_t *line, uint32_t x, uint32_t count, uint16_t bit_count)
+{
+    while (count > 0) {
+        uint32_t n = count < RLE_MAX_COUNT ? count : RLE_MAX_COUNT;
+        if (n >= 3) {
+            out = emit_absolute(out, line, x, n, bit_count);
+        } else {
+            for (uint32_t i = 0; i < n; i++) {
+                out = emit_run(out, 1, pixel_at(line, x + i), bit_count);
+            }
+        }
+        x += n;
+        count -= n;
+    }
+    return out;
+}
+
+// Size of emit_literal() output, used to decide whether run-length coding a span pays off
+static size_t literal_size(uint32_t count, uint16_t bit_count)
+{
+    size_t size = 0;
+    while (count > 0) {
+        uint32_t n = count < RLE_MAX_COUNT ? count : RLE_MAX_COUNT;
+        if (n >= 3) {
+            uint32_t bytes = bit_count == 4 ? (n + 1) / 2 : n;
+            size += 2 + bytes + (bytes & 1);
+        } else {
+            size += 2 * n;
+        }
+        count -= n;
+    }
+    return size;
+}
+
+// Run-length code pixels [x, x + count) of a line, falling back to literal pixels where runs don't pay off
+static uint8_t *encode_span(uint8_t *out, const uint8_t *line, uint32_t x, uint32_t count, uint16_t bit_count)
+{
+    uint8_t *start = out;
+    uint32_t end = x + count;
+    uint32_t i = x;
+
+    while (i < end) {
+        uint8_t color = pixel_at(line, i);
+        uint32_t run = 1;
+        while (i + run < end && run < RLE_MAX_COUNT && pixel_at(line, i + run) == color) {
+            run++;
+        }
+        if (run >= 3) {
+            out = emit_run(out, run, color, bit_count);
+            i += run;
+            continue;
+        }
+
+        // Collect literal pixels up to the next run of at least 3
+        uint32_t j = i;
+        while (j < end && j - i < RLE_MAX_COUNT) {
+            if (j + 2 < end && pixel_at(line, j) == pixel_at(line, j + 1) &&
+                pixel_at(line, j) == pixel_at(line, j + 2)) {
+                break;
+            }
+            j++;
+        }
+        if (j - i == 2 && pixel_at(line, i) == pixel_at(line, i + 1)) {
+            out = emit_run(out, 2, color, bit_count);
+        } else {
+            out = emit_literal(out, line, i, j - i, bit_count);
+        }
+        i = j;
+    }
+
+    // Noisy content: store the span as plain pixels instead
+    if ((size_t)(out - start) > literal_size(count, bit_count)) {
+        out = emit_literal(start, line, x, count, bit_count);
+    }
+    return out;
+}
+
+// Move the decoder position by (dx, dy); dy counts lines in bitmap (bottom-up) order
+static uint8_t *emit_delta(uint8_t *out, uint32_t dx, uint32_t dy)
+{
+    while (dx > 0 || dy > 0) {
+        uint32_t step_x = dx < RLE_MAX_COUNT ? dx : RLE_MAX_COUNT;
+        uint32_t step_y = dy < RLE_MAX_COUNT ? dy : RLE_MAX_COUNT;
+        *out++ = 0;
+        *out++ = 2;
+        *out++ = (uint8_t)step_x;
+        *out++ = (uint8_t)step_y;
+        dx -= step_x;
+        dy -= step_y;
+    }
+    return out;
+}
+
+size_t c64u_rle_encode_frame(uint8_t *dst, const uint8_t *frame, const uint8_t *previous, uint32_t width,
+                             uint32_t height, uint32_t bytes_per_line, uint16_t bit_count)
+{
+    uint8_t *out = dst;
+    uint32_t row = 0; // Decoder position: bitmap row (0 = bottom line) at column 0
+
+    for (uint32_t r = 0; r < height; r++) {
+        uint32_t y = height - 1 - r;
+        const uint8_t *line = frame + (size_t)y * bytes_per_line;
+        uint32_t first = 0;
+        uint32_t last = width;
+
+        if (previous) {
+            // Delta frame: encode only the span of pixels that changed
+            const uint8_t *prev_line = previous + (size_t)y * bytes_per_line;
+            if (memcmp(line, prev_line, (width + 1) / 2) == 0) {
+                continue;
+            }
+            while (pixel_at(line, first) == pixel_at(prev_line, first)) {
+                first++;
+            }
+            while (pixel_at(line, last - 1) == pixel_at(prev_line, last - 1)) {
+                last--;
+            }
+        }
+
+        out = emit_delta(out, first, r - row);
+        out = encode_span(out, line, first, last - first, bit_count);
+
+        // End of line: continue at column 0 of the next bitmap row
+        *out++ = 0;
+        *out++ = 0;
+        row = r + 1;
+    }
+
+    // End of bitmap: lines not reached keep their previous content
+    *out++ = 0;
+    *out++ = 1;
+    return (size_t)(out - dst);
+}
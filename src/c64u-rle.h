@@ -0,0 +1,29 @@
+#ifndef C64U_RLE_H
+#define C64U_RLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// AVI/DIB run-length compression (biCompression values)
+#define C64U_BI_RLE8 1
+#define C64U_BI_RLE4 2
+
+// Worst-case encoded size of one line: absolute runs of at most 255 pixels (2 byte header, word padded),
+// leading position deltas and the end-of-line marker
+#define C64U_RLE_MAX_LINE_SIZE(width) ((width) + ((width) / 255 + 1) * 8 + 8)
+
+// Worst-case encoded size of one frame (all lines plus position deltas and the end-of-bitmap marker)
+#define C64U_RLE_MAX_FRAME_SIZE(width, height) (C64U_RLE_MAX_LINE_SIZE(width) * (height) + 4)
+
+// Encode a frame of packed 4-bit VIC indices (low nibble = left pixel, top line first, bytes_per_line
+// apart) as one bottom-up BI_RLE8 (bit_count 8) or BI_RLE4 (bit_count 4) DIB frame.
+//
+// With previous == NULL the whole frame is encoded (keyframe). Otherwise only lines and line spans that
+// differ from previous are encoded and unchanged pixels are skipped with position deltas (delta frame).
+// Runs that don't compress are written in absolute mode, so a frame never grows much beyond raw size.
+// dst must hold C64U_RLE_MAX_FRAME_SIZE(width, height) bytes. Returns the number of bytes written.
+size_t c64u_rle_encode_frame(uint8_t *dst, const uint8_t *frame, const uint8_t *previous, uint32_t width,
+                             uint32_t height, uint32_t bytes_per_line, uint16_t bit_count);
+
+#endif // C64U_RLE_H
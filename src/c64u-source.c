@@ -11,8 +11,12 @@
 #include "c64u-protocol.h"
 #include "c64u-video.h"
 #include "c64u-network.h"
+#include "c64u-resolve.h"
 #include "c64u-audio.h"
 #include "c64u-record.h"
+#include "c64u-framedump.h"
+#include "c64u-capture.h"
+#include "c64u-memory.h"
 #include "plugin-support.h"
 
 // Helper function to safely close and reset sockets
@@ -57,6 +61,169 @@ static gs_texture_t *load_logo_texture(void)
     return logo_texture;
 }
 
+// Allocate frame buffers and initialize the assembly and delay queue state shared by the live
+// and replay sources. On failure everything allocated here is released again.
+bool c64u_init_frame_pipeline(struct c64u_source *context)
+{
+    // Initialize video format (start with PAL, will be detected from stream)
+    context->width = C64U_PAL_WIDTH;
+    context->height = C64U_PAL_HEIGHT;
+
+    // Allocate video buffers (double buffering)
+    size_t frame_size = context->width * context->height * 4; // RGBA
+    uint32_t *front = bmalloc(frame_size);
+    uint32_t *back = bmalloc(frame_size);
+    if (!front || !back) {
+        C64U_LOG_ERROR("Failed to allocate video frame buffers");
+        if (front)
+            bfree(front);
+        if (back)
+            bfree(back);
+        return false;
+    }
+    memset(front, 0, frame_size);
+    memset(back, 0, frame_size);
+    context->frame_ready = false;
+    context->last_frame_time = 0; // Initialize frame timeout detection
+
+    // Initialize packet parsing, frame assembly and video format detection (PAL timing until detected)
+    struct c64u_core_callbacks callbacks = {
+        .frame = deliver_video_frame,
+        .format = update_video_format,
+        .audio = deliver_audio_packet,
+        .user = context,
+    };
+    c64u_core_init(&context->core, &callbacks);
+
+    // Complete frames go from the core to the double buffers, through the delay queue when there is a delay. The
+    // delay queue is allocated on the first delayed frame, sized for the delay the memory budget allows.
+    init_frame_output(context, front, back);
+
+    // Initialize mutexes
+    if (pthread_mutex_init(&context->frame_mutex, NULL) != 0) {
+        C64U_LOG_ERROR("Failed to initialize frame mutex");
+        bfree(front);
+        bfree(back);
+        return false;
+    }
+    if (pthread_mutex_init(&context->assembly_mutex, NULL) != 0) {
+        C64U_LOG_ERROR("Failed to initialize assembly mutex");
+        pthread_mutex_destroy(&context->frame_mutex);
+        bfree(front);
+        bfree(back);
+        return false;
+    }
+
+    // Initialize delay queue mutex
+    if (pthread_mutex_init(&context->delay_mutex, NULL) != 0) {
+        C64U_LOG_ERROR("Failed to initialize delay mutex");
+        pthread_mutex_destroy(&context->frame_mutex);
+        pthread_mutex_destroy(&context->assembly_mutex);
+        bfree(front);
+        bfree(back);
+        return false;
+    }
+
+    c64u_memory_register(context);
+
+    return true;
+}
+
+// Release everything allocated by c64u_init_frame_pipeline()
+void c64u_free_frame_pipeline(struct c64u_source *context)
+{
+    c64u_memory_unregister(context); // While delay_mutex exists: the rebalance takes it
+    pthread_mutex_destroy(&context->frame_mutex);
+    pthread_mutex_destroy(&context->assembly_mutex);
+    pthread_mutex_destroy(&context->delay_mutex);
+    if (context->output.front) {
+        bfree(context->output.front);
+    }
+    if (context->output.back) {
+        bfree(context->output.back);
+    }
+    c64u_frame_output_free(&context->output);
+}
+
+// Clear frame buffers, frame assembly state and the delay queue (receiver threads must be stopped)
+void c64u_reset_frame_pipeline(struct c64u_source *context)
+{
+    // Reset frame state and clear buffers
+    if (pthread_mutex_lock(&context->frame_mutex) == 0) {
+        context->frame_ready = false;
+        context->buffer_swap_pending = false;
+
+        // Clear frame buffers to prevent yellow screen
+        if (context->output.front && context->output.back) {
+            uint32_t frame_size = context->width * context->height * 4;
+            memset(context->output.front, 0, frame_size);
+            memset(context->output.back, 0, frame_size);
+        }
+
+        pthread_mutex_unlock(&context->frame_mutex);
+    }
+
+    // Reset frame assembly state
+    if (pthread_mutex_lock(&context->assembly_mutex) == 0) {
+        c64u_core_reset(&context->core);
+        memset(&context->core.stats, 0, sizeof(context->core.stats));
+        context->frames_delivered_to_obs = 0;
+        context->frames_completed = 0;
+        pthread_mutex_unlock(&context->assembly_mutex);
+    }
+
+    // Clear delay queue
+    clear_delay_queue(context);
+}
+
+// Change the render delay; the delay queue is reset and reallocated on the next frame
+void c64u_set_render_delay(struct c64u_source *context, uint32_t new_delay_frames)
+{
+    if (new_delay_frames != context->render_delay_frames) {
+        C64U_LOG_INFO("Rendering delay changed from %u to %u frames", context->render_delay_frames, new_delay_frames);
+
+        if (pthread_mutex_lock(&context->delay_mutex) == 0) {
+            context->render_delay_frames = new_delay_frames;
+
+            // Reset delay queue when delay changes; it is reallocated for the new delay on the next frame
+            c64u_delay_queue_free(&context->output.queue);
+
+            pthread_mutex_unlock(&context->delay_mutex);
+        }
+
+        // A new delay changes how the memory budget is shared out
+        c64u_memory_rebalance();
+    }
+}
+
+// Instant replay triggers: a hotkey, the "Save Instant Replay" button and the save_replay procedure for scripts
+static void replay_hotkey_pressed(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
+{
+    UNUSED_PARAMETER(id);
+    UNUSED_PARAMETER(hotkey);
+    if (pressed) {
+        c64u_capture_save_replay(data, NULL, 0);
+    }
+}
+
+static void replay_proc_save(void *data, calldata_t *cd)
+{
+    char path[1024];
+    bool saving = c64u_capture_save_replay(data, path, sizeof(path));
+    calldata_set_bool(cd, "saving", saving);
+    calldata_set_string(cd, "path", path);
+}
+
+static bool replay_save_clicked(obs_properties_t *props, obs_property_t *property, void *data)
+{
+    UNUSED_PARAMETER(props);
+    UNUSED_PARAMETER(property);
+    if (data) {
+        c64u_capture_save_replay(data, NULL, 0);
+    }
+    return false;
+}
+
 void *c64u_create(obs_data_t *settings, obs_source_t *source)
 {
     C64U_LOG_INFO("Creating C64U source");
@@ -91,16 +258,14 @@ void *c64u_create(obs_data_t *settings, obs_source_t *source)
 
     // Get configured DNS server IP
     const char *dns_server_ip = obs_data_get_string(settings, "dns_server_ip");
+    snprintf(context->dns_server_ip, sizeof(context->dns_server_ip), "%s", dns_server_ip ? dns_server_ip : "");
 
-    // Resolve hostname to IP address for actual connections
-    if (!c64u_resolve_hostname_with_dns(hostname, dns_server_ip, context->ip_address, sizeof(context->ip_address))) {
-        // If hostname resolution fails, store the hostname as-is (might be invalid IP like 0.0.0.0)
-        strncpy(context->ip_address, hostname, sizeof(context->ip_address) - 1);
-        context->ip_address[sizeof(context->ip_address) - 1] = '\0';
-        C64U_LOG_WARNING("Could not resolve hostname '%s', using as-is: %s", hostname, context->ip_address);
-    } else {
-        C64U_LOG_INFO("Resolved C64U host '%s' to IP: %s", hostname, context->ip_address);
-    }
+    // An IP address is used as is. A hostname is resolved by the retry thread before its first connection attempt:
+    // this runs on OBS's loading thread for every source in the scene collection, and a lookup can take seconds
+    // per DNS server. Until then ip_address holds the hostname, which no connection attempt accepts.
+    strncpy(context->ip_address, hostname, sizeof(context->ip_address) - 1);
+    context->ip_address[sizeof(context->ip_address) - 1] = '\0';
+    context->host_resolve_pending = !c64u_is_ip_address(hostname);
 
     context->auto_detect_ip = obs_data_get_bool(settings, "auto_detect_ip");
     context->video_port = (uint32_t)obs_data_get_int(settings, "video_port");
@@ -117,23 +282,9 @@ void *c64u_create(obs_data_t *settings, obs_source_t *source)
         context->initial_ip_detected = true;
         C64U_LOG_INFO("Using saved OBS IP address: %s", context->obs_ip_address);
     } else {
-        // First time - detect local IP address
-        if (c64u_detect_local_ip(context->obs_ip_address, sizeof(context->obs_ip_address))) {
-            C64U_LOG_INFO("Successfully detected OBS IP address: %s", context->obs_ip_address);
-            context->initial_ip_detected = true;
-            // Save the detected IP to settings for future use
-            obs_data_set_string(settings, "obs_ip_address", context->obs_ip_address);
-        } else {
-            C64U_LOG_WARNING("Failed to detect OBS IP address, will use configured value");
-            context->initial_ip_detected = false;
-        }
-    }
-
-    // Ensure we have a valid OBS IP address - use localhost as last resort
-    if (strlen(context->obs_ip_address) == 0) {
-        C64U_LOG_INFO("No OBS IP configured, using localhost as fallback");
-        strncpy(context->obs_ip_address, "127.0.0.1", sizeof(context->obs_ip_address) - 1);
-        obs_data_set_string(settings, "obs_ip_address", context->obs_ip_address);
+        // First time - the retry thread detects the local IP address before its first connection attempt, like it
+        // resolves the hostname: scanning the network interfaces would hold up OBS's loading thread as well
+        context->local_ip_detect_pending = true;
     }
 
     // Set default ports if not configured
@@ -142,57 +293,8 @@ void *c64u_create(obs_data_t *settings, obs_source_t *source)
     if (context->audio_port == 0)
         context->audio_port = C64U_DEFAULT_AUDIO_PORT;
 
-    // Initialize video format (start with PAL, will be detected from stream)
-    context->width = C64U_PAL_WIDTH;
-    context->height = C64U_PAL_HEIGHT;
-
-    // Allocate video buffers (double buffering)
-    size_t frame_size = context->width * context->height * 4; // RGBA
-    context->frame_buffer_front = bmalloc(frame_size);
-    context->frame_buffer_back = bmalloc(frame_size);
-    if (!context->frame_buffer_front || !context->frame_buffer_back) {
-        C64U_LOG_ERROR("Failed to allocate video frame buffers");
-        if (context->frame_buffer_front)
-            bfree(context->frame_buffer_front);
-        if (context->frame_buffer_back)
-            bfree(context->frame_buffer_back);
-        bfree(context);
-        return NULL;
-    }
-    memset(context->frame_buffer_front, 0, frame_size);
-    memset(context->frame_buffer_back, 0, frame_size);
-    context->frame_ready = false;
-    context->last_frame_time = 0; // Initialize frame timeout detection
-
-    // Initialize video format detection
-    context->detected_frame_height = 0;
-    context->format_detected = false;
-    context->expected_fps = 50.125; // Default to PAL timing until detected
-
-    // Initialize mutexes
-    if (pthread_mutex_init(&context->frame_mutex, NULL) != 0) {
-        C64U_LOG_ERROR("Failed to initialize frame mutex");
-        bfree(context->frame_buffer_front);
-        bfree(context->frame_buffer_back);
-        bfree(context);
-        return NULL;
-    }
-    if (pthread_mutex_init(&context->assembly_mutex, NULL) != 0) {
-        C64U_LOG_ERROR("Failed to initialize assembly mutex");
-        pthread_mutex_destroy(&context->frame_mutex);
-        bfree(context->frame_buffer_front);
-        bfree(context->frame_buffer_back);
-        bfree(context);
-        return NULL;
-    }
-
-    // Initialize delay queue mutex
-    if (pthread_mutex_init(&context->delay_mutex, NULL) != 0) {
-        C64U_LOG_ERROR("Failed to initialize delay mutex");
-        pthread_mutex_destroy(&context->frame_mutex);
-        pthread_mutex_destroy(&context->assembly_mutex);
-        bfree(context->frame_buffer_front);
-        bfree(context->frame_buffer_back);
+    // Frame buffers, format detection and delay queue
+    if (!c64u_init_frame_pipeline(context)) {
         bfree(context);
         return NULL;
     }
@@ -203,14 +305,9 @@ void *c64u_create(obs_data_t *settings, obs_source_t *source)
         context->render_delay_frames = C64U_DEFAULT_RENDER_DELAY_FRAMES;
     }
 
-    // Initialize delay queue - allocate for maximum delay + some extra buffer
-    context->delay_queue_size = 0;
-    context->delay_queue_head = 0;
-    context->delay_queue_tail = 0;
-    context->delayed_frame_queue = NULL;
-    context->delay_sequence_queue = NULL;
-
     C64U_LOG_INFO("Rendering delay initialized: %u frames", context->render_delay_frames);
+    c64u_memory_set_budget(context, (uint32_t)obs_data_get_int(settings, "memory_budget_mb"));
+    c64u_memory_rebalance(); // Another source's budget is shared with this source's delay as well
 
     // Initialize sockets to invalid
     context->video_socket = INVALID_SOCKET_VALUE;
@@ -239,8 +336,23 @@ void *c64u_create(obs_data_t *settings, obs_source_t *source)
     // Apply recording settings from OBS
     c64u_record_update_settings(context, settings);
 
+    // Initialize frame dumping (uses the recording mutex and session)
+    c64u_framedump_init(context);
+    c64u_framedump_update_settings(context, settings);
+
+    // Initialize raw stream capture
+    c64u_capture_init(context);
+    c64u_capture_update_settings(context, settings);
+    context->replay_buffer_hotkey = obs_hotkey_register_source(source, "c64u_save_replay",
+                                                               "Save C64U Instant Replay", replay_hotkey_pressed,
+                                                               context);
+    proc_handler_add(obs_source_get_proc_handler(source), "void save_replay(out bool saving, out string path)",
+                     replay_proc_save, context);
+    proc_handler_add(obs_source_get_proc_handler(source), C64U_MEMORY_PROC, c64u_memory_proc_get, context);
+
     C64U_LOG_INFO("C64U source created - C64U host: %s (IP: %s), OBS IP: %s, Video: %u, Audio: %u", context->hostname,
-                  context->ip_address, context->obs_ip_address, context->video_port, context->audio_port);
+                  context->ip_address, context->local_ip_detect_pending ? "(detecting)" : context->obs_ip_address,
+                  context->video_port, context->audio_port);
 
     // Initialize async retry system immediately to start continuous retry attempts
     init_async_retry_system(context);
@@ -261,6 +373,8 @@ void c64u_destroy(void *data)
 
     C64U_LOG_INFO("Destroying C64U source");
 
+    obs_hotkey_unregister(context->replay_buffer_hotkey);
+
     // Shutdown async retry system first
     shutdown_async_retry_system(context);
 
@@ -286,9 +400,13 @@ void c64u_destroy(void *data)
         }
     }
 
-    // Cleanup recording module
+    // Write the remaining dumped frames, then cleanup recording module
+    c64u_framedump_cleanup(context);
     c64u_record_cleanup(context);
 
+    // Finish raw stream capture (receive threads are stopped, so the queue no longer grows)
+    c64u_capture_cleanup(context);
+
     // Cleanup logo texture
     if (context->logo_texture) {
         gs_texture_destroy(context->logo_texture);
@@ -296,21 +414,7 @@ void c64u_destroy(void *data)
     }
 
     // Cleanup resources
-    pthread_mutex_destroy(&context->frame_mutex);
-    pthread_mutex_destroy(&context->assembly_mutex);
-    pthread_mutex_destroy(&context->delay_mutex);
-    if (context->frame_buffer_front) {
-        bfree(context->frame_buffer_front);
-    }
-    if (context->frame_buffer_back) {
-        bfree(context->frame_buffer_back);
-    }
-    if (context->delayed_frame_queue) {
-        bfree(context->delayed_frame_queue);
-    }
-    if (context->delay_sequence_queue) {
-        bfree(context->delay_sequence_queue);
-    }
+    c64u_free_frame_pipeline(context);
 
     bfree(context);
     C64U_LOG_INFO("C64U source destroyed");
@@ -368,23 +472,23 @@ void c64u_update(void *data, obs_data_t *settings)
         os_sleep_ms(100);
     }
 
-    // Update configuration - hostname and IP resolution
-    strncpy(context->hostname, new_host, sizeof(context->hostname) - 1);
-    context->hostname[sizeof(context->hostname) - 1] = '\0';
-
-    // Get configured DNS server IP
+    // Update configuration - hostname and IP resolution. A changed hostname is resolved by the retry thread, as in
+    // c64u_create(); this runs on the UI thread.
     const char *dns_server_ip = obs_data_get_string(settings, "dns_server_ip");
-
-    // Resolve hostname to IP address for connections
-    if (!c64u_resolve_hostname_with_dns(new_host, dns_server_ip, context->ip_address, sizeof(context->ip_address))) {
-        // If hostname resolution fails, store the hostname as-is (might be invalid IP like 0.0.0.0)
-        strncpy(context->ip_address, new_host, sizeof(context->ip_address) - 1);
-        context->ip_address[sizeof(context->ip_address) - 1] = '\0';
-        C64U_LOG_WARNING("Could not resolve hostname '%s' during update, using as-is: %s", new_host,
-                         context->ip_address);
-    } else {
-        C64U_LOG_DEBUG("Resolved C64U host '%s' to IP: %s", new_host, context->ip_address);
+    if (!dns_server_ip)
+        dns_server_ip = "";
+    pthread_mutex_lock(&context->retry_mutex);
+    if (strcmp(context->hostname, new_host) != 0 || strcmp(context->dns_server_ip, dns_server_ip) != 0) {
+        snprintf(context->hostname, sizeof(context->hostname), "%s", new_host);
+        snprintf(context->dns_server_ip, sizeof(context->dns_server_ip), "%s", dns_server_ip);
+        snprintf(context->ip_address, sizeof(context->ip_address), "%s", new_host);
+        context->host_resolve_pending = !c64u_is_ip_address(new_host);
+        pthread_cond_signal(&context->retry_cond);
     }
+    if (new_obs_ip && new_obs_ip[0] != '\0') {
+        context->local_ip_detect_pending = false; // An address entered before the first detection wins
+    }
+    pthread_mutex_unlock(&context->retry_mutex);
     if (new_obs_ip) {
         strncpy(context->obs_ip_address, new_obs_ip, sizeof(context->obs_ip_address) - 1);
         context->obs_ip_address[sizeof(context->obs_ip_address) - 1] = '\0';
@@ -393,34 +497,13 @@ void c64u_update(void *data, obs_data_t *settings)
     context->audio_port = new_audio_port;
 
     // Update rendering delay setting
-    uint32_t new_delay_frames = (uint32_t)obs_data_get_int(settings, "render_delay_frames");
-    if (new_delay_frames != context->render_delay_frames) {
-        C64U_LOG_INFO("Rendering delay changed from %u to %u frames", context->render_delay_frames, new_delay_frames);
-
-        if (pthread_mutex_lock(&context->delay_mutex) == 0) {
-            context->render_delay_frames = new_delay_frames;
-
-            // Reset delay queue when delay changes
-            context->delay_queue_size = 0;
-            context->delay_queue_head = 0;
-            context->delay_queue_tail = 0;
-
-            // Force reallocation of delay buffers on next frame
-            if (context->delayed_frame_queue) {
-                bfree(context->delayed_frame_queue);
-                context->delayed_frame_queue = NULL;
-            }
-            if (context->delay_sequence_queue) {
-                bfree(context->delay_sequence_queue);
-                context->delay_sequence_queue = NULL;
-            }
-
-            pthread_mutex_unlock(&context->delay_mutex);
-        }
-    }
+    c64u_set_render_delay(context, (uint32_t)obs_data_get_int(settings, "render_delay_frames"));
+    c64u_memory_set_budget(context, (uint32_t)obs_data_get_int(settings, "memory_budget_mb"));
 
     // Update recording settings
     c64u_record_update_settings(context, settings);
+    c64u_framedump_update_settings(context, settings);
+    c64u_capture_update_settings(context, settings);
 
     // Start streaming with current configuration (will create new sockets if needed)
     C64U_LOG_INFO("Applying configuration and starting streaming");
@@ -520,38 +603,70 @@ void c64u_stop_streaming(struct c64u_source *context)
     }
     context->audio_thread_active = false;
 
-    // Reset frame state and clear buffers
-    if (pthread_mutex_lock(&context->frame_mutex) == 0) {
-        context->frame_ready = false;
-        context->buffer_swap_pending = false;
+    // Reset frame state, assembly and delay queue
+    c64u_reset_frame_pipeline(context);
 
-        // Clear frame buffers to prevent yellow screen
-        if (context->frame_buffer_front && context->frame_buffer_back) {
-            uint32_t frame_size = context->width * context->height * 4;
-            memset(context->frame_buffer_front, 0, frame_size);
-            memset(context->frame_buffer_back, 0, frame_size);
-        }
+    C64U_LOG_INFO("C64U streaming stopped");
+}
 
-        pthread_mutex_unlock(&context->frame_mutex);
+// Test streams from c64u_mock_server carry a latency stamp (--stamp), a continuity pattern (--pattern) and A/V sync
+// flash frames (--av-sync) in their pixels (c64u-core.h). Check each new frame as it is rendered and log the results
+// every 5 seconds; frames from a real C64U carry none of them and cost a few pixel checks per band. The stamp's send
+// time comes from the mock server's monotonic clock, so latency only means something on the same host. The A/V
+// offset accumulates over the whole session so its drift shows.
+static void measure_test_stream(struct c64u_source *context, uint64_t now)
+{
+    if (context->last_frame_time == context->latency_frame_time) {
+        return;
     }
+    context->latency_frame_time = context->last_frame_time;
 
-    // Reset frame assembly state
-    if (pthread_mutex_lock(&context->assembly_mutex) == 0) {
-        memset(&context->current_frame, 0, sizeof(context->current_frame));
-        context->last_completed_frame = 0;
-        context->frame_drops = 0;
-        context->packet_drops = 0;
-        context->frames_expected = 0;
-        context->frames_captured = 0;
-        context->frames_delivered_to_obs = 0;
-        context->frames_completed = 0;
-        pthread_mutex_unlock(&context->assembly_mutex);
+    uint32_t counter;
+    uint64_t send_time;
+    if (c64u_stamp_decode(context->output.front, &counter, &send_time) && send_time <= now) {
+        c64u_latency_add(&context->latency, now - send_time);
+    }
+    c64u_continuity_check(&context->continuity, context->output.front, context->height);
+    uint32_t mark;
+    if (c64u_avsync_flash_decode(context->output.front, &mark)) {
+        c64u_avsync_video_mark(&context->avsync, now); // Audio marks come from deliver_audio_packet()
     }
 
-    // Clear delay queue
-    clear_delay_queue(context);
-
-    C64U_LOG_INFO("C64U streaming stopped");
+    if (context->latency_log_time == 0) {
+        context->latency_log_time = now;
+    }
+    if (now - context->latency_log_time < 5000000000ULL) {
+        return;
+    }
+    struct c64u_latency *latency = &context->latency;
+    if (latency->count > 0) {
+        C64U_LOG_INFO("⏱️ LATENCY: %u frames | Mean %.1f ms | p50 %.1f ms | p90 %.1f ms | p99 %.1f ms | Max %.1f ms | "
+                      "Render delay %u frames",
+                      latency->count, latency->sum_ns / 1000000.0 / latency->count,
+                      c64u_latency_percentile(latency, 50) / 1000000.0,
+                      c64u_latency_percentile(latency, 90) / 1000000.0,
+                      c64u_latency_percentile(latency, 99) / 1000000.0, latency->max_ns / 1000000.0,
+                      context->render_delay_frames);
+    }
+    struct c64u_continuity *continuity = &context->continuity;
+    if (continuity->have_last) {
+        C64U_LOG_INFO("🎞️ CONTINUITY: Smoothness %.1f%% | %u in order | %u skipped (%u frames never shown) | "
+                      "%u repeated | %u torn | %u concealed",
+                      c64u_continuity_score(continuity), continuity->counts[C64U_CONTINUITY_IN_ORDER],
+                      continuity->counts[C64U_CONTINUITY_SKIPPED], continuity->skipped_frames,
+                      continuity->counts[C64U_CONTINUITY_REPEATED], continuity->counts[C64U_CONTINUITY_TORN],
+                      continuity->counts[C64U_CONTINUITY_CONCEALED]);
+    }
+    struct c64u_avsync *avsync = &context->avsync;
+    if (avsync->count > 0) {
+        C64U_LOG_INFO("🎬 A/V SYNC: %u marks | Audio %+.1f ms (stddev %.1f ms, last %+.1f ms) | Drift %+.2f ms/min | "
+                      "%u unpaired",
+                      avsync->count, c64u_avsync_mean_ms(avsync), c64u_avsync_stddev_ms(avsync), avsync->last_ms,
+                      c64u_avsync_drift_ms_per_min(avsync), avsync->unpaired);
+    }
+    c64u_latency_reset(latency);
+    c64u_continuity_reset(continuity);
+    context->latency_log_time = now;
 }
 
 void c64u_render(void *data, gs_effect_t *effect)
@@ -592,7 +707,7 @@ void c64u_render(void *data, gs_effect_t *effect)
         }
     }
 
-    bool should_show_logo = !context->streaming || !context->frame_ready || !context->frame_buffer_front ||
+    bool should_show_logo = !context->streaming || !context->frame_ready || !context->output.front ||
                             frames_timed_out;
 
     // Debug logging (only when debug logging is enabled)
@@ -612,11 +727,11 @@ void c64u_render(void *data, gs_effect_t *effect)
     // Additional debug when logo should be showing
     static uint64_t last_debug_log = 0;
     if (should_show_logo && (last_debug_log == 0 || (now - last_debug_log) >= C64U_DEBUG_LOG_INTERVAL_NS)) {
-        const char *reason = !context->streaming            ? "not_streaming"
-                             : !context->frame_ready        ? "no_frames"
-                             : !context->frame_buffer_front ? "no_buffer"
-                             : frames_timed_out             ? "frame_timeout"
-                                                            : "unknown";
+        const char *reason = !context->streaming       ? "not_streaming"
+                             : !context->frame_ready   ? "no_frames"
+                             : !context->output.front  ? "no_buffer"
+                             : frames_timed_out        ? "frame_timeout"
+                                                       : "unknown";
         C64U_LOG_DEBUG("🖼️ Showing logo (%s): streaming=%d, frame_ready=%d, frames_timed_out=%d, C64_IP='%s'", reason,
                        context->streaming, context->frame_ready, frames_timed_out, context->ip_address);
         last_debug_log = now;
@@ -729,9 +844,11 @@ void c64u_render(void *data, gs_effect_t *effect)
     } else {
         // Render actual C64U video frame from front buffer
         if (pthread_mutex_lock(&context->frame_mutex) == 0) {
+            measure_test_stream(context, now);
+
             // Create texture from front buffer data
             gs_texture_t *texture = gs_texture_create(context->width, context->height, GS_RGBA, 1,
-                                                      (const uint8_t **)&context->frame_buffer_front, 0);
+                                                      (const uint8_t **)&context->output.front, 0);
             if (texture) {
                 // Use default effect for texture rendering
                 gs_effect_t *default_effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
@@ -827,18 +944,112 @@ obs_properties_t *c64u_properties(void *data)
     obs_property_set_long_description(
         delay_prop, "Delay frames before rendering to smooth UDP packet loss/reordering (default: 3)");
 
+    // Memory budget shared by all C64U sources
+    obs_property_t *budget_prop = obs_properties_add_int(props, "memory_budget_mb", "Memory Budget (MB, 0 = no limit)",
+                                                         0, C64U_MEMORY_BUDGET_MAX_MB, 16);
+    obs_property_set_long_description(
+        budget_prop, "Cap on the buffers of all C64U sources together; the smallest budget set on any source applies. "
+                     "Render delays are lowered to fit; recording, capture and the replay buffer count against the "
+                     "budget but are not limited (see the 🧠 MEMORY lines in the log).");
+
     // Recording Group (compact layout)
     obs_property_t *recording_group =
         obs_properties_add_group(props, "recording_group", "Recording", OBS_GROUP_NORMAL, obs_properties_create());
     obs_properties_t *recording_props = obs_property_group_content(recording_group);
 
     obs_property_t *save_frames_prop = obs_properties_add_bool(recording_props, "save_frames", "☐ Save BMP Frames");
+    obs_property_set_long_description(save_frames_prop,
+                                      "Save each frame as BMP in the frames/ subfolder (written by background "
+                                      "workers; frames are skipped rather than slowing down the stream)");
+
+    obs_property_t *frames_format_prop = obs_properties_add_list(
+        recording_props, "save_frames_format", "BMP Frame Format", OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+    obs_property_list_add_int(frames_format_prop, "4-bit palettized (52KB per frame)", C64U_FRAMEDUMP_FORMAT_BMP4);
+    obs_property_list_add_int(frames_format_prop, "4-bit RLE compressed (smallest)", C64U_FRAMEDUMP_FORMAT_RLE4);
+    obs_property_list_add_int(frames_format_prop, "24-bit RGB (313KB per frame)", C64U_FRAMEDUMP_FORMAT_BMP24);
+
+    obs_property_t *record_video_prop =
+        obs_properties_add_bool(recording_props, "record_video", "☐ Record AVI (Video + Audio)");
+    obs_property_set_long_description(record_video_prop,
+                                      "Record video with interleaved PCM audio into one AVI (for debugging - high disk "
+                                      "usage)");
+
+    obs_property_t *format_prop = obs_properties_add_list(recording_props, "record_format", "AVI Video Format",
+                                                          OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+    obs_property_list_add_int(format_prop, "Uncompressed BGR24 (largest)", C64U_RECORD_FORMAT_BGR24);
+    obs_property_list_add_int(format_prop, "8-bit palettized (3x smaller)", C64U_RECORD_FORMAT_PAL8);
+    obs_property_list_add_int(format_prop, "4-bit palettized (6x smaller)", C64U_RECORD_FORMAT_PAL4);
+    obs_property_list_add_int(format_prop, "8-bit RLE (smallest)", C64U_RECORD_FORMAT_RLE8);
+    obs_property_list_add_int(format_prop, "4-bit RLE (smallest)", C64U_RECORD_FORMAT_RLE4);
+#ifdef C64U_HAVE_FFMPEG
+    obs_property_list_add_int(format_prop, "FFV1 lossless in Matroska (archival, .mkv)", C64U_RECORD_FORMAT_FFV1);
+#endif
+    obs_property_set_long_description(
+        format_prop, "Pixel format of video.avi. Palettized formats store the 16 VIC-II colors as a palette and write "
+                     "the received color indices directly; RLE formats also run-length compress them and only store "
+                     "changed lines between keyframes. FFV1 (if available) writes video.mkv instead, encoded on spare "
+                     "cores. All open in standard players and ffmpeg");
+
+    obs_property_t *audio_format_prop = obs_properties_add_list(recording_props, "record_audio_format",
+                                                                "Audio Format", OBS_COMBO_TYPE_LIST,
+                                                                OBS_COMBO_FORMAT_INT);
+    obs_property_list_add_int(audio_format_prop, "PCM in the video file", C64U_RECORD_AUDIO_PCM);
+    obs_property_list_add_int(audio_format_prop, "FLAC (audio.flac, smaller)", C64U_RECORD_AUDIO_FLAC);
+    obs_property_set_long_description(
+        audio_format_prop, "PCM is interleaved with the video (192 KB/s). FLAC is lossless, typically 2-3x smaller "
+                           "and written as a separate audio.flac that stays playable if OBS crashes");
+
+    obs_property_t *overflow_prop = obs_properties_add_list(recording_props, "record_overflow_policy",
+                                                            "When Disk Is Too Slow", OBS_COMBO_TYPE_LIST,
+                                                            OBS_COMBO_FORMAT_INT);
+    obs_property_list_add_int(overflow_prop, "Drop recorded frames (protect live stream)", C64U_RECORD_OVERFLOW_DROP);
+    obs_property_list_add_int(overflow_prop, "Wait for disk (lossless recording)", C64U_RECORD_OVERFLOW_BLOCK);
     obs_property_set_long_description(
-        save_frames_prop, "Save each frame as BMP in frames/ subfolder (for debugging - impacts performance)");
+        overflow_prop,
+        "Recording is written on a background thread. If the disk falls behind and the recording queue fills up, "
+        "either drop frames from the recording or make the receiver wait (which can cause UDP packet loss)");
+
+    obs_property_t *skip_duplicates_prop =
+        obs_properties_add_bool(recording_props, "record_skip_duplicates", "Store Repeated Frames Only Once");
+    obs_property_set_long_description(skip_duplicates_prop,
+                                      "Frames identical to the previous one (static screens, menus, BASIC) become "
+                                      "empty AVI frames or a longer display of the previous Matroska frame. "
+                                      "Playback timing is unchanged; timing.txt still lists every frame. Some "
+                                      "editors and players handle empty frames poorly (default: off)");
+
+    obs_property_t *segment_minutes_prop = obs_properties_add_int(recording_props, "record_segment_minutes",
+                                                                  "Split Recording Every (minutes)", 0, 1440, 1);
+    obs_property_set_long_description(segment_minutes_prop,
+                                      "Continue in a new numbered video file (video_000.avi, video_001.avi, ...) "
+                                      "after this many minutes, for long unattended recordings. 0 = never");
+    obs_property_t *segment_mb_prop = obs_properties_add_int(recording_props, "record_segment_mb",
+                                                             "Split Recording at Size (MB)", 0, 65536, 1);
+    obs_property_set_long_description(segment_mb_prop,
+                                      "Continue in a new numbered video file once the current one reaches this "
+                                      "size. 0 = never");
+    obs_property_t *direct_io_prop =
+        obs_properties_add_bool(recording_props, "record_direct_io", "Write AVI Without Page Cache (Direct I/O)");
+    obs_property_set_long_description(direct_io_prop,
+                                      "Write the AVI in aligned 1 MB blocks that bypass the operating system's page "
+                                      "cache, so recording doesn't evict OBS's own data from memory (Linux and "
+                                      "macOS; ignored where not supported)");
+
+    obs_property_t *capture_prop =
+        obs_properties_add_bool(recording_props, "capture_stream", "☐ Capture Raw Stream (.c64s)");
+    obs_property_set_long_description(
+        capture_prop, "Save every received video and audio datagram with its arrival time to a .c64s file in the "
+                      "output folder (lossless, about 3 MB/s). Use it to reproduce stream problems offline");
 
-    obs_property_t *record_video_prop = obs_properties_add_bool(recording_props, "record_video", "☐ Record AVI + WAV");
-    obs_property_set_long_description(record_video_prop,
-                                      "Record uncompressed AVI video + WAV audio (for debugging - high disk usage)");
+    obs_property_t *replay_prop =
+        obs_properties_add_bool(recording_props, "replay_buffer", "☐ Instant Replay Buffer");
+    obs_property_set_long_description(
+        replay_prop, "Keep the last seconds of received datagrams in memory (about 3 MB per second) and save them as "
+                     "replay_YYYYMMDD_HHMMSS.c64s on demand - with the button below, the \"Save C64U Instant "
+                     "Replay\" hotkey or the save_replay source procedure. Catches rare glitches without recording "
+                     "everything");
+    obs_properties_add_int(recording_props, "replay_buffer_seconds", "Instant Replay Length (seconds)", 1,
+                           C64U_REPLAY_BUFFER_MAX_SECONDS, 1);
+    obs_properties_add_button(recording_props, "replay_save", "Save Instant Replay", replay_save_clicked);
 
     // Save Folder (applies to both frame saving and video recording) - now properly in Recording group
     obs_property_t *save_folder_prop =
@@ -862,9 +1073,11 @@ void c64u_defaults(obs_data_t *settings)
     obs_data_set_default_int(settings, "video_port", C64U_DEFAULT_VIDEO_PORT);
     obs_data_set_default_int(settings, "audio_port", C64U_DEFAULT_AUDIO_PORT);
     obs_data_set_default_int(settings, "render_delay_frames", C64U_DEFAULT_RENDER_DELAY_FRAMES);
+    obs_data_set_default_int(settings, "memory_budget_mb", 0); // No limit
 
     // Frame saving defaults
     obs_data_set_default_bool(settings, "save_frames", false); // Disabled by default
+    obs_data_set_default_int(settings, "save_frames_format", C64U_FRAMEDUMP_FORMAT_BMP4);
 
     // Platform-specific default recording folder (absolute paths to avoid tilde expansion issues)
     char platform_path[512];
@@ -892,4 +1105,14 @@ void c64u_defaults(obs_data_t *settings)
 
     // Video recording defaults
     obs_data_set_default_bool(settings, "record_video", false); // Disabled by default
+    obs_data_set_default_int(settings, "record_overflow_policy", C64U_RECORD_OVERFLOW_DROP);
+    obs_data_set_default_int(settings, "record_format", C64U_RECORD_FORMAT_BGR24);
+    obs_data_set_default_int(settings, "record_audio_format", C64U_RECORD_AUDIO_PCM);
+    obs_data_set_default_int(settings, "record_segment_minutes", 0);
+    obs_data_set_default_int(settings, "record_segment_mb", 0);
+    obs_data_set_default_bool(settings, "record_direct_io", false);
+    obs_data_set_default_bool(settings, "record_skip_duplicates", false); // Some editors mishandle empty frames
+    obs_data_set_default_bool(settings, "capture_stream", false);
+    obs_data_set_default_bool(settings, "replay_buffer", false);
+    obs_data_set_default_int(settings, "replay_buffer_seconds", C64U_REPLAY_BUFFER_DEFAULT_SECONDS);
 }
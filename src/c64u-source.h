@@ -17,6 +17,12 @@ const char *c64u_get_name(void *unused);
 obs_properties_t *c64u_properties(void *data);
 void c64u_defaults(obs_data_t *settings);
 
+// Frame pipeline shared by the live and replay sources
+bool c64u_init_frame_pipeline(struct c64u_source *context);
+void c64u_free_frame_pipeline(struct c64u_source *context);
+void c64u_reset_frame_pipeline(struct c64u_source *context);
+void c64u_set_render_delay(struct c64u_source *context, uint32_t new_delay_frames);
+
 // Streaming control functions
 void c64u_start_streaming(struct c64u_source *context);
 void c64u_stop_streaming(struct c64u_source *context);
@@ -8,23 +8,41 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "c64u-network.h"
+#include "c64u-protocol.h"
+#include "c64u-capture.h"
+#include "c64u-core.h"
 
-// Frame packet structure for reordering
-struct frame_packet {
-    uint16_t line_num;
-    uint8_t lines_per_packet;
-    uint8_t packet_data[780 - 12]; // C64U_VIDEO_PACKET_SIZE - C64U_VIDEO_HEADER_SIZE
-    bool received;
+// Recording queue slot: one completed frame as packed 4-bit VIC indices, handed from the
+// video thread to the recording writer thread
+struct record_frame_slot {
+    uint8_t indexed_data[C64U_PAL_HEIGHT * C64U_BYTES_PER_LINE];
+    uint32_t width;
+    uint32_t height;
+    uint16_t frame_num;
+    uint64_t capture_time; // os_gettime_ns() when the frame completed
 };
 
-// Frame assembly structure
-struct frame_assembly {
-    uint16_t frame_num;
-    uint16_t expected_packets;
-    uint16_t received_packets;
-    struct frame_packet packets[68]; // C64U_MAX_PACKETS_PER_FRAME
-    bool complete;
-    uint64_t start_time;
+// Frame dump slot: one completed frame waiting for a frame dump worker to write it as an image file
+struct framedump_slot {
+    uint8_t indexed_data[C64U_PAL_HEIGHT * C64U_BYTES_PER_LINE];
+    uint32_t width;
+    uint32_t height;
+    uint32_t sequence;     // Running number of the dumped frame (file name and batch folder)
+    uint64_t capture_time; // os_gettime_ns() when the frame completed
+};
+
+// Capture queue slot: one received datagram, copied verbatim for the .c64s writer thread
+struct capture_slot {
+    uint64_t receive_time; // os_gettime_ns() right after recv()
+    uint16_t size;         // Datagram size in bytes
+    uint8_t stream_id;     // C64U_CAPTURE_STREAM_*
+    uint8_t data[C64U_CAPTURE_MAX_PAYLOAD];
+};
+
+// Recording queue slot: one audio packet payload (192 stereo 16-bit samples)
+struct record_audio_slot {
+    uint8_t data[C64U_AUDIO_PACKET_SIZE - C64U_AUDIO_HEADER_SIZE];
+    uint32_t size;
 };
 
 struct c64u_source {
@@ -32,7 +50,8 @@ struct c64u_source {
 
     // Configuration
     char hostname[64];       // C64U hostname or IP as entered by user
-    char ip_address[64];     // C64U IP Address (resolved from hostname)
+    char ip_address[64];     // C64U IP Address (resolved from hostname on the retry thread)
+    char dns_server_ip[64];  // DNS server for resolving hostname ("ip" or "ip:port")
     char obs_ip_address[64]; // OBS IP Address (this machine)
     bool auto_detect_ip;
     bool initial_ip_detected; // Flag to track if initial IP detection was done
@@ -45,32 +64,28 @@ struct c64u_source {
     uint32_t height;
     uint8_t *video_buffer;
 
-    // Double buffering for smooth video
-    uint32_t *frame_buffer_front; // For rendering (OBS thread)
-    uint32_t *frame_buffer_back;  // For UDP assembly (video thread)
+    // Double buffering for smooth video: output.front is rendered (OBS thread), output.back filled by the core
+    struct c64u_frame_output output; // Buffers under frame_mutex, delay queue under delay_mutex
     bool frame_ready;
     bool buffer_swap_pending;
 
-    // Frame assembly and packet reordering
-    struct frame_assembly current_frame;
-    uint16_t last_completed_frame;
-    uint32_t frame_drops;
-    uint32_t packet_drops;
+    // Packet parsing, frame assembly and format detection (headless core, fed under assembly_mutex for video)
+    struct c64u_core core;
 
     // Frame diagnostic counters (Stats for Nerds style)
-    uint32_t frames_expected;
-    uint32_t frames_captured;
     uint32_t frames_delivered_to_obs;
     uint32_t frames_completed;
     uint32_t buffer_swaps;
-    uint64_t last_capture_time;
     uint64_t total_capture_latency;
     uint64_t total_pipeline_latency;
 
-    // Dynamic video format detection
-    uint32_t detected_frame_height;
-    bool format_detected;
-    double expected_fps;
+    // Statistics log periods, per source (0 = not started). CPU is the receiving thread's, at the period start.
+    uint64_t video_log_time;
+    uint64_t video_log_cpu_ns;
+    uint32_t framedump_written_reported;
+    uint64_t audio_log_time;
+    uint64_t audio_log_cpu_ns;
+    uint32_t audio_packet_total;
 
     // Audio data
     struct audio_output_info audio_info;
@@ -103,15 +118,27 @@ struct c64u_source {
     uint32_t retry_count;          // Number of retry attempts
     uint32_t consecutive_failures; // Number of consecutive TCP failures
     bool retry_shutdown;           // Signal to shutdown retry thread
+    bool host_resolve_pending;     // hostname or dns_server_ip changed: resolve before the next attempt
+    bool local_ip_detect_pending;  // No saved OBS IP address: detect it before the next attempt
 
     // Rendering delay
-    uint32_t render_delay_frames;   // Delay in frames before making buffer available to OBS
-    uint32_t *delayed_frame_queue;  // Circular buffer for delayed frames
-    uint32_t delay_queue_size;      // Current size of delay queue
-    uint32_t delay_queue_head;      // Head position in delay queue
-    uint32_t delay_queue_tail;      // Tail position in delay queue
-    uint16_t *delay_sequence_queue; // Sequence numbers for delayed frames
-    pthread_mutex_t delay_mutex;    // Mutex for delay queue access
+    uint32_t render_delay_frames; // Delay in frames before making buffer available to OBS
+    pthread_mutex_t delay_mutex;  // Mutex for delay queue (output.queue) access
+
+    // Memory accounting (c64u-memory.c) - sources are registered while their frame pipeline exists. The budget
+    // shared by all sources is the smallest non-zero memory_budget_mb; it caps each source's delay queue.
+    struct c64u_source *memory_next; // Next registered source, protected by the registry mutex
+    uint32_t memory_budget_mb;       // This source's budget setting (0 = no limit)
+    uint32_t delay_queue_limit;      // Delay queue frames the budget leaves this source (UINT32_MAX = no limit)
+    size_t memory_reported;          // Total of the last 🧠 MEMORY line (0 = not reported yet)
+
+    // Glass-to-glass latency, frame continuity and A/V sync of test streams (c64u_mock_server --stamp / --pattern /
+    // --av-sync), render thread only; avsync also gets audio marks under frame_mutex
+    uint64_t latency_frame_time; // last_frame_time of the last frame checked
+    uint64_t latency_log_time;
+    struct c64u_latency latency;
+    struct c64u_continuity continuity;
+    struct c64u_avsync avsync;
 
     // Auto-start control
     bool auto_start_attempted;
@@ -127,14 +154,143 @@ struct c64u_source {
 
     // Video recording for analysis
     bool record_video;
-    FILE *video_file;
-    FILE *audio_file;
+    struct c64u_avi_writer *video_avi; // Open OpenDML AVI (c64u-avi.h), owned by the writer thread
+    struct c64u_mkv_writer *video_mkv; // Open FFV1 Matroska file (c64u-mkv.h), owned by the writer thread
+    FILE *audio_flac;                  // Open audio.flac (FLAC audio format), owned by the writer thread
     FILE *timing_file;
-    char session_folder[800]; // Current session folder path
+    char session_folder[800]; // Current session folder path, protected by session_mutex
+    pthread_mutex_t session_mutex;
     uint64_t recording_start_time;
     uint32_t recorded_frames;
     uint32_t recorded_audio_samples;
+    uint32_t record_format;    // Requested video format (C64U_RECORD_FORMAT_*)
+    uint32_t recording_format; // Format, width and height of the video file being written
+    uint32_t recording_width;
+    uint32_t recording_height;
+    uint32_t record_audio_format;    // Requested audio format (C64U_RECORD_AUDIO_*)
+    uint32_t recording_audio_format; // Audio format of the files being written
+    uint32_t record_segment_minutes;    // Start a new segment file after this many minutes (0 = no limit)
+    uint32_t record_segment_mb;         // ...or after this many MB (0 = no limit)
+    bool record_direct_io;              // Write the video file with direct I/O (bypass the page cache)
+    uint32_t recording_segment_minutes; // Segment limits and I/O mode of the recording being written
+    uint32_t recording_segment_mb;
+    bool recording_direct_io;
+    bool record_skip_duplicates;    // Store frames identical to the previous one as empty/repeat frames
+    bool recording_skip_duplicates; // ...snapshot for the recording being written
+    uint64_t record_last_hash;      // Content hash of the last frame stored in the video file (writer thread)
+    bool record_have_last_hash;     // record_last_hash is valid (false after a segment start or write error)
+    uint8_t *record_last_frame;     // Indexed data of that frame, confirms hash matches (writer thread)
+    uint32_t record_last_height;
+    uint32_t record_segment;             // Current segment number (writer thread)
+    uint32_t record_segment_first_frame; // recorded_frames when the current segment started
+    uint64_t record_segment_bytes;       // Video and audio bytes written to the current segment
     pthread_mutex_t recording_mutex;
+
+    // Recording writer thread - all recording file I/O happens here, never on the receive threads.
+    // Ring state is protected by recording_mutex; file handles and session_folder are owned by the writer.
+    pthread_t record_thread;
+    bool record_thread_active;
+    bool record_shutdown;
+    pthread_cond_t record_cond;       // Signals the writer: work queued, settings changed or shutdown
+    pthread_cond_t record_space_cond; // Signals producers: a ring slot was freed (block policy)
+    struct record_frame_slot *record_frame_ring;
+    uint32_t record_frame_head;
+    uint32_t record_frame_count;
+    struct record_audio_slot *record_audio_ring;
+    uint32_t record_audio_head;
+    uint32_t record_audio_count;
+    uint8_t *record_scratch;         // Writer-side BGR24 conversion / RLE output buffer (allocated once)
+    uint8_t *record_rle_frame;       // Writer-side packed copy of the frame being RLE encoded
+    uint8_t *record_rle_previous;    // Last frame written to the RLE AVI, reference for delta frames
+    bool record_rle_have_previous;   // record_rle_previous is valid (false forces a keyframe)
+    uint8_t *record_audio_chunk;     // Writer-side audio collected for the next interleaved AVI chunk
+    uint32_t record_audio_chunk_size;
+    int16_t *record_flac_block;      // Writer-side stereo samples collected for the next FLAC frame
+    uint32_t record_flac_block_samples;
+    uint8_t *record_flac_frame;      // Writer-side encoded FLAC frame (allocated once)
+    uint32_t record_flac_frames;     // FLAC frames written, the number of the next frame
+    uint32_t record_flac_min_frame_size;
+    uint32_t record_flac_max_frame_size;
+    uint64_t record_flac_samples;
+    bool record_flac_failed;
+    uint32_t record_overflow_policy; // C64U_RECORD_OVERFLOW_DROP or C64U_RECORD_OVERFLOW_BLOCK
+
+    // Recording queue counters (reported with the periodic video statistics)
+    uint32_t record_frames_queued;
+    uint32_t record_frames_written;
+    uint32_t record_frames_duplicate; // Written frames stored as duplicates of the previous frame
+    uint32_t record_frames_discarded; // Dequeued frames that could not be written (no open file, write error)
+    uint32_t record_frames_dropped;
+    uint32_t record_audio_dropped;
+    uint32_t record_block_waits;
+    uint32_t record_queue_high_water;
+    uint64_t record_encode_time_ns;     // Total writer time spent encoding frames (RLE/FFV1 or pixel conversion)
+    uint64_t record_encode_time_max_ns; // Slowest frame encode since recording started
+
+    // Frame dumping (Save BMP Frames) - a pool of worker threads writes one image file per frame.
+    // Slot lists and counters are protected by recording_mutex, like the recording rings.
+    uint32_t framedump_format;      // C64U_FRAMEDUMP_FORMAT_*
+    pthread_t framedump_threads[2]; // C64U_FRAMEDUMP_WORKERS
+    uint32_t framedump_thread_count;
+    bool framedump_shutdown;
+    pthread_cond_t framedump_cond; // Signals the workers: frame queued or shutdown
+    struct framedump_slot *framedump_slots;
+    uint32_t framedump_pending[16]; // C64U_FRAMEDUMP_SLOTS - FIFO of queued slot indices
+    uint32_t framedump_pending_head;
+    uint32_t framedump_pending_count;
+    uint32_t framedump_free[16]; // Stack of unused slot indices
+    uint32_t framedump_free_count;
+    uint32_t framedump_busy_count; // Slots currently being written by a worker
+    uint32_t framedump_written;    // Frames written (reported as frames/s with the video statistics)
+    uint32_t framedump_dropped;    // Frames not dumped because all slots were in use
+    uint32_t framedump_failed;     // Frames that could not be written
+
+    // Raw stream capture (.c64s) - own writer thread, fed verbatim from the receive threads.
+    // Ring state and counters are protected by capture_mutex; capture_file is owned by the writer.
+    bool capture_stream;
+    FILE *capture_file;
+    char capture_filename[1024];
+    pthread_t capture_thread;
+    bool capture_thread_active;
+    bool capture_shutdown;
+    pthread_mutex_t capture_mutex;
+    pthread_cond_t capture_cond;
+    struct capture_slot *capture_ring;
+    uint32_t capture_head;
+    uint32_t capture_count;
+    uint32_t capture_pending_gap;  // Datagrams dropped since the last GAP record was queued
+    uint32_t capture_dropped;      // Datagrams dropped because the capture queue was full
+    uint32_t capture_records;      // Records written to the current capture file
+    uint32_t capture_file_dropped; // Datagrams recorded as lost in the current capture file (GAP records)
+    uint64_t capture_bytes;        // Bytes written to the current capture file
+    uint64_t capture_start_time;   // os_gettime_ns() of the capture header; record timestamps are relative to it
+
+    // Instant replay buffer - the receive threads overwrite the oldest datagram in a ring sized for
+    // replay_buffer_seconds. Ring state is protected by capture_mutex. Datagrams are numbered with 64-bit sequence
+    // numbers (slot = sequence % replay_buffer_slots), so a running save notices datagrams overwritten under it.
+    bool replay_buffer;
+    uint32_t replay_buffer_seconds;
+    struct capture_slot *replay_buffer_ring;
+    uint32_t replay_buffer_slots;
+    uint64_t replay_buffer_first; // Sequence number of the oldest buffered datagram
+    uint64_t replay_buffer_next;  // Sequence number of the next datagram
+    pthread_t replay_buffer_save_thread;
+    bool replay_buffer_save_thread_active; // Joined before the next save, a resize or cleanup
+    bool replay_buffer_saving;             // Save in progress
+    uint64_t replay_buffer_save_next;      // Saver position and end (sequence numbers)
+    uint64_t replay_buffer_save_end;
+    uint64_t replay_buffer_save_start_time; // os_gettime_ns() of the first saved datagram
+    uint64_t replay_buffer_save_unix_ms;    // Wall clock time of the first saved datagram
+    char replay_buffer_filename[1024];
+    obs_hotkey_id replay_buffer_hotkey;
+
+    // Capture replay (replay source only) - the replay thread stands in for the UDP receiver threads
+    pthread_t replay_thread;
+    bool replay_thread_active;
+    char replay_path[1024]; // .c64s file being replayed
+    double replay_speed;    // Playback speed factor, C64U_REPLAY_SPEED_UNLIMITED = as fast as possible
+    bool replay_loop;       // Restart from the first record at the end of the file
+    uint32_t replay_loops;  // Completed passes through the file
 };
 
 #endif // C64U_TYPES_H
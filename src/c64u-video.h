@@ -3,11 +3,11 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 // Rendering defaults
-#define C64U_DEFAULT_RENDER_DELAY_FRAMES 3  // Default frame delay to smooth UDP packet loss/reordering
-#define C64U_MAX_RENDER_DELAY_FRAMES 100    // Maximum allowed render delay frames
-#define C64U_RENDER_BUFFER_SAFETY_MARGIN 10 // Extra buffer frames for queue safety
+#define C64U_DEFAULT_RENDER_DELAY_FRAMES 3 // Default frame delay to smooth UDP packet loss/reordering
+#define C64U_MAX_RENDER_DELAY_FRAMES 100   // Maximum allowed render delay frames
 
 // Timing constants (nanoseconds)
 #define C64U_FRAME_TIMEOUT_NS 500000000ULL       // 500ms - timeout for frame freshness detection
@@ -17,22 +17,20 @@
 struct c64u_source;
 struct frame_assembly;
 
-// VIC color palette (BGRA values for OBS) - converted from grab.py RGB values
-extern const uint32_t vic_colors[16];
-
-// Helper functions for frame assembly
-void init_frame_assembly(struct frame_assembly *frame, uint16_t frame_num);
-bool is_frame_complete(struct frame_assembly *frame);
-bool is_frame_timeout(struct frame_assembly *frame);
-void swap_frame_buffers(struct c64u_source *context);
-void assemble_frame_to_buffer(struct c64u_source *context, struct frame_assembly *frame);
+// Frame delivery to OBS: set up context->output with the buffers and attach it to the core (after c64u_core_init())
+void init_frame_output(struct c64u_source *context, uint32_t *front, uint32_t *back);
 
 // Delay queue management
 void init_delay_queue(struct c64u_source *context);
-bool enqueue_delayed_frame(struct c64u_source *context, struct frame_assembly *frame, uint16_t sequence_num);
-bool dequeue_delayed_frame(struct c64u_source *context);
 void clear_delay_queue(struct c64u_source *context);
 
+// Core callbacks (struct c64u_core_callbacks); data is the c64u_source
+void deliver_video_frame(void *data, struct frame_assembly *frame, uint16_t seq_num, uint64_t time);
+void update_video_format(void *data, uint32_t height, double fps);
+
+// Packet processing (shared by the UDP receiver thread and the replay source)
+bool process_video_packet(struct c64u_source *context, const uint8_t *packet, size_t size);
+
 // Video thread function
 void *video_thread_func(void *data);
 
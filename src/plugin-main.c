@@ -17,21 +17,38 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 */
 
 #include <obs-module.h>
+#include <stdio.h>
 #include "plugin-support.h"
 #include "c64u-logging.h"
 #include "c64u-protocol.h"
 #include "c64u-network.h"
 #include "c64u-source.h"
+#include "c64u-replay.h"
+#include "c64u-core.h"
 
 // Logging control - define the global variable
 bool c64u_debug_logging = true;
 
+// Forward the headless core's diagnostics to the OBS log, like C64U_LOG_*
+static void core_log_handler(int level, const char *format, va_list args)
+{
+    static const int obs_levels[] = {LOG_ERROR, LOG_WARNING, LOG_INFO, LOG_DEBUG};
+    char message[512];
+
+    if (!c64u_debug_logging) {
+        return;
+    }
+    vsnprintf(message, sizeof(message), format, args);
+    blog(obs_levels[level], "[C64U] %s", message);
+}
+
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE(PLUGIN_NAME, "en")
 
 bool obs_module_load(void)
 {
     C64U_LOG_INFO("Loading C64U plugin (version %s)", PLUGIN_VERSION);
+    c64u_core_set_log_handler(core_log_handler);
 
     // DEBUG: This will always be hit when the plugin loads
     // Module loading
@@ -50,6 +67,22 @@ bool obs_module_load(void)
                                         .get_height = c64u_get_height};
 
     obs_register_source(&c64u_info);
+
+    // Replays .c64s stream captures through the same frame assembly and rendering as the live source
+    struct obs_source_info c64u_replay_info = {.id = "c64u_replay_source",
+                                               .type = OBS_SOURCE_TYPE_INPUT,
+                                               .output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_AUDIO,
+                                               .get_name = c64u_replay_get_name,
+                                               .create = c64u_replay_create,
+                                               .destroy = c64u_replay_destroy,
+                                               .update = c64u_replay_update,
+                                               .get_defaults = c64u_replay_defaults,
+                                               .video_render = c64u_render,
+                                               .get_properties = c64u_replay_properties,
+                                               .get_width = c64u_get_width,
+                                               .get_height = c64u_get_height};
+
+    obs_register_source(&c64u_replay_info);
     C64U_LOG_INFO("C64U plugin loaded successfully");
     return true;
 }
@@ -0,0 +1,309 @@
+/*
+C64U A/V Synchronization Harness
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+Measures A/V skew after the plugin's pipeline. c64u_mock_server --av-sync sends a flash frame and an audio click
+at the same device time at regular intervals. This harness receives both streams the way the plugin does (receive
+loops, c64u-core, render delay queue, front/back buffers, a render thread at the OBS frame rate) and compares the
+time the flash frame is rendered with the time the click plays, i.e. the timestamp deliver_audio_packet() passes to
+obs_source_output_audio() plus the click's position in the packet. Reports mean, spread and drift of the offset;
+--audio-clock samples tries sample-counted audio timestamps instead of os_gettime_ns() at delivery.
+*/
+
+#define _GNU_SOURCE // POSIX sockets under -std=c17
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../src/c64u-core.h"
+#include "c64u_test_source.h"
+#include "c64u_test_util.h"
+
+#define AVSYNC_DEFAULT_DURATION 60.0
+#define AVSYNC_DEFAULT_FPS 60.0
+#define AVSYNC_SAMPLE_RATE 48000
+#define AVSYNC_RESYNC_NS 70000000ULL // Sample clock: re-anchor when it strays this far from the receive time
+
+// Audio timestamps: the plugin's (os_gettime_ns() when the packet is delivered), or counted samples from the
+// first packet, so receive jitter stays out of the audio timeline
+enum audio_clock {
+    AUDIO_CLOCK_RECEIVE,
+    AUDIO_CLOCK_SAMPLES,
+};
+
+struct harness {
+    struct c64u_test_source source; // The plugin's receive loops, core and frame output
+    int video_socket;
+    int audio_socket;
+    bool events;    // Print every pair
+    uint32_t delay; // Render delay frames
+    double fps;     // Render rate
+
+    // Audio, as in c64u-audio.c
+    enum audio_clock clock;
+    uint64_t anchor;  // Sample clock: time of sample 0
+    uint64_t samples; // Sample clock: samples since the anchor
+    uint16_t last_audio_seq;
+    bool have_audio_seq;
+    uint32_t resyncs;
+
+    pthread_mutex_t sync_mutex;
+    struct c64u_avsync avsync;
+    uint64_t start;
+};
+
+static volatile bool interrupted;
+
+static void signal_handler(int sig)
+{
+    (void)sig;
+    interrupted = true;
+}
+
+static void report_pair(struct harness *h, bool paired)
+{
+    if (paired && h->events) {
+        printf("  %7.1f s: audio %+.2f ms\n", (c64u_test_now_ns() - h->start) / 1e9, h->avsync.last_ms);
+    }
+}
+
+// deliver_audio_packet(): timestamp the packet, then find the click in it
+static void on_audio(void *user, const int16_t *samples, uint32_t count, uint16_t seq_num)
+{
+    struct harness *h = user;
+    uint64_t now = c64u_test_now_ns();
+    uint64_t timestamp = now;
+
+    if (h->clock == AUDIO_CLOCK_SAMPLES) {
+        // Lost packets still took their time on the device
+        if (h->have_audio_seq) {
+            uint16_t lost = (uint16_t)(seq_num - h->last_audio_seq - 1);
+            h->samples += lost < 0x8000 ? (uint64_t)lost * count : 0;
+        }
+        timestamp = h->anchor + h->samples * 1000000000ULL / AVSYNC_SAMPLE_RATE;
+        if (h->anchor == 0 || (timestamp > now ? timestamp - now : now - timestamp) > AVSYNC_RESYNC_NS) {
+            h->resyncs += h->anchor != 0;
+            h->anchor = now;
+            h->samples = 0;
+            timestamp = now;
+        }
+        h->samples += count;
+    }
+    h->last_audio_seq = seq_num;
+    h->have_audio_seq = true;
+
+    int32_t click = c64u_avsync_click_find(samples, count);
+    if (click >= 0) {
+        pthread_mutex_lock(&h->sync_mutex);
+        bool paired = c64u_avsync_audio_mark(&h->avsync,
+                                             timestamp + (uint64_t)click * 1000000000ULL / AVSYNC_SAMPLE_RATE);
+        report_pair(h, paired);
+        pthread_mutex_unlock(&h->sync_mutex);
+    }
+}
+
+// Both receive loops do what video_thread_func() and audio_thread_func() do: non-blocking recv(), 1ms sleep
+static void *video_thread(void *data)
+{
+    struct harness *h = data;
+    c64u_test_source_receive(&h->source, h->video_socket, true);
+    return NULL;
+}
+
+static void *audio_thread(void *data)
+{
+    struct harness *h = data;
+    c64u_test_source_receive(&h->source, h->audio_socket, false);
+    return NULL;
+}
+
+// Render side: one tick per output frame; a new front buffer with a flash mark is the moment the flash shows
+static void *render_thread(void *data)
+{
+    struct harness *h = data;
+    struct c64u_test_source *source = &h->source;
+    uint64_t interval = (uint64_t)(1e9 / h->fps);
+    uint64_t tick = c64u_test_now_ns();
+    uint64_t last_generation = 0;
+
+    while (source->running) {
+        tick += interval;
+        c64u_test_sleep_until(tick);
+
+        pthread_mutex_lock(&source->frame_mutex);
+        uint32_t mark;
+        bool flash = source->generation != last_generation && c64u_avsync_flash_decode(source->output.front, &mark);
+        last_generation = source->generation;
+        pthread_mutex_unlock(&source->frame_mutex);
+
+        if (flash) {
+            pthread_mutex_lock(&h->sync_mutex);
+            report_pair(h, c64u_avsync_video_mark(&h->avsync, c64u_test_now_ns()));
+            pthread_mutex_unlock(&h->sync_mutex);
+        }
+    }
+    return NULL;
+}
+
+static int open_socket(uint32_t port)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t)port);
+    if (sock < 0 || bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Failed to bind port %u: %s\n", port, strerror(errno));
+        if (sock >= 0) {
+            close(sock);
+        }
+        return -1;
+    }
+    int buffer = 1024 * 1024; // As create_udp_socket()
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    return sock;
+}
+
+// Ask c64u_mock_server on this host to start a stream, as send_control_command() does
+static void start_mock_stream(uint8_t stream_id)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(C64U_CONTROL_PORT);
+    uint8_t cmd[6] = {(uint8_t)(0x20 + stream_id), 0xFF, 0x02, 0x00, 0x00, 0x00}; // Duration 0 = forever
+    if (sock < 0 || connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        send(sock, cmd, sizeof(cmd), 0) != (ssize_t)sizeof(cmd)) {
+        fprintf(stderr, "Could not start mock server stream %u: %s\n", stream_id, strerror(errno));
+    }
+    if (sock >= 0) {
+        close(sock);
+    }
+}
+
+static void usage(const char *program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("Measures A/V offset against c64u_mock_server --av-sync on this host.\n");
+    printf("  --port P         Video port; audio uses P+1 (default %u)\n", C64U_DEFAULT_VIDEO_PORT);
+    printf("  --duration S     Seconds to measure, 0 = until Ctrl+C (default %.0f)\n", AVSYNC_DEFAULT_DURATION);
+    printf("  --delay N        Render delay in frames (default 0)\n");
+    printf("  --fps N          Render rate (default %.0f)\n", AVSYNC_DEFAULT_FPS);
+    printf("  --audio-clock C  receive (the plugin's os_gettime_ns() timestamps) or samples (default receive)\n");
+    printf("  --events         Print every measured offset\n");
+}
+
+int main(int argc, char *argv[])
+{
+    static struct harness h;
+    uint32_t port = C64U_DEFAULT_VIDEO_PORT;
+    double duration = AVSYNC_DEFAULT_DURATION;
+    h.fps = AVSYNC_DEFAULT_FPS;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = true;
+        if (strcmp(argv[i], "--events") == 0) {
+            h.events = true;
+            continue;
+        } else if (strcmp(argv[i], "--port") == 0 && value) {
+            port = (uint32_t)atoi(value);
+            ok = port > 0 && port < 65535;
+        } else if (strcmp(argv[i], "--duration") == 0 && value) {
+            duration = atof(value);
+            ok = duration >= 0;
+        } else if (strcmp(argv[i], "--delay") == 0 && value) {
+            h.delay = (uint32_t)atoi(value);
+            ok = h.delay <= 100;
+        } else if (strcmp(argv[i], "--fps") == 0 && value) {
+            h.fps = atof(value);
+            ok = h.fps >= 1 && h.fps <= 1000;
+        } else if (strcmp(argv[i], "--audio-clock") == 0 && value) {
+            h.clock = strcmp(value, "samples") == 0 ? AUDIO_CLOCK_SAMPLES : AUDIO_CLOCK_RECEIVE;
+            ok = h.clock == AUDIO_CLOCK_SAMPLES || strcmp(value, "receive") == 0;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+        i++;
+    }
+
+    h.video_socket = open_socket(port);
+    h.audio_socket = open_socket(port + 1);
+    if (h.video_socket < 0 || h.audio_socket < 0 || !c64u_test_source_init(&h.source, h.delay)) {
+        fprintf(stderr, "Setup failed\n");
+        return 1;
+    }
+    h.source.audio = on_audio;
+    h.source.user = &h;
+    pthread_mutex_init(&h.sync_mutex, NULL);
+    c64u_avsync_reset(&h.avsync);
+    signal(SIGINT, signal_handler);
+
+    printf("c64u-avsync: ports %u/%u, render delay %u, %.0f fps, %s audio clock\n", port, port + 1, h.delay, h.fps,
+           h.clock == AUDIO_CLOCK_SAMPLES ? "sample" : "receive");
+    start_mock_stream(0);
+    start_mock_stream(1);
+
+    h.start = c64u_test_now_ns();
+    pthread_t threads[3];
+    pthread_create(&threads[0], NULL, video_thread, &h);
+    pthread_create(&threads[1], NULL, audio_thread, &h);
+    pthread_create(&threads[2], NULL, render_thread, &h);
+    uint64_t end = duration > 0 ? h.start + (uint64_t)(duration * 1e9) : UINT64_MAX;
+    while (!interrupted && c64u_test_now_ns() < end) {
+        c64u_test_sleep_ns(100000000);
+    }
+    c64u_test_source_stop(&h.source);
+    for (int i = 0; i < 3; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    const struct c64u_avsync *a = &h.avsync;
+    printf("\n%u marks paired, %u unpaired", a->count, a->unpaired);
+    if (h.clock == AUDIO_CLOCK_SAMPLES) {
+        printf(", %u sample clock resyncs", h.resyncs);
+    }
+    printf("\n");
+    if (a->count > 0) {
+        printf("Audio offset (positive = audio late): mean %+.2f ms, stddev %.2f ms, min %+.2f ms, max %+.2f ms\n",
+               c64u_avsync_mean_ms(a), c64u_avsync_stddev_ms(a), a->min_ms, a->max_ms);
+        printf("Drift: %+.3f ms/min over %.0f s\n", c64u_avsync_drift_ms_per_min(a),
+               (c64u_test_now_ns() - h.start) / 1e9);
+    } else {
+        printf("warning: no marks paired (is the mock server running with --av-sync?)\n");
+    }
+
+    close(h.video_socket);
+    close(h.audio_socket);
+    c64u_test_source_free(&h.source);
+    return a->count > 0 ? 0 : 1;
+}
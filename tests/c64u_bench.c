@@ -0,0 +1,476 @@
+/*
+C64U Frame Pipeline Microbenchmarks
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+Repeatable microbenchmarks for the hot paths of the stream pipeline, run against the
+headless c64u-core library with synthetic PAL and NTSC packet sets.
+*/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // sched_setaffinity()
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "../src/c64u-core.h"
+#include "c64u_test_util.h"
+
+#define BENCH_FRAMES 50            // Distinct synthetic frames per packet set
+#define BENCH_AUDIO_PACKETS 250    // One second of audio packets
+#define DEFAULT_SAMPLES 15         // Measured samples per benchmark (after one warm-up sample)
+#define DEFAULT_SAMPLE_FRAMES 2000 // Frames (video) or packets (audio) per sample
+#define DELAY_FRAMES 3             // Render delay used for the delay queue benchmark
+
+struct packet_set {
+    const char *format; // "PAL" / "NTSC"
+    uint32_t height;
+    uint32_t packets_per_frame;
+    uint8_t *packets; // BENCH_FRAMES * packets_per_frame datagrams, in send order
+    struct frame_assembly *frames;
+};
+
+struct bench_options {
+    uint32_t samples;
+    uint32_t sample_frames;
+    int cpu;                // -1 = not pinned
+    const char *json_path;  // NULL = no JSON
+    const char *filter;     // Substring of the benchmark names to run
+    const char *format;     // "pal", "ntsc" or NULL for both
+};
+
+struct bench_result {
+    char name[48];
+    const char *format;
+    const char *unit;
+    uint32_t samples;
+    double mean_ns; // Per unit
+    double stddev_ns;
+    double min_ns;
+    double median_ns;
+    double packets_per_unit;
+    double bytes_per_unit;
+};
+
+struct bench_context {
+    struct packet_set *set;
+    struct c64u_core core;
+    struct c64u_delay_queue queue;
+    uint32_t *rgba_front;
+    uint32_t *rgba_back;
+    uint8_t *indexed;
+    uint8_t *bgr24;
+    uint8_t *audio_packets;
+    int16_t audio_out[(C64U_AUDIO_PACKET_SIZE - C64U_AUDIO_HEADER_SIZE) / 2];
+    uint64_t sink; // Results folded in here, so the work cannot be optimized away
+};
+
+typedef void (*bench_func)(struct bench_context *ctx, uint32_t units);
+
+static struct bench_result results[64];
+static uint32_t result_count;
+static FILE *report; // Human-readable table: stdout, or stderr when the JSON goes to stdout
+
+static bool pin_to_cpu(int cpu)
+{
+#ifdef _WIN32
+    return cpu < 64 && SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false; // No hard affinity on macOS
+#endif
+}
+
+// Deterministic pseudo-random pixels (xorshift32), so every run measures the same data
+static uint32_t next_random(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static void build_packet_set(struct packet_set *set, const char *format, uint32_t height)
+{
+    uint32_t random = 0xC64C64u;
+    uint16_t seq = 0;
+
+    set->format = format;
+    set->height = height;
+    set->packets_per_frame = height / C64U_LINES_PER_PACKET;
+    set->packets = malloc((size_t)BENCH_FRAMES * set->packets_per_frame * C64U_VIDEO_PACKET_SIZE);
+    set->frames = calloc(BENCH_FRAMES, sizeof(struct frame_assembly));
+
+    for (uint32_t f = 0; f < BENCH_FRAMES; f++) {
+        for (uint32_t i = 0; i < set->packets_per_frame; i++) {
+            uint8_t *packet = set->packets + ((size_t)f * set->packets_per_frame + i) * C64U_VIDEO_PACKET_SIZE;
+            uint16_t line = (uint16_t)(i * C64U_LINES_PER_PACKET);
+
+            c64u_test_video_header(packet, seq++, (uint16_t)(f + 1), i, height);
+            for (uint32_t x = C64U_VIDEO_HEADER_SIZE; x < C64U_VIDEO_PACKET_SIZE; x++) {
+                packet[x] = (uint8_t)next_random(&random);
+            }
+
+            // The same frame, already assembled, for the conversion benchmarks
+            struct frame_packet *fp = &set->frames[f].packets[i];
+            fp->line_num = line;
+            fp->lines_per_packet = C64U_LINES_PER_PACKET;
+            fp->received = true;
+            memcpy(fp->packet_data, packet + C64U_VIDEO_HEADER_SIZE, sizeof(fp->packet_data));
+        }
+        set->frames[f].frame_num = (uint16_t)(f + 1);
+        set->frames[f].expected_packets = (uint16_t)set->packets_per_frame;
+        set->frames[f].received_packets = (uint16_t)set->packets_per_frame;
+    }
+}
+
+static const uint8_t *frame_packets(const struct packet_set *set, uint32_t frame)
+{
+    return set->packets + (size_t)(frame % BENCH_FRAMES) * set->packets_per_frame * C64U_VIDEO_PACKET_SIZE;
+}
+
+// Benchmarks: each processes units frames (or audio packets)
+
+static void bench_parse_header(struct bench_context *ctx, uint32_t units)
+{
+    struct c64u_video_header header;
+    for (uint32_t f = 0; f < units; f++) {
+        const uint8_t *packet = frame_packets(ctx->set, f);
+        for (uint32_t i = 0; i < ctx->set->packets_per_frame; i++, packet += C64U_VIDEO_PACKET_SIZE) {
+            c64u_core_parse_video_header(packet, C64U_VIDEO_PACKET_SIZE, &header);
+            ctx->sink += header.seq_num + header.line_num;
+        }
+    }
+}
+
+static void count_frame(void *user, struct frame_assembly *frame, uint16_t seq_num, uint64_t time)
+{
+    struct bench_context *ctx = user;
+    (void)time;
+    ctx->sink += frame->frame_num + seq_num;
+}
+
+static void bench_assemble(struct bench_context *ctx, uint32_t units)
+{
+    // Receive time advances one frame period per frame, so incomplete frames would time out as in a live stream
+    uint64_t time = 0;
+    for (uint32_t f = 0; f < units; f++) {
+        const uint8_t *packet = frame_packets(ctx->set, f);
+        for (uint32_t i = 0; i < ctx->set->packets_per_frame; i++, packet += C64U_VIDEO_PACKET_SIZE) {
+            c64u_core_video_packet(&ctx->core, packet, C64U_VIDEO_PACKET_SIZE, time);
+        }
+        time += 20000000;
+    }
+}
+
+static void bench_frame_to_rgba(struct bench_context *ctx, uint32_t units)
+{
+    for (uint32_t f = 0; f < units; f++) {
+        c64u_core_frame_to_rgba(&ctx->set->frames[f % BENCH_FRAMES], ctx->rgba_back, ctx->set->height);
+        ctx->sink += ctx->rgba_back[f % 1024];
+    }
+}
+
+// Immediate delivery: convert into the back buffer and swap it with the front buffer, like
+// assemble_frame_to_buffer() + swap_frame_buffers()
+static void bench_deliver(struct bench_context *ctx, uint32_t units)
+{
+    for (uint32_t f = 0; f < units; f++) {
+        c64u_core_frame_to_rgba(&ctx->set->frames[f % BENCH_FRAMES], ctx->rgba_back, ctx->set->height);
+        uint32_t *temp = ctx->rgba_front;
+        ctx->rgba_front = ctx->rgba_back;
+        ctx->rgba_back = temp;
+        ctx->sink += ctx->rgba_front[f % 1024];
+    }
+}
+
+// Delayed delivery in steady state: every completed frame is enqueued and the oldest one dequeued
+static void bench_delay_queue(struct bench_context *ctx, uint32_t units)
+{
+    size_t pixels = (size_t)C64U_PIXELS_PER_LINE * ctx->set->height;
+    for (uint32_t f = 0; f < units; f++) {
+        c64u_delay_queue_push(&ctx->queue, &ctx->set->frames[f % BENCH_FRAMES], ctx->set->height, (uint16_t)f);
+        if (c64u_delay_queue_pop(&ctx->queue, DELAY_FRAMES, ctx->rgba_back, pixels)) {
+            ctx->sink += ctx->rgba_back[f % 1024];
+        }
+    }
+}
+
+static void bench_frame_to_indexed(struct bench_context *ctx, uint32_t units)
+{
+    for (uint32_t f = 0; f < units; f++) {
+        c64u_core_frame_to_indexed(&ctx->set->frames[f % BENCH_FRAMES], ctx->indexed, ctx->set->height);
+        ctx->sink += ctx->indexed[f % 1024];
+    }
+}
+
+static void bench_bgr24(struct bench_context *ctx, uint32_t units)
+{
+    for (uint32_t f = 0; f < units; f++) {
+        c64u_core_frame_to_indexed(&ctx->set->frames[f % BENCH_FRAMES], ctx->indexed, ctx->set->height);
+        for (uint32_t y = 0; y < ctx->set->height; y++) {
+            c64u_core_line_to_bgr24(ctx->indexed + (size_t)y * C64U_BYTES_PER_LINE,
+                                    ctx->bgr24 + (size_t)y * C64U_PIXELS_PER_LINE * 3, C64U_PIXELS_PER_LINE);
+        }
+        ctx->sink += ctx->bgr24[f % 1024];
+    }
+}
+
+// The output side copies the samples, like obs_source_output_audio() does
+static void copy_audio(void *user, const int16_t *samples, uint32_t count, uint16_t seq_num)
+{
+    struct bench_context *ctx = user;
+    memcpy(ctx->audio_out, samples, (size_t)count * 2 * sizeof(int16_t));
+    ctx->sink += (uint16_t)ctx->audio_out[0] + seq_num;
+}
+
+static void bench_audio(struct bench_context *ctx, uint32_t units)
+{
+    for (uint32_t p = 0; p < units; p++) {
+        const uint8_t *packet = ctx->audio_packets + (size_t)(p % BENCH_AUDIO_PACKETS) * C64U_AUDIO_PACKET_SIZE;
+        c64u_core_audio_packet(&ctx->core, packet, C64U_AUDIO_PACKET_SIZE);
+    }
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void run_bench(const struct bench_options *options, struct bench_context *ctx, const char *name,
+                      const char *unit, bench_func func, double packets_per_unit, double bytes_per_unit)
+{
+    if (options->filter && !strstr(name, options->filter)) {
+        return;
+    }
+    if (result_count == sizeof(results) / sizeof(results[0])) {
+        return;
+    }
+
+    double *per_unit = malloc(sizeof(double) * options->samples);
+    func(ctx, options->sample_frames); // Warm-up: caches, branch predictors, page faults
+    for (uint32_t s = 0; s < options->samples; s++) {
+        uint64_t start = c64u_test_now_ns();
+        func(ctx, options->sample_frames);
+        per_unit[s] = (double)(c64u_test_now_ns() - start) / options->sample_frames;
+    }
+
+    struct bench_result *r = &results[result_count++];
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->format = ctx->set ? ctx->set->format : "-";
+    r->unit = unit;
+    r->samples = options->samples;
+    r->packets_per_unit = packets_per_unit;
+    r->bytes_per_unit = bytes_per_unit;
+
+    double sum = 0.0;
+    for (uint32_t s = 0; s < options->samples; s++) {
+        sum += per_unit[s];
+    }
+    r->mean_ns = sum / options->samples;
+    double variance = 0.0;
+    for (uint32_t s = 0; s < options->samples; s++) {
+        variance += (per_unit[s] - r->mean_ns) * (per_unit[s] - r->mean_ns);
+    }
+    r->stddev_ns = options->samples > 1 ? sqrt(variance / (options->samples - 1)) : 0.0;
+    qsort(per_unit, options->samples, sizeof(double), compare_double);
+    r->min_ns = per_unit[0];
+    r->median_ns = options->samples % 2 ? per_unit[options->samples / 2]
+                                        : (per_unit[options->samples / 2 - 1] + per_unit[options->samples / 2]) / 2;
+    free(per_unit);
+
+    // Median per unit, relative standard deviation, best sample, throughput at the median
+    fprintf(report, "%-16s %-5s %10.1f ns/%-6s ±%5.1f%% (min %10.1f) %10.0f packets/s %9.1f MB/s\n", r->name,
+            r->format, r->median_ns, r->unit, r->mean_ns > 0 ? 100.0 * r->stddev_ns / r->mean_ns : 0.0, r->min_ns,
+            r->packets_per_unit * 1e9 / r->median_ns, r->bytes_per_unit * 1e3 / r->median_ns);
+}
+
+static void run_packet_set(const struct bench_options *options, struct packet_set *set)
+{
+    struct bench_context *ctx = calloc(1, sizeof(struct bench_context));
+    struct c64u_core_callbacks callbacks = {count_frame, NULL, NULL, ctx};
+    size_t rgba_size = (size_t)C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT * sizeof(uint32_t);
+
+    ctx->set = set;
+    ctx->rgba_front = calloc(1, rgba_size);
+    ctx->rgba_back = calloc(1, rgba_size);
+    ctx->indexed = calloc(1, (size_t)C64U_BYTES_PER_LINE * C64U_PAL_HEIGHT);
+    ctx->bgr24 = calloc(1, (size_t)C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT * 3);
+    c64u_core_init(&ctx->core, &callbacks);
+    if (!c64u_delay_queue_alloc(&ctx->queue, DELAY_FRAMES)) { // Plugin default delay
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    double packets = set->packets_per_frame;
+    double wire_bytes = packets * C64U_VIDEO_PACKET_SIZE;
+    double rgba_bytes = (double)C64U_PIXELS_PER_LINE * set->height * 4;
+
+    run_bench(options, ctx, "parse_header", "frame", bench_parse_header, packets, wire_bytes);
+    run_bench(options, ctx, "assemble", "frame", bench_assemble, packets, wire_bytes);
+    run_bench(options, ctx, "frame_to_rgba", "frame", bench_frame_to_rgba, packets, rgba_bytes);
+    run_bench(options, ctx, "deliver_swap", "frame", bench_deliver, packets, rgba_bytes);
+    run_bench(options, ctx, "delay_queue", "frame", bench_delay_queue, packets, rgba_bytes);
+    run_bench(options, ctx, "frame_to_indexed", "frame", bench_frame_to_indexed, packets,
+              (double)C64U_BYTES_PER_LINE * set->height);
+    run_bench(options, ctx, "bgr24", "frame", bench_bgr24, packets, (double)C64U_PIXELS_PER_LINE * set->height * 3);
+
+    if (ctx->sink == 0x5eed) { // Practically never true; keeps the results observable
+        printf("\n");
+    }
+    c64u_delay_queue_free(&ctx->queue);
+    free(ctx->rgba_front);
+    free(ctx->rgba_back);
+    free(ctx->indexed);
+    free(ctx->bgr24);
+    free(ctx);
+}
+
+static void run_audio(const struct bench_options *options, uint8_t *audio_packets)
+{
+    struct bench_context *ctx = calloc(1, sizeof(struct bench_context));
+    struct c64u_core_callbacks callbacks = {NULL, NULL, copy_audio, ctx};
+
+    ctx->audio_packets = audio_packets;
+    c64u_core_init(&ctx->core, &callbacks);
+    run_bench(options, ctx, "audio_packet", "packet", bench_audio, 1.0, C64U_AUDIO_PACKET_SIZE);
+    if (ctx->sink == 0x5eed) {
+        printf("\n");
+    }
+    free(ctx);
+}
+
+static bool write_json(const struct bench_options *options, const char *path)
+{
+    FILE *file = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\n  \"benchmark\": \"c64u-bench\",\n  \"version\": 1,\n  \"timestamp\": %lld,\n",
+            (long long)time(NULL));
+    fprintf(file, "  \"cpu\": %d,\n  \"samples\": %u,\n  \"sample_units\": %u,\n  \"results\": [\n", options->cpu,
+            options->samples, options->sample_frames);
+    for (uint32_t i = 0; i < result_count; i++) {
+        const struct bench_result *r = &results[i];
+        fprintf(file,
+                "    {\"name\": \"%s\", \"format\": \"%s\", \"unit\": \"%s\", \"samples\": %u, "
+                "\"ns_per_unit\": {\"median\": %.2f, \"mean\": %.2f, \"stddev\": %.2f, \"min\": %.2f}, "
+                "\"packets_per_sec\": %.0f, \"bytes_per_sec\": %.0f}%s\n",
+                r->name, r->format, r->unit, r->samples, r->median_ns, r->mean_ns, r->stddev_ns, r->min_ns,
+                r->packets_per_unit * 1e9 / r->median_ns, r->bytes_per_unit * 1e9 / r->median_ns,
+                i + 1 < result_count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return file == stdout ? fflush(file) == 0 : fclose(file) == 0;
+}
+
+static void usage(const char *program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("  --samples N      Measured samples per benchmark (default %d)\n", DEFAULT_SAMPLES);
+    printf("  --frames N       Frames (audio: packets) per sample (default %d)\n", DEFAULT_SAMPLE_FRAMES);
+    printf("  --format F       pal or ntsc (default both)\n");
+    printf("  --filter NAME    Only run benchmarks whose name contains NAME\n");
+    printf("  --cpu N          Pin the benchmark thread to CPU N (Linux, Windows)\n");
+    printf("  --json FILE      Also write the results as JSON (- for stdout)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    struct bench_options options = {DEFAULT_SAMPLES, DEFAULT_SAMPLE_FRAMES, -1, NULL, NULL, NULL};
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--samples") == 0 && value) {
+            options.samples = (uint32_t)atoi(value);
+        } else if (strcmp(argv[i], "--frames") == 0 && value) {
+            options.sample_frames = (uint32_t)atoi(value);
+        } else if (strcmp(argv[i], "--format") == 0 && value) {
+            options.format = value;
+        } else if (strcmp(argv[i], "--filter") == 0 && value) {
+            options.filter = value;
+        } else if (strcmp(argv[i], "--cpu") == 0 && value) {
+            options.cpu = atoi(value);
+        } else if (strcmp(argv[i], "--json") == 0 && value) {
+            options.json_path = value;
+        } else {
+            usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+        i++;
+    }
+    if (options.samples == 0 || options.sample_frames == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (options.cpu >= 0 && !pin_to_cpu(options.cpu)) {
+        fprintf(stderr, "Warning: could not pin to CPU %d, running unpinned\n", options.cpu);
+        options.cpu = -1;
+    }
+
+    struct packet_set sets[2];
+    build_packet_set(&sets[0], "PAL", C64U_PAL_HEIGHT);
+    build_packet_set(&sets[1], "NTSC", C64U_NTSC_HEIGHT);
+
+    uint8_t *audio_packets = malloc((size_t)BENCH_AUDIO_PACKETS * C64U_AUDIO_PACKET_SIZE);
+    uint32_t random = 0x5D1Du;
+    for (uint32_t p = 0; p < BENCH_AUDIO_PACKETS; p++) {
+        uint8_t *packet = audio_packets + (size_t)p * C64U_AUDIO_PACKET_SIZE;
+        c64u_test_put_u16(packet, (uint16_t)p);
+        for (uint32_t x = C64U_AUDIO_HEADER_SIZE; x < C64U_AUDIO_PACKET_SIZE; x++) {
+            packet[x] = (uint8_t)next_random(&random);
+        }
+    }
+
+    report = options.json_path && strcmp(options.json_path, "-") == 0 ? stderr : stdout;
+    fprintf(report, "c64u-bench: %u samples x %u frames%s\n\n", options.samples, options.sample_frames,
+            options.cpu >= 0 ? " (pinned)" : "");
+    for (int s = 0; s < 2; s++) {
+        bool wanted = !options.format || (s == 0 && strcmp(options.format, "pal") == 0) ||
+                      (s == 1 && strcmp(options.format, "ntsc") == 0);
+        if (wanted) {
+            run_packet_set(&options, &sets[s]);
+        }
+    }
+    run_audio(&options, audio_packets);
+
+    bool ok = !options.json_path || write_json(&options, options.json_path);
+    for (int s = 0; s < 2; s++) {
+        free(sets[s].packets);
+        free(sets[s].frames);
+    }
+    free(audio_packets);
+    return ok ? 0 : 1;
+}
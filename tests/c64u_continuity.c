@@ -0,0 +1,273 @@
+/*
+C64U Frame Continuity Verifier
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+Checks every frame the pipeline delivers from a continuity pattern stream (c64u_mock_server --pattern), the
+automated version of watching tools/c64/digit-cycle for stutter. Datagrams come live from the mock server or from
+a raw stream capture (.c64s), go through c64u-core frame assembly and the plugin's RGBA double buffer, and each
+delivered frame is classified as in-order, repeated, skipped, torn or concealed. Prints the counts and a
+smoothness score; --min-score turns it into a pass/fail check.
+*/
+
+#define _POSIX_C_SOURCE 200809L // clock_gettime()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../src/c64u-core.h"
+#include "../src/c64u-capture.h"
+#include "c64u_test_util.h"
+
+#define CONTINUITY_DEFAULT_DURATION 10.0
+#define CONTINUITY_RECV_TIMEOUT_US 100000
+
+struct verifier {
+    struct c64u_core core;
+    struct c64u_continuity continuity;
+    uint32_t *front; // Double buffer as in c64u-video.c: missing lines keep what the buffer held before
+    uint32_t *back;
+    uint32_t height;
+    bool events; // Print every frame that is not in order
+    uint32_t frames;
+};
+
+static volatile bool running = true;
+
+static void signal_handler(int sig)
+{
+    (void)sig;
+    running = false;
+}
+
+static uint64_t read_u64(const uint8_t *p)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+// Same order of work as deliver_video_frame() without render delay: convert into the back buffer, then swap
+static void on_frame(void *user, struct frame_assembly *frame, uint16_t seq_num, uint64_t time)
+{
+    struct verifier *v = user;
+    (void)seq_num;
+    (void)time;
+
+    c64u_core_frame_to_rgba(frame, v->back, v->height);
+    uint32_t last = v->continuity.last_counter;
+    enum c64u_continuity_class result = c64u_continuity_check(&v->continuity, v->back, v->height);
+    if (v->events && result != C64U_CONTINUITY_IN_ORDER) {
+        printf("  frame %u (stream frame %u): %s", v->frames, frame->frame_num, c64u_continuity_class_name(result));
+        if (result == C64U_CONTINUITY_SKIPPED) {
+            printf(", %u frames never delivered", v->continuity.last_counter - last - 1);
+        }
+        printf("\n");
+    }
+    v->frames++;
+
+    uint32_t *temp = v->front;
+    v->front = v->back;
+    v->back = temp;
+}
+
+static void on_format(void *user, uint32_t height, double fps)
+{
+    struct verifier *v = user;
+    (void)fps;
+    v->height = height;
+}
+
+static bool verify_capture(struct verifier *v, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+
+    uint8_t header[C64U_CAPTURE_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, C64U_CAPTURE_MAGIC, 4) != 0 ||
+        c64u_test_read_u16(header + 4) != C64U_CAPTURE_VERSION ||
+        c64u_test_read_u16(header + 6) < C64U_CAPTURE_HEADER_SIZE) {
+        fprintf(stderr, "Not a supported C64U stream capture file: %s\n", path);
+        fclose(file);
+        return false;
+    }
+    fseek(file, c64u_test_read_u16(header + 6), SEEK_SET);
+
+    uint8_t record[C64U_CAPTURE_RECORD_HEADER_SIZE];
+    uint8_t payload[C64U_CAPTURE_MAX_PAYLOAD];
+    while (running && fread(record, 1, sizeof(record), file) == sizeof(record)) {
+        uint16_t length = c64u_test_read_u16(record + 10);
+        if (length > sizeof(payload) || fread(payload, 1, length, file) != length) {
+            break; // Truncated last record
+        }
+        if (record[8] == C64U_CAPTURE_STREAM_VIDEO) {
+            c64u_core_video_packet(&v->core, payload, length, read_u64(record));
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+// Ask c64u_mock_server on this host to start its video stream, as the plugin does at startup
+static void start_mock_stream(void)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(C64U_CONTROL_PORT);
+    uint8_t cmd[6] = {0x20, 0xFF, 0x02, 0x00, 0x00, 0x00}; // Start video, duration 0 = forever
+    if (sock < 0 || connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        send(sock, cmd, sizeof(cmd), 0) != (ssize_t)sizeof(cmd)) {
+        fprintf(stderr, "Could not start the mock server stream: %s\n", strerror(errno));
+    }
+    if (sock >= 0) {
+        close(sock);
+    }
+}
+
+static bool verify_live(struct verifier *v, uint32_t port, double duration)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t)port);
+    if (sock < 0 || bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Failed to bind port %u: %s\n", port, strerror(errno));
+        if (sock >= 0) {
+            close(sock);
+        }
+        return false;
+    }
+    int buffer = 1024 * 1024; // As create_udp_socket()
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    struct timeval timeout = {0, CONTINUITY_RECV_TIMEOUT_US};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    start_mock_stream();
+    uint64_t end = duration > 0 ? c64u_test_now_ns() + (uint64_t)(duration * 1e9) : UINT64_MAX;
+    uint8_t packet[C64U_VIDEO_PACKET_SIZE];
+    while (running && c64u_test_now_ns() < end) {
+        ssize_t received = recv(sock, packet, sizeof(packet), 0);
+        if (received > 0) {
+            c64u_core_video_packet(&v->core, packet, (size_t)received, c64u_test_now_ns());
+        }
+    }
+    close(sock);
+    return true;
+}
+
+static void usage(const char *program)
+{
+    printf("Usage: %s [options] [FILE.c64s]\n", program);
+    printf("Verifies a capture file, or with --port the live stream of c64u_mock_server --pattern.\n");
+    printf("  --port P         Listen for the mock server's video on port P\n");
+    printf("  --duration S     Seconds to listen, 0 = until Ctrl+C (default %.0f)\n", CONTINUITY_DEFAULT_DURATION);
+    printf("  --min-score N    Exit with 1 if the smoothness score is below N percent\n");
+    printf("  --events         Print every frame that is not in order\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = NULL;
+    uint32_t port = 0;
+    double duration = CONTINUITY_DEFAULT_DURATION;
+    double min_score = 0.0;
+    static struct verifier v;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = true;
+        if (strcmp(argv[i], "--events") == 0) {
+            v.events = true;
+            continue;
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+            continue;
+        } else if (strcmp(argv[i], "--port") == 0 && value) {
+            port = (uint32_t)atoi(value);
+            ok = port > 0 && port < 65536;
+        } else if (strcmp(argv[i], "--duration") == 0 && value) {
+            duration = atof(value);
+            ok = duration >= 0;
+        } else if (strcmp(argv[i], "--min-score") == 0 && value) {
+            min_score = atof(value);
+            ok = min_score >= 0 && min_score <= 100;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+        i++;
+    }
+    if ((path == NULL) == (port == 0)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    size_t frame_bytes = sizeof(uint32_t) * C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT;
+    v.front = calloc(1, frame_bytes);
+    v.back = calloc(1, frame_bytes);
+    if (!v.front || !v.back) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    v.height = C64U_PAL_HEIGHT;
+    struct c64u_core_callbacks callbacks = {on_frame, on_format, NULL, &v};
+    c64u_core_init(&v.core, &callbacks);
+    c64u_continuity_reset(&v.continuity);
+    signal(SIGINT, signal_handler);
+
+    printf("c64u-continuity: %s\n", path ? path : "listening for c64u_mock_server --pattern");
+    bool ok = path ? verify_capture(&v, path) : verify_live(&v, port, duration);
+
+    const struct c64u_continuity *c = &v.continuity;
+    double score = c64u_continuity_score(c);
+    printf("\n%u frames delivered: %u in order, %u repeated, %u skipped (%u frames never delivered), %u torn, "
+           "%u concealed, %u without pattern\n",
+           v.frames, c->counts[C64U_CONTINUITY_IN_ORDER], c->counts[C64U_CONTINUITY_REPEATED],
+           c->counts[C64U_CONTINUITY_SKIPPED], c->skipped_frames, c->counts[C64U_CONTINUITY_TORN],
+           c->counts[C64U_CONTINUITY_CONCEALED], c->counts[C64U_CONTINUITY_UNMARKED]);
+    printf("Assembly: %u frames dropped incomplete, %u sequence gaps\n", v.core.stats.frame_drops,
+           v.core.stats.video_seq_gaps);
+    printf("Smoothness score: %.2f%%\n", score);
+    if (c->counts[C64U_CONTINUITY_UNMARKED] == v.frames && v.frames > 0) {
+        printf("warning: no frame carried the pattern (is the sender running with --pattern?)\n");
+    }
+
+    free(v.front);
+    free(v.back);
+    if (!ok) {
+        return 1;
+    }
+    return score >= min_score ? 0 : 1;
+}
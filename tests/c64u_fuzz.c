@@ -0,0 +1,500 @@
+/*
+C64U Packet Parser Fuzzing Harness
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+Feeds untrusted datagrams through c64u-core and everything the plugin does with what comes out: frame buffers
+sized for PAL, the render delay queue, the recording copy, the test stream decoders and the texture upload of
+width x height pixels. Built twice: c64u-fuzz-video feeds the video records of an input and c64u-fuzz-audio the
+audio records (C64U_FUZZ_STREAM). An input is a .c64s capture (doc/capture-file-format.md), with or without its
+file header, so captures saved by the plugin are seed inputs as they are.
+
+With ENABLE_FUZZING (Clang) this is a libFuzzer target. Otherwise main() below runs files, directories, built-in
+seed streams and seeded mutations of them, so a plain sanitizer build exercises the same code in ctest.
+*/
+
+#define _POSIX_C_SOURCE 200809L // opendir()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+#include "../src/c64u-core.h"
+#include "../src/c64u-capture.h"
+#include "c64u_test_util.h"
+
+#ifndef C64U_FUZZ_STREAM
+#define C64U_FUZZ_STREAM C64U_CAPTURE_STREAM_VIDEO
+#endif
+
+#define FUZZ_DELAY_FRAMES 2 // Render delay of the queued path
+#define FUZZ_FRAME_PIXELS ((size_t)C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT)
+
+// What the OBS source keeps per stream, as far as the packet paths touch it
+struct fuzz_state {
+    struct c64u_core core;
+    uint32_t *front; // PAL-sized like the source's frame buffers
+    uint32_t *back;
+    uint8_t *indexed; // Recording slot
+    struct c64u_delay_queue queue;
+    uint32_t height; // context->height, set by the format callback
+    struct c64u_latency latency;
+    struct c64u_continuity continuity;
+    struct c64u_avsync avsync;
+    uint64_t now;      // Arrival time of the current record
+    uint32_t checksum; // Keeps the reads of delivered data from being optimized away
+};
+
+static struct fuzz_state state;
+
+static uint64_t read_u64(const uint8_t *p)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+// Format every message like the plugin's log handler does, so bad format arguments show up too
+static void fuzz_log(int level, const char *format, va_list args)
+{
+    char message[512];
+    (void)level;
+    vsnprintf(message, sizeof(message), format, args);
+}
+
+// The render callback: measure_test_stream() and the texture upload of width x height pixels
+static void render(struct fuzz_state *s)
+{
+    uint32_t counter;
+    uint64_t send_time;
+    uint32_t mark;
+    if (c64u_stamp_decode(s->front, &counter, &send_time) && send_time <= s->now) {
+        c64u_latency_add(&s->latency, s->now - send_time);
+    }
+    c64u_continuity_check(&s->continuity, s->front, s->height);
+    if (c64u_avsync_flash_decode(s->front, &mark)) {
+        c64u_avsync_video_mark(&s->avsync, s->now);
+    }
+    for (size_t i = 0; i < (size_t)C64U_PIXELS_PER_LINE * s->height; i++) {
+        s->checksum += s->front[i];
+    }
+}
+
+// deliver_video_frame() with and without render delay, and record_submit_frame()
+static void on_frame(void *user, struct frame_assembly *frame, uint16_t seq_num, uint64_t time)
+{
+    struct fuzz_state *s = user;
+    (void)time;
+
+    uint32_t record_height = s->height > C64U_PAL_HEIGHT ? C64U_PAL_HEIGHT : s->height;
+    c64u_core_frame_to_indexed(frame, s->indexed, record_height);
+
+    c64u_core_frame_to_rgba(frame, s->back, s->height);
+    c64u_delay_queue_push(&s->queue, frame, s->height, seq_num);
+    c64u_delay_queue_pop(&s->queue, FUZZ_DELAY_FRAMES, s->back, (size_t)C64U_PIXELS_PER_LINE * s->height);
+    uint32_t *temp = s->front;
+    s->front = s->back;
+    s->back = temp;
+    render(s);
+}
+
+static void on_format(void *user, uint32_t height, double fps)
+{
+    struct fuzz_state *s = user;
+    (void)fps;
+    s->height = height;
+    render(s); // OBS may render the front buffer with the new height before the next frame arrives
+}
+
+// deliver_audio_packet(): click search, then recording and OBS read every sample
+static void on_audio(void *user, const int16_t *samples, uint32_t count, uint16_t seq_num)
+{
+    struct fuzz_state *s = user;
+    (void)seq_num;
+
+    int32_t click = c64u_avsync_click_find(samples, count);
+    if (click >= 0) {
+        c64u_avsync_audio_mark(&s->avsync, s->now + (uint64_t)click * 1000000000ULL / 48000);
+    }
+    for (uint32_t i = 0; i < count * 2; i++) {
+        s->checksum += (uint16_t)samples[i];
+    }
+}
+
+static void reset_state(struct fuzz_state *s)
+{
+    if (!s->front) {
+        s->front = malloc(FUZZ_FRAME_PIXELS * sizeof(uint32_t));
+        s->back = malloc(FUZZ_FRAME_PIXELS * sizeof(uint32_t));
+        s->indexed = malloc((size_t)C64U_BYTES_PER_LINE * C64U_PAL_HEIGHT);
+        if (!s->front || !s->back || !s->indexed || !c64u_delay_queue_alloc(&s->queue, FUZZ_DELAY_FRAMES + 2)) {
+            fprintf(stderr, "Out of memory\n");
+            abort();
+        }
+        c64u_core_set_log_handler(fuzz_log);
+    }
+    struct c64u_core_callbacks callbacks = {on_frame, on_format, on_audio, s};
+    c64u_core_init(&s->core, &callbacks);
+    memset(s->front, 0, FUZZ_FRAME_PIXELS * sizeof(uint32_t));
+    memset(s->back, 0, FUZZ_FRAME_PIXELS * sizeof(uint32_t));
+    c64u_delay_queue_clear(&s->queue);
+    s->height = C64U_PAL_HEIGHT; // The source's default until a format is detected
+    c64u_latency_reset(&s->latency);
+    c64u_continuity_reset(&s->continuity);
+    c64u_avsync_reset(&s->avsync);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    struct fuzz_state *s = &state;
+    reset_state(s);
+
+    size_t pos = 0;
+    if (size >= C64U_CAPTURE_HEADER_SIZE && memcmp(data, C64U_CAPTURE_MAGIC, 4) == 0) {
+        pos = c64u_test_read_u16(data + 6);
+        if (pos < C64U_CAPTURE_HEADER_SIZE || pos > size) {
+            return 0;
+        }
+    }
+
+    while (size - pos >= C64U_CAPTURE_RECORD_HEADER_SIZE) {
+        const uint8_t *record = data + pos;
+        uint16_t length = c64u_test_read_u16(record + 10);
+        pos += C64U_CAPTURE_RECORD_HEADER_SIZE;
+        if (length > C64U_CAPTURE_MAX_PAYLOAD || length > size - pos) {
+            break; // A truncated record ends the input, as in the replay source
+        }
+
+        // Copy to an odd address in a buffer that ends with the datagram: reads past it trip the address
+        // sanitizer, and 16-bit accesses through cast pointers trip the alignment check
+        uint8_t *buffer = malloc((size_t)length + 1);
+        if (!buffer) {
+            break;
+        }
+        uint8_t *packet = buffer + 1;
+        memcpy(packet, data + pos, length);
+        pos += length;
+
+        s->now = read_u64(record);
+        if (record[8] == C64U_FUZZ_STREAM) {
+            if (C64U_FUZZ_STREAM == C64U_CAPTURE_STREAM_VIDEO) {
+                c64u_core_video_packet(&s->core, packet, length, s->now);
+            } else {
+                c64u_core_audio_packet(&s->core, packet, length);
+            }
+        }
+        free(buffer);
+    }
+    return 0;
+}
+
+#ifndef C64U_LIBFUZZER
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define SEED_MAX_SIZE (2 * 1024 * 1024)
+#define SEED_FRAME_NS 20000000ULL
+#define SEED_AUDIO_PER_FRAME 5 // 4 ms audio packets
+#define SEED_KINDS 3
+
+static const char *seed_names[SEED_KINDS] = {"seed_pal.c64s", "seed_ntsc.c64s", "seed_damaged.c64s"};
+
+static void put_record(uint8_t *buf, size_t *size, uint64_t time, uint8_t stream, const uint8_t *payload,
+                       uint16_t length)
+{
+    c64u_test_put_u64(buf + *size, time);
+    buf[*size + 8] = stream;
+    buf[*size + 9] = 0;
+    c64u_test_put_u16(buf + *size + 10, length);
+    memcpy(buf + *size + C64U_CAPTURE_RECORD_HEADER_SIZE, payload, length);
+    *size += C64U_CAPTURE_RECORD_HEADER_SIZE + length;
+}
+
+// A test stream packet with all markers: pattern in every packet, latency stamp and (every other frame) the A/V
+// flash in the top one
+static void make_video(uint8_t *packet, uint16_t seq, uint16_t frame, uint32_t index, uint32_t height,
+                       uint64_t time)
+{
+    c64u_test_video_header(packet, seq, frame, index, height);
+
+    uint8_t *lines = packet + C64U_VIDEO_HEADER_SIZE;
+    c64u_pattern_encode(lines, frame);
+    if (index == 0) {
+        c64u_stamp_encode(lines, frame, time);
+        if (frame % 2 == 0) {
+            c64u_avsync_flash_encode(lines, frame / 2u);
+        }
+    }
+}
+
+static void make_audio(uint8_t *packet, uint16_t seq, bool click)
+{
+    int16_t samples[(C64U_AUDIO_PACKET_SIZE - C64U_AUDIO_HEADER_SIZE) / 2];
+    uint32_t count = (uint32_t)(sizeof(samples) / sizeof(samples[0]) / 2);
+    for (uint32_t i = 0; i < count; i++) {
+        samples[i * 2] = (int16_t)((i % 48) * 400 - 9600); // 1 kHz sawtooth
+        samples[i * 2 + 1] = samples[i * 2];
+    }
+    if (click) {
+        c64u_avsync_click_encode(samples, count, 50);
+    }
+    c64u_test_put_u16(packet, seq);
+    memcpy(packet + C64U_AUDIO_HEADER_SIZE, samples, sizeof(samples));
+}
+
+// Built-in seed streams: clean PAL, clean NTSC, and PAL with the damage the parsers have to survive
+static size_t make_seed(uint8_t *buf, int kind)
+{
+    uint32_t height = kind == 1 ? C64U_NTSC_HEIGHT : C64U_PAL_HEIGHT;
+    uint32_t packets = height / C64U_LINES_PER_PACKET;
+    uint8_t video[C64U_VIDEO_PACKET_SIZE];
+    uint8_t audio[C64U_AUDIO_PACKET_SIZE];
+    uint16_t video_seq = 0;
+    uint16_t audio_seq = 0;
+
+    memset(buf, 0, C64U_CAPTURE_HEADER_SIZE);
+    memcpy(buf, C64U_CAPTURE_MAGIC, 4);
+    c64u_test_put_u16(buf + 4, C64U_CAPTURE_VERSION);
+    c64u_test_put_u16(buf + 6, C64U_CAPTURE_HEADER_SIZE);
+    c64u_test_put_u16(buf + 156, (uint16_t)height);
+    size_t size = C64U_CAPTURE_HEADER_SIZE;
+
+    for (uint16_t frame = 1; frame <= 6; frame++) {
+        uint64_t start = frame * SEED_FRAME_NS;
+        for (uint32_t i = 0; i < packets; i++) {
+            uint64_t time = start + i * (SEED_FRAME_NS / packets);
+            uint32_t index = i;
+            if (kind == 2 && frame == 3 && (i == 20 || i == 21)) {
+                index = 41 - i; // Swapped pair
+            }
+            make_video(video, video_seq++, frame, index, height, start);
+            if (kind == 2 && frame == 2 && i == 10) {
+                continue; // Lost packet
+            }
+            put_record(buf, &size, time, C64U_CAPTURE_STREAM_VIDEO, video, sizeof(video));
+            if (kind == 2 && frame == 3 && i == 5) {
+                put_record(buf, &size, time, C64U_CAPTURE_STREAM_VIDEO, video, sizeof(video)); // Duplicate
+            }
+            if (kind == 2 && frame == 4 && i == 30) {
+                video[9] = 8; // Unsupported bits per pixel
+                put_record(buf, &size, time, C64U_CAPTURE_STREAM_VIDEO, video, sizeof(video));
+                put_record(buf, &size, time, C64U_CAPTURE_STREAM_VIDEO, video, sizeof(video) - 1);
+            }
+        }
+        if (kind == 2 && frame == 5) {
+            // Last-packet flag on a line far beyond the largest frame
+            make_video(video, video_seq++, frame + 100, 0, height, start);
+            c64u_test_put_u16(video + 4, 0x7FFC | 0x8000);
+            put_record(buf, &size, start + SEED_FRAME_NS - 1, C64U_CAPTURE_STREAM_VIDEO, video, sizeof(video));
+        }
+        for (uint32_t a = 0; a < SEED_AUDIO_PER_FRAME; a++) {
+            make_audio(audio, audio_seq++, frame % 2 == 0 && a == 0);
+            put_record(buf, &size, start + a * (SEED_FRAME_NS / SEED_AUDIO_PER_FRAME), C64U_CAPTURE_STREAM_AUDIO,
+                       audio, sizeof(audio));
+        }
+    }
+    if (kind == 2) {
+        uint8_t gap[4] = {3, 0, 0, 0};
+        put_record(buf, &size, 7 * SEED_FRAME_NS, C64U_CAPTURE_STREAM_GAP, gap, sizeof(gap));
+        put_record(buf, &size, 7 * SEED_FRAME_NS, C64U_CAPTURE_STREAM_AUDIO, audio, 100);
+    }
+    return size;
+}
+
+static uint64_t rng_state;
+
+static uint32_t rng_next(void)
+{
+    // xorshift64*
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (uint32_t)((rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+// Offset of record header number n (or the last one), walking the records after the file header
+static size_t record_offset(const uint8_t *buf, size_t size, uint32_t n)
+{
+    size_t pos = C64U_CAPTURE_HEADER_SIZE;
+    size_t found = pos;
+    for (uint32_t i = 0; i <= n && pos + C64U_CAPTURE_RECORD_HEADER_SIZE <= size; i++) {
+        found = pos;
+        pos += C64U_CAPTURE_RECORD_HEADER_SIZE + c64u_test_read_u16(buf + pos + 10);
+    }
+    return found;
+}
+
+// A few random edits, mostly on record and packet headers where the parsers make their decisions
+static size_t mutate(uint8_t *buf, size_t size)
+{
+    static const uint16_t interesting[] = {0, 1, 0x7FFF, 0x8000, 0xFFFF, C64U_PAL_HEIGHT, C64U_PAL_HEIGHT | 0x8000,
+                                           0x7FFC | 0x8000, C64U_VIDEO_PACKET_SIZE, C64U_AUDIO_PACKET_SIZE};
+    uint32_t edits = 1 + rng_next() % 8;
+    for (uint32_t e = 0; e < edits && size > C64U_CAPTURE_HEADER_SIZE + 24; e++) {
+        size_t header = record_offset(buf, size, rng_next() % 2000);
+        size_t pos = header + rng_next() % 24;
+        if (pos + 2 > size) {
+            continue;
+        }
+        switch (rng_next() % 4) {
+        case 0:
+            buf[pos] = (uint8_t)rng_next();
+            break;
+        case 1:
+            c64u_test_put_u16(buf + pos, interesting[rng_next() % (sizeof(interesting) / sizeof(interesting[0]))]);
+            break;
+        case 2:
+            pos = C64U_CAPTURE_HEADER_SIZE + rng_next() % (size - C64U_CAPTURE_HEADER_SIZE); // Anywhere
+            buf[pos] ^= (uint8_t)(1 << (rng_next() % 8));
+            break;
+        default:
+            size = C64U_CAPTURE_HEADER_SIZE + rng_next() % (size - C64U_CAPTURE_HEADER_SIZE);
+            break;
+        }
+    }
+    return size;
+}
+
+static bool run_file(const char *path, uint8_t *buf)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+    size_t size = fread(buf, 1, SEED_MAX_SIZE, file);
+    fclose(file);
+    LLVMFuzzerTestOneInput(buf, size);
+    return true;
+}
+
+// Run a file, or every file in a directory (a libFuzzer corpus)
+static uint32_t run_path(const char *path, uint8_t *buf)
+{
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return run_file(path, buf) ? 1 : 0;
+    }
+    DIR *dir = opendir(path);
+    uint32_t count = 0;
+    struct dirent *entry;
+    while (dir && (entry = readdir(dir)) != NULL) {
+        char child[4096];
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        if (entry->d_name[0] != '.' && stat(child, &st) == 0 && S_ISREG(st.st_mode)) {
+            count += run_file(child, buf) ? 1 : 0;
+        }
+    }
+    if (dir) {
+        closedir(dir);
+    }
+    return count;
+}
+
+static bool write_seeds(const char *dir, uint8_t *buf)
+{
+    for (int kind = 0; kind < SEED_KINDS; kind++) {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", dir, seed_names[kind]);
+        size_t size = make_seed(buf, kind);
+        FILE *file = fopen(path, "wb");
+        if (!file || fwrite(buf, 1, size, file) != size) {
+            fprintf(stderr, "Cannot write %s\n", path);
+            if (file) {
+                fclose(file);
+            }
+            return false;
+        }
+        fclose(file);
+        printf("Wrote %s (%zu bytes)\n", path, size);
+    }
+    return true;
+}
+
+static void usage(const char *program)
+{
+    printf("Usage: %s [options] [FILE.c64s | CORPUS_DIR]...\n", program);
+    printf("Runs the inputs (or the built-in seed streams) through the packet handlers.\n");
+    printf("  --mutate N         Also run N seeded random mutations of the built-in seeds\n");
+    printf("  --seed S           Mutation seed (default 1)\n");
+    printf("  --write-seeds DIR  Write the built-in seed streams as .c64s files to DIR and exit\n");
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t mutations = 0;
+    uint64_t seed = 1;
+    const char *seed_dir = NULL;
+    int first_input = argc;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--mutate") == 0 && value) {
+            mutations = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && value) {
+            seed = strtoull(value, NULL, 10);
+        } else if (strcmp(argv[i], "--write-seeds") == 0 && value) {
+            seed_dir = value;
+        } else if (argv[i][0] != '-') {
+            first_input = i;
+            break;
+        } else {
+            usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+        i++;
+    }
+
+    static uint8_t buf[SEED_MAX_SIZE];
+    if (seed_dir) {
+        return write_seeds(seed_dir, buf) ? 0 : 1;
+    }
+
+    uint32_t inputs = 0;
+    for (int i = first_input; i < argc; i++) {
+        inputs += run_path(argv[i], buf);
+    }
+    if (first_input == argc) {
+        for (int kind = 0; kind < SEED_KINDS; kind++) {
+            LLVMFuzzerTestOneInput(buf, make_seed(buf, kind));
+            inputs++;
+        }
+    }
+
+    static uint8_t seeds[SEED_KINDS][SEED_MAX_SIZE];
+    size_t seed_sizes[SEED_KINDS];
+    for (int kind = 0; mutations > 0 && kind < SEED_KINDS; kind++) {
+        seed_sizes[kind] = make_seed(seeds[kind], kind);
+    }
+    rng_state = seed ? seed : 1;
+    for (uint32_t m = 0; m < mutations; m++) {
+        int kind = (int)(rng_next() % SEED_KINDS);
+        memcpy(buf, seeds[kind], seed_sizes[kind]);
+        LLVMFuzzerTestOneInput(buf, mutate(buf, seed_sizes[kind]));
+    }
+
+    printf("%s: %u inputs, %u mutations, checksum %08x\n", argv[0], inputs, mutations, state.checksum);
+    free(state.front);
+    free(state.back);
+    free(state.indexed);
+    c64u_delay_queue_free(&state.queue);
+    return 0;
+}
+
+#endif // C64U_LIBFUZZER
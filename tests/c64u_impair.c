@@ -0,0 +1,335 @@
+/*
+C64U Network Impairment Engine
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "c64u_impair.h"
+
+#define NS_PER_MS 1000000.0
+
+void impair_config_defaults(struct impair_config *config)
+{
+    memset(config, 0, sizeof(struct impair_config));
+    config->burst_exit = 0.25;
+    config->burst_loss = 1.0;
+    config->reorder_depth = 3;
+    config->bucket = 1;
+    config->queue_limit = 4096;
+}
+
+static bool parse_probability(const char *value, double *out)
+{
+    char *end;
+    double p = strtod(value, &end);
+    if (end == value || *end != '\0' || p < 0.0 || p > 1.0) {
+        return false;
+    }
+    *out = p;
+    return true;
+}
+
+static bool parse_positive(const char *value, double *out)
+{
+    char *end;
+    double v = strtod(value, &end);
+    if (end == value || *end != '\0' || v < 0.0) {
+        return false;
+    }
+    *out = v;
+    return true;
+}
+
+bool impair_config_set(struct impair_config *config, const char *name, const char *value)
+{
+    double v;
+
+    if (strcmp(name, "loss") == 0) {
+        return parse_probability(value, &config->loss);
+    } else if (strcmp(name, "burst-enter") == 0) {
+        return parse_probability(value, &config->burst_enter);
+    } else if (strcmp(name, "burst-exit") == 0) {
+        return parse_probability(value, &config->burst_exit);
+    } else if (strcmp(name, "burst-loss") == 0) {
+        return parse_probability(value, &config->burst_loss);
+    } else if (strcmp(name, "duplicate") == 0) {
+        return parse_probability(value, &config->duplicate);
+    } else if (strcmp(name, "reorder") == 0) {
+        return parse_probability(value, &config->reorder);
+    } else if (strcmp(name, "reorder-depth") == 0) {
+        if (!parse_positive(value, &v) || v < 1 || v > IMPAIR_MAX_HELD) {
+            return false;
+        }
+        config->reorder_depth = (uint32_t)v;
+        return true;
+    } else if (strcmp(name, "delay") == 0) {
+        return parse_positive(value, &config->delay_ms);
+    } else if (strcmp(name, "jitter") == 0) {
+        return parse_positive(value, &config->jitter_ms);
+    } else if (strcmp(name, "jitter-dist") == 0) {
+        if (strcmp(value, "uniform") == 0) {
+            config->jitter_dist = IMPAIR_JITTER_UNIFORM;
+        } else if (strcmp(value, "normal") == 0) {
+            config->jitter_dist = IMPAIR_JITTER_NORMAL;
+        } else if (strcmp(value, "exponential") == 0) {
+            config->jitter_dist = IMPAIR_JITTER_EXPONENTIAL;
+        } else {
+            return false;
+        }
+        return true;
+    } else if (strcmp(name, "rate") == 0) {
+        return parse_positive(value, &config->rate_pps);
+    } else if (strcmp(name, "bucket") == 0) {
+        if (!parse_positive(value, &v) || v < 1) {
+            return false;
+        }
+        config->bucket = (uint32_t)v;
+        return true;
+    } else if (strcmp(name, "aggregate") == 0) {
+        return parse_positive(value, &config->aggregate_ms);
+    } else if (strcmp(name, "queue") == 0) {
+        if (!parse_positive(value, &v) || v < 1) {
+            return false;
+        }
+        config->queue_limit = (uint32_t)v;
+        return true;
+    }
+    return false;
+}
+
+bool impair_config_active(const struct impair_config *config)
+{
+    return config->loss > 0 || config->burst_enter > 0 || config->duplicate > 0 || config->reorder > 0 ||
+           config->delay_ms > 0 || config->jitter_ms > 0 || config->rate_pps > 0 || config->aggregate_ms > 0;
+}
+
+void impair_usage(const char *prefix)
+{
+    printf("  %sloss P             Random loss probability\n", prefix);
+    printf("  %sburst-enter P      Gilbert-Elliott: chance per packet to start a loss burst\n", prefix);
+    printf("  %sburst-exit P       Chance per packet to end a burst (default 0.25)\n", prefix);
+    printf("  %sburst-loss P       Loss probability during a burst (default 1)\n", prefix);
+    printf("  %sduplicate P        Probability to send a packet twice\n", prefix);
+    printf("  %sreorder P          Probability to hold a packet back...\n", prefix);
+    printf("  %sreorder-depth N    ...behind up to N later packets (1-%d, default 3)\n", prefix, IMPAIR_MAX_HELD);
+    printf("  %sdelay MS           Constant delay\n", prefix);
+    printf("  %sjitter MS          Jitter on top of the delay (order is kept)\n", prefix);
+    printf("  %sjitter-dist D      uniform, normal or exponential (default uniform)\n", prefix);
+    printf("  %srate PPS           Token bucket rate limit in packets/s...\n", prefix);
+    printf("  %sbucket N           ...allowing bursts of N packets (default 1)\n", prefix);
+    printf("  %saggregate MS       Release packets in bunches every MS (Wi-Fi aggregation)\n", prefix);
+    printf("  %squeue N            Queue limit in packets, tail drop beyond (default 4096)\n", prefix);
+}
+
+// splitmix64: small, fast and good enough for network simulation
+static uint64_t next_u64(struct impair *im)
+{
+    uint64_t z = (im->rng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1)
+static double next_double(struct impair *im)
+{
+    return (double)(next_u64(im) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static bool chance(struct impair *im, double p)
+{
+    return p > 0.0 && next_double(im) < p;
+}
+
+bool impair_init(struct impair *im, const struct impair_config *config, uint64_t seed)
+{
+    memset(im, 0, sizeof(struct impair));
+    im->config = *config;
+    im->rng = seed;
+    im->tokens = config->bucket;
+    im->queue = malloc(sizeof(struct impair_packet) * config->queue_limit);
+    return im->queue != NULL;
+}
+
+void impair_free(struct impair *im)
+{
+    free(im->queue);
+    im->queue = NULL;
+}
+
+static uint64_t sample_delay(struct impair *im)
+{
+    double jitter = 0.0;
+    double j = im->config.jitter_ms;
+
+    if (j > 0.0) {
+        switch (im->config.jitter_dist) {
+        case IMPAIR_JITTER_UNIFORM:
+            jitter = next_double(im) * j;
+            break;
+        case IMPAIR_JITTER_NORMAL: {
+            // Box-Muller; 1 - u keeps the logarithm finite
+            double u1 = 1.0 - next_double(im);
+            double u2 = next_double(im);
+            jitter = fabs(sqrt(-2.0 * log(u1)) * cos(2.0 * 3.14159265358979323846 * u2) * j);
+            break;
+        }
+        case IMPAIR_JITTER_EXPONENTIAL:
+            jitter = -log(1.0 - next_double(im)) * j;
+            break;
+        }
+    }
+    return (uint64_t)((im->config.delay_ms + jitter) * NS_PER_MS);
+}
+
+static void enqueue(struct impair *im, const uint8_t *data, size_t size, uint64_t now)
+{
+    if (im->count == im->config.queue_limit) {
+        im->stats.queue_dropped++;
+        return;
+    }
+
+    // Jitter varies the delay, but a packet never overtakes the one before it
+    uint64_t due = now + sample_delay(im);
+    if (due < im->last_due) {
+        due = im->last_due;
+    }
+    if (im->config.aggregate_ms > 0.0) {
+        uint64_t interval = (uint64_t)(im->config.aggregate_ms * NS_PER_MS);
+        if (interval > 0) {
+            due = (due + interval - 1) / interval * interval;
+        }
+    }
+    im->last_due = due;
+
+    struct impair_packet *packet = &im->queue[(im->head + im->count) % im->config.queue_limit];
+    packet->due = due;
+    packet->size = (uint16_t)size;
+    memcpy(packet->data, data, size);
+    im->count++;
+}
+
+// Another packet passed: release held packets whose countdown ran out, in the order they were held
+static void tick_held(struct impair *im, uint64_t now)
+{
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < im->held_count; i++) {
+        struct impair_held *held = &im->held[i];
+        if (--held->countdown == 0) {
+            enqueue(im, held->data, held->size, now);
+        } else {
+            im->held[kept++] = *held;
+        }
+    }
+    im->held_count = kept;
+}
+
+void impair_submit(struct impair *im, const uint8_t *data, size_t size, uint64_t now)
+{
+    if (size > IMPAIR_MAX_PACKET) {
+        size = IMPAIR_MAX_PACKET;
+    }
+    im->stats.submitted++;
+
+    // Gilbert-Elliott two-state loss: random loss in the good state, burst loss in the bad state
+    if (im->bad) {
+        im->bad = !chance(im, im->config.burst_exit);
+    } else if (chance(im, im->config.burst_enter)) {
+        im->bad = true;
+        im->stats.bursts++;
+    }
+    if (chance(im, im->bad ? im->config.burst_loss : im->config.loss)) {
+        if (im->bad) {
+            im->stats.lost_burst++;
+        } else {
+            im->stats.lost_random++;
+        }
+        return;
+    }
+
+    if (im->held_count < IMPAIR_MAX_HELD && chance(im, im->config.reorder)) {
+        struct impair_held *held = &im->held[im->held_count++];
+        held->countdown = 1 + (uint32_t)(next_u64(im) % im->config.reorder_depth);
+        held->size = (uint16_t)size;
+        memcpy(held->data, data, size);
+        im->stats.reordered++;
+        return;
+    }
+
+    enqueue(im, data, size, now);
+    if (chance(im, im->config.duplicate)) {
+        enqueue(im, data, size, now);
+        im->stats.duplicated++;
+    }
+    tick_held(im, now);
+}
+
+void impair_flush(struct impair *im, uint64_t now)
+{
+    for (uint32_t i = 0; i < im->held_count; i++) {
+        enqueue(im, im->held[i].data, im->held[i].size, now);
+    }
+    im->held_count = 0;
+}
+
+// Time the token bucket allows the next packet; the epsilon keeps rounding from stalling a due packet
+static uint64_t token_time(const struct impair *im)
+{
+    if (im->config.rate_pps <= 0.0 || im->tokens + 1e-9 >= 1.0) {
+        return 0;
+    }
+    return im->last_refill + (uint64_t)ceil((1.0 - im->tokens) * 1e9 / im->config.rate_pps);
+}
+
+uint64_t impair_next_due(const struct impair *im)
+{
+    if (im->count == 0) {
+        return UINT64_MAX;
+    }
+    uint64_t due = im->queue[im->head].due;
+    uint64_t tokens = token_time(im);
+    return tokens > due ? tokens : due;
+}
+
+size_t impair_poll(struct impair *im, uint64_t now, uint8_t *out)
+{
+    if (im->config.rate_pps > 0.0) {
+        // The bucket starts full, so the first refill from time 0 only caps it
+        if (now < im->last_refill) {
+            im->last_refill = now;
+        }
+        im->tokens += (double)(now - im->last_refill) * im->config.rate_pps / 1e9;
+        if (im->tokens > im->config.bucket) {
+            im->tokens = im->config.bucket;
+        }
+        im->last_refill = now;
+    }
+
+    if (im->count == 0 || im->queue[im->head].due > now || token_time(im) > now) {
+        return 0;
+    }
+    if (im->config.rate_pps > 0.0) {
+        im->tokens = im->tokens > 1.0 ? im->tokens - 1.0 : 0.0;
+    }
+
+    struct impair_packet *packet = &im->queue[im->head];
+    size_t size = packet->size;
+    memcpy(out, packet->data, size);
+    im->head = (im->head + 1) % im->config.queue_limit;
+    im->count--;
+    im->stats.sent++;
+    return size;
+}
@@ -0,0 +1,122 @@
+/*
+C64U Network Impairment Engine
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef C64U_IMPAIR_H
+#define C64U_IMPAIR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Impairs one datagram stream the way Wi-Fi links and busy switches do: random and Gilbert-Elliott burst loss,
+// bounded reordering, duplication, delay with jitter, and a token bucket rate limit with aggregated releases.
+// Pure and seeded: the same packets submitted at the same times always come out the same way. The caller
+// submits each datagram and sends whatever impair_poll() hands back once it is due.
+
+#define IMPAIR_MAX_PACKET 1500 // Largest datagram
+#define IMPAIR_MAX_HELD 16     // Largest reorder depth
+
+enum impair_jitter_dist {
+    IMPAIR_JITTER_UNIFORM,     // delay + [0, jitter)
+    IMPAIR_JITTER_NORMAL,      // delay + |N(0, jitter)|
+    IMPAIR_JITTER_EXPONENTIAL, // delay + Exp(mean jitter): mostly small, occasionally long stalls
+};
+
+struct impair_config {
+    double loss;            // Random loss probability (in the good state)
+    double burst_enter;     // Gilbert-Elliott: probability per packet to enter the bad state (0 = no bursts)
+    double burst_exit;      // Probability per packet to leave the bad state
+    double burst_loss;      // Loss probability in the bad state
+    double duplicate;       // Probability that a packet is sent twice
+    double reorder;         // Probability that a packet is held back...
+    uint32_t reorder_depth; // ...until up to this many later packets have passed (1..IMPAIR_MAX_HELD)
+    double delay_ms;        // Constant one-way delay
+    double jitter_ms;       // Jitter on top of the delay (packets stay in order)
+    enum impair_jitter_dist jitter_dist;
+    double rate_pps;        // Token bucket rate limit (0 = unlimited)...
+    uint32_t bucket;        // ...with this many packets of burst
+    double aggregate_ms;    // Release packets only at multiples of this interval (0 = off), like Wi-Fi aggregation
+    uint32_t queue_limit;   // Packets waiting to be sent; more are tail-dropped
+};
+
+struct impair_stats {
+    uint64_t submitted;
+    uint64_t lost_random;
+    uint64_t lost_burst;
+    uint64_t bursts; // Transitions into the bad state
+    uint64_t duplicated;
+    uint64_t reordered;
+    uint64_t queue_dropped;
+    uint64_t sent;
+};
+
+struct impair_packet {
+    uint64_t due; // Earliest send time (ns)
+    uint16_t size;
+    uint8_t data[IMPAIR_MAX_PACKET];
+};
+
+struct impair_held {
+    uint32_t countdown; // Packets still to pass before this one
+    uint16_t size;
+    uint8_t data[IMPAIR_MAX_PACKET];
+};
+
+struct impair {
+    struct impair_config config;
+    struct impair_stats stats;
+    uint64_t rng;
+    bool bad; // Gilbert-Elliott state
+
+    struct impair_packet *queue; // Ring of config.queue_limit packets, due times never decrease
+    uint32_t head;
+    uint32_t count;
+    uint64_t last_due;
+
+    struct impair_held held[IMPAIR_MAX_HELD];
+    uint32_t held_count;
+
+    double tokens;
+    uint64_t last_refill;
+};
+
+// Defaults: no impairment, 4096 packet queue
+void impair_config_defaults(struct impair_config *config);
+
+// Set one option by name (see impair_usage()). Returns false for an unknown name or invalid value.
+bool impair_config_set(struct impair_config *config, const char *name, const char *value);
+
+// True if the configuration changes anything
+bool impair_config_active(const struct impair_config *config);
+
+// Print the option names with their meaning, each prefixed with prefix (e.g. "--video-")
+void impair_usage(const char *prefix);
+
+bool impair_init(struct impair *im, const struct impair_config *config, uint64_t seed);
+void impair_free(struct impair *im);
+
+// Pass one datagram submitted at now (ns, any monotonic clock)
+void impair_submit(struct impair *im, const uint8_t *data, size_t size, uint64_t now);
+
+// Release the packets held for reordering, e.g. when the stream stops
+void impair_flush(struct impair *im, uint64_t now);
+
+// Copy the next packet that is due at now into out and return its size, or 0 if none is due
+size_t impair_poll(struct impair *im, uint64_t now, uint8_t *out);
+
+// Time the next packet becomes due (UINT64_MAX if the queue is empty)
+uint64_t impair_next_due(const struct impair *im);
+
+#endif // C64U_IMPAIR_H
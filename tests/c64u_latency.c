@@ -0,0 +1,410 @@
+/*
+C64U Glass-to-Glass Latency Benchmark
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+Measures per-frame latency from the moment a frame starts to leave the sender to the moment the render stage
+shows it. Frames carry a latency stamp (c64u-core.h) in their top border; the pipeline is the plugin's: UDP
+receive thread, c64u-core frame assembly, render delay queue and front/back buffer swap (c64u_test_source.h),
+and a render thread ticking at the OBS frame rate that reads the stamp back from the front buffer. Runs every
+combination of the given render delays and receive loops against its own paced sender, or against
+c64u_mock_server --stamp.
+*/
+
+#define _GNU_SOURCE // POSIX sockets and timeouts under -std=c17
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../src/c64u-core.h"
+#include "c64u_test_source.h"
+#include "c64u_test_util.h"
+
+#define LATENCY_MAX_DELAYS 16
+#define LATENCY_DEFAULT_DURATION 5.0
+#define LATENCY_DEFAULT_FPS 60.0
+#define LATENCY_RECV_TIMEOUT_US 100000
+
+// Receive loops: the plugin's own (non-blocking recv(), 1ms sleep when empty) and a blocking recv()
+enum receive_backend {
+    BACKEND_POLL_SLEEP,
+    BACKEND_BLOCKING,
+    BACKEND_COUNT,
+};
+
+static const char *backend_names[BACKEND_COUNT] = {"poll-sleep", "blocking"};
+
+struct latency_options {
+    uint32_t delays[LATENCY_MAX_DELAYS];
+    uint32_t delay_count;
+    bool backends[BACKEND_COUNT];
+    double duration; // Seconds per run
+    double fps;      // Render rate
+    uint32_t port;   // 0 = own sender on an ephemeral loopback port, else listen for c64u_mock_server --stamp
+    const char *json_path;
+};
+
+struct pipeline {
+    struct c64u_test_source source; // Receive side
+    double fps;                     // Render rate
+    int socket;
+
+    // Render side
+    struct c64u_latency latency;
+    uint32_t rendered;
+    uint32_t skipped; // Frames never shown: the counter jumped
+    uint32_t unstamped;
+};
+
+struct latency_result {
+    const char *backend;
+    uint32_t delay;
+    uint32_t frames;
+    uint32_t skipped;
+    double mean_ms;
+    double min_ms;
+    double p50_ms;
+    double p90_ms;
+    double p99_ms;
+    double max_ms;
+};
+
+static struct latency_result results[LATENCY_MAX_DELAYS * BACKEND_COUNT];
+static uint32_t result_count;
+static FILE *report; // Human-readable table: stdout, or stderr when the JSON goes to stdout
+
+// Sender: PAL frames paced like the device, packets spread evenly over the frame, stamped when the frame starts
+
+struct sender {
+    pthread_t thread;
+    int socket;
+    struct sockaddr_in target;
+    volatile bool running;
+};
+
+static void *sender_thread(void *data)
+{
+    struct sender *sender = data;
+    uint8_t packet[C64U_VIDEO_PACKET_SIZE];
+    uint32_t packets_per_frame = C64U_PAL_HEIGHT / C64U_LINES_PER_PACKET;
+    uint16_t seq = 0;
+    uint32_t counter = 0;
+    uint64_t frame_start = c64u_test_now_ns();
+
+    memset(packet, 0, sizeof(packet));
+    for (uint16_t frame_num = 1; sender->running; frame_num++) {
+        for (uint32_t i = 0; i < packets_per_frame; i++) {
+            c64u_test_sleep_until(frame_start + C64U_PAL_FRAME_INTERVAL_NS * i / packets_per_frame);
+
+            c64u_test_video_header(packet, seq++, frame_num, i, C64U_PAL_HEIGHT);
+            memset(packet + C64U_VIDEO_HEADER_SIZE, 0x66, C64U_VIDEO_PACKET_SIZE - C64U_VIDEO_HEADER_SIZE);
+            if (i == 0) {
+                c64u_stamp_encode(packet + C64U_VIDEO_HEADER_SIZE, counter++, c64u_test_now_ns());
+            }
+            sendto(sender->socket, packet, sizeof(packet), 0, (struct sockaddr *)&sender->target,
+                   sizeof(sender->target));
+        }
+        frame_start += C64U_PAL_FRAME_INTERVAL_NS;
+    }
+    return NULL;
+}
+
+// Receive side: the plugin's loop (non-blocking recv(), 1ms sleep when empty) or a blocking recv()
+
+static void *receive_thread(void *data)
+{
+    struct pipeline *p = data;
+    c64u_test_source_receive(&p->source, p->socket, true);
+    return NULL;
+}
+
+// Render side: one tick per output frame, reading the stamp of each new front buffer
+
+static void *render_thread(void *data)
+{
+    struct pipeline *p = data;
+    struct c64u_test_source *source = &p->source;
+    uint64_t interval = (uint64_t)(1e9 / p->fps);
+    uint64_t tick = c64u_test_now_ns();
+    uint64_t last_generation = 0;
+    bool have_counter = false;
+    uint32_t last_counter = 0;
+
+    c64u_latency_reset(&p->latency);
+    while (source->running) {
+        tick += interval;
+        c64u_test_sleep_until(tick);
+
+        pthread_mutex_lock(&source->frame_mutex);
+        if (source->generation != last_generation) {
+            last_generation = source->generation;
+            uint32_t counter;
+            uint64_t send_time;
+            if (c64u_stamp_decode(source->output.front, &counter, &send_time)) {
+                c64u_latency_add(&p->latency, c64u_test_now_ns() - send_time);
+                if (have_counter && counter != last_counter + 1) {
+                    p->skipped += counter - last_counter - 1;
+                }
+                last_counter = counter;
+                have_counter = true;
+                p->rendered++;
+            } else {
+                p->unstamped++;
+            }
+        }
+        pthread_mutex_unlock(&source->frame_mutex);
+    }
+    return NULL;
+}
+
+static int open_receive_socket(const struct latency_options *options, enum receive_backend backend,
+                               struct sockaddr_in *bound)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        return -1;
+    }
+    int buffer = 1024 * 1024; // As create_udp_socket()
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    if (backend == BACKEND_POLL_SLEEP) {
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    } else {
+        struct timeval timeout = {0, LATENCY_RECV_TIMEOUT_US};
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = options->port ? htonl(INADDR_ANY) : htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)options->port);
+    socklen_t length = sizeof(addr);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        getsockname(sock, (struct sockaddr *)bound, &length) < 0) {
+        fprintf(stderr, "Failed to bind port %u: %s\n", options->port, strerror(errno));
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// Ask c64u_mock_server on this host to start its video stream, as the plugin does at startup. The mock server
+// sends to whoever connected, i.e. 127.0.0.1.
+static void start_mock_stream(void)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(C64U_CONTROL_PORT);
+    uint8_t cmd[6] = {0x20, 0xFF, 0x02, 0x00, 0x00, 0x00}; // Start video, duration 0 = forever
+    if (sock < 0 || connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        send(sock, cmd, sizeof(cmd), 0) != (ssize_t)sizeof(cmd)) {
+        fprintf(stderr, "Could not start the mock server stream: %s\n", strerror(errno));
+    }
+    if (sock >= 0) {
+        close(sock);
+    }
+}
+
+static bool run_pipeline(const struct latency_options *options, enum receive_backend backend, uint32_t delay)
+{
+    struct pipeline *p = calloc(1, sizeof(struct pipeline));
+    struct sockaddr_in bound;
+
+    if (!p || !c64u_test_source_init(&p->source, delay)) {
+        free(p);
+        return false;
+    }
+    p->socket = open_receive_socket(options, backend, &bound);
+    if (p->socket < 0) {
+        c64u_test_source_free(&p->source);
+        free(p);
+        return false;
+    }
+    p->source.poll_sleep = backend == BACKEND_POLL_SLEEP; // The blocking socket times out instead
+
+    struct sender sender;
+    memset(&sender, 0, sizeof(sender));
+    if (options->port == 0) {
+        sender.socket = socket(AF_INET, SOCK_DGRAM, 0);
+        sender.target = bound;
+        sender.running = true;
+        pthread_create(&sender.thread, NULL, sender_thread, &sender);
+    }
+
+    p->fps = options->fps;
+    pthread_t receiver;
+    pthread_t renderer;
+    pthread_create(&receiver, NULL, receive_thread, p);
+    pthread_create(&renderer, NULL, render_thread, p);
+
+    c64u_test_sleep_until(c64u_test_now_ns() + (uint64_t)(options->duration * 1e9));
+
+    c64u_test_source_stop(&p->source);
+    pthread_join(renderer, NULL);
+    pthread_join(receiver, NULL);
+    if (options->port == 0) {
+        sender.running = false;
+        pthread_join(sender.thread, NULL);
+        close(sender.socket);
+    }
+
+    struct latency_result *r = &results[result_count++];
+    const struct c64u_latency *l = &p->latency;
+    r->backend = backend_names[backend];
+    r->delay = delay;
+    r->frames = l->count;
+    r->skipped = p->skipped;
+    r->mean_ms = l->count ? l->sum_ns / 1e6 / l->count : 0;
+    r->min_ms = l->min_ns / 1e6;
+    r->p50_ms = c64u_latency_percentile(l, 50) / 1e6;
+    r->p90_ms = c64u_latency_percentile(l, 90) / 1e6;
+    r->p99_ms = c64u_latency_percentile(l, 99) / 1e6;
+    r->max_ms = l->max_ns / 1e6;
+    fprintf(report, "%-10s  %5u  %6u  %7u  %8.1f  %8.1f  %8.1f  %8.1f  %8.1f  %8.1f\n", r->backend, r->delay,
+            r->frames, r->skipped, r->mean_ms, r->min_ms, r->p50_ms, r->p90_ms, r->p99_ms, r->max_ms);
+    if (p->unstamped > 0) {
+        fprintf(report, "  warning: %u frames without a stamp (is the sender running with --stamp?)\n", p->unstamped);
+    }
+
+    close(p->socket);
+    c64u_test_source_free(&p->source);
+    free(p);
+    return r->frames > 0;
+}
+
+static bool write_json(const char *path)
+{
+    FILE *f = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return false;
+    }
+    fprintf(f, "{\n  \"results\": [\n");
+    for (uint32_t i = 0; i < result_count; i++) {
+        const struct latency_result *r = &results[i];
+        fprintf(f,
+                "    {\"backend\": \"%s\", \"delay_frames\": %u, \"frames\": %u, \"skipped\": %u, \"mean_ms\": %.3f, "
+                "\"min_ms\": %.3f, \"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f}%s\n",
+                r->backend, r->delay, r->frames, r->skipped, r->mean_ms, r->min_ms, r->p50_ms, r->p90_ms, r->p99_ms,
+                r->max_ms, i + 1 < result_count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    if (f != stdout) {
+        fclose(f);
+    }
+    return true;
+}
+
+static void usage(const char *program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("  --delays LIST    Render delays in frames, comma separated (default 0,1,3,10)\n");
+    printf("  --backend B      poll-sleep, blocking or all (default all)\n");
+    printf("  --duration S     Seconds per run (default %.0f)\n", LATENCY_DEFAULT_DURATION);
+    printf("  --fps N          Render rate (default %.0f)\n", LATENCY_DEFAULT_FPS);
+    printf("  --port P         Listen for c64u_mock_server --stamp on port P instead of using the own sender\n");
+    printf("  --json FILE      Also write the results as JSON (- for stdout)\n");
+}
+
+static bool parse_delays(struct latency_options *options, const char *list)
+{
+    options->delay_count = 0;
+    for (const char *p = list; *p;) {
+        char *end;
+        long delay = strtol(p, &end, 10);
+        if (end == p || delay < 0 || delay > 100 || options->delay_count == LATENCY_MAX_DELAYS) {
+            return false;
+        }
+        options->delays[options->delay_count++] = (uint32_t)delay;
+        p = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return false;
+        }
+    }
+    return options->delay_count > 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct latency_options options;
+    memset(&options, 0, sizeof(options));
+    options.duration = LATENCY_DEFAULT_DURATION;
+    options.fps = LATENCY_DEFAULT_FPS;
+    parse_delays(&options, "0,1,3,10");
+    options.backends[BACKEND_POLL_SLEEP] = true;
+    options.backends[BACKEND_BLOCKING] = true;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = value != NULL;
+        if (strcmp(argv[i], "--delays") == 0 && value) {
+            ok = parse_delays(&options, value);
+        } else if (strcmp(argv[i], "--backend") == 0 && value) {
+            bool all = strcmp(value, "all") == 0;
+            for (int b = 0; b < BACKEND_COUNT; b++) {
+                options.backends[b] = all || strcmp(value, backend_names[b]) == 0;
+            }
+            ok = all || options.backends[BACKEND_POLL_SLEEP] || options.backends[BACKEND_BLOCKING];
+        } else if (strcmp(argv[i], "--duration") == 0 && value) {
+            options.duration = atof(value);
+            ok = options.duration > 0;
+        } else if (strcmp(argv[i], "--fps") == 0 && value) {
+            options.fps = atof(value);
+            ok = options.fps >= 1 && options.fps <= 1000;
+        } else if (strcmp(argv[i], "--port") == 0 && value) {
+            options.port = (uint32_t)atoi(value);
+            ok = options.port > 0 && options.port < 65536;
+        } else if (strcmp(argv[i], "--json") == 0 && value) {
+            options.json_path = value;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+        i++;
+    }
+
+    report = options.json_path && strcmp(options.json_path, "-") == 0 ? stderr : stdout;
+    fprintf(report, "c64u-latency: %.1f s per run, render at %.0f fps, %s\n\n", options.duration, options.fps,
+            options.port ? "listening for c64u_mock_server --stamp" : "own PAL sender on loopback");
+    fprintf(report, "backend     delay  frames  skipped   mean ms    min ms    p50 ms    p90 ms    p99 ms    max ms\n");
+
+    if (options.port) {
+        start_mock_stream();
+    }
+
+    bool ok = true;
+    for (int b = 0; b < BACKEND_COUNT; b++) {
+        for (uint32_t d = 0; options.backends[b] && d < options.delay_count; d++) {
+            ok = run_pipeline(&options, (enum receive_backend)b, options.delays[d]) && ok;
+        }
+    }
+    if (options.json_path) {
+        ok = write_json(options.json_path) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,678 @@
+/*
+C64U Multi-Device Load Generator
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+Simulates N C64U devices streaming at once, each from its own socket (and optionally its own source address)
+to its own pair of ports, with the frames of the devices spread over the frame period. Packets are prebuilt
+and sent in batches with sendmmsg() on Linux, in real time or faster. --receive runs the matching receive
+side: one thread per device doing what the plugin's video_thread_func does with the headless c64u-core,
+reporting the CPU cost per packet and the packets/s ceiling of one core.
+*/
+
+#define _GNU_SOURCE // sendmmsg(), sched_setaffinity(), pthread_getcpuclockid()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "../src/c64u-core.h"
+#include "c64u_test_util.h"
+
+#define LOADGEN_PATTERN_FRAMES 8              // Distinct prebuilt frames per device, sent in a loop
+#define LOADGEN_AUDIO_PACKETS 250             // Prebuilt audio packets per device (one second)
+#define LOADGEN_AUDIO_INTERVAL_NS 4000000ULL  // 192 stereo samples at 48kHz
+#define LOADGEN_MAX_BATCH 256                 // Datagrams per sendmmsg() call
+#define LOADGEN_MAX_DEVICES 256
+#define LOADGEN_MAX_SLEEP_NS 1000000ULL       // Longest single sleep between batches
+#define LOADGEN_REPORT_INTERVAL_NS 1000000000ULL
+#define LOADGEN_SOCKET_BUFFER (4 * 1024 * 1024)
+
+struct loadgen_options {
+    uint32_t devices;
+    const char *target;      // Destination address of all devices
+    uint32_t video_port;     // Device i sends video to video_port + i * port_step
+    uint32_t audio_port;
+    uint32_t port_step;
+    const char *source_base; // Device i binds to source_base + i (NULL = any address)
+    bool spread;             // Spread the frame phases of the devices over the frame period
+    bool ntsc;
+    bool audio;
+    double speed;            // 1 = real time, 2 = twice as fast, 0 = as fast as possible
+    double duration;         // Seconds, 0 = until interrupted
+    uint32_t batch;
+    int cpu;                 // -1 = not pinned
+    bool receive;
+};
+
+struct device {
+    int video_socket;
+    int audio_socket;
+    struct sockaddr_in video_addr;
+    struct sockaddr_in audio_addr;
+
+    uint8_t *video_packets; // LOADGEN_PATTERN_FRAMES frames, patched with sequence and frame numbers when sent
+    uint8_t *audio_packets; // LOADGEN_AUDIO_PACKETS packets
+    uint32_t packets_per_frame;
+    uint64_t frame_interval;
+
+    uint64_t frame_start; // Stream time of the current frame's first packet (ns)
+    uint32_t packet_index;
+    uint16_t frame_num;
+    uint16_t video_seq;
+    uint64_t next_audio;
+    uint16_t audio_seq;
+
+    uint64_t video_sent;
+    uint64_t audio_sent;
+    uint64_t send_errors;
+};
+
+struct receiver {
+    pthread_t thread;
+    int socket;
+    uint32_t port;
+    struct c64u_core core;
+    uint32_t *rgba; // Conversion target, like the plugin's render buffer
+    volatile uint64_t packets;
+    volatile uint64_t frames;
+};
+
+static volatile bool running = true;
+static struct loadgen_options options;
+
+static void signal_handler(int sig)
+{
+    (void)sig;
+    running = false;
+}
+
+static bool pin_to_cpu(int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// Sender
+
+static void build_device_packets(struct device *dev, uint32_t index, uint32_t height)
+{
+    dev->packets_per_frame = height / C64U_LINES_PER_PACKET;
+    dev->video_packets = malloc((size_t)LOADGEN_PATTERN_FRAMES * dev->packets_per_frame * C64U_VIDEO_PACKET_SIZE);
+    dev->audio_packets = malloc((size_t)LOADGEN_AUDIO_PACKETS * C64U_AUDIO_PACKET_SIZE);
+
+    // Moving diagonal stripes, offset per device so the sources can be told apart in OBS
+    for (uint32_t f = 0; f < LOADGEN_PATTERN_FRAMES; f++) {
+        for (uint32_t i = 0; i < dev->packets_per_frame; i++) {
+            uint8_t *packet =
+                dev->video_packets + ((size_t)f * dev->packets_per_frame + i) * C64U_VIDEO_PACKET_SIZE;
+            uint16_t line = (uint16_t)(i * C64U_LINES_PER_PACKET);
+
+            c64u_test_video_header(packet, 0, 0, i, height); // Sequence and frame numbers are set when sent
+            for (uint32_t l = 0; l < C64U_LINES_PER_PACKET; l++) {
+                for (uint32_t x = 0; x < C64U_BYTES_PER_LINE; x++) {
+                    uint32_t c = (x * 2 + line + l + f * 4) / 16 + index;
+                    packet[C64U_VIDEO_HEADER_SIZE + l * C64U_BYTES_PER_LINE + x] =
+                        (uint8_t)(((c + 1) % 16) << 4 | (c % 16));
+                }
+            }
+        }
+    }
+
+    // A different tone per device
+    double frequency = 440.0 + 110.0 * (index % 8);
+    for (uint32_t p = 0; p < LOADGEN_AUDIO_PACKETS; p++) {
+        uint8_t *packet = dev->audio_packets + (size_t)p * C64U_AUDIO_PACKET_SIZE;
+        int16_t *samples = (int16_t *)(packet + C64U_AUDIO_HEADER_SIZE);
+        for (uint32_t s = 0; s < 192; s++) {
+            double t = (p * 192 + s) / 48000.0;
+            int16_t sample = (int16_t)(sin(t * 2 * M_PI * frequency) * 8000);
+            samples[s * 2] = sample;
+            samples[s * 2 + 1] = sample;
+        }
+    }
+}
+
+static int open_send_socket(const struct in_addr *source)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        return -1;
+    }
+    int buffer = LOADGEN_SOCKET_BUFFER;
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+
+    if (source) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr = *source;
+        if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            close(sock);
+            return -1;
+        }
+    }
+    return sock;
+}
+
+static bool init_device(struct device *dev, uint32_t index)
+{
+    struct in_addr target;
+    struct in_addr source;
+    bool bind_source = options.source_base != NULL;
+
+    memset(dev, 0, sizeof(struct device));
+    if (inet_pton(AF_INET, options.target, &target) != 1) {
+        fprintf(stderr, "Invalid target address: %s\n", options.target);
+        return false;
+    }
+    if (bind_source) {
+        if (inet_pton(AF_INET, options.source_base, &source) != 1) {
+            fprintf(stderr, "Invalid source address: %s\n", options.source_base);
+            return false;
+        }
+        source.s_addr = htonl(ntohl(source.s_addr) + index);
+    }
+
+    dev->video_socket = open_send_socket(bind_source ? &source : NULL);
+    dev->audio_socket = open_send_socket(bind_source ? &source : NULL);
+    if (dev->video_socket < 0 || dev->audio_socket < 0) {
+        fprintf(stderr, "Device %u: failed to open sockets: %s\n", index, strerror(errno));
+        return false;
+    }
+
+    dev->video_addr.sin_family = AF_INET;
+    dev->video_addr.sin_addr = target;
+    dev->video_addr.sin_port = htons((uint16_t)(options.video_port + index * options.port_step));
+    dev->audio_addr = dev->video_addr;
+    dev->audio_addr.sin_port = htons((uint16_t)(options.audio_port + index * options.port_step));
+
+    build_device_packets(dev, index, options.ntsc ? C64U_NTSC_HEIGHT : C64U_PAL_HEIGHT);
+    dev->frame_interval = options.ntsc ? C64U_NTSC_FRAME_INTERVAL_NS : C64U_PAL_FRAME_INTERVAL_NS;
+
+    // Real devices are not frame-locked to each other; spreading the phases avoids all frames arriving at once
+    if (options.spread) {
+        dev->frame_start = dev->frame_interval * index / options.devices;
+        dev->next_audio = LOADGEN_AUDIO_INTERVAL_NS * index / options.devices;
+    }
+    return true;
+}
+
+static void free_device(struct device *dev)
+{
+    close(dev->video_socket);
+    close(dev->audio_socket);
+    free(dev->video_packets);
+    free(dev->audio_packets);
+}
+
+static uint64_t next_video_time(const struct device *dev)
+{
+    return dev->frame_start + dev->frame_interval * dev->packet_index / dev->packets_per_frame;
+}
+
+// Send count datagrams to addr in one system call where the platform allows it
+static void send_batch(struct device *dev, int sock, const struct sockaddr_in *addr, struct iovec *iov,
+                       uint32_t count)
+{
+#ifdef __linux__
+    struct mmsghdr msgs[LOADGEN_MAX_BATCH];
+    memset(msgs, 0, sizeof(struct mmsghdr) * count);
+    for (uint32_t i = 0; i < count; i++) {
+        msgs[i].msg_hdr.msg_name = (void *)addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(*addr);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    uint32_t done = 0;
+    while (done < count) {
+        int sent = sendmmsg(sock, msgs + done, count - done, 0);
+        if (sent <= 0) {
+            dev->send_errors += count - done; // ENOBUFS and friends: the datagrams are lost, as on a real link
+            break;
+        }
+        done += (uint32_t)sent;
+    }
+#else
+    for (uint32_t i = 0; i < count; i++) {
+        if (sendto(sock, iov[i].iov_base, iov[i].iov_len, 0, (const struct sockaddr *)addr, sizeof(*addr)) < 0) {
+            dev->send_errors++;
+        }
+    }
+#endif
+}
+
+// Send the video packets due by stream time until, at most one batch
+static uint32_t send_video(struct device *dev, uint64_t until)
+{
+    struct iovec iov[LOADGEN_MAX_BATCH];
+    uint32_t count = 0;
+
+    while (count < options.batch && next_video_time(dev) <= until) {
+        uint32_t frame = dev->frame_num % LOADGEN_PATTERN_FRAMES;
+        uint8_t *packet = dev->video_packets +
+                          ((size_t)frame * dev->packets_per_frame + dev->packet_index) * C64U_VIDEO_PACKET_SIZE;
+        c64u_test_put_u16(packet + 0, dev->video_seq++);
+        c64u_test_put_u16(packet + 2, dev->frame_num);
+        iov[count].iov_base = packet;
+        iov[count].iov_len = C64U_VIDEO_PACKET_SIZE;
+        count++;
+
+        if (++dev->packet_index == dev->packets_per_frame) {
+            dev->packet_index = 0;
+            dev->frame_num++;
+            dev->frame_start += dev->frame_interval;
+        }
+    }
+    if (count > 0) {
+        send_batch(dev, dev->video_socket, &dev->video_addr, iov, count);
+        dev->video_sent += count;
+    }
+    return count;
+}
+
+static uint32_t send_audio(struct device *dev, uint64_t until)
+{
+    struct iovec iov[LOADGEN_MAX_BATCH];
+    uint32_t count = 0;
+
+    while (count < options.batch && dev->next_audio <= until) {
+        uint8_t *packet =
+            dev->audio_packets + (size_t)(dev->audio_seq % LOADGEN_AUDIO_PACKETS) * C64U_AUDIO_PACKET_SIZE;
+        c64u_test_put_u16(packet, dev->audio_seq++);
+        iov[count].iov_base = packet;
+        iov[count].iov_len = C64U_AUDIO_PACKET_SIZE;
+        count++;
+        dev->next_audio += LOADGEN_AUDIO_INTERVAL_NS;
+    }
+    if (count > 0) {
+        send_batch(dev, dev->audio_socket, &dev->audio_addr, iov, count);
+        dev->audio_sent += count;
+    }
+    return count;
+}
+
+struct send_totals {
+    uint64_t video;
+    uint64_t audio;
+    uint64_t errors;
+};
+
+static void sum_devices(const struct device *devices, struct send_totals *totals)
+{
+    memset(totals, 0, sizeof(struct send_totals));
+    for (uint32_t d = 0; d < options.devices; d++) {
+        totals->video += devices[d].video_sent;
+        totals->audio += devices[d].audio_sent;
+        totals->errors += devices[d].send_errors;
+    }
+}
+
+static void print_send_period(const char *label, const struct send_totals *from, const struct send_totals *to,
+                              double seconds, uint64_t behind)
+{
+    double video = (double)(to->video - from->video);
+    double audio = (double)(to->audio - from->audio);
+    double bytes = video * C64U_VIDEO_PACKET_SIZE + audio * C64U_AUDIO_PACKET_SIZE;
+    printf("%s %.0f packets/s (%.0f video, %.0f audio), %.1f Mbit/s, %llu send errors", label,
+           (video + audio) / seconds, video / seconds, audio / seconds, bytes * 8 / seconds / 1e6,
+           (unsigned long long)(to->errors - from->errors));
+    if (options.speed > 0) {
+        printf(", up to %.1f ms behind", behind / 1e6);
+    }
+    printf("\n");
+}
+
+static int run_sender(void)
+{
+    struct device *devices = calloc(options.devices, sizeof(struct device));
+    for (uint32_t d = 0; d < options.devices; d++) {
+        if (!init_device(&devices[d], d)) {
+            return 1;
+        }
+    }
+
+    printf("Sending %u %s device(s) to %s, video ports %u+%u*i, audio %s, speed %s\n", options.devices,
+           options.ntsc ? "NTSC" : "PAL", options.target, options.video_port, options.port_step,
+           options.audio ? "on" : "off", options.speed > 0 ? "paced" : "unlimited");
+
+    uint64_t start = c64u_test_now_ns();
+    uint64_t last_report = start;
+    uint64_t max_behind = 0;
+    uint64_t period_behind = 0; // How far the sender lags behind the schedule: above a frame, it cannot keep up
+    struct send_totals first;
+    struct send_totals last;
+    struct send_totals current;
+    sum_devices(devices, &first);
+    last = first;
+
+    while (running) {
+        uint64_t wall = c64u_test_now_ns();
+        if (options.duration > 0 && wall - start >= (uint64_t)(options.duration * 1e9)) {
+            break;
+        }
+        uint64_t stream_now = options.speed > 0 ? (uint64_t)((wall - start) * options.speed) : UINT64_MAX;
+
+        // One batch per device and stream per round keeps the devices interleaved
+        uint64_t next_due = UINT64_MAX;
+        for (uint32_t d = 0; d < options.devices; d++) {
+            struct device *dev = &devices[d];
+            uint64_t due = next_video_time(dev);
+            if (options.speed > 0 && due < stream_now && stream_now - due > period_behind) {
+                period_behind = stream_now - due;
+            }
+            send_video(dev, stream_now);
+            // Unpaced, audio follows the video's stream time so the packet mix stays realistic
+            if (options.audio) {
+                send_audio(dev, options.speed > 0 ? stream_now : next_video_time(dev));
+            }
+            due = next_video_time(dev);
+            next_due = due < next_due ? due : next_due;
+            if (options.audio && dev->next_audio < next_due) {
+                next_due = dev->next_audio;
+            }
+        }
+
+        if (wall - last_report >= LOADGEN_REPORT_INTERVAL_NS) {
+            char label[32];
+            snprintf(label, sizeof(label), "[%5.1fs]", (wall - start) / 1e9);
+            sum_devices(devices, &current);
+            print_send_period(label, &last, &current, (wall - last_report) / 1e9, period_behind);
+            last = current;
+            last_report = wall;
+            max_behind = period_behind > max_behind ? period_behind : max_behind;
+            period_behind = 0;
+        }
+
+        if (options.speed > 0 && next_due > stream_now) {
+            uint64_t wait = (uint64_t)((next_due - stream_now) / options.speed);
+            c64u_test_sleep_ns(wait < LOADGEN_MAX_SLEEP_NS ? wait : LOADGEN_MAX_SLEEP_NS);
+        }
+    }
+
+    max_behind = period_behind > max_behind ? period_behind : max_behind;
+    sum_devices(devices, &current);
+    print_send_period("Total:", &first, &current, (c64u_test_now_ns() - start) / 1e9, max_behind);
+    for (uint32_t d = 0; d < options.devices; d++) {
+        free_device(&devices[d]);
+    }
+    free(devices);
+    return 0;
+}
+
+// Receiver
+
+static void receive_frame(void *user, struct frame_assembly *frame, uint16_t seq_num, uint64_t time)
+{
+    struct receiver *rx = user;
+    (void)seq_num;
+    (void)time;
+    c64u_core_frame_to_rgba(frame, rx->rgba, rx->core.detected_frame_height);
+    rx->frames++;
+}
+
+static void *receiver_thread(void *data)
+{
+    struct receiver *rx = data;
+    uint8_t packet[C64U_VIDEO_PACKET_SIZE];
+
+    while (running) {
+        ssize_t received = recv(rx->socket, packet, sizeof(packet), 0);
+        if (received < 0) {
+            continue; // Receive timeout: check running
+        }
+        c64u_core_video_packet(&rx->core, packet, (size_t)received, c64u_test_now_ns());
+        rx->packets++;
+    }
+    return NULL;
+}
+
+static bool init_receiver(struct receiver *rx, uint32_t index)
+{
+    memset(rx, 0, sizeof(struct receiver));
+    rx->port = options.video_port + index * options.port_step;
+    rx->rgba = malloc(sizeof(uint32_t) * C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT);
+
+    struct c64u_core_callbacks callbacks = {receive_frame, NULL, NULL, rx};
+    c64u_core_init(&rx->core, &callbacks);
+
+    rx->socket = socket(AF_INET, SOCK_DGRAM, 0);
+    int buffer = LOADGEN_SOCKET_BUFFER;
+    setsockopt(rx->socket, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    struct timeval timeout = {0, 100000};
+    setsockopt(rx->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons((uint16_t)rx->port);
+    if (bind(rx->socket, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Failed to bind port %u: %s\n", rx->port, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+// CPU time of a receiver thread; 0 where per-thread clocks are unavailable (no ceiling is reported then)
+static uint64_t thread_cpu_ns(pthread_t thread)
+{
+#ifdef __linux__
+    clockid_t clock;
+    struct timespec ts;
+    if (pthread_getcpuclockid(thread, &clock) != 0 || clock_gettime(clock, &ts) != 0) {
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#else
+    (void)thread;
+    return 0;
+#endif
+}
+
+struct receive_totals {
+    uint64_t packets;
+    uint64_t frames;
+    uint64_t seq_gaps;
+    uint64_t cpu_ns;
+};
+
+static void sum_receivers(struct receiver *receivers, struct receive_totals *totals)
+{
+    memset(totals, 0, sizeof(struct receive_totals));
+    for (uint32_t r = 0; r < options.devices; r++) {
+        totals->packets += receivers[r].packets;
+        totals->frames += receivers[r].frames;
+        totals->seq_gaps += receivers[r].core.stats.video_seq_gaps;
+        totals->cpu_ns += thread_cpu_ns(receivers[r].thread);
+    }
+}
+
+static void print_receive_period(const char *label, const struct receive_totals *from, const struct receive_totals *to,
+                                 double seconds)
+{
+    double packets = (double)(to->packets - from->packets);
+    double cpu_ns = (double)(to->cpu_ns - from->cpu_ns);
+    double per_packet = packets > 0 ? cpu_ns / packets : 0;
+    printf("%s %.0f packets/s, %.1f frames/s, %llu seq gaps, %.1f%% of a core, %.0f ns/packet", label,
+           packets / seconds, (to->frames - from->frames) / seconds,
+           (unsigned long long)(to->seq_gaps - from->seq_gaps), cpu_ns / seconds / 1e7, per_packet);
+    if (per_packet > 0) {
+        printf(" -> ceiling ~%.0f packets/s per core (%.0f PAL devices)", 1e9 / per_packet,
+               1e9 / per_packet / (C64U_MAX_PACKETS_PER_FRAME * 1e9 / C64U_PAL_FRAME_INTERVAL_NS));
+    }
+    printf("\n");
+}
+
+static int run_receiver(void)
+{
+    struct receiver *receivers = calloc(options.devices, sizeof(struct receiver));
+    for (uint32_t r = 0; r < options.devices; r++) {
+        if (!init_receiver(&receivers[r], r)) {
+            return 1;
+        }
+    }
+    // One thread per source, like the plugin
+    for (uint32_t r = 0; r < options.devices; r++) {
+        if (pthread_create(&receivers[r].thread, NULL, receiver_thread, &receivers[r]) != 0) {
+            fprintf(stderr, "Failed to create receiver thread\n");
+            return 1;
+        }
+    }
+
+    printf("Receiving video for %u device(s) on ports %u+%u*i\n", options.devices, options.video_port,
+           options.port_step);
+
+    uint64_t start = c64u_test_now_ns();
+    uint64_t last_report = start;
+    struct receive_totals first;
+    struct receive_totals last;
+    struct receive_totals current;
+    sum_receivers(receivers, &first);
+    last = first;
+
+    while (running && (options.duration <= 0 || c64u_test_now_ns() - start < (uint64_t)(options.duration * 1e9))) {
+        c64u_test_sleep_ns(LOADGEN_REPORT_INTERVAL_NS / 10);
+        uint64_t now = c64u_test_now_ns();
+        if (now - last_report >= LOADGEN_REPORT_INTERVAL_NS) {
+            sum_receivers(receivers, &current);
+            char label[32];
+            snprintf(label, sizeof(label), "[%5.1fs]", (now - start) / 1e9);
+            print_receive_period(label, &last, &current, (now - last_report) / 1e9);
+            last = current;
+            last_report = now;
+        }
+    }
+
+    sum_receivers(receivers, &current);
+    print_receive_period("Total:", &first, &current, (c64u_test_now_ns() - start) / 1e9);
+
+    running = false;
+    for (uint32_t r = 0; r < options.devices; r++) {
+        pthread_join(receivers[r].thread, NULL);
+        close(receivers[r].socket);
+        free(receivers[r].rgba);
+    }
+    free(receivers);
+    return 0;
+}
+
+static void usage(const char *program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("  --devices N      Simulated C64U devices (default 1, max %d)\n", LOADGEN_MAX_DEVICES);
+    printf("  --target IP      Destination address (default 127.0.0.1)\n");
+    printf("  --video-port P   Video port of device 0 (default %d)\n", C64U_DEFAULT_VIDEO_PORT);
+    printf("  --audio-port P   Audio port of device 0 (default %d)\n", C64U_DEFAULT_AUDIO_PORT);
+    printf("  --port-step N    Port distance between devices (default 2)\n");
+    printf("  --source IP      Bind device i to source address IP + i (e.g. 127.0.1.1 on Linux loopback)\n");
+    printf("  --aligned        Start all frames at the same time instead of spreading the phases\n");
+    printf("  --ntsc           NTSC frames instead of PAL\n");
+    printf("  --no-audio       Video only\n");
+    printf("  --speed X        Stream time per wall time, 1 = real time, 0 = as fast as possible (default 1)\n");
+    printf("  --duration S     Stop after S seconds (default: run until Ctrl+C)\n");
+    printf("  --batch N        Datagrams per sendmmsg() call (default 64, max %d)\n", LOADGEN_MAX_BATCH);
+    printf("  --cpu N          Pin the sender (or all receivers) to CPU N (Linux)\n");
+    printf("  --receive        Receive and assemble the video streams instead of sending\n");
+}
+
+int main(int argc, char *argv[])
+{
+    options = (struct loadgen_options){
+        .devices = 1,
+        .target = "127.0.0.1",
+        .video_port = C64U_DEFAULT_VIDEO_PORT,
+        .audio_port = C64U_DEFAULT_AUDIO_PORT,
+        .port_step = 2,
+        .spread = true,
+        .audio = true,
+        .speed = 1.0,
+        .batch = 64,
+        .cpu = -1,
+    };
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--aligned") == 0) {
+            options.spread = false;
+            continue;
+        } else if (strcmp(argv[i], "--ntsc") == 0) {
+            options.ntsc = true;
+            continue;
+        } else if (strcmp(argv[i], "--no-audio") == 0) {
+            options.audio = false;
+            continue;
+        } else if (strcmp(argv[i], "--receive") == 0) {
+            options.receive = true;
+            continue;
+        } else if (strcmp(argv[i], "--devices") == 0 && value) {
+            options.devices = (uint32_t)atoi(value);
+        } else if (strcmp(argv[i], "--target") == 0 && value) {
+            options.target = value;
+        } else if (strcmp(argv[i], "--video-port") == 0 && value) {
+            options.video_port = (uint32_t)atoi(value);
+        } else if (strcmp(argv[i], "--audio-port") == 0 && value) {
+            options.audio_port = (uint32_t)atoi(value);
+        } else if (strcmp(argv[i], "--port-step") == 0 && value) {
+            options.port_step = (uint32_t)atoi(value);
+        } else if (strcmp(argv[i], "--source") == 0 && value) {
+            options.source_base = value;
+        } else if (strcmp(argv[i], "--speed") == 0 && value) {
+            options.speed = atof(value);
+        } else if (strcmp(argv[i], "--duration") == 0 && value) {
+            options.duration = atof(value);
+        } else if (strcmp(argv[i], "--batch") == 0 && value) {
+            options.batch = (uint32_t)atoi(value);
+        } else if (strcmp(argv[i], "--cpu") == 0 && value) {
+            options.cpu = atoi(value);
+        } else {
+            usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+        i++;
+    }
+    if (options.devices == 0 || options.devices > LOADGEN_MAX_DEVICES || options.batch == 0 ||
+        options.batch > LOADGEN_MAX_BATCH || options.speed < 0 ||
+        options.video_port + (options.devices - 1) * options.port_step > 65535 ||
+        options.audio_port + (options.devices - 1) * options.port_step > 65535) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (options.cpu >= 0 && !pin_to_cpu(options.cpu)) {
+        fprintf(stderr, "Warning: could not pin to CPU %d, running unpinned\n", options.cpu);
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    return options.receive ? run_receiver() : run_sender();
+}
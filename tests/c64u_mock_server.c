@@ -21,6 +21,7 @@ GNU General Public License for more details.
 #include <math.h>
 #include <signal.h>
 #include <errno.h>
+#include <time.h>
 
 // Platform-specific includes
 #ifdef _WIN32
@@ -38,20 +39,19 @@ typedef int socklen_t;
 #include <pthread.h>
 #endif
 
-// C64U constants matching the plugin
-#define C64U_VIDEO_PACKET_SIZE 780
-#define C64U_AUDIO_PACKET_SIZE 770
-#define C64U_VIDEO_HEADER_SIZE 12
-#define C64U_AUDIO_HEADER_SIZE 2
-#define C64U_CONTROL_PORT 64
-#define C64U_VIDEO_PORT 11000
-#define C64U_AUDIO_PORT 11001
-
-// Video format constants
-#define C64U_PAL_WIDTH 384
-#define C64U_PAL_HEIGHT 272
-#define C64U_PIXELS_PER_LINE 384
-#define C64U_LINES_PER_PACKET 4
+#include "c64u_impair.h"
+#include "../src/c64u-core.h"
+#include "c64u_test_util.h"
+
+// Stream constants come from the plugin (c64u-protocol.h, through c64u-core.h)
+#define C64U_VIDEO_PORT C64U_DEFAULT_VIDEO_PORT
+#define C64U_AUDIO_PORT C64U_DEFAULT_AUDIO_PORT
+#define C64U_PAL_PACKETS_PER_FRAME (C64U_PAL_HEIGHT / C64U_LINES_PER_PACKET)
+
+// Stream timing: the real device paces packets evenly over the frame rather than sending each frame in a burst
+#define C64U_AUDIO_PACKET_INTERVAL_NS 4000000ULL // 192 samples at 48kHz
+#define MOCK_IDLE_SLEEP_NS 10000000ULL           // Poll interval while a stream is stopped
+#define MOCK_MAX_SLEEP_US 1000                   // Longest single sleep while packets may become due
 
 // Mock server state
 struct mock_server {
@@ -65,10 +65,78 @@ struct mock_server {
     volatile int video_streaming;
     volatile int audio_streaming;
     char client_ip[64];
+    bool stamp; // Code a frame counter and send time into the top border of every frame
+    uint32_t stamp_counter;
+    bool pattern; // Cycle a frame counter pattern through every packet for continuity checks
+
+    // A/V sync marks: a flash frame and an audio click at the same device time every av_sync_interval ns
+    uint64_t av_sync_interval;
+    pthread_mutex_t av_sync_mutex;
+    uint64_t av_sync_mark; // Send time of the next flash frame, published a frame ahead for the audio thread
+
+    // Network impairment, one engine per stream (see c64u_impair.h)
+    uint64_t seed;
+    struct impair_config video_config;
+    struct impair_config audio_config;
+    struct impair video_impair;
+    struct impair audio_impair;
 };
 
 static struct mock_server server = {0};
 
+// Send every packet the impairment engine has due by now
+static void send_due(int sock, struct impair *im, const struct sockaddr_in *addr, uint64_t now, const char *name)
+{
+    uint8_t packet[IMPAIR_MAX_PACKET];
+    size_t size;
+
+    while ((size = impair_poll(im, now, packet)) > 0) {
+        ssize_t sent = sendto(sock, packet, size, 0, (const struct sockaddr *)addr, sizeof(*addr));
+        if (sent < 0) {
+            printf("%s send error: %s\n", name, strerror(errno));
+        }
+    }
+}
+
+// Sleep until deadline, sending delayed packets as they become due on the way
+static void wait_until(int sock, struct impair *im, const struct sockaddr_in *addr, uint64_t deadline,
+                       const char *name)
+{
+    for (;;) {
+        uint64_t now = c64u_test_now_ns();
+        send_due(sock, im, addr, now, name);
+        if (now >= deadline) {
+            return;
+        }
+
+        uint64_t wake = impair_next_due(im);
+        if (wake > deadline) {
+            wake = deadline;
+        }
+        if (wake > now) {
+            uint64_t sleep_us = (wake - now) / 1000;
+            usleep(sleep_us > MOCK_MAX_SLEEP_US ? MOCK_MAX_SLEEP_US : (sleep_us > 0 ? (useconds_t)sleep_us : 1));
+        }
+    }
+}
+
+// Hand one datagram to the impairment engine and send what is due
+static void transmit(int sock, struct impair *im, const struct sockaddr_in *addr, const uint8_t *data, size_t size,
+                     const char *name)
+{
+    uint64_t now = c64u_test_now_ns();
+    impair_submit(im, data, size, now);
+    send_due(sock, im, addr, now, name);
+}
+
+// Stream stopped: release packets held for reordering, then idle
+static void idle(int sock, struct impair *im, const struct sockaddr_in *addr, const char *name)
+{
+    uint64_t now = c64u_test_now_ns();
+    impair_flush(im, now);
+    wait_until(sock, im, addr, now + MOCK_IDLE_SLEEP_NS, name);
+}
+
 // Generate test pattern for video
 static void generate_test_pattern(uint8_t *pixel_data, int frame_num, int line_num)
 {
@@ -89,59 +157,90 @@ static void generate_test_pattern(uint8_t *pixel_data, int frame_num, int line_n
 static void *video_thread_func(void *data)
 {
     (void)data; // Suppress unused parameter warning
-    {
-        struct sockaddr_in client_addr;
-        socklen_t client_len = sizeof(client_addr);
-        uint8_t packet[C64U_VIDEO_PACKET_SIZE];
-        uint16_t frame_num = 0;
-
-        memset(&client_addr, 0, sizeof(client_addr));
-        client_addr.sin_family = AF_INET;
-        client_addr.sin_port = htons(C64U_VIDEO_PORT);
-        inet_pton(AF_INET, server.client_ip, &client_addr.sin_addr);
-
-        printf("Video thread started, sending to %s:%d\n", server.client_ip, C64U_VIDEO_PORT);
-
-        while (server.running) {
-            if (!server.video_streaming) {
-                usleep(10000); // 10ms
-                continue;
-            }
+    struct sockaddr_in client_addr;
+    struct impair *im = &server.video_impair;
+    uint8_t packet[C64U_VIDEO_PACKET_SIZE];
+    uint16_t seq_num = 0;
+    uint16_t frame_num = 0;
+    uint32_t frame_counter = 0;
+    uint64_t frame_start = 0;
+    uint64_t next_mark = 0;
+    uint32_t mark_counter = 0;
+    bool flash = false;
+    bool flash_next = false;
 
-            // Send one frame (PAL format: 68 packets of 4 lines each)
-            for (int packet_num = 0; packet_num < 68; packet_num++) {
-                uint16_t line_num = packet_num * C64U_LINES_PER_PACKET;
-                bool last_packet = (packet_num == 67);
-
-                // Build packet header
-                *(uint16_t *)(packet + 0) = packet_num;                            // sequence number
-                *(uint16_t *)(packet + 2) = frame_num;                             // frame number
-                *(uint16_t *)(packet + 4) = line_num | (last_packet ? 0x8000 : 0); // line number + flag
-                *(uint16_t *)(packet + 6) = C64U_PIXELS_PER_LINE;                  // pixels per line
-                packet[8] = C64U_LINES_PER_PACKET;                                 // lines per packet
-                packet[9] = 4;                                                     // bits per pixel
-                *(uint16_t *)(packet + 10) = 0;                                    // encoding type
-
-                // Generate test pattern
-                generate_test_pattern(packet + C64U_VIDEO_HEADER_SIZE, frame_num, line_num);
+    memset(&client_addr, 0, sizeof(client_addr));
+    client_addr.sin_family = AF_INET;
+    client_addr.sin_port = htons(C64U_VIDEO_PORT);
+    inet_pton(AF_INET, server.client_ip, &client_addr.sin_addr);
 
-                // Send packet
-                ssize_t sent = sendto(server.video_socket, packet, C64U_VIDEO_PACKET_SIZE, 0,
-                                      (struct sockaddr *)&client_addr, client_len);
-                if (sent < 0) {
-                    printf("Video send error: %s\n", strerror(errno));
-                }
+    printf("Video thread started, sending to %s:%d\n", server.client_ip, C64U_VIDEO_PORT);
 
-                usleep(1000); // 1ms between packets
+    while (server.running) {
+        if (!server.video_streaming) {
+            idle(server.video_socket, im, &client_addr, "Video");
+            frame_start = 0;
+            continue;
+        }
+
+        // Absolute deadlines keep the frame rate exact; resync after falling more than a frame behind
+        uint64_t now = c64u_test_now_ns();
+        if (frame_start == 0 || now > frame_start + C64U_PAL_FRAME_INTERVAL_NS) {
+            frame_start = now;
+        }
+
+        // Decide on the next flash frame a frame ahead, so the audio thread knows before it builds the packet for
+        // that time
+        uint64_t next_start = frame_start + C64U_PAL_FRAME_INTERVAL_NS;
+        flash_next = server.av_sync_interval > 0 && next_start >= next_mark;
+        if (flash_next) {
+            next_mark = next_start + server.av_sync_interval;
+            pthread_mutex_lock(&server.av_sync_mutex);
+            server.av_sync_mark = next_start;
+            pthread_mutex_unlock(&server.av_sync_mutex);
+        }
+
+        // Send one frame (PAL format: 68 packets of 4 lines each)
+        for (int packet_num = 0; packet_num < C64U_PAL_PACKETS_PER_FRAME; packet_num++) {
+            uint16_t line_num = packet_num * C64U_LINES_PER_PACKET;
+            c64u_test_video_header(packet, seq_num++, frame_num, (uint32_t)packet_num, C64U_PAL_HEIGHT);
+
+            // Generate test pattern
+            if (server.pattern) {
+                c64u_pattern_encode(packet + C64U_VIDEO_HEADER_SIZE, frame_counter);
+            } else {
+                generate_test_pattern(packet + C64U_VIDEO_HEADER_SIZE, frame_num, line_num);
+            }
+            if (flash) {
+                // White, except for the continuity pattern's counter line
+                int lines = server.pattern ? C64U_LINES_PER_PACKET - 1 : C64U_LINES_PER_PACKET;
+                memset(packet + C64U_VIDEO_HEADER_SIZE, 0x11, (size_t)lines * C64U_BYTES_PER_LINE);
+                if (packet_num == 0) {
+                    c64u_avsync_flash_encode(packet + C64U_VIDEO_HEADER_SIZE, mark_counter);
+                }
             }
 
-            frame_num++;
-            usleep(20000); // ~50fps (20ms per frame)
+            wait_until(server.video_socket, im, &client_addr,
+                       frame_start + C64U_PAL_FRAME_INTERVAL_NS * packet_num / C64U_PAL_PACKETS_PER_FRAME, "Video");
+            if (server.stamp && packet_num == 0) {
+                // Stamped as late as possible: latency counts from the moment the frame starts to leave
+                c64u_stamp_encode(packet + C64U_VIDEO_HEADER_SIZE, server.stamp_counter++, c64u_test_now_ns());
+            }
+            transmit(server.video_socket, im, &client_addr, packet, C64U_VIDEO_PACKET_SIZE, "Video");
         }
 
-        printf("Video thread stopped\n");
-        return NULL;
+        frame_num++;
+        frame_counter++;
+        frame_start += C64U_PAL_FRAME_INTERVAL_NS;
+        if (flash) {
+            mark_counter++;
+        }
+        flash = flash_next;
+        wait_until(server.video_socket, im, &client_addr, frame_start, "Video");
     }
+
+    printf("Video thread stopped\n");
+    return NULL;
 }
 
 // Audio streaming thread
@@ -149,9 +248,11 @@ static void *audio_thread_func(void *data)
 {
     (void)data; // Suppress unused parameter warning
     struct sockaddr_in client_addr;
-    socklen_t client_len = sizeof(client_addr);
+    struct impair *im = &server.audio_impair;
     uint8_t packet[C64U_AUDIO_PACKET_SIZE];
     uint16_t seq_num = 0;
+    uint64_t next_packet = 0;
+    uint64_t clicked_mark = 0;
 
     memset(&client_addr, 0, sizeof(client_addr));
     client_addr.sin_family = AF_INET;
@@ -162,10 +263,16 @@ static void *audio_thread_func(void *data)
 
     while (server.running) {
         if (!server.audio_streaming) {
-            usleep(10000); // 10ms
+            idle(server.audio_socket, im, &client_addr, "Audio");
+            next_packet = 0;
             continue;
         }
 
+        uint64_t now = c64u_test_now_ns();
+        if (next_packet == 0 || now > next_packet + C64U_AUDIO_PACKET_INTERVAL_NS) {
+            next_packet = now;
+        }
+
         // Build packet header
         *(uint16_t *)(packet) = seq_num++;
 
@@ -178,14 +285,24 @@ static void *audio_thread_func(void *data)
             audio_data[i * 2 + 1] = sample;                                // Right channel
         }
 
-        // Send packet
-        ssize_t sent =
-            sendto(server.audio_socket, packet, C64U_AUDIO_PACKET_SIZE, 0, (struct sockaddr *)&client_addr, client_len);
-        if (sent < 0) {
-            printf("Audio send error: %s\n", strerror(errno));
+        // The packet sent at next_packet holds the 4ms of samples before it; click where the flash frame starts
+        if (server.av_sync_interval > 0) {
+            pthread_mutex_lock(&server.av_sync_mutex);
+            uint64_t mark = server.av_sync_mark;
+            pthread_mutex_unlock(&server.av_sync_mutex);
+            uint64_t packet_start = next_packet - C64U_AUDIO_PACKET_INTERVAL_NS;
+            if (mark != clicked_mark && mark < next_packet) {
+                if (mark >= packet_start) {
+                    uint32_t offset = (uint32_t)((mark - packet_start) * 48000 / 1000000000ULL);
+                    c64u_avsync_click_encode(audio_data, 192, offset);
+                }
+                clicked_mark = mark;
+            }
         }
 
-        usleep(4000); // ~250Hz packet rate (4ms per packet for 192 samples at 48kHz)
+        wait_until(server.audio_socket, im, &client_addr, next_packet, "Audio");
+        transmit(server.audio_socket, im, &client_addr, packet, C64U_AUDIO_PACKET_SIZE, "Audio");
+        next_packet += C64U_AUDIO_PACKET_INTERVAL_NS;
     }
 
     printf("Audio thread stopped\n");
@@ -240,27 +357,16 @@ static void *control_thread_func(void *data)
             }
             printf("\n");
 
-            // Parse command
-            if (cmd[0] == 0x20 && cmd[1] == 0xFF) {
-                // Start stream command
-                uint8_t stream_id = cmd[2] - 0x02;
+            // Parse command: FF2n starts and FF3n stops stream n (0 = video, 1 = audio), as send_control_command()
+            uint8_t stream_id = cmd[0] & 0x0F;
+            bool start = (cmd[0] & 0xF0) == 0x20;
+            if (cmd[1] == 0xFF && (start || (cmd[0] & 0xF0) == 0x30) && stream_id <= 1) {
                 if (stream_id == 0) {
-                    server.video_streaming = 1;
-                    printf("Video streaming started\n");
-                } else if (stream_id == 1) {
-                    server.audio_streaming = 1;
-                    printf("Audio streaming started\n");
-                }
-            } else if (cmd[0] == 0x30 && cmd[1] == 0xFF) {
-                // Stop stream command
-                uint8_t stream_id = cmd[2] - 0x03;
-                if (stream_id == 0) {
-                    server.video_streaming = 0;
-                    printf("Video streaming stopped\n");
-                } else if (stream_id == 1) {
-                    server.audio_streaming = 0;
-                    printf("Audio streaming stopped\n");
+                    server.video_streaming = start;
+                } else {
+                    server.audio_streaming = start;
                 }
+                printf("%s streaming %s\n", stream_id == 0 ? "Video" : "Audio", start ? "started" : "stopped");
             }
         }
 
@@ -276,16 +382,107 @@ static void signal_handler(int sig)
     (void)sig; // Suppress unused parameter warning
     printf("\nShutting down mock server...\n");
     server.running = 0;
+    shutdown(server.control_socket, SHUT_RDWR); // Wake the control thread from accept()
 }
 
-int main(int argc, char *argv[])
+static void print_usage(const char *program)
+{
+    printf("Usage: %s [options]\n\n", program);
+    printf("Network impairment (applies to both streams; prefix with video- or audio- for one stream only,\n");
+    printf("e.g. --video-loss 0.01 --audio-jitter 5):\n");
+    impair_usage("--");
+    printf("  --seed N             Random seed, runs with the same seed impair the same packets (default 1)\n");
+    printf("  --stamp              Code a frame counter and send time into each frame for latency measurement\n");
+    printf("  --pattern            Send the continuity pattern (frame counter in every packet) for c64u-continuity\n");
+    printf("  --av-sync S          Send a flash frame and an audio click at the same time every S seconds\n");
+    printf("  --help               Show this help\n");
+}
+
+// Returns false on an unknown option or invalid value
+static bool parse_arguments(int argc, char *argv[])
 {
-    (void)argc;
-    (void)argv; // Suppress unused parameter warnings
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
 
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            print_usage(argv[0]);
+            exit(0);
+        }
+        if (strcmp(arg, "--stamp") == 0) {
+            server.stamp = true;
+            continue;
+        }
+        if (strcmp(arg, "--pattern") == 0) {
+            server.pattern = true;
+            continue;
+        }
+        if (strncmp(arg, "--", 2) != 0 || i + 1 >= argc) {
+            printf("Invalid argument: %s\n", arg);
+            return false;
+        }
+
+        const char *name = arg + 2;
+        const char *value = argv[++i];
+        bool ok;
+        if (strcmp(name, "seed") == 0) {
+            server.seed = strtoull(value, NULL, 0);
+            ok = true;
+        } else if (strcmp(name, "av-sync") == 0) {
+            double seconds = atof(value);
+            server.av_sync_interval = (uint64_t)(seconds * 1e9);
+            ok = seconds >= 0.5; // Marks must be further apart than C64U_AVSYNC_MAX_OFFSET_NS
+        } else if (strncmp(name, "video-", 6) == 0) {
+            ok = impair_config_set(&server.video_config, name + 6, value);
+        } else if (strncmp(name, "audio-", 6) == 0) {
+            ok = impair_config_set(&server.audio_config, name + 6, value);
+        } else {
+            ok = impair_config_set(&server.video_config, name, value) &&
+                 impair_config_set(&server.audio_config, name, value);
+        }
+        if (!ok) {
+            printf("Invalid option or value: %s %s\n", arg, value);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void print_impair_stats(const char *name, const struct impair *im)
+{
+    const struct impair_stats *stats = &im->stats;
+    printf("%s impairment: %llu submitted, %llu sent, %llu lost (%llu random, %llu in %llu bursts), "
+           "%llu duplicated, %llu reordered, %llu queue drops\n",
+           name, (unsigned long long)stats->submitted, (unsigned long long)stats->sent,
+           (unsigned long long)(stats->lost_random + stats->lost_burst), (unsigned long long)stats->lost_random,
+           (unsigned long long)stats->lost_burst, (unsigned long long)stats->bursts,
+           (unsigned long long)stats->duplicated, (unsigned long long)stats->reordered,
+           (unsigned long long)stats->queue_dropped);
+}
+
+int main(int argc, char *argv[])
+{
     printf("C64U Mock Server v1.0\n");
     printf("Simulating C64 Ultimate device for testing\n\n");
 
+    server.seed = 1;
+    impair_config_defaults(&server.video_config);
+    impair_config_defaults(&server.audio_config);
+    if (!parse_arguments(argc, argv)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // Different streams of one run get different, but reproducible, random sequences
+    if (!impair_init(&server.video_impair, &server.video_config, server.seed * 2) ||
+        !impair_init(&server.audio_impair, &server.audio_config, server.seed * 2 + 1)) {
+        printf("Failed to allocate impairment queues\n");
+        return 1;
+    }
+    bool impaired = impair_config_active(&server.video_config) || impair_config_active(&server.audio_config);
+    if (impaired) {
+        printf("Network impairment enabled (seed %llu)\n\n", (unsigned long long)server.seed);
+    }
+
     // Setup signal handling
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
@@ -311,6 +508,7 @@ int main(int argc, char *argv[])
     setsockopt(server.control_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
 
     // Start threads
+    pthread_mutex_init(&server.av_sync_mutex, NULL);
     if (pthread_create(&server.control_thread, NULL, control_thread_func, NULL) != 0) {
         printf("Failed to create control thread\n");
         return 1;
@@ -334,7 +532,15 @@ int main(int argc, char *argv[])
     pthread_join(server.video_thread, NULL);
     pthread_join(server.audio_thread, NULL);
 
+    if (impaired) {
+        print_impair_stats("Video", &server.video_impair);
+        print_impair_stats("Audio", &server.audio_impair);
+    }
+
     // Cleanup
+    impair_free(&server.video_impair);
+    impair_free(&server.audio_impair);
+    pthread_mutex_destroy(&server.av_sync_mutex);
     close(server.control_socket);
     close(server.video_socket);
     close(server.audio_socket);
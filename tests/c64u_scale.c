@@ -0,0 +1,601 @@
+/*
+C64U Multi-Source Scaling Benchmark
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+Runs 1..N C64U sources in one process against c64u-loadgen and measures what each one costs. A source is what the OBS
+source runs per device (c64u_test_source.h): a video and an audio receive thread (non-blocking recv(), 1ms sleep when
+empty), the async retry thread, c64u-core frame assembly, the render delay queue and front/back buffers; one render
+thread at the OBS frame rate stands in for the graphics thread all sources share. Per step it reports CPU per thread
+role (per-thread CPU clocks), wakeups/s (voluntary context switches from /proc), RSS and the video and audio loss and
+frame drop rates, as a table and optionally as JSON for tracking the curve over releases.
+*/
+
+#define _GNU_SOURCE // pthread_getcpuclockid(), syscall()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "../src/c64u-core.h"
+#include "c64u_test_source.h"
+#include "c64u_test_util.h"
+
+#define SCALE_MAX_SOURCES 64
+#define SCALE_DEFAULT_SOURCES 4
+#define SCALE_DEFAULT_DURATION 10.0
+#define SCALE_WARMUP_NS 1000000000ULL
+#define SCALE_DEFAULT_DELAY 3 // C64U_DEFAULT_RENDER_DELAY_FRAMES
+#define SCALE_RENDER_FPS 60.0
+#define SCALE_SOCKET_BUFFER (1024 * 1024) // As create_udp_socket()
+#define SCALE_PORT_STEP 2
+
+enum thread_role {
+    ROLE_VIDEO,
+    ROLE_AUDIO,
+    ROLE_RETRY,
+    ROLE_SOURCE_THREADS,
+};
+
+static const char *role_names[ROLE_SOURCE_THREADS] = {"video", "audio", "retry"};
+
+struct scale_options {
+    uint32_t max_sources;
+    double duration; // Measured seconds per step
+    uint32_t delay;  // Render delay frames
+    bool ntsc;
+    uint32_t video_port;
+    const char *loadgen; // Path of c64u-loadgen
+    const char *json_path;
+};
+
+// Thread handle with what is needed to read its CPU time and context switches from outside
+struct thread_info {
+    pthread_t thread;
+    volatile pid_t tid; // Set by the thread itself (0 until it runs)
+};
+
+struct source {
+    struct c64u_test_source pipeline;
+    int video_socket;
+    int audio_socket;
+    struct thread_info threads[ROLE_SOURCE_THREADS];
+    int16_t audio_out[(C64U_AUDIO_PACKET_SIZE - C64U_AUDIO_HEADER_SIZE) / 2]; // obs_source_output_audio() copies
+};
+
+// Per-thread counters at one point in time
+struct thread_sample {
+    uint64_t cpu_ns;
+    uint64_t switches; // Voluntary context switches: the thread went to sleep and was woken up
+};
+
+struct step_result {
+    uint32_t sources;
+    double seconds;
+    double process_cpu;                   // Percent of one core, whole process (the sender is a separate process)
+    double role_cpu[ROLE_SOURCE_THREADS]; // Percent of one core per source
+    double render_cpu;                    // Shared render thread
+    double wakeups[ROLE_SOURCE_THREADS];  // Per second per source
+    double rss_mb;
+    double video_loss;    // Percent of video packets out of sequence
+    double audio_loss;    // Percent of audio packets out of sequence
+    double frame_drops;   // Percent of the frames the devices sent that were not completed
+    double delivered_fps; // Per source, after the delay queue
+    uint32_t stalls;
+};
+
+static volatile bool running = true;
+static struct scale_options options;
+static struct source *sources;
+static uint32_t source_count;
+static struct thread_info render_info;
+static uint8_t *texture; // The render thread's upload target
+
+static void signal_handler(int sig)
+{
+    (void)sig;
+    running = false;
+}
+
+static void register_thread(struct thread_info *info)
+{
+#ifdef __linux__
+    info->tid = (pid_t)syscall(SYS_gettid);
+#else
+    info->tid = 1;
+#endif
+}
+
+static void sample_thread(const struct thread_info *info, struct thread_sample *sample)
+{
+    memset(sample, 0, sizeof(struct thread_sample));
+#ifdef __linux__
+    clockid_t clock;
+    struct timespec ts;
+    if (pthread_getcpuclockid(info->thread, &clock) == 0 && clock_gettime(clock, &ts) == 0) {
+        sample->cpu_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+
+    char path[64];
+    char line[128];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/status", (int)info->tid);
+    FILE *file = fopen(path, "r");
+    while (file && fgets(line, sizeof(line), file)) {
+        unsigned long long value;
+        if (sscanf(line, "voluntary_ctxt_switches: %llu", &value) == 1) {
+            sample->switches = value;
+        }
+    }
+    if (file) {
+        fclose(file);
+    }
+#else
+    (void)info; // Per-thread CPU and wakeups need Linux; only the process totals are measured elsewhere
+#endif
+}
+
+static uint64_t process_cpu_ns(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL +
+           (uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL;
+}
+
+// Resident set size in MB (peak RSS where /proc is unavailable)
+static double rss_mb(void)
+{
+#ifdef __linux__
+    char line[128];
+    double mb = 0;
+    FILE *file = fopen("/proc/self/status", "r");
+    while (file && fgets(line, sizeof(line), file)) {
+        unsigned long kb;
+        if (sscanf(line, "VmRSS: %lu kB", &kb) == 1) {
+            mb = kb / 1024.0;
+        }
+    }
+    if (file) {
+        fclose(file);
+    }
+    return mb;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / (1024.0 * 1024.0); // Bytes on macOS
+#endif
+}
+
+// Source: the plugin's threads on the shared test source
+
+// deliver_audio_packet(): the A/V sync click search and the copy OBS makes
+static void deliver_audio(void *user, const int16_t *samples, uint32_t count, uint16_t seq_num)
+{
+    struct source *src = user;
+    (void)seq_num;
+    c64u_avsync_click_find(samples, count);
+    memcpy(src->audio_out, samples, (size_t)count * 2 * sizeof(int16_t));
+}
+
+static void *video_thread(void *data)
+{
+    struct source *src = data;
+    register_thread(&src->threads[ROLE_VIDEO]);
+    c64u_test_source_receive(&src->pipeline, src->video_socket, true);
+    return NULL;
+}
+
+static void *audio_thread(void *data)
+{
+    struct source *src = data;
+    register_thread(&src->threads[ROLE_AUDIO]);
+    c64u_test_source_receive(&src->pipeline, src->audio_socket, false);
+    return NULL;
+}
+
+static void *retry_thread(void *data)
+{
+    struct source *src = data;
+    register_thread(&src->threads[ROLE_RETRY]);
+    c64u_test_source_retry(&src->pipeline);
+    return NULL;
+}
+
+// The OBS graphics thread: every source's render callback uploads its front buffer
+static void *render_thread(void *data)
+{
+    (void)data;
+    register_thread(&render_info);
+    uint64_t interval = (uint64_t)(1e9 / SCALE_RENDER_FPS);
+    uint64_t next = c64u_test_now_ns();
+
+    while (running && render_info.tid != -1) {
+        for (uint32_t s = 0; s < source_count; s++) {
+            struct c64u_test_source *pipeline = &sources[s].pipeline;
+            pthread_mutex_lock(&pipeline->frame_mutex);
+            if (pipeline->generation > 0) {
+                memcpy(texture, pipeline->output.front, sizeof(uint32_t) * C64U_PIXELS_PER_LINE * pipeline->height);
+            }
+            pthread_mutex_unlock(&pipeline->frame_mutex);
+        }
+        next += interval;
+        uint64_t now = c64u_test_now_ns();
+        if (next > now) {
+            c64u_test_sleep_ns(next - now);
+        } else {
+            next = now;
+        }
+    }
+    return NULL;
+}
+
+static int open_socket(uint32_t port)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        return -1;
+    }
+    int buffer = SCALE_SOCKET_BUFFER;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t)port);
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 || flags < 0 ||
+        fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0) {
+        fprintf(stderr, "Failed to bind port %u: %s\n", port, strerror(errno));
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+static bool start_source(struct source *src, uint32_t index)
+{
+    memset(src, 0, sizeof(struct source));
+    uint32_t port = options.video_port + index * SCALE_PORT_STEP;
+    src->video_socket = open_socket(port);
+    src->audio_socket = open_socket(port + 1);
+    if (src->video_socket < 0 || src->audio_socket < 0 || !c64u_test_source_init(&src->pipeline, options.delay)) {
+        return false;
+    }
+    src->pipeline.audio = deliver_audio;
+    src->pipeline.user = src;
+
+    void *(*functions[ROLE_SOURCE_THREADS])(void *) = {video_thread, audio_thread, retry_thread};
+    for (int r = 0; r < ROLE_SOURCE_THREADS; r++) {
+        if (pthread_create(&src->threads[r].thread, NULL, functions[r], src) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void stop_source(struct source *src)
+{
+    c64u_test_source_stop(&src->pipeline);
+    for (int r = 0; r < ROLE_SOURCE_THREADS; r++) {
+        pthread_join(src->threads[r].thread, NULL);
+    }
+    c64u_test_source_free(&src->pipeline);
+    close(src->video_socket);
+    close(src->audio_socket);
+}
+
+// Step: N sources against a loadgen with N devices
+
+static pid_t start_loadgen(uint32_t devices, double seconds)
+{
+    char devices_arg[16];
+    char port_arg[16];
+    char audio_port_arg[16];
+    char step_arg[16];
+    char duration_arg[32];
+    snprintf(devices_arg, sizeof(devices_arg), "%u", devices);
+    snprintf(port_arg, sizeof(port_arg), "%u", options.video_port);
+    snprintf(audio_port_arg, sizeof(audio_port_arg), "%u", options.video_port + 1);
+    snprintf(step_arg, sizeof(step_arg), "%d", SCALE_PORT_STEP);
+    snprintf(duration_arg, sizeof(duration_arg), "%.1f", seconds);
+    char *args[] = {(char *)options.loadgen, "--devices", devices_arg, "--video-port", port_arg, "--audio-port",
+                    audio_port_arg, "--port-step", step_arg, "--duration", duration_arg,
+                    options.ntsc ? "--ntsc" : NULL, NULL};
+
+    fflush(stdout); // Or the child flushes our buffered output a second time
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (!freopen("/dev/null", "w", stdout)) {
+            _exit(127);
+        }
+        execv(options.loadgen, args);
+        fprintf(stderr, "Cannot run %s: %s\n", options.loadgen, strerror(errno));
+        _exit(127);
+    }
+    return pid;
+}
+
+struct snapshot {
+    uint64_t time;
+    uint64_t process_cpu;
+    struct thread_sample threads[SCALE_MAX_SOURCES][ROLE_SOURCE_THREADS];
+    struct thread_sample render;
+    struct c64u_core_stats stats[SCALE_MAX_SOURCES];
+    uint64_t delivered[SCALE_MAX_SOURCES];
+};
+
+static void take_snapshot(struct snapshot *snap)
+{
+    snap->time = c64u_test_now_ns();
+    snap->process_cpu = process_cpu_ns();
+    sample_thread(&render_info, &snap->render);
+    for (uint32_t s = 0; s < source_count; s++) {
+        for (int r = 0; r < ROLE_SOURCE_THREADS; r++) {
+            sample_thread(&sources[s].threads[r], &snap->threads[s][r]);
+        }
+        // Counters only grow; a torn read is off by one packet at most
+        snap->stats[s] = sources[s].pipeline.core.stats;
+        snap->delivered[s] = sources[s].pipeline.generation;
+    }
+}
+
+static void compute_step(const struct snapshot *a, const struct snapshot *b, struct step_result *result)
+{
+    double seconds = (b->time - a->time) / 1e9;
+    double n = source_count;
+    memset(result, 0, sizeof(struct step_result));
+    result->sources = source_count;
+    result->seconds = seconds;
+    result->process_cpu = (b->process_cpu - a->process_cpu) / seconds / 1e7;
+    result->render_cpu = (b->render.cpu_ns - a->render.cpu_ns) / seconds / 1e7;
+
+    uint64_t video = 0;
+    uint64_t video_gaps = 0;
+    uint64_t audio = 0;
+    uint64_t audio_gaps = 0;
+    uint64_t complete = 0;
+    uint64_t delivered = 0;
+    for (uint32_t s = 0; s < source_count; s++) {
+        for (int r = 0; r < ROLE_SOURCE_THREADS; r++) {
+            result->role_cpu[r] += (b->threads[s][r].cpu_ns - a->threads[s][r].cpu_ns) / seconds / 1e7 / n;
+            result->wakeups[r] += (b->threads[s][r].switches - a->threads[s][r].switches) / seconds / n;
+        }
+        video += b->stats[s].video_packets - a->stats[s].video_packets;
+        video_gaps += b->stats[s].video_seq_gaps - a->stats[s].video_seq_gaps;
+        audio += b->stats[s].audio_packets - a->stats[s].audio_packets;
+        audio_gaps += b->stats[s].audio_seq_gaps - a->stats[s].audio_seq_gaps;
+        complete += b->stats[s].frames_complete - a->stats[s].frames_complete;
+        delivered += b->delivered[s] - a->delivered[s];
+        result->stalls += sources[s].pipeline.stalls;
+    }
+    double fps = options.ntsc ? 1e9 / C64U_NTSC_FRAME_INTERVAL_NS : 1e9 / C64U_PAL_FRAME_INTERVAL_NS;
+    double sent_frames = fps * seconds * n;
+    result->video_loss = video > 0 ? 100.0 * video_gaps / video : 100.0;
+    result->audio_loss = audio > 0 ? 100.0 * audio_gaps / audio : 100.0;
+    result->frame_drops = complete < sent_frames ? 100.0 * (sent_frames - complete) / sent_frames : 0.0;
+    result->delivered_fps = delivered / seconds / n;
+    result->rss_mb = rss_mb();
+}
+
+static bool run_step(uint32_t count, struct step_result *result)
+{
+    static struct snapshot before;
+    static struct snapshot after;
+
+    source_count = 0;
+    for (uint32_t s = 0; s < count; s++) {
+        if (!start_source(&sources[s], s)) {
+            fprintf(stderr, "Failed to start source %u\n", s);
+            return false;
+        }
+        source_count++;
+    }
+    pthread_t render;
+    render_info.tid = 0;
+    pthread_create(&render, NULL, render_thread, NULL);
+    render_info.thread = render;
+
+    double seconds = options.duration + SCALE_WARMUP_NS / 1e9;
+    pid_t loadgen = start_loadgen(count, seconds + 1.0);
+    if (loadgen < 0) {
+        fprintf(stderr, "fork() failed: %s\n", strerror(errno));
+        return false;
+    }
+
+    // Let every thread start and the first frames arrive, then measure
+    uint64_t start = c64u_test_now_ns();
+    while (running && c64u_test_now_ns() - start < SCALE_WARMUP_NS) {
+        c64u_test_sleep_ns(10000000);
+    }
+    take_snapshot(&before);
+    while (running && c64u_test_now_ns() - before.time < (uint64_t)(options.duration * 1e9)) {
+        c64u_test_sleep_ns(10000000);
+    }
+    take_snapshot(&after);
+    compute_step(&before, &after, result);
+
+    kill(loadgen, SIGINT);
+    waitpid(loadgen, NULL, 0);
+    render_info.tid = -1;
+    pthread_join(render, NULL);
+    for (uint32_t s = 0; s < count; s++) {
+        stop_source(&sources[s]);
+    }
+    source_count = 0;
+    return true;
+}
+
+static void print_header(void)
+{
+    printf("%7s %8s %8s %7s %7s %7s %8s %9s %9s %8s %7s %7s %7s %7s %6s\n", "sources", "process", "/source",
+           "video", "audio", "retry", "render", "wake/s", "wake/s", "RSS", "video", "audio", "frame", "shown", "");
+    printf("%7s %8s %8s %7s %7s %7s %8s %9s %9s %8s %7s %7s %7s %7s %6s\n", "", "CPU %", "CPU %", "CPU %", "CPU %",
+           "CPU %", "CPU %", "video", "audio", "MB", "loss %", "loss %", "drop %", "fps", "stalls");
+}
+
+static void print_step(const struct step_result *r)
+{
+    printf("%7u %8.1f %8.2f %7.2f %7.2f %7.2f %8.2f %9.0f %9.0f %8.1f %7.2f %7.2f %7.2f %7.1f %6u\n", r->sources,
+           r->process_cpu, r->role_cpu[ROLE_VIDEO] + r->role_cpu[ROLE_AUDIO] + r->role_cpu[ROLE_RETRY],
+           r->role_cpu[ROLE_VIDEO], r->role_cpu[ROLE_AUDIO], r->role_cpu[ROLE_RETRY], r->render_cpu,
+           r->wakeups[ROLE_VIDEO], r->wakeups[ROLE_AUDIO], r->rss_mb, r->video_loss, r->audio_loss, r->frame_drops,
+           r->delivered_fps, r->stalls);
+    fflush(stdout);
+}
+
+static bool write_json(const struct step_result *results, uint32_t count, const char *path)
+{
+    FILE *file = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\n  \"benchmark\": \"c64u-scale\",\n  \"version\": 1,\n  \"timestamp\": %lld,\n",
+            (long long)time(NULL));
+    fprintf(file, "  \"format\": \"%s\",\n  \"render_delay\": %u,\n  \"duration\": %.1f,\n  \"steps\": [\n",
+            options.ntsc ? "ntsc" : "pal", options.delay, options.duration);
+    for (uint32_t i = 0; i < count; i++) {
+        const struct step_result *r = &results[i];
+        fprintf(file, "    {\"sources\": %u, \"process_cpu_percent\": %.2f, \"cpu_percent_per_source\": {", r->sources,
+                r->process_cpu);
+        for (int t = 0; t < ROLE_SOURCE_THREADS; t++) {
+            fprintf(file, "\"%s\": %.3f, ", role_names[t], r->role_cpu[t]);
+        }
+        fprintf(file, "\"render_shared\": %.3f}, \"wakeups_per_sec_per_source\": {", r->render_cpu);
+        for (int t = 0; t < ROLE_SOURCE_THREADS; t++) {
+            fprintf(file, "\"%s\": %.1f%s", role_names[t], r->wakeups[t], t + 1 < ROLE_SOURCE_THREADS ? ", " : "");
+        }
+        fprintf(file,
+                "}, \"rss_mb\": %.1f, \"video_loss_percent\": %.3f, \"audio_loss_percent\": %.3f, "
+                "\"frame_drop_percent\": %.3f, \"shown_fps_per_source\": %.2f, \"stalls\": %u}%s\n",
+                r->rss_mb, r->video_loss, r->audio_loss, r->frame_drops, r->delivered_fps, r->stalls,
+                i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return file == stdout ? fflush(file) == 0 : fclose(file) == 0;
+}
+
+static void usage(const char *program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("  --sources N      Measure 1..N sources (default %d, max %d)\n", SCALE_DEFAULT_SOURCES,
+           SCALE_MAX_SOURCES);
+    printf("  --duration S     Measured seconds per step, after 1s of warm-up (default %.0f)\n",
+           SCALE_DEFAULT_DURATION);
+    printf("  --delay N        Render delay frames of every source (default %d)\n", SCALE_DEFAULT_DELAY);
+    printf("  --ntsc           NTSC devices instead of PAL\n");
+    printf("  --video-port P   Video port of source 0; source i uses P + 2i and P + 2i + 1 (default %d)\n",
+           C64U_DEFAULT_VIDEO_PORT);
+    printf("  --loadgen PATH   c64u-loadgen to run (default: next to this program)\n");
+    printf("  --json FILE      Also write the scaling curve as JSON (- for stdout)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    options = (struct scale_options){
+        .max_sources = SCALE_DEFAULT_SOURCES,
+        .duration = SCALE_DEFAULT_DURATION,
+        .delay = SCALE_DEFAULT_DELAY,
+        .video_port = C64U_DEFAULT_VIDEO_PORT,
+    };
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--ntsc") == 0) {
+            options.ntsc = true;
+            continue;
+        } else if (strcmp(argv[i], "--sources") == 0 && value) {
+            options.max_sources = (uint32_t)atoi(value);
+        } else if (strcmp(argv[i], "--duration") == 0 && value) {
+            options.duration = atof(value);
+        } else if (strcmp(argv[i], "--delay") == 0 && value) {
+            options.delay = (uint32_t)atoi(value);
+        } else if (strcmp(argv[i], "--video-port") == 0 && value) {
+            options.video_port = (uint32_t)atoi(value);
+        } else if (strcmp(argv[i], "--loadgen") == 0 && value) {
+            options.loadgen = value;
+        } else if (strcmp(argv[i], "--json") == 0 && value) {
+            options.json_path = value;
+        } else {
+            usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+        i++;
+    }
+    if (options.max_sources == 0 || options.max_sources > SCALE_MAX_SOURCES || options.duration <= 0 ||
+        options.delay > 100 || options.video_port + options.max_sources * SCALE_PORT_STEP > 65535) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    char loadgen[4096];
+    if (!options.loadgen) {
+        const char *slash = strrchr(argv[0], '/');
+        snprintf(loadgen, sizeof(loadgen), "%.*sc64u-loadgen", slash ? (int)(slash - argv[0] + 1) : 0, argv[0]);
+        options.loadgen = loadgen;
+    }
+    if (access(options.loadgen, X_OK) != 0) {
+        fprintf(stderr, "c64u-loadgen not found at %s (use --loadgen)\n", options.loadgen);
+        return 1;
+    }
+
+    sources = calloc(options.max_sources, sizeof(struct source));
+    texture = malloc(sizeof(uint32_t) * C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT);
+    struct step_result *results = calloc(options.max_sources, sizeof(struct step_result));
+    if (!sources || !texture || !results) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    printf("c64u-scale: 1..%u %s sources, render delay %u, %.0fs per step (RSS at start %.1f MB)\n\n",
+           options.max_sources, options.ntsc ? "NTSC" : "PAL", options.delay, options.duration, rss_mb());
+    print_header();
+    uint32_t steps = 0;
+    for (uint32_t n = 1; n <= options.max_sources && running; n++) {
+        if (!run_step(n, &results[steps])) {
+            break;
+        }
+        print_step(&results[steps]);
+        steps++;
+    }
+    if (steps > 1) {
+        const struct step_result *first = &results[0];
+        const struct step_result *last = &results[steps - 1];
+        printf("\nEach added source: %+.2f%% of a core, %+.1f MB RSS\n",
+               (last->process_cpu - first->process_cpu) / (last->sources - first->sources),
+               (last->rss_mb - first->rss_mb) / (last->sources - first->sources));
+    }
+
+    bool ok = steps == options.max_sources && (!options.json_path || write_json(results, steps, options.json_path));
+    free(results);
+    free(texture);
+    free(sources);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,667 @@
+/*
+C64U Startup Benchmark
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+Measures what OBS waits for when it loads a scene collection with C64U sources, and how long until the first frame
+shows. Each scenario creates several sources with the plugin's own c64u_create(), built against a thin OBS stub
+(obs-stub/), and lets their retry threads work as in OBS: detect the local address, resolve the host, create the UDP
+sockets and receive threads, send the start commands to the device and deliver the first frame. A built-in DNS
+server answers the hostname immediately, slowly or never; the literal scenario uses an IP address. The device is
+c64u_mock_server on this host; without it only creation and resolution are measured. --legacy resolves the host and
+detects the local address on the loading thread before c64u_create(), as the plugin did before both moved to the
+retry thread, for comparison.
+*/
+
+#define _GNU_SOURCE // POSIX sockets and threads under -std=c17
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../src/c64u-core.h"
+#include "../src/c64u-resolve.h"
+#include "../src/c64u-source.h"
+#include "../src/c64u-types.h"
+#include "c64u_test_util.h"
+
+#define STARTUP_DEFAULT_SOURCES 4
+#define STARTUP_DEFAULT_DNS_PORT 10053
+#define STARTUP_DEFAULT_DNS_DELAY_MS 1500
+#define STARTUP_DEFAULT_TIMEOUT 30.0
+#define STARTUP_HOSTNAME "c64u-startup-%u.invalid" // Per source; never resolved by the system resolver (RFC 6761)
+#define STARTUP_CONNECT_TIMEOUT_S 1
+#define STARTUP_DNS_MAX_PENDING 64
+
+enum scenario {
+    SCENARIO_LITERAL,
+    SCENARIO_REACHABLE,
+    SCENARIO_SLOW,
+    SCENARIO_UNREACHABLE,
+    SCENARIO_COUNT,
+};
+
+static const char *scenario_names[SCENARIO_COUNT] = {"literal", "reachable", "slow", "unreachable"};
+
+struct startup_options {
+    uint32_t sources;
+    bool scenarios[SCENARIO_COUNT];
+    uint32_t dns_port;
+    uint32_t dns_delay_ms;
+    double timeout;
+    bool legacy;
+    const char *device; // Address the DNS server answers with and the literal scenario uses
+    double max_create_ms;
+    double max_first_frame_ms;
+    const char *json_path;
+    bool verbose;
+};
+
+// One C64U source as OBS holds it: its settings, the stub's obs_source_t and what c64u_create() returned
+struct source {
+    char hostname[64];
+    obs_data_t *settings;
+    obs_source_t *obs_source;
+    struct c64u_source *context;
+
+    // Measurements (ns); the resolution is taken from the plugin's log under measure_mutex
+    uint64_t create_start;
+    uint64_t create_ns;
+    uint64_t resolve_ns;
+    bool resolve_done;
+    bool resolve_failed;
+    bool device_missing; // The control connection was refused or timed out
+    uint64_t first_frame;
+};
+
+struct scenario_result {
+    enum scenario scenario;
+    double create_total_ms; // All sources, i.e. what OBS's loading thread spends
+    double create_max_ms;   // Slowest single source
+    double resolve_ms;      // Slowest resolution (-1 = none needed)
+    double first_frame_ms;  // Source 0, from the start of its creation (-1 = no frame)
+    bool resolve_failed;
+    bool device_missing;
+    bool timed_out;
+};
+
+static volatile bool running = true;
+static struct startup_options options;
+
+// Sources of the running scenario, for the log handler
+static pthread_mutex_t measure_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct source *scenario_sources;
+static uint32_t scenario_source_count;
+
+bool c64u_debug_logging = true; // Defined by plugin-main.c, which is not linked
+
+// Built-in DNS server: answers A queries for any name with the device address
+static int dns_socket = -1;
+static volatile enum scenario dns_mode = SCENARIO_REACHABLE;
+static volatile bool dns_running;
+static uint32_t dns_queries;
+
+static void signal_handler(int sig)
+{
+    (void)sig;
+    running = false;
+}
+
+static void core_log(int level, const char *format, va_list args)
+{
+    static const char *names[] = {"error", "warning", "info", "debug"};
+    if (!options.verbose) {
+        return;
+    }
+    printf("  [%s] ", names[level & 3]);
+    vprintf(format, args);
+    printf("\n");
+}
+
+// The plugin's log. resolve_pending_host() logs each lookup with the hostname and its duration; every source has
+// its own hostname, so the line tells which source it belongs to.
+static void plugin_log(int level, const char *message)
+{
+    if (options.verbose) {
+        printf("  [%s] %s\n", level <= LOG_ERROR ? "error" : level <= LOG_WARNING ? "warning" : "info", message);
+    }
+    bool resolved = strstr(message, "Resolved C64U host") != NULL;
+    bool failed = strstr(message, "Could not resolve hostname") != NULL;
+    if (!resolved && !failed) {
+        return;
+    }
+    double ms = 0;
+    const char *duration = strrchr(message, '(');
+    if (duration) {
+        sscanf(duration, "(%lf ms)", &ms);
+    }
+
+    pthread_mutex_lock(&measure_mutex);
+    for (uint32_t i = 0; i < scenario_source_count; i++) {
+        struct source *src = &scenario_sources[i];
+        char quoted[sizeof(src->hostname) + 2];
+        snprintf(quoted, sizeof(quoted), "'%s'", src->hostname);
+        if (!src->resolve_done && strstr(message, quoted)) {
+            src->resolve_done = true;
+            src->resolve_failed = failed;
+            src->resolve_ns = (uint64_t)(ms * 1e6);
+        }
+    }
+    pthread_mutex_unlock(&measure_mutex);
+}
+
+// DNS
+
+struct dns_pending {
+    uint8_t query[512];
+    ssize_t size;
+    struct sockaddr_in from;
+    uint64_t due;
+};
+
+// Build the answer to query into response; returns its size or 0 if the query cannot be parsed
+static size_t dns_answer(const uint8_t *query, size_t size, uint8_t *response, struct in_addr address)
+{
+    if (size < 12 || query[4] != 0 || query[5] != 1) {
+        return 0; // One question expected
+    }
+    size_t pos = 12;
+    while (pos < size && query[pos] != 0) {
+        pos += (size_t)query[pos] + 1;
+    }
+    if (pos + 5 > size) {
+        return 0;
+    }
+    size_t question_end = pos + 5; // Zero label, type, class
+    bool type_a = query[pos + 1] == 0 && query[pos + 2] == 1;
+
+    memcpy(response, query, question_end);
+    response[2] = (uint8_t)(0x84 | (query[2] & 0x01)); // Response, authoritative, recursion desired as asked
+    response[3] = 0x80;                                // Recursion available, no error
+    memset(response + 6, 0, 6);                        // Answers, authority, additional
+    if (!type_a) {
+        return question_end;
+    }
+    response[7] = 1;
+    static const uint8_t record[] = {0xC0, 0x0C, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3C, 0x00, 0x04};
+    memcpy(response + question_end, record, sizeof(record));
+    memcpy(response + question_end + sizeof(record), &address, 4);
+    return question_end + sizeof(record) + 4;
+}
+
+static void *dns_thread(void *data)
+{
+    (void)data;
+    static struct dns_pending pending[STARTUP_DNS_MAX_PENDING];
+    uint32_t count = 0;
+    struct in_addr address;
+    inet_pton(AF_INET, options.device, &address);
+
+    while (dns_running) {
+        struct dns_pending *slot = &pending[count < STARTUP_DNS_MAX_PENDING ? count : STARTUP_DNS_MAX_PENDING - 1];
+        socklen_t from_len = sizeof(slot->from);
+        slot->size = recvfrom(dns_socket, slot->query, sizeof(slot->query), 0, (struct sockaddr *)&slot->from,
+                              &from_len);
+        uint64_t now = c64u_test_now_ns();
+        if (slot->size > 0) {
+            __atomic_add_fetch(&dns_queries, 1, __ATOMIC_RELAXED);
+            if (dns_mode != SCENARIO_UNREACHABLE) {
+                uint32_t delay = dns_mode == SCENARIO_SLOW ? options.dns_delay_ms : 0;
+                slot->due = now + delay * 1000000ULL;
+                if (count < STARTUP_DNS_MAX_PENDING) {
+                    count++;
+                }
+            }
+        }
+
+        // Answer what is due, keep the rest in arrival order
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (pending[i].due <= now) {
+                uint8_t response[512 + 16];
+                size_t size = dns_answer(pending[i].query, (size_t)pending[i].size, response, address);
+                if (size > 0) {
+                    sendto(dns_socket, response, size, 0, (struct sockaddr *)&pending[i].from,
+                           sizeof(pending[i].from));
+                }
+            } else {
+                pending[kept++] = pending[i];
+            }
+        }
+        count = kept;
+    }
+    return NULL;
+}
+
+static bool start_dns_server(pthread_t *thread)
+{
+    dns_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)options.dns_port);
+    struct timeval timeout = {0, 5000}; // Answer slow queries within 5ms of their due time
+    if (dns_socket < 0 || bind(dns_socket, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        setsockopt(dns_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
+        fprintf(stderr, "Cannot run the DNS server on 127.0.0.1:%u: %s\n", options.dns_port, strerror(errno));
+        return false;
+    }
+    dns_running = true;
+    return pthread_create(thread, NULL, dns_thread, NULL) == 0;
+}
+
+// Sources
+
+// Ask the device to stop streaming, so that the next scenario starts cold (c64u_destroy() sends no commands)
+static void stop_device(void)
+{
+    for (uint8_t stream_id = 0; stream_id < 2; stream_id++) {
+        int sock = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(C64U_CONTROL_PORT);
+        struct timeval timeout = {STARTUP_CONNECT_TIMEOUT_S, 0}; // connect() honors the send timeout on Linux
+        uint8_t cmd[4] = {(uint8_t)(0x30 + stream_id), 0xFF, 0x00, 0x00};
+        if (sock < 0 || inet_pton(AF_INET, options.device, &addr.sin_addr) != 1 ||
+            setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) < 0 ||
+            connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+            send(sock, cmd, sizeof(cmd), 0) != (ssize_t)sizeof(cmd)) {
+            fprintf(stderr, "Could not stop stream %u of %s\n", stream_id, options.device);
+        }
+        if (sock >= 0) {
+            close(sock);
+        }
+    }
+}
+
+// What OBS does for each source of a scene collection: settings with the plugin's defaults, then c64u_create()
+static bool create_source(struct source *src, uint32_t index, enum scenario scenario)
+{
+    pthread_mutex_lock(&measure_mutex);
+    if (scenario == SCENARIO_LITERAL) {
+        snprintf(src->hostname, sizeof(src->hostname), "%s", options.device);
+        src->resolve_done = true; // Nothing to resolve
+    } else {
+        snprintf(src->hostname, sizeof(src->hostname), STARTUP_HOSTNAME, index);
+    }
+    scenario_source_count = index + 1; // Its retry thread may log the lookup before c64u_create() returns
+    pthread_mutex_unlock(&measure_mutex);
+    char dns_server[32];
+    snprintf(dns_server, sizeof(dns_server), "127.0.0.1:%u", options.dns_port);
+    char name[32];
+    snprintf(name, sizeof(name), "C64U %u", index);
+
+    src->settings = obs_data_create();
+    if (!src->settings) {
+        return false;
+    }
+    c64u_defaults(src->settings);
+    obs_data_set_string(src->settings, "c64u_host", src->hostname);
+    obs_data_set_string(src->settings, "dns_server_ip", dns_server);
+    obs_data_set_int(src->settings, "video_port", C64U_DEFAULT_VIDEO_PORT + index * 2);
+    obs_data_set_int(src->settings, "audio_port", C64U_DEFAULT_AUDIO_PORT + index * 2);
+    src->obs_source = obs_stub_source_create(name, src->settings);
+    if (!src->obs_source) {
+        return false;
+    }
+
+    src->create_start = c64u_test_now_ns();
+    if (options.legacy) {
+        // Before: the host was resolved and the local address detected right here, on the loading thread
+        char ip[64];
+        char obs_ip[64];
+        if (!c64u_is_ip_address(src->hostname)) {
+            uint64_t start = c64u_test_now_ns();
+            bool resolved = c64u_resolve_hostname_with_dns(src->hostname, dns_server, ip, sizeof(ip));
+            pthread_mutex_lock(&measure_mutex);
+            src->resolve_ns = c64u_test_now_ns() - start;
+            src->resolve_failed = !resolved;
+            src->resolve_done = true;
+            pthread_mutex_unlock(&measure_mutex);
+            if (resolved) {
+                obs_data_set_string(src->settings, "c64u_host", ip);
+            }
+        }
+        if (c64u_detect_local_ip(obs_ip, sizeof(obs_ip))) {
+            obs_data_set_string(src->settings, "obs_ip_address", obs_ip);
+        }
+    }
+    src->context = c64u_create(src->settings, src->obs_source);
+    src->create_ns = c64u_test_now_ns() - src->create_start;
+    return src->context != NULL;
+}
+
+static void destroy_source(struct source *src)
+{
+    if (src->context) {
+        c64u_destroy(src->context);
+    }
+    obs_stub_source_destroy(src->obs_source);
+    obs_data_release(src->settings);
+}
+
+// Poll what the plugin's threads did: the first frame in the front buffer, failed control connections
+static void update_source(struct source *src)
+{
+    struct c64u_source *context = src->context;
+    if (src->first_frame == 0) {
+        pthread_mutex_lock(&context->frame_mutex);
+        bool ready = context->frame_ready;
+        pthread_mutex_unlock(&context->frame_mutex);
+        if (ready) {
+            src->first_frame = c64u_test_now_ns();
+        }
+    }
+    pthread_mutex_lock(&context->retry_mutex);
+    src->device_missing |= context->consecutive_failures > 0;
+    pthread_mutex_unlock(&context->retry_mutex);
+}
+
+// Scenario: create all sources like a scene collection load, then wait for resolution and the first frame
+
+static bool scenario_done(struct source *sources)
+{
+    for (uint32_t i = 0; i < options.sources; i++) {
+        update_source(&sources[i]);
+        pthread_mutex_lock(&measure_mutex);
+        bool resolved = sources[i].resolve_done;
+        bool failed = sources[i].resolve_failed || sources[i].device_missing;
+        pthread_mutex_unlock(&measure_mutex);
+        if (!resolved || (i == 0 && !failed && sources[0].first_frame == 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool run_scenario(enum scenario scenario, struct scenario_result *result)
+{
+    struct source *sources = calloc(options.sources, sizeof(struct source));
+    if (!sources) {
+        return false;
+    }
+    dns_mode = scenario;
+    memset(result, 0, sizeof(struct scenario_result));
+    result->scenario = scenario;
+    pthread_mutex_lock(&measure_mutex);
+    scenario_sources = sources;
+    pthread_mutex_unlock(&measure_mutex);
+
+    uint64_t load_start = c64u_test_now_ns();
+    uint32_t created = 0;
+    for (uint32_t i = 0; i < options.sources; i++) {
+        bool ok = create_source(&sources[i], i, scenario);
+        if (ok) {
+            created++;
+        }
+        double ms = sources[i].create_ns / 1e6;
+        result->create_max_ms = ms > result->create_max_ms ? ms : result->create_max_ms;
+        if (!ok) {
+            fprintf(stderr, "Failed to create source %u\n", i);
+            destroy_source(&sources[i]);
+            break;
+        }
+    }
+    result->create_total_ms = (c64u_test_now_ns() - load_start) / 1e6;
+
+    uint64_t deadline = load_start + (uint64_t)(options.timeout * 1e9);
+    while (running && created == options.sources && !scenario_done(sources) && c64u_test_now_ns() < deadline) {
+        c64u_test_sleep_ns(1000000);
+    }
+    result->timed_out = running && c64u_test_now_ns() >= deadline;
+
+    result->resolve_ms = -1;
+    result->first_frame_ms = -1;
+    pthread_mutex_lock(&measure_mutex);
+    for (uint32_t i = 0; i < created; i++) {
+        if (sources[i].resolve_ns > 0 && sources[i].resolve_ns / 1e6 > result->resolve_ms) {
+            result->resolve_ms = sources[i].resolve_ns / 1e6;
+        }
+        result->resolve_failed |= sources[i].resolve_failed;
+    }
+    pthread_mutex_unlock(&measure_mutex);
+    if (created > 0) {
+        result->device_missing = sources[0].device_missing;
+        if (sources[0].first_frame > 0) {
+            result->first_frame_ms = (sources[0].first_frame - sources[0].create_start) / 1e6;
+        }
+    }
+    for (uint32_t i = 0; i < created; i++) {
+        destroy_source(&sources[i]);
+    }
+    pthread_mutex_lock(&measure_mutex);
+    scenario_sources = NULL;
+    scenario_source_count = 0;
+    pthread_mutex_unlock(&measure_mutex);
+    free(sources);
+
+    // Stop the device so the next scenario starts cold, then let the last datagrams drain
+    if (result->first_frame_ms >= 0) {
+        stop_device();
+        c64u_test_sleep_ns(100000000);
+    }
+    return created == options.sources;
+}
+
+static void print_result(const struct scenario_result *r)
+{
+    char resolve[32];
+    char first[48];
+    if (r->resolve_ms < 0) {
+        snprintf(resolve, sizeof(resolve), "-");
+    } else {
+        snprintf(resolve, sizeof(resolve), "%.1f%s", r->resolve_ms, r->resolve_failed ? " failed" : "");
+    }
+    if (r->first_frame_ms >= 0) {
+        snprintf(first, sizeof(first), "%.1f", r->first_frame_ms);
+    } else {
+        snprintf(first, sizeof(first), "%s", r->resolve_failed ? "- (no address)"
+                                             : r->device_missing ? "- (no device)"
+                                             : r->timed_out      ? "- (timeout)"
+                                                                 : "-");
+    }
+    printf("%-12s %11.2f %11.2f %16s %16s\n", scenario_names[r->scenario], r->create_total_ms, r->create_max_ms,
+           resolve, first);
+    fflush(stdout);
+}
+
+// Regression thresholds: creation must not depend on DNS; the first frame is checked where DNS answers at once
+static bool check_thresholds(const struct scenario_result *results, uint32_t count)
+{
+    bool ok = true;
+    for (uint32_t i = 0; i < count; i++) {
+        const struct scenario_result *r = &results[i];
+        const char *name = scenario_names[r->scenario];
+        if (options.max_create_ms > 0 && r->create_max_ms > options.max_create_ms) {
+            printf("FAIL: %s: creating a source took %.2f ms (limit %.2f ms)\n", name, r->create_max_ms,
+                   options.max_create_ms);
+            ok = false;
+        }
+        bool fast_dns = r->scenario == SCENARIO_LITERAL || r->scenario == SCENARIO_REACHABLE;
+        if (options.max_first_frame_ms > 0 && fast_dns && !r->device_missing &&
+            (r->first_frame_ms < 0 || r->first_frame_ms > options.max_first_frame_ms)) {
+            printf("FAIL: %s: first frame after %.1f ms (limit %.1f ms)\n", name, r->first_frame_ms,
+                   options.max_first_frame_ms);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+static bool write_json(const struct scenario_result *results, uint32_t count, const char *path)
+{
+    FILE *file = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return false;
+    }
+    fprintf(file, "{\n  \"benchmark\": \"c64u-startup\",\n  \"version\": 1,\n  \"timestamp\": %lld,\n",
+            (long long)time(NULL));
+    fprintf(file, "  \"sources\": %u,\n  \"legacy\": %s,\n  \"dns_delay_ms\": %u,\n  \"scenarios\": [\n",
+            options.sources, options.legacy ? "true" : "false", options.dns_delay_ms);
+    for (uint32_t i = 0; i < count; i++) {
+        const struct scenario_result *r = &results[i];
+        fprintf(file,
+                "    {\"name\": \"%s\", \"create_total_ms\": %.3f, \"create_max_ms\": %.3f, \"resolve_ms\": %.3f, "
+                "\"resolve_failed\": %s, \"first_frame_ms\": %.3f, \"device\": %s}%s\n",
+                scenario_names[r->scenario], r->create_total_ms, r->create_max_ms, r->resolve_ms,
+                r->resolve_failed ? "true" : "false", r->first_frame_ms, r->device_missing ? "false" : "true",
+                i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return file == stdout ? fflush(file) == 0 : fclose(file) == 0;
+}
+
+static bool parse_scenarios(const char *list)
+{
+    memset(options.scenarios, 0, sizeof(options.scenarios));
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "%s", list);
+    for (char *name = strtok(buffer, ","); name; name = strtok(NULL, ",")) {
+        bool found = false;
+        for (int s = 0; s < SCENARIO_COUNT; s++) {
+            if (strcmp(name, scenario_names[s]) == 0) {
+                options.scenarios[s] = true;
+                found = true;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void usage(const char *program)
+{
+    printf("Usage: %s [options]\n", program);
+    printf("Start c64u_mock_server on this host first to measure the time to the first frame.\n");
+    printf("  --sources N             Sources created per scenario, as in a scene collection (default %d)\n",
+           STARTUP_DEFAULT_SOURCES);
+    printf("  --scenarios LIST        Any of literal,reachable,slow,unreachable (default: all)\n");
+    printf("  --dns-delay MS          Answer delay of the slow DNS server (default %d)\n",
+           STARTUP_DEFAULT_DNS_DELAY_MS);
+    printf("  --dns-port P            Port of the built-in DNS server on 127.0.0.1 (default %d)\n",
+           STARTUP_DEFAULT_DNS_PORT);
+    printf("  --device IP             Device address (default 127.0.0.1)\n");
+    printf("  --legacy                Resolve and detect the local address before c64u_create(), as before\n");
+    printf("  --timeout S             Limit per scenario (default %.0f)\n", STARTUP_DEFAULT_TIMEOUT);
+    printf("  --max-create-ms X       Exit with 1 if creating a source takes longer than X ms\n");
+    printf("  --max-first-frame-ms X  Exit with 1 if the first frame (literal and reachable, with a device) takes\n");
+    printf("                          longer than X ms\n");
+    printf("  --json FILE             Also write the results as JSON (- for stdout)\n");
+    printf("  --verbose               Print the plugin's log\n");
+}
+
+int main(int argc, char *argv[])
+{
+    options = (struct startup_options){
+        .sources = STARTUP_DEFAULT_SOURCES,
+        .scenarios = {true, true, true, true},
+        .dns_port = STARTUP_DEFAULT_DNS_PORT,
+        .dns_delay_ms = STARTUP_DEFAULT_DNS_DELAY_MS,
+        .timeout = STARTUP_DEFAULT_TIMEOUT,
+        .device = "127.0.0.1",
+    };
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = true;
+        if (strcmp(argv[i], "--legacy") == 0) {
+            options.legacy = true;
+            continue;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            options.verbose = true;
+            continue;
+        } else if (strcmp(argv[i], "--sources") == 0 && value) {
+            options.sources = (uint32_t)atoi(value);
+            ok = options.sources > 0 && options.sources <= 64;
+        } else if (strcmp(argv[i], "--scenarios") == 0 && value) {
+            ok = parse_scenarios(value);
+        } else if (strcmp(argv[i], "--dns-delay") == 0 && value) {
+            options.dns_delay_ms = (uint32_t)atoi(value);
+        } else if (strcmp(argv[i], "--dns-port") == 0 && value) {
+            options.dns_port = (uint32_t)atoi(value);
+            ok = options.dns_port > 0 && options.dns_port < 65536;
+        } else if (strcmp(argv[i], "--device") == 0 && value) {
+            options.device = value;
+            ok = c64u_is_ip_address(value);
+        } else if (strcmp(argv[i], "--timeout") == 0 && value) {
+            options.timeout = atof(value);
+            ok = options.timeout > 0;
+        } else if (strcmp(argv[i], "--max-create-ms") == 0 && value) {
+            options.max_create_ms = atof(value);
+        } else if (strcmp(argv[i], "--max-first-frame-ms") == 0 && value) {
+            options.max_first_frame_ms = atof(value);
+        } else if (strcmp(argv[i], "--json") == 0 && value) {
+            options.json_path = value;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+        i++;
+    }
+
+    c64u_core_set_log_handler(core_log);
+    obs_stub_set_log_handler(plugin_log);
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    pthread_t dns;
+    if (!start_dns_server(&dns)) {
+        return 1;
+    }
+
+    printf("c64u-startup: %u sources per scenario, %s, DNS on 127.0.0.1:%u (slow: %u ms)\n\n", options.sources,
+           options.legacy ? "legacy startup (resolve first)" : "resolution on the retry thread", options.dns_port,
+           options.dns_delay_ms);
+    printf("%-12s %11s %11s %16s %16s\n", "scenario", "create ms", "max/source", "resolve ms", "first frame ms");
+
+    struct scenario_result results[SCENARIO_COUNT];
+    uint32_t count = 0;
+    bool ok = true;
+    for (int s = 0; s < SCENARIO_COUNT && running; s++) {
+        if (!options.scenarios[s]) {
+            continue;
+        }
+        ok &= run_scenario((enum scenario)s, &results[count]);
+        print_result(&results[count]);
+        count++;
+    }
+    printf("\nDNS queries answered or dropped: %u\n", dns_queries);
+
+    dns_running = false;
+    pthread_join(dns, NULL);
+    close(dns_socket);
+
+    ok &= check_thresholds(results, count);
+    if (options.json_path) {
+        ok &= write_json(results, count, options.json_path);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+/*
+C64U Test Source
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "c64u_test_source.h"
+#include "c64u_test_util.h"
+
+#define RETRY_WAIT_NS 100000000ULL // The retry thread's wait between checks
+#define STALL_NS 500000000ULL      // C64U_FRAME_TIMEOUT_NS: the retry thread would restart the stream
+
+// Core callbacks, as deliver_video_frame(), update_video_format() and deliver_audio_packet()
+static void on_frame(void *user, struct frame_assembly *frame, uint16_t seq_num, uint64_t time)
+{
+    struct c64u_test_source *source = user;
+    (void)frame;
+    (void)seq_num;
+    (void)time;
+    source->frames_completed++;
+}
+
+static void on_format(void *user, uint32_t height, double fps)
+{
+    struct c64u_test_source *source = user;
+    (void)fps;
+    source->height = height;
+}
+
+static void on_audio(void *user, const int16_t *samples, uint32_t count, uint16_t seq_num)
+{
+    struct c64u_test_source *source = user;
+    if (source->audio) {
+        source->audio(source->user, samples, count, seq_num);
+    }
+}
+
+// Frame output callbacks, as in c64u-video.c
+static bool lock_queue(void *user)
+{
+    struct c64u_test_source *source = user;
+    return pthread_mutex_lock(&source->delay_mutex) == 0;
+}
+
+static void unlock_queue(void *user)
+{
+    struct c64u_test_source *source = user;
+    pthread_mutex_unlock(&source->delay_mutex);
+}
+
+static bool lock_buffers(void *user)
+{
+    struct c64u_test_source *source = user;
+    return pthread_mutex_lock(&source->frame_mutex) == 0;
+}
+
+static void unlock_buffers(void *user)
+{
+    struct c64u_test_source *source = user;
+    pthread_mutex_unlock(&source->frame_mutex);
+}
+
+static void swapped(void *user, uint64_t time)
+{
+    struct c64u_test_source *source = user;
+    source->generation++;
+    source->pipeline_ns += c64u_test_now_ns() - time;
+}
+
+bool c64u_test_source_init(struct c64u_test_source *source, uint32_t delay)
+{
+    memset(source, 0, sizeof(struct c64u_test_source));
+    uint32_t *front = calloc((size_t)C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT, sizeof(uint32_t));
+    uint32_t *back = calloc((size_t)C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT, sizeof(uint32_t));
+    if (!front || !back) {
+        free(front);
+        free(back);
+        return false;
+    }
+
+    struct c64u_core_callbacks callbacks = {on_frame, on_format, on_audio, source};
+    c64u_core_init(&source->core, &callbacks);
+    struct c64u_frame_output_callbacks output_callbacks = {lock_queue,   unlock_queue, lock_buffers,
+                                                           unlock_buffers, swapped,    source};
+    c64u_frame_output_init(&source->output, &output_callbacks, front, back);
+    source->output.delay = delay;
+    source->core.output = &source->output;
+
+    pthread_mutex_init(&source->assembly_mutex, NULL);
+    pthread_mutex_init(&source->frame_mutex, NULL);
+    pthread_mutex_init(&source->delay_mutex, NULL);
+    pthread_mutex_init(&source->retry_mutex, NULL);
+    pthread_cond_init(&source->retry_cond, NULL);
+    source->last_udp_packet_time = c64u_test_now_ns();
+    source->height = C64U_PAL_HEIGHT;
+    source->poll_sleep = true;
+    source->running = true;
+    return true;
+}
+
+void c64u_test_source_free(struct c64u_test_source *source)
+{
+    pthread_mutex_destroy(&source->assembly_mutex);
+    pthread_mutex_destroy(&source->frame_mutex);
+    pthread_mutex_destroy(&source->delay_mutex);
+    pthread_mutex_destroy(&source->retry_mutex);
+    pthread_cond_destroy(&source->retry_cond);
+    c64u_frame_output_free(&source->output);
+    free(source->output.front);
+    free(source->output.back);
+}
+
+void c64u_test_source_receive(struct c64u_test_source *source, int sock, bool video)
+{
+    uint8_t packet[C64U_VIDEO_PACKET_SIZE];
+
+    while (source->running) {
+        ssize_t received = recv(sock, packet, sizeof(packet), 0);
+        if (received < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                if (source->poll_sleep && errno != EINTR) {
+                    c64u_test_sleep_ns(1000000);
+                }
+                continue;
+            }
+            break;
+        }
+
+        uint64_t receive_time = c64u_test_now_ns();
+        bool c64u_packet;
+        if (video) {
+            pthread_mutex_lock(&source->assembly_mutex);
+            c64u_packet = c64u_core_video_packet(&source->core, packet, (size_t)received, receive_time);
+            pthread_mutex_unlock(&source->assembly_mutex);
+        } else {
+            c64u_packet = c64u_core_audio_packet(&source->core, packet, (size_t)received);
+        }
+        if (c64u_packet) {
+            pthread_mutex_lock(&source->retry_mutex);
+            source->last_udp_packet_time = receive_time;
+            pthread_mutex_unlock(&source->retry_mutex);
+        }
+    }
+}
+
+void c64u_test_source_retry(struct c64u_test_source *source)
+{
+    pthread_mutex_lock(&source->retry_mutex);
+    while (source->running) {
+        if (c64u_test_now_ns() - source->last_udp_packet_time > STALL_NS) {
+            source->stalls++; // The plugin would send the start commands again here
+            source->last_udp_packet_time = c64u_test_now_ns();
+        }
+        struct timespec deadline;
+        timespec_get(&deadline, TIME_UTC); // pthread_cond_timedwait() takes wall clock time
+        uint64_t nsec = (uint64_t)deadline.tv_nsec + RETRY_WAIT_NS;
+        deadline.tv_sec += (time_t)(nsec / 1000000000ULL);
+        deadline.tv_nsec = (long)(nsec % 1000000000ULL);
+        pthread_cond_timedwait(&source->retry_cond, &source->retry_mutex, &deadline);
+    }
+    pthread_mutex_unlock(&source->retry_mutex);
+}
+
+void c64u_test_source_stop(struct c64u_test_source *source)
+{
+    pthread_mutex_lock(&source->retry_mutex);
+    source->running = false;
+    pthread_cond_signal(&source->retry_cond);
+    pthread_mutex_unlock(&source->retry_mutex);
+}
@@ -0,0 +1,65 @@
+/*
+C64U Test Source
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef C64U_TEST_SOURCE_H
+#define C64U_TEST_SOURCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "../src/c64u-core.h"
+
+// A C64U source as the plugin runs it, without OBS: c64u-core frame assembly delivering into the core's frame output
+// (render delay queue, front/back buffers) under the plugin's locks, the receive loop of video_thread_func() and
+// audio_thread_func() and the packet timer check of async_retry_thread(). The latency, A/V sync and scaling
+// benchmarks run their pipelines on it. POSIX only.
+struct c64u_test_source {
+    struct c64u_core core;
+    struct c64u_frame_output output;
+    pthread_mutex_t assembly_mutex; // Around c64u_core_video_packet(), as in process_video_packet()
+    pthread_mutex_t frame_mutex;    // Hold it while reading output.front
+    pthread_mutex_t delay_mutex;
+    uint32_t height;           // Current frame height
+    uint64_t generation;       // Bumped by every buffer swap (frame_mutex)
+    uint32_t frames_completed; // Frames the core completed
+    uint64_t pipeline_ns;      // Sum of the times from frame completion to swap (frame_mutex)
+    bool poll_sleep;           // Receive loop: sleep 1ms when the non-blocking socket is empty, as the plugin does
+    volatile bool running;
+
+    pthread_mutex_t retry_mutex;   // Guards the packet timer, as in the plugin
+    pthread_cond_t retry_cond;     // Wakes the retry loop on c64u_test_source_stop()
+    uint64_t last_udp_packet_time; // Set by the receive loop for every C64U packet
+    uint32_t stalls;               // Times the retry loop found the stream silent (retry_mutex)
+
+    // Optional hook, set after c64u_test_source_init(): the core's audio callback
+    void (*audio)(void *user, const int16_t *samples, uint32_t count, uint16_t seq_num);
+    void *user;
+};
+
+// Allocate the buffers and set up the core with the render delay. Returns false if out of memory.
+bool c64u_test_source_init(struct c64u_test_source *source, uint32_t delay);
+void c64u_test_source_free(struct c64u_test_source *source);
+
+// Feed video or audio datagrams from sock to the core until running is cleared or the socket fails
+void c64u_test_source_receive(struct c64u_test_source *source, int sock, bool video);
+
+// async_retry_thread() while the stream is healthy: check the packet timer every 100ms until
+// c64u_test_source_stop(). Counts a stall where the plugin would send the start commands again.
+void c64u_test_source_retry(struct c64u_test_source *source);
+
+// Clear running and wake the retry loop; the caller joins its threads
+void c64u_test_source_stop(struct c64u_test_source *source);
+
+#endif // C64U_TEST_SOURCE_H
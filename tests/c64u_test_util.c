@@ -0,0 +1,106 @@
+/*
+C64U Test Helpers
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L // clock_gettime(), nanosleep()
+#endif
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "c64u_test_util.h"
+#include "../src/c64u-protocol.h"
+
+uint64_t c64u_test_now_ns(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1000000000.0 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+void c64u_test_sleep_ns(uint64_t ns)
+{
+#ifdef _WIN32
+    Sleep((DWORD)((ns + 999999) / 1000000)); // Milliseconds, rounded up
+#else
+    struct timespec ts = {(time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL)};
+    nanosleep(&ts, NULL);
+#endif
+}
+
+void c64u_test_sleep_until(uint64_t deadline)
+{
+    uint64_t now = c64u_test_now_ns();
+    if (deadline > now) {
+        c64u_test_sleep_ns(deadline - now);
+    }
+}
+
+void c64u_test_put_u16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)(value & 0xFF);
+    p[1] = (uint8_t)(value >> 8);
+}
+
+void c64u_test_put_u64(uint8_t *p, uint64_t value)
+{
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(value >> (i * 8));
+    }
+}
+
+uint16_t c64u_test_read_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+void c64u_test_video_header(uint8_t *packet, uint16_t seq_num, uint16_t frame_num, uint32_t index, uint32_t height)
+{
+    uint16_t line = (uint16_t)(index * C64U_LINES_PER_PACKET);
+    bool last = (uint32_t)line + C64U_LINES_PER_PACKET >= height;
+
+    c64u_test_put_u16(packet + 0, seq_num);
+    c64u_test_put_u16(packet + 2, frame_num);
+    c64u_test_put_u16(packet + 4, (uint16_t)(line | (last ? 0x8000 : 0)));
+    c64u_test_put_u16(packet + 6, C64U_PIXELS_PER_LINE);
+    packet[8] = C64U_LINES_PER_PACKET;
+    packet[9] = 4;
+    c64u_test_put_u16(packet + 10, 0);
+}
+
+uint8_t c64u_test_pixel_byte(uint16_t frame_num, uint32_t line, uint32_t x)
+{
+    return (uint8_t)(frame_num * 7 + line * 3 + x);
+}
+
+void c64u_test_video_pixels(uint8_t *packet, uint16_t frame_num, uint32_t index)
+{
+    uint32_t line = index * C64U_LINES_PER_PACKET;
+    for (uint32_t l = 0; l < C64U_LINES_PER_PACKET; l++) {
+        for (uint32_t x = 0; x < C64U_BYTES_PER_LINE; x++) {
+            packet[C64U_VIDEO_HEADER_SIZE + l * C64U_BYTES_PER_LINE + x] = c64u_test_pixel_byte(frame_num, line + l, x);
+        }
+    }
+}
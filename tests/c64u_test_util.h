@@ -0,0 +1,44 @@
+/*
+C64U Test Helpers
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef C64U_TEST_UTIL_H
+#define C64U_TEST_UTIL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Timing and packet building shared by the tests, benchmarks and the mock server. Portable (POSIX and Windows).
+
+// Monotonic time in nanoseconds
+uint64_t c64u_test_now_ns(void);
+void c64u_test_sleep_ns(uint64_t ns);
+void c64u_test_sleep_until(uint64_t deadline);
+
+// Little endian fields, like the C64U protocol
+void c64u_test_put_u16(uint8_t *p, uint16_t value);
+void c64u_test_put_u64(uint8_t *p, uint64_t value);
+uint16_t c64u_test_read_u16(const uint8_t *p);
+
+// Header of video packet index (C64U_LINES_PER_PACKET lines from line index * C64U_LINES_PER_PACKET) of a frame
+// height lines high; the packet that reaches the height carries the last-packet flag
+void c64u_test_video_header(uint8_t *packet, uint16_t seq_num, uint16_t frame_num, uint32_t index, uint32_t height);
+
+// Fill the pixels of video packet index with bytes derived from frame and line, so every packet of every frame is
+// distinct; c64u_test_pixel_byte() tells what a byte should be
+void c64u_test_video_pixels(uint8_t *packet, uint16_t frame_num, uint32_t index);
+uint8_t c64u_test_pixel_byte(uint16_t frame_num, uint32_t line, uint32_t x);
+
+#endif // C64U_TEST_UTIL_H
@@ -0,0 +1,63 @@
+/*
+C64U OBS Stub - graphics (see ../obs-module.h)
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef OBS_STUB_GRAPHICS_H
+#define OBS_STUB_GRAPHICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct gs_texture gs_texture_t;
+typedef struct gs_effect gs_effect_t;
+typedef struct gs_effect_param gs_eparam_t;
+typedef struct gs_effect_technique gs_technique_t;
+
+struct vec4 {
+    float x, y, z, w;
+};
+
+enum gs_color_format {
+    GS_UNKNOWN,
+    GS_A8,
+    GS_R8,
+    GS_RGBA,
+    GS_BGRX,
+    GS_BGRA,
+};
+
+gs_texture_t *gs_texture_create(uint32_t width, uint32_t height, enum gs_color_format color_format, uint32_t levels,
+                                const uint8_t **data, uint32_t flags);
+gs_texture_t *gs_texture_create_from_file(const char *file);
+void gs_texture_destroy(gs_texture_t *tex);
+uint32_t gs_texture_get_width(const gs_texture_t *tex);
+uint32_t gs_texture_get_height(const gs_texture_t *tex);
+
+gs_technique_t *gs_effect_get_technique(const gs_effect_t *effect, const char *name);
+size_t gs_technique_begin(gs_technique_t *technique);
+void gs_technique_end(gs_technique_t *technique);
+bool gs_technique_begin_pass(gs_technique_t *technique, size_t pass);
+void gs_technique_end_pass(gs_technique_t *technique);
+gs_eparam_t *gs_effect_get_param_by_name(const gs_effect_t *effect, const char *name);
+void gs_effect_set_vec4(gs_eparam_t *param, const struct vec4 *val);
+void gs_effect_set_texture(gs_eparam_t *param, gs_texture_t *val);
+
+void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width, uint32_t height);
+void gs_matrix_push(void);
+void gs_matrix_pop(void);
+void gs_matrix_translate3f(float x, float y, float z);
+void gs_matrix_scale3f(float x, float y, float z);
+
+#endif // OBS_STUB_GRAPHICS_H
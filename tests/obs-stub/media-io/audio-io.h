@@ -0,0 +1,42 @@
+/*
+C64U OBS Stub - audio formats (see ../obs-module.h)
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef OBS_STUB_AUDIO_IO_H
+#define OBS_STUB_AUDIO_IO_H
+
+#include <stdint.h>
+
+enum audio_format {
+    AUDIO_FORMAT_UNKNOWN,
+    AUDIO_FORMAT_U8BIT,
+    AUDIO_FORMAT_16BIT,
+    AUDIO_FORMAT_32BIT,
+    AUDIO_FORMAT_FLOAT,
+};
+
+enum speaker_layout {
+    SPEAKERS_UNKNOWN,
+    SPEAKERS_MONO,
+    SPEAKERS_STEREO,
+};
+
+struct audio_output_info {
+    const char *name;
+    uint32_t samples_per_sec;
+    enum audio_format format;
+    enum speaker_layout speakers;
+};
+
+#endif // OBS_STUB_AUDIO_IO_H
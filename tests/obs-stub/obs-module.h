@@ -0,0 +1,199 @@
+/*
+C64U OBS Stub
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+The part of the libobs API the plugin's sources use, with libobs' signatures, so that tools can drive the real
+source (c64u_create(), its retry and receive threads) without OBS. Settings are a small key/value store; graphics,
+properties, hotkeys and procedures do nothing. Not a libobs replacement: only what the plugin calls is here.
+*/
+
+#ifndef OBS_STUB_OBS_MODULE_H
+#define OBS_STUB_OBS_MODULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "graphics/graphics.h"
+#include "media-io/audio-io.h"
+
+#define UNUSED_PARAMETER(param) (void)param
+
+#define LOG_ERROR 100
+#define LOG_WARNING 200
+#define LOG_INFO 300
+#define LOG_DEBUG 400
+
+#define MAX_AV_PLANES 8
+
+typedef struct obs_data obs_data_t;
+typedef struct obs_source obs_source_t;
+typedef struct obs_properties obs_properties_t;
+typedef struct obs_property obs_property_t;
+typedef struct obs_hotkey obs_hotkey_t;
+typedef struct calldata calldata_t;
+typedef struct proc_handler proc_handler_t;
+typedef size_t obs_hotkey_id;
+
+// Memory and logging
+void *bmalloc(size_t size);
+void *brealloc(void *ptr, size_t size);
+void bfree(void *ptr);
+static inline void *bzalloc(size_t size)
+{
+    void *mem = bmalloc(size);
+    if (mem) {
+        memset(mem, 0, size);
+    }
+    return mem;
+}
+
+void blog(int log_level, const char *format, ...);
+void blogva(int log_level, const char *format, va_list args);
+
+// Settings
+obs_data_t *obs_data_create(void);
+void obs_data_release(obs_data_t *data);
+const char *obs_data_get_string(obs_data_t *data, const char *name);
+long long obs_data_get_int(obs_data_t *data, const char *name);
+double obs_data_get_double(obs_data_t *data, const char *name);
+bool obs_data_get_bool(obs_data_t *data, const char *name);
+void obs_data_set_string(obs_data_t *data, const char *name, const char *val);
+void obs_data_set_int(obs_data_t *data, const char *name, long long val);
+void obs_data_set_double(obs_data_t *data, const char *name, double val);
+void obs_data_set_bool(obs_data_t *data, const char *name, bool val);
+void obs_data_set_default_string(obs_data_t *data, const char *name, const char *val);
+void obs_data_set_default_int(obs_data_t *data, const char *name, long long val);
+void obs_data_set_default_double(obs_data_t *data, const char *name, double val);
+void obs_data_set_default_bool(obs_data_t *data, const char *name, bool val);
+
+// Sources
+enum obs_source_type {
+    OBS_SOURCE_TYPE_INPUT,
+    OBS_SOURCE_TYPE_FILTER,
+    OBS_SOURCE_TYPE_TRANSITION,
+    OBS_SOURCE_TYPE_SCENE,
+};
+
+#define OBS_SOURCE_VIDEO (1 << 0)
+#define OBS_SOURCE_AUDIO (1 << 1)
+
+struct obs_source_audio {
+    const uint8_t *data[MAX_AV_PLANES];
+    uint32_t frames;
+    enum speaker_layout speakers;
+    enum audio_format format;
+    uint32_t samples_per_sec;
+    uint64_t timestamp;
+};
+
+const char *obs_source_get_name(const obs_source_t *source);
+obs_data_t *obs_source_get_settings(const obs_source_t *source);
+proc_handler_t *obs_source_get_proc_handler(const obs_source_t *source);
+void obs_source_output_audio(obs_source_t *source, const struct obs_source_audio *audio);
+
+// Procedures and hotkeys
+typedef void (*proc_handler_proc_t)(void *data, calldata_t *cd);
+void proc_handler_add(proc_handler_t *handler, const char *decl_string, proc_handler_proc_t proc, void *data);
+void calldata_set_int(calldata_t *data, const char *name, long long val);
+void calldata_set_bool(calldata_t *data, const char *name, bool val);
+void calldata_set_string(calldata_t *data, const char *name, const char *str);
+
+typedef void (*obs_hotkey_func)(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed);
+obs_hotkey_id obs_hotkey_register_source(obs_source_t *source, const char *name, const char *description,
+                                         obs_hotkey_func func, void *data);
+void obs_hotkey_unregister(obs_hotkey_id id);
+
+// Module
+const char *obs_module_text(const char *lookup_string);
+char *obs_module_file(const char *file);
+
+// Properties
+enum obs_text_type {
+    OBS_TEXT_DEFAULT,
+    OBS_TEXT_PASSWORD,
+    OBS_TEXT_MULTILINE,
+    OBS_TEXT_INFO,
+};
+
+enum obs_path_type {
+    OBS_PATH_FILE,
+    OBS_PATH_FILE_SAVE,
+    OBS_PATH_DIRECTORY,
+};
+
+enum obs_combo_type {
+    OBS_COMBO_TYPE_INVALID,
+    OBS_COMBO_TYPE_EDITABLE,
+    OBS_COMBO_TYPE_LIST,
+    OBS_COMBO_TYPE_RADIO,
+};
+
+enum obs_combo_format {
+    OBS_COMBO_FORMAT_INVALID,
+    OBS_COMBO_FORMAT_INT,
+    OBS_COMBO_FORMAT_FLOAT,
+    OBS_COMBO_FORMAT_STRING,
+    OBS_COMBO_FORMAT_BOOL,
+};
+
+enum obs_group_type {
+    OBS_COMBO_INVALID,
+    OBS_GROUP_NORMAL,
+    OBS_GROUP_CHECKABLE,
+};
+
+typedef bool (*obs_property_clicked_t)(obs_properties_t *props, obs_property_t *property, void *data);
+
+obs_properties_t *obs_properties_create(void);
+obs_property_t *obs_properties_add_bool(obs_properties_t *props, const char *name, const char *description);
+obs_property_t *obs_properties_add_int(obs_properties_t *props, const char *name, const char *description, int min,
+                                       int max, int step);
+obs_property_t *obs_properties_add_int_slider(obs_properties_t *props, const char *name, const char *description,
+                                              int min, int max, int step);
+obs_property_t *obs_properties_add_text(obs_properties_t *props, const char *name, const char *description,
+                                        enum obs_text_type type);
+obs_property_t *obs_properties_add_path(obs_properties_t *props, const char *name, const char *description,
+                                        enum obs_path_type type, const char *filter, const char *default_path);
+obs_property_t *obs_properties_add_list(obs_properties_t *props, const char *name, const char *description,
+                                        enum obs_combo_type type, enum obs_combo_format format);
+obs_property_t *obs_properties_add_button(obs_properties_t *props, const char *name, const char *text,
+                                          obs_property_clicked_t callback);
+obs_property_t *obs_properties_add_group(obs_properties_t *props, const char *name, const char *description,
+                                         enum obs_group_type type, obs_properties_t *group);
+obs_properties_t *obs_property_group_content(obs_property_t *p);
+void obs_property_set_long_description(obs_property_t *p, const char *long_description);
+size_t obs_property_list_add_int(obs_property_t *p, const char *name, long long val);
+size_t obs_property_list_add_float(obs_property_t *p, const char *name, double val);
+
+// Effects
+enum obs_base_effect {
+    OBS_EFFECT_DEFAULT,
+    OBS_EFFECT_DEFAULT_RECT,
+    OBS_EFFECT_OPAQUE,
+    OBS_EFFECT_SOLID,
+};
+
+gs_effect_t *obs_get_base_effect(enum obs_base_effect effect);
+
+// Stub only: what OBS does around a source. A source has a name and takes a reference to its settings. Without a
+// log handler, warnings and errors go to stderr.
+typedef void (*obs_stub_log_handler)(int log_level, const char *message);
+void obs_stub_set_log_handler(obs_stub_log_handler handler);
+obs_source_t *obs_stub_source_create(const char *name, obs_data_t *settings);
+void obs_stub_source_destroy(obs_source_t *source);
+
+#endif // OBS_STUB_OBS_MODULE_H
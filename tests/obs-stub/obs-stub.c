@@ -0,0 +1,635 @@
+/*
+C64U OBS Stub
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#define _GNU_SOURCE // POSIX clocks and mkdir() under -std=c17
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "obs-module.h"
+#include "util/platform.h"
+
+// One setting: its value if set and its default
+struct obs_data_value {
+    char *string;
+    long long integer;
+    double number;
+    bool boolean;
+};
+
+struct obs_data_item {
+    char *name;
+    bool has_value;
+    struct obs_data_value value;
+    struct obs_data_value default_value;
+    struct obs_data_item *next;
+};
+
+struct obs_data {
+    long refs;
+    struct obs_data_item *items;
+};
+
+struct obs_source {
+    char *name;
+    obs_data_t *settings;
+};
+
+// Settings are read and written by the loading thread and the sources' threads, as in OBS
+static pthread_mutex_t data_mutex = PTHREAD_MUTEX_INITIALIZER;
+static obs_stub_log_handler log_handler;
+
+// Memory and logging
+
+void *bmalloc(size_t size)
+{
+    return malloc(size ? size : 1);
+}
+
+void *brealloc(void *ptr, size_t size)
+{
+    return realloc(ptr, size ? size : 1);
+}
+
+void bfree(void *ptr)
+{
+    free(ptr);
+}
+
+void obs_stub_set_log_handler(obs_stub_log_handler handler)
+{
+    log_handler = handler;
+}
+
+void blogva(int log_level, const char *format, va_list args)
+{
+    char message[1024];
+    vsnprintf(message, sizeof(message), format, args);
+    if (log_handler) {
+        log_handler(log_level, message);
+    } else if (log_level <= LOG_WARNING) {
+        fprintf(stderr, "%s\n", message);
+    }
+}
+
+void blog(int log_level, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    blogva(log_level, format, args);
+    va_end(args);
+}
+
+// Settings
+
+obs_data_t *obs_data_create(void)
+{
+    obs_data_t *data = calloc(1, sizeof(obs_data_t));
+    if (data) {
+        data->refs = 1;
+    }
+    return data;
+}
+
+static void value_free(struct obs_data_value *value)
+{
+    free(value->string);
+    memset(value, 0, sizeof(struct obs_data_value));
+}
+
+void obs_data_release(obs_data_t *data)
+{
+    if (!data) {
+        return;
+    }
+    pthread_mutex_lock(&data_mutex);
+    bool last = --data->refs == 0;
+    pthread_mutex_unlock(&data_mutex);
+    if (!last) {
+        return;
+    }
+    while (data->items) {
+        struct obs_data_item *item = data->items;
+        data->items = item->next;
+        value_free(&item->value);
+        value_free(&item->default_value);
+        free(item->name);
+        free(item);
+    }
+    free(data);
+}
+
+// The item called name, created if create is set (data_mutex held)
+static struct obs_data_item *find_item(obs_data_t *data, const char *name, bool create)
+{
+    for (struct obs_data_item *item = data->items; item; item = item->next) {
+        if (strcmp(item->name, name) == 0) {
+            return item;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    struct obs_data_item *item = calloc(1, sizeof(struct obs_data_item));
+    if (item) {
+        item->name = strdup(name);
+        item->next = data->items;
+        data->items = item;
+    }
+    return item;
+}
+
+// The value of name, its default if unset, NULL if neither (data_mutex held)
+static const struct obs_data_value *get_value(obs_data_t *data, const char *name)
+{
+    struct obs_data_item *item = data ? find_item(data, name, false) : NULL;
+    if (!item) {
+        return NULL;
+    }
+    return item->has_value ? &item->value : &item->default_value;
+}
+
+static void set_value(obs_data_t *data, const char *name, bool is_default, const struct obs_data_value *value)
+{
+    if (!data || !name) {
+        return;
+    }
+    pthread_mutex_lock(&data_mutex);
+    struct obs_data_item *item = find_item(data, name, true);
+    if (item) {
+        struct obs_data_value *target = is_default ? &item->default_value : &item->value;
+        value_free(target);
+        *target = *value;
+        target->string = value->string ? strdup(value->string) : NULL;
+        item->has_value |= !is_default;
+    }
+    pthread_mutex_unlock(&data_mutex);
+}
+
+const char *obs_data_get_string(obs_data_t *data, const char *name)
+{
+    pthread_mutex_lock(&data_mutex);
+    const struct obs_data_value *value = get_value(data, name);
+    const char *string = value && value->string ? value->string : "";
+    pthread_mutex_unlock(&data_mutex);
+    return string;
+}
+
+long long obs_data_get_int(obs_data_t *data, const char *name)
+{
+    pthread_mutex_lock(&data_mutex);
+    const struct obs_data_value *value = get_value(data, name);
+    long long integer = value ? value->integer : 0;
+    pthread_mutex_unlock(&data_mutex);
+    return integer;
+}
+
+double obs_data_get_double(obs_data_t *data, const char *name)
+{
+    pthread_mutex_lock(&data_mutex);
+    const struct obs_data_value *value = get_value(data, name);
+    double number = value ? value->number : 0.0;
+    pthread_mutex_unlock(&data_mutex);
+    return number;
+}
+
+bool obs_data_get_bool(obs_data_t *data, const char *name)
+{
+    pthread_mutex_lock(&data_mutex);
+    const struct obs_data_value *value = get_value(data, name);
+    bool boolean = value ? value->boolean : false;
+    pthread_mutex_unlock(&data_mutex);
+    return boolean;
+}
+
+// Numbers are readable as integers and doubles alike, as in OBS
+void obs_data_set_string(obs_data_t *data, const char *name, const char *val)
+{
+    set_value(data, name, false, &(struct obs_data_value){.string = (char *)val});
+}
+
+void obs_data_set_int(obs_data_t *data, const char *name, long long val)
+{
+    set_value(data, name, false, &(struct obs_data_value){.integer = val, .number = (double)val});
+}
+
+void obs_data_set_double(obs_data_t *data, const char *name, double val)
+{
+    set_value(data, name, false, &(struct obs_data_value){.integer = (long long)val, .number = val});
+}
+
+void obs_data_set_bool(obs_data_t *data, const char *name, bool val)
+{
+    set_value(data, name, false, &(struct obs_data_value){.boolean = val});
+}
+
+void obs_data_set_default_string(obs_data_t *data, const char *name, const char *val)
+{
+    set_value(data, name, true, &(struct obs_data_value){.string = (char *)val});
+}
+
+void obs_data_set_default_int(obs_data_t *data, const char *name, long long val)
+{
+    set_value(data, name, true, &(struct obs_data_value){.integer = val, .number = (double)val});
+}
+
+void obs_data_set_default_double(obs_data_t *data, const char *name, double val)
+{
+    set_value(data, name, true, &(struct obs_data_value){.integer = (long long)val, .number = val});
+}
+
+void obs_data_set_default_bool(obs_data_t *data, const char *name, bool val)
+{
+    set_value(data, name, true, &(struct obs_data_value){.boolean = val});
+}
+
+// Sources
+
+obs_source_t *obs_stub_source_create(const char *name, obs_data_t *settings)
+{
+    obs_source_t *source = calloc(1, sizeof(obs_source_t));
+    if (!source) {
+        return NULL;
+    }
+    source->name = strdup(name);
+    source->settings = settings;
+    pthread_mutex_lock(&data_mutex);
+    settings->refs++;
+    pthread_mutex_unlock(&data_mutex);
+    return source;
+}
+
+void obs_stub_source_destroy(obs_source_t *source)
+{
+    if (source) {
+        obs_data_release(source->settings);
+        free(source->name);
+        free(source);
+    }
+}
+
+const char *obs_source_get_name(const obs_source_t *source)
+{
+    return source ? source->name : NULL;
+}
+
+obs_data_t *obs_source_get_settings(const obs_source_t *source)
+{
+    if (!source) {
+        return NULL;
+    }
+    pthread_mutex_lock(&data_mutex);
+    source->settings->refs++;
+    pthread_mutex_unlock(&data_mutex);
+    return source->settings;
+}
+
+proc_handler_t *obs_source_get_proc_handler(const obs_source_t *source)
+{
+    UNUSED_PARAMETER(source);
+    return NULL;
+}
+
+void obs_source_output_audio(obs_source_t *source, const struct obs_source_audio *audio)
+{
+    UNUSED_PARAMETER(source);
+    UNUSED_PARAMETER(audio);
+}
+
+// Procedures and hotkeys: never called back
+
+void proc_handler_add(proc_handler_t *handler, const char *decl_string, proc_handler_proc_t proc, void *data)
+{
+    UNUSED_PARAMETER(handler);
+    UNUSED_PARAMETER(decl_string);
+    UNUSED_PARAMETER(proc);
+    UNUSED_PARAMETER(data);
+}
+
+void calldata_set_int(calldata_t *data, const char *name, long long val)
+{
+    UNUSED_PARAMETER(data);
+    UNUSED_PARAMETER(name);
+    UNUSED_PARAMETER(val);
+}
+
+void calldata_set_bool(calldata_t *data, const char *name, bool val)
+{
+    UNUSED_PARAMETER(data);
+    UNUSED_PARAMETER(name);
+    UNUSED_PARAMETER(val);
+}
+
+void calldata_set_string(calldata_t *data, const char *name, const char *str)
+{
+    UNUSED_PARAMETER(data);
+    UNUSED_PARAMETER(name);
+    UNUSED_PARAMETER(str);
+}
+
+obs_hotkey_id obs_hotkey_register_source(obs_source_t *source, const char *name, const char *description,
+                                         obs_hotkey_func func, void *data)
+{
+    UNUSED_PARAMETER(source);
+    UNUSED_PARAMETER(name);
+    UNUSED_PARAMETER(description);
+    UNUSED_PARAMETER(func);
+    UNUSED_PARAMETER(data);
+    static obs_hotkey_id next_id;
+    return __atomic_add_fetch(&next_id, 1, __ATOMIC_RELAXED);
+}
+
+void obs_hotkey_unregister(obs_hotkey_id id)
+{
+    UNUSED_PARAMETER(id);
+}
+
+// Module: no locale and no data directory
+
+const char *obs_module_text(const char *lookup_string)
+{
+    return lookup_string;
+}
+
+char *obs_module_file(const char *file)
+{
+    UNUSED_PARAMETER(file);
+    return NULL;
+}
+
+// Properties: nothing is shown
+
+obs_properties_t *obs_properties_create(void)
+{
+    return NULL;
+}
+
+obs_property_t *obs_properties_add_bool(obs_properties_t *props, const char *name, const char *description)
+{
+    UNUSED_PARAMETER(props);
+    UNUSED_PARAMETER(name);
+    UNUSED_PARAMETER(description);
+    return NULL;
+}
+
+obs_property_t *obs_properties_add_int(obs_properties_t *props, const char *name, const char *description, int min,
+                                       int max, int step)
+{
+    UNUSED_PARAMETER(props);
+    UNUSED_PARAMETER(name);
+    UNUSED_PARAMETER(description);
+    UNUSED_PARAMETER(min);
+    UNUSED_PARAMETER(max);
+    UNUSED_PARAMETER(step);
+    return NULL;
+}
+
+obs_property_t *obs_properties_add_int_slider(obs_properties_t *props, const char *name, const char *description,
+                                              int min, int max, int step)
+{
+    return obs_properties_add_int(props, name, description, min, max, step);
+}
+
+obs_property_t *obs_properties_add_text(obs_properties_t *props, const char *name, const char *description,
+                                        enum obs_text_type type)
+{
+    UNUSED_PARAMETER(type);
+    return obs_properties_add_bool(props, name, description);
+}
+
+obs_property_t *obs_properties_add_path(obs_properties_t *props, const char *name, const char *description,
+                                        enum obs_path_type type, const char *filter, const char *default_path)
+{
+    UNUSED_PARAMETER(type);
+    UNUSED_PARAMETER(filter);
+    UNUSED_PARAMETER(default_path);
+    return obs_properties_add_bool(props, name, description);
+}
+
+obs_property_t *obs_properties_add_list(obs_properties_t *props, const char *name, const char *description,
+                                        enum obs_combo_type type, enum obs_combo_format format)
+{
+    UNUSED_PARAMETER(type);
+    UNUSED_PARAMETER(format);
+    return obs_properties_add_bool(props, name, description);
+}
+
+obs_property_t *obs_properties_add_button(obs_properties_t *props, const char *name, const char *text,
+                                          obs_property_clicked_t callback)
+{
+    UNUSED_PARAMETER(callback);
+    return obs_properties_add_bool(props, name, text);
+}
+
+obs_property_t *obs_properties_add_group(obs_properties_t *props, const char *name, const char *description,
+                                         enum obs_group_type type, obs_properties_t *group)
+{
+    UNUSED_PARAMETER(type);
+    UNUSED_PARAMETER(group);
+    return obs_properties_add_bool(props, name, description);
+}
+
+obs_properties_t *obs_property_group_content(obs_property_t *p)
+{
+    UNUSED_PARAMETER(p);
+    return NULL;
+}
+
+void obs_property_set_long_description(obs_property_t *p, const char *long_description)
+{
+    UNUSED_PARAMETER(p);
+    UNUSED_PARAMETER(long_description);
+}
+
+size_t obs_property_list_add_int(obs_property_t *p, const char *name, long long val)
+{
+    UNUSED_PARAMETER(p);
+    UNUSED_PARAMETER(name);
+    UNUSED_PARAMETER(val);
+    return 0;
+}
+
+size_t obs_property_list_add_float(obs_property_t *p, const char *name, double val)
+{
+    UNUSED_PARAMETER(p);
+    UNUSED_PARAMETER(name);
+    UNUSED_PARAMETER(val);
+    return 0;
+}
+
+// Graphics: no device, so nothing is created or drawn
+
+gs_effect_t *obs_get_base_effect(enum obs_base_effect effect)
+{
+    UNUSED_PARAMETER(effect);
+    return NULL;
+}
+
+gs_texture_t *gs_texture_create(uint32_t width, uint32_t height, enum gs_color_format color_format, uint32_t levels,
+                                const uint8_t **data, uint32_t flags)
+{
+    UNUSED_PARAMETER(width);
+    UNUSED_PARAMETER(height);
+    UNUSED_PARAMETER(color_format);
+    UNUSED_PARAMETER(levels);
+    UNUSED_PARAMETER(data);
+    UNUSED_PARAMETER(flags);
+    return NULL;
+}
+
+gs_texture_t *gs_texture_create_from_file(const char *file)
+{
+    UNUSED_PARAMETER(file);
+    return NULL;
+}
+
+void gs_texture_destroy(gs_texture_t *tex)
+{
+    UNUSED_PARAMETER(tex);
+}
+
+uint32_t gs_texture_get_width(const gs_texture_t *tex)
+{
+    UNUSED_PARAMETER(tex);
+    return 0;
+}
+
+uint32_t gs_texture_get_height(const gs_texture_t *tex)
+{
+    UNUSED_PARAMETER(tex);
+    return 0;
+}
+
+gs_technique_t *gs_effect_get_technique(const gs_effect_t *effect, const char *name)
+{
+    UNUSED_PARAMETER(effect);
+    UNUSED_PARAMETER(name);
+    return NULL;
+}
+
+size_t gs_technique_begin(gs_technique_t *technique)
+{
+    UNUSED_PARAMETER(technique);
+    return 0;
+}
+
+void gs_technique_end(gs_technique_t *technique)
+{
+    UNUSED_PARAMETER(technique);
+}
+
+bool gs_technique_begin_pass(gs_technique_t *technique, size_t pass)
+{
+    UNUSED_PARAMETER(technique);
+    UNUSED_PARAMETER(pass);
+    return false;
+}
+
+void gs_technique_end_pass(gs_technique_t *technique)
+{
+    UNUSED_PARAMETER(technique);
+}
+
+gs_eparam_t *gs_effect_get_param_by_name(const gs_effect_t *effect, const char *name)
+{
+    UNUSED_PARAMETER(effect);
+    UNUSED_PARAMETER(name);
+    return NULL;
+}
+
+void gs_effect_set_vec4(gs_eparam_t *param, const struct vec4 *val)
+{
+    UNUSED_PARAMETER(param);
+    UNUSED_PARAMETER(val);
+}
+
+void gs_effect_set_texture(gs_eparam_t *param, gs_texture_t *val)
+{
+    UNUSED_PARAMETER(param);
+    UNUSED_PARAMETER(val);
+}
+
+void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width, uint32_t height)
+{
+    UNUSED_PARAMETER(tex);
+    UNUSED_PARAMETER(flip);
+    UNUSED_PARAMETER(width);
+    UNUSED_PARAMETER(height);
+}
+
+void gs_matrix_push(void) {}
+
+void gs_matrix_pop(void) {}
+
+void gs_matrix_translate3f(float x, float y, float z)
+{
+    UNUSED_PARAMETER(x);
+    UNUSED_PARAMETER(y);
+    UNUSED_PARAMETER(z);
+}
+
+void gs_matrix_scale3f(float x, float y, float z)
+{
+    UNUSED_PARAMETER(x);
+    UNUSED_PARAMETER(y);
+    UNUSED_PARAMETER(z);
+}
+
+// Platform
+
+uint64_t os_gettime_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void os_sleep_ms(uint32_t duration)
+{
+    struct timespec ts = {(time_t)(duration / 1000), (long)(duration % 1000) * 1000000L};
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+bool os_sleepto_ns(uint64_t time_target)
+{
+    uint64_t now = os_gettime_ns();
+    if (time_target <= now) {
+        return false;
+    }
+    uint64_t wait = time_target - now;
+    struct timespec ts = {(time_t)(wait / 1000000000ULL), (long)(wait % 1000000000ULL)};
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+    return true;
+}
+
+int os_mkdir(const char *path)
+{
+    if (mkdir(path, 0755) == 0) {
+        return MKDIR_SUCCESS;
+    }
+    return errno == EEXIST ? MKDIR_EXISTS : MKDIR_ERROR;
+}
+
+int os_get_logical_cores(void)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+}
@@ -0,0 +1,32 @@
+/*
+C64U OBS Stub - platform helpers (see ../obs-module.h)
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef OBS_STUB_PLATFORM_H
+#define OBS_STUB_PLATFORM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MKDIR_EXISTS 1
+#define MKDIR_SUCCESS 0
+#define MKDIR_ERROR -1
+
+uint64_t os_gettime_ns(void);
+void os_sleep_ms(uint32_t duration);
+bool os_sleepto_ns(uint64_t time_target);
+int os_mkdir(const char *path);
+int os_get_logical_cores(void);
+
+#endif // OBS_STUB_PLATFORM_H
@@ -0,0 +1,21 @@
+/*
+C64U OBS Stub - threading (see ../obs-module.h)
+Copyright (C) 2025 Chris Gleissner
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifndef OBS_STUB_THREADING_H
+#define OBS_STUB_THREADING_H
+
+#include <pthread.h>
+
+#endif // OBS_STUB_THREADING_H
@@ -0,0 +1,453 @@
+/*
+Frame Assembly Simulation Tests
+Copyright (C) 2025 Chris Gleissner
+
+Scripted packet sequences through c64u_core_video_packet(), the frame assembler behind the plugin's video receive
+thread: in order, reordered within and across frames, duplicated, lost, truncated, PAL/NTSC switches and 16-bit
+frame and sequence number wraparound. A script is what the device sent, followed by what the network did to it;
+each script lists the frames it must deliver, and every delivered frame is checked line by line. Afterwards every
+script is replayed to report the assembler's throughput in packets/s (--packets N per script, 0 to skip).
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "../src/c64u-core.h"
+#include "c64u_test_util.h"
+
+#define MAX_STEPS 2048
+#define MAX_FRAMES 16
+#define PACKET_INTERVAL_NS 294000ULL // A PAL frame's 68 packets spread over 20ms
+#define DEFAULT_BENCH_PACKETS 1000000
+
+struct step {
+    uint16_t seq_num;
+    uint16_t frame_num;
+    uint16_t index;
+    uint16_t height;
+    uint16_t size; // Datagram size; anything but C64U_VIDEO_PACKET_SIZE is truncated
+};
+
+struct expected_frame {
+    uint16_t frame_num;
+    uint16_t height;
+};
+
+struct script {
+    const char *name;
+    struct step steps[MAX_STEPS];
+    uint32_t count;
+    uint16_t next_seq;
+    struct expected_frame expected[MAX_FRAMES];
+    uint32_t expected_count;
+    uint32_t frame_drops;  // Expected c64u_core_stats
+    uint32_t packet_drops; //
+    uint32_t rejected;     // Datagrams c64u_core_video_packet() refuses
+    uint32_t formats;      // Format callbacks
+};
+
+struct delivered {
+    struct expected_frame frames[MAX_FRAMES];
+    uint32_t count;
+    uint32_t formats;
+    bool verify; // Off while measuring throughput
+};
+
+static struct delivered out;
+static struct script script;
+static uint8_t indexed[C64U_PAL_HEIGHT * C64U_BYTES_PER_LINE];
+static uint32_t random_state = 0xC64C64u;
+
+static uint32_t next_random(void)
+{
+    // xorshift32: the same sequences on every run and platform
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static void make_packet(uint8_t *packet, const struct step *step)
+{
+    c64u_test_video_header(packet, step->seq_num, step->frame_num, step->index, step->height);
+    c64u_test_video_pixels(packet, step->frame_num, step->index);
+}
+
+static void on_frame(void *user, struct frame_assembly *frame, uint16_t seq_num, uint64_t time)
+{
+    struct delivered *d = user;
+    (void)seq_num;
+    (void)time;
+    uint16_t height = (uint16_t)(frame->expected_packets * C64U_LINES_PER_PACKET);
+    if (d->verify) {
+        assert(d->count < MAX_FRAMES);
+        c64u_core_frame_to_indexed(frame, indexed, height);
+        for (uint32_t line = 0; line < height; line++) {
+            for (uint32_t x = 0; x < C64U_BYTES_PER_LINE; x++) {
+                assert(indexed[line * C64U_BYTES_PER_LINE + x] == c64u_test_pixel_byte(frame->frame_num, line, x));
+            }
+        }
+    }
+    if (d->count < MAX_FRAMES) {
+        d->frames[d->count].frame_num = frame->frame_num;
+        d->frames[d->count].height = height;
+    }
+    d->count++;
+}
+
+static void on_format(void *user, uint32_t height, double fps)
+{
+    struct delivered *d = user;
+    (void)height;
+    (void)fps;
+    d->formats++;
+}
+
+// Script building: the device's send order first
+
+static void begin_script(const char *name, uint16_t first_seq)
+{
+    memset(&script, 0, sizeof(script));
+    script.name = name;
+    script.next_seq = first_seq;
+    script.formats = 1; // Scripts start with PAL frames
+}
+
+static void send_frame(uint16_t frame_num, uint16_t height)
+{
+    for (uint16_t i = 0; i < height / C64U_LINES_PER_PACKET; i++) {
+        assert(script.count < MAX_STEPS);
+        struct step *step = &script.steps[script.count++];
+        step->seq_num = script.next_seq++; // Wraps like the device's counter
+        step->frame_num = frame_num;
+        step->index = i;
+        step->height = height;
+        step->size = C64U_VIDEO_PACKET_SIZE;
+    }
+}
+
+static void expect_frame(uint16_t frame_num, uint16_t height)
+{
+    assert(script.expected_count < MAX_FRAMES);
+    script.expected[script.expected_count].frame_num = frame_num;
+    script.expected[script.expected_count].height = height;
+    script.expected_count++;
+}
+
+// Position of a frame's packet in the current arrival order
+static uint32_t find(uint16_t frame_num, uint16_t index)
+{
+    for (uint32_t i = 0; i < script.count; i++) {
+        if (script.steps[i].frame_num == frame_num && script.steps[i].index == index) {
+            return i;
+        }
+    }
+    assert(!"packet not in script");
+    return 0;
+}
+
+// Then what the network did to it
+
+static void shuffle_frame(uint16_t frame_num)
+{
+    uint32_t first = find(frame_num, 0);
+    uint32_t n = script.steps[first].height / C64U_LINES_PER_PACKET;
+    for (uint32_t i = n - 1; i > 0; i--) {
+        uint32_t j = next_random() % (i + 1);
+        struct step tmp = script.steps[first + i];
+        script.steps[first + i] = script.steps[first + j];
+        script.steps[first + j] = tmp;
+    }
+}
+
+// Let the packet arrive after the packet now at position to
+static void delay_packet(uint32_t from, uint32_t to)
+{
+    assert(from < to && to < script.count);
+    struct step moved = script.steps[from];
+    memmove(&script.steps[from], &script.steps[from + 1], (to - from) * sizeof(struct step));
+    script.steps[to] = moved;
+}
+
+// A second copy of the packet at from arrives after the packet now at position to
+static void duplicate_packet(uint32_t from, uint32_t to)
+{
+    assert(script.count < MAX_STEPS && from <= to && to < script.count);
+    struct step copy = script.steps[from];
+    memmove(&script.steps[to + 2], &script.steps[to + 1], (script.count - to - 1) * sizeof(struct step));
+    script.steps[to + 1] = copy;
+    script.count++;
+}
+
+static void lose_packet(uint32_t at)
+{
+    assert(at < script.count);
+    memmove(&script.steps[at], &script.steps[at + 1], (script.count - at - 1) * sizeof(struct step));
+    script.count--;
+}
+
+// Run the script against a fresh core and compare what it delivered
+
+static bool feed_step(struct c64u_core *core, const struct step *step, uint64_t time)
+{
+    uint8_t packet[C64U_VIDEO_PACKET_SIZE];
+    make_packet(packet, step);
+    return c64u_core_video_packet(core, packet, step->size, time);
+}
+
+static void run_script(void)
+{
+    printf("Testing %s (%u packets)...\n", script.name, script.count);
+    struct c64u_core core;
+    struct c64u_core_callbacks callbacks = {on_frame, on_format, NULL, &out};
+    memset(&out, 0, sizeof(out));
+    out.verify = true;
+    c64u_core_init(&core, &callbacks);
+
+    uint32_t rejected = 0;
+    uint32_t seq_gaps = 0;
+    bool have_seq = false;
+    uint16_t last_seq = 0;
+    for (uint32_t i = 0; i < script.count; i++) {
+        const struct step *step = &script.steps[i];
+        if (!feed_step(&core, step, i * PACKET_INTERVAL_NS)) {
+            rejected++;
+            continue;
+        }
+        seq_gaps += have_seq && step->seq_num != (uint16_t)(last_seq + 1);
+        last_seq = step->seq_num;
+        have_seq = true;
+    }
+
+    for (uint32_t i = 0; i < out.count && i < MAX_FRAMES; i++) {
+        printf("  delivered frame %u (%u lines)\n", out.frames[i].frame_num, out.frames[i].height);
+    }
+    assert(out.count == script.expected_count);
+    for (uint32_t i = 0; i < script.expected_count; i++) {
+        assert(out.frames[i].frame_num == script.expected[i].frame_num);
+        assert(out.frames[i].height == script.expected[i].height);
+    }
+    assert(out.formats == script.formats);
+    assert(rejected == script.rejected);
+    assert(core.stats.video_packets == script.count - rejected);
+    assert(core.stats.video_seq_gaps == seq_gaps); // Across the 16-bit wrap too
+    assert(core.stats.frames_complete == script.expected_count);
+    assert(core.stats.frame_drops == script.frame_drops);
+    assert(core.stats.packet_drops == script.packet_drops);
+    printf("%s PASSED\n\n", script.name);
+}
+
+// Scripts
+
+static void script_in_order(void)
+{
+    begin_script("in-order", 0);
+    for (uint16_t f = 1; f <= 5; f++) {
+        send_frame(f, C64U_PAL_HEIGHT);
+        expect_frame(f, C64U_PAL_HEIGHT);
+    }
+}
+
+// The device counts frames from 0, and 0 once was the assembler's "no frame completed yet"
+static void script_first_frame_zero(void)
+{
+    begin_script("first-frame-zero", 0);
+    for (uint16_t f = 0; f <= 3; f++) {
+        send_frame(f, C64U_PAL_HEIGHT);
+        expect_frame(f, C64U_PAL_HEIGHT);
+    }
+}
+
+static void script_reorder_within_frames(void)
+{
+    begin_script("reorder-within-frames", 100);
+    for (uint16_t f = 1; f <= 4; f++) {
+        send_frame(f, C64U_PAL_HEIGHT);
+        expect_frame(f, C64U_PAL_HEIGHT);
+    }
+    for (uint16_t f = 1; f <= 4; f++) {
+        shuffle_frame(f);
+    }
+}
+
+// A packet arriving after the next frame started loses its own frame, but must not cost the next one
+static void script_reorder_across_frames(void)
+{
+    begin_script("reorder-across-frames", 0);
+    for (uint16_t f = 1; f <= 5; f++) {
+        send_frame(f, C64U_PAL_HEIGHT);
+    }
+    delay_packet(find(2, C64U_MAX_PACKETS_PER_FRAME - 1), find(3, 2)); // Frame 2's last packet
+    delay_packet(find(4, 40), find(5, 0));                            // A middle packet of frame 4
+    expect_frame(1, C64U_PAL_HEIGHT);
+    expect_frame(3, C64U_PAL_HEIGHT);
+    expect_frame(5, C64U_PAL_HEIGHT);
+    script.frame_drops = 2;
+    script.packet_drops = 2; // The two late packets
+}
+
+static void script_duplicates(void)
+{
+    begin_script("duplicates", 0);
+    for (uint16_t f = 1; f <= 3; f++) {
+        send_frame(f, C64U_PAL_HEIGHT);
+        expect_frame(f, C64U_PAL_HEIGHT);
+    }
+    duplicate_packet(find(1, 10), find(1, 10));                            // Back to back
+    duplicate_packet(find(1, 20), find(1, 50));                            // Later within the frame
+    duplicate_packet(find(2, C64U_MAX_PACKETS_PER_FRAME - 1), find(3, 5)); // After the frame completed
+    script.packet_drops = 3;
+}
+
+static void script_loss(void)
+{
+    begin_script("loss", 0);
+    for (uint16_t f = 1; f <= 5; f++) {
+        send_frame(f, C64U_PAL_HEIGHT);
+    }
+    lose_packet(find(2, 5));
+    lose_packet(find(3, C64U_MAX_PACKETS_PER_FRAME - 1)); // The frame never learns its packet count
+    lose_packet(find(4, 0));
+    expect_frame(1, C64U_PAL_HEIGHT);
+    expect_frame(5, C64U_PAL_HEIGHT);
+    script.frame_drops = 3;
+}
+
+static void script_truncated(void)
+{
+    begin_script("truncated", 0);
+    for (uint16_t f = 1; f <= 3; f++) {
+        send_frame(f, C64U_PAL_HEIGHT);
+    }
+    script.steps[find(2, 7)].size = C64U_VIDEO_PACKET_SIZE - 100;
+    duplicate_packet(find(3, 3), find(3, 3));
+    script.steps[find(3, 3) + 1].size = C64U_VIDEO_HEADER_SIZE; // A header without pixels, besides the real one
+    duplicate_packet(find(3, 9), find(3, 9));
+    script.steps[find(3, 9) + 1].size = 0;
+    expect_frame(1, C64U_PAL_HEIGHT);
+    expect_frame(3, C64U_PAL_HEIGHT);
+    script.frame_drops = 1;
+    script.rejected = 3;
+}
+
+static void script_pal_ntsc_switch(void)
+{
+    begin_script("pal-ntsc-switch", 0);
+    send_frame(1, C64U_PAL_HEIGHT);
+    send_frame(2, C64U_NTSC_HEIGHT);
+    send_frame(3, C64U_NTSC_HEIGHT);
+    send_frame(4, C64U_PAL_HEIGHT);
+    send_frame(5, C64U_NTSC_HEIGHT);
+    shuffle_frame(4); // The height is known only once the last packet arrives
+    expect_frame(1, C64U_PAL_HEIGHT);
+    expect_frame(2, C64U_NTSC_HEIGHT);
+    expect_frame(3, C64U_NTSC_HEIGHT);
+    expect_frame(4, C64U_PAL_HEIGHT);
+    expect_frame(5, C64U_NTSC_HEIGHT);
+    script.formats = 4;
+}
+
+// Frame and sequence numbers wrap around within the script
+static void script_wraparound(void)
+{
+    begin_script("wraparound", 65500);
+    for (uint16_t f = 65533; f != 3; f++) {
+        send_frame(f, C64U_PAL_HEIGHT);
+        expect_frame(f, C64U_PAL_HEIGHT);
+    }
+}
+
+static void script_wraparound_impaired(void)
+{
+    begin_script("wraparound-impaired", 65530);
+    for (uint16_t f = 65534; f != 3; f++) {
+        send_frame(f, C64U_PAL_HEIGHT);
+    }
+    delay_packet(find(65535, 60), find(0, 1)); // Frame 65535 is dropped, its late packet too
+    lose_packet(find(1, 30));                  // Frame 1 is dropped
+    shuffle_frame(2);
+    expect_frame(65534, C64U_PAL_HEIGHT);
+    expect_frame(0, C64U_PAL_HEIGHT);
+    expect_frame(2, C64U_PAL_HEIGHT);
+    script.frame_drops = 2;
+    script.packet_drops = 1;
+}
+
+typedef void (*script_builder)(void);
+
+static const script_builder scripts[] = {
+    script_in_order,   script_first_frame_zero, script_reorder_within_frames, script_reorder_across_frames,
+    script_duplicates, script_loss,             script_truncated,             script_pal_ntsc_switch,
+    script_wraparound, script_wraparound_impaired,
+};
+
+// Throughput: replay a script against fresh cores until the packet count is reached
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void measure(script_builder build, uint32_t packets)
+{
+    build();
+    uint8_t *wire = malloc((size_t)script.count * C64U_VIDEO_PACKET_SIZE);
+    struct c64u_core *core = malloc(sizeof(struct c64u_core));
+    assert(wire && core);
+    for (uint32_t i = 0; i < script.count; i++) {
+        make_packet(wire + (size_t)i * C64U_VIDEO_PACKET_SIZE, &script.steps[i]);
+    }
+
+    struct c64u_core_callbacks callbacks = {on_frame, on_format, NULL, &out};
+    memset(&out, 0, sizeof(out));
+    uint32_t fed = 0;
+    double start = now_seconds();
+    while (fed < packets) {
+        c64u_core_init(core, &callbacks);
+        for (uint32_t i = 0; i < script.count; i++) {
+            c64u_core_video_packet(core, wire + (size_t)i * C64U_VIDEO_PACKET_SIZE, script.steps[i].size,
+                                   i * PACKET_INTERVAL_NS);
+        }
+        fed += script.count;
+    }
+    double seconds = now_seconds() - start;
+    printf("%-24s %12.0f packets/s %8.1f ns/packet %9.0f frames/s\n", script.name,
+           seconds > 0 ? fed / seconds : 0.0, seconds * 1e9 / fed, seconds > 0 ? out.count / seconds : 0.0);
+    free(core);
+    free(wire);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t packets = DEFAULT_BENCH_PACKETS;
+    if (argc == 3 && strcmp(argv[1], "--packets") == 0) {
+        packets = (uint32_t)strtoul(argv[2], NULL, 10);
+    } else if (argc != 1) {
+        printf("Usage: %s [--packets N]  (assembler throughput per script, 0 to skip)\n", argv[0]);
+        return 1;
+    }
+
+    printf("C64U Frame Assembly Simulation Tests\n");
+    printf("====================================\n\n");
+
+    for (size_t i = 0; i < sizeof(scripts) / sizeof(scripts[0]); i++) {
+        scripts[i]();
+        run_script();
+    }
+    printf("All frame assembly tests PASSED!\n");
+
+    if (packets > 0) {
+        printf("\nAssembler throughput, %u packets per script:\n", packets);
+        for (size_t i = 0; i < sizeof(scripts) / sizeof(scripts[0]); i++) {
+            measure(scripts[i], packets);
+        }
+    }
+    return 0;
+}
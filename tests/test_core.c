@@ -0,0 +1,652 @@
+/*
+Stream Core Tests
+Copyright (C) 2025 Chris Gleissner
+
+Packet parsing, frame assembly and format detection tests for the headless c64u-core library,
+fed with synthetic C64U datagrams.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "../src/c64u-core.h"
+#include "c64u_test_util.h"
+
+#define MS 1000000ULL
+#define PAL_BANDS (C64U_PAL_HEIGHT / C64U_LINES_PER_PACKET)
+
+struct delivered {
+    uint32_t frames;
+    uint16_t frame_num;
+    uint16_t seq_num;
+    uint8_t indexed[C64U_PAL_HEIGHT * C64U_BYTES_PER_LINE];
+    uint32_t formats;
+    uint32_t height;
+    double fps;
+    uint32_t audio_packets;
+    uint32_t audio_count;
+    int16_t first_sample;
+};
+
+static struct delivered out;
+static uint16_t video_seq;
+static uint16_t audio_seq;
+
+static void on_frame(void *user, struct frame_assembly *frame, uint16_t seq_num, uint64_t time)
+{
+    struct delivered *d = user;
+    (void)time;
+    d->frames++;
+    d->frame_num = frame->frame_num;
+    d->seq_num = seq_num;
+    c64u_core_frame_to_indexed(frame, d->indexed, C64U_PAL_HEIGHT);
+}
+
+static void on_format(void *user, uint32_t height, double fps)
+{
+    struct delivered *d = user;
+    d->formats++;
+    d->height = height;
+    d->fps = fps;
+}
+
+static void on_audio(void *user, const int16_t *samples, uint32_t count, uint16_t seq_num)
+{
+    struct delivered *d = user;
+    (void)seq_num;
+    assert(((uintptr_t)samples & 1) == 0);
+    d->audio_packets++;
+    d->audio_count = count;
+    memcpy(&d->first_sample, samples, sizeof(int16_t));
+}
+
+static void init_core(struct c64u_core *core)
+{
+    struct c64u_core_callbacks callbacks = {on_frame, on_format, on_audio, &out};
+    memset(&out, 0, sizeof(out));
+    c64u_core_init(core, &callbacks);
+    video_seq = 0;
+    audio_seq = 0;
+}
+
+static void make_video_packet(uint8_t *packet, uint16_t frame_num, uint32_t index, uint32_t height)
+{
+    c64u_test_video_header(packet, video_seq++, frame_num, index, height);
+    c64u_test_video_pixels(packet, frame_num, index);
+}
+
+static void feed(struct c64u_core *core, uint16_t frame_num, uint32_t index, uint32_t height, uint64_t time)
+{
+    uint8_t packet[C64U_VIDEO_PACKET_SIZE];
+    make_video_packet(packet, frame_num, index, height);
+    assert(c64u_core_video_packet(core, packet, sizeof(packet), time));
+}
+
+static void feed_frame(struct c64u_core *core, uint16_t frame_num, uint32_t height, uint64_t time)
+{
+    for (uint32_t i = 0; i < height / C64U_LINES_PER_PACKET; i++) {
+        feed(core, frame_num, i, height, time);
+    }
+}
+
+static void check_frame(uint16_t frame_num, uint32_t height)
+{
+    for (uint32_t line = 0; line < height; line++) {
+        for (uint32_t x = 0; x < C64U_BYTES_PER_LINE; x++) {
+            assert(out.indexed[line * C64U_BYTES_PER_LINE + x] == c64u_test_pixel_byte(frame_num, line, x));
+        }
+    }
+}
+
+static void test_in_order_frames(void)
+{
+    printf("Testing in-order PAL frames...\n");
+    struct c64u_core core;
+    init_core(&core);
+
+    for (uint16_t f = 1; f <= 3; f++) {
+        feed_frame(&core, f, C64U_PAL_HEIGHT, f * 20 * MS);
+        assert(out.frames == f);
+        assert(out.frame_num == f);
+        check_frame(f, C64U_PAL_HEIGHT);
+    }
+    assert(out.formats == 1);
+    assert(out.height == C64U_PAL_HEIGHT);
+    assert(out.fps == 50.125);
+    assert(core.stats.video_packets == 3 * C64U_MAX_PACKETS_PER_FRAME);
+    assert(core.stats.video_seq_gaps == 0);
+    assert(core.stats.frames_complete == 3);
+    assert(core.stats.frame_drops == 0 && core.stats.packet_drops == 0);
+
+    printf("In-order test PASSED\n\n");
+}
+
+static void test_reordered_and_duplicate(void)
+{
+    printf("Testing reordered and duplicated packets...\n");
+    struct c64u_core core;
+    init_core(&core);
+
+    // Last packet first: the expected packet count is known before the rest arrives
+    for (int i = C64U_MAX_PACKETS_PER_FRAME - 1; i >= 0; i--) {
+        feed(&core, 1, (uint32_t)i, C64U_PAL_HEIGHT, 0);
+        if (i == 10) {
+            feed(&core, 1, 10, C64U_PAL_HEIGHT, 0);
+        }
+    }
+    assert(out.frames == 1);
+    check_frame(1, C64U_PAL_HEIGHT);
+    assert(core.stats.packet_drops == 1);
+    assert(core.stats.video_seq_gaps == 0); // Sequence numbers were assigned in send order
+
+    printf("Reorder test PASSED\n\n");
+}
+
+static void test_loss_and_timeout(void)
+{
+    printf("Testing lost packets and frame timeout...\n");
+    struct c64u_core core;
+    init_core(&core);
+
+    // Frame 1 misses a packet: never delivered, dropped once frame 2 starts after the timeout
+    for (uint32_t i = 0; i < C64U_MAX_PACKETS_PER_FRAME; i++) {
+        if (i == 5) {
+            video_seq++;
+            continue;
+        }
+        feed(&core, 1, i, C64U_PAL_HEIGHT, 0);
+    }
+    assert(out.frames == 0);
+    assert(core.stats.video_seq_gaps == 1);
+
+    feed_frame(&core, 2, C64U_PAL_HEIGHT, (C64U_FRAME_TIMEOUT_MS + 1) * MS);
+    assert(core.stats.frame_drops == 1);
+    assert(out.frames == 1 && out.frame_num == 2);
+    check_frame(2, C64U_PAL_HEIGHT);
+
+    // The missing lines of an incomplete frame stay black in the indexed copy
+    struct frame_assembly *frame = malloc(sizeof(*frame));
+    memset(frame, 0, sizeof(*frame));
+    uint8_t packet[C64U_VIDEO_PACKET_SIZE];
+    make_video_packet(packet, 3, 1, C64U_PAL_HEIGHT);
+    frame->packets[1].line_num = 4;
+    frame->packets[1].lines_per_packet = 4;
+    frame->packets[1].received = true;
+    memcpy(frame->packets[1].packet_data, packet + C64U_VIDEO_HEADER_SIZE, sizeof(frame->packets[1].packet_data));
+    c64u_core_frame_to_indexed(frame, out.indexed, C64U_PAL_HEIGHT);
+    assert(out.indexed[0] == 0 && out.indexed[4 * C64U_BYTES_PER_LINE] == c64u_test_pixel_byte(3, 4, 0));
+    assert(out.indexed[8 * C64U_BYTES_PER_LINE] == 0);
+    free(frame);
+
+    printf("Loss test PASSED\n\n");
+}
+
+static void test_format_switch(void)
+{
+    printf("Testing PAL/NTSC detection...\n");
+    struct c64u_core core;
+    init_core(&core);
+    assert(core.expected_fps == 50.125 && !core.format_detected);
+
+    feed_frame(&core, 1, C64U_NTSC_HEIGHT, 0);
+    assert(out.formats == 1 && out.height == C64U_NTSC_HEIGHT && out.fps == 59.826);
+    assert(out.frames == 1);
+    check_frame(1, C64U_NTSC_HEIGHT);
+
+    feed_frame(&core, 2, C64U_NTSC_HEIGHT, 17 * MS);
+    assert(out.formats == 1);
+
+    feed_frame(&core, 3, C64U_PAL_HEIGHT, 34 * MS);
+    assert(out.formats == 2 && out.height == C64U_PAL_HEIGHT && out.fps == 50.125);
+    assert(core.detected_frame_height == C64U_PAL_HEIGHT);
+    assert(out.frames == 3);
+
+    printf("Format test PASSED\n\n");
+}
+
+static void test_invalid_packets(void)
+{
+    printf("Testing invalid datagrams...\n");
+    struct c64u_core core;
+    init_core(&core);
+
+    uint8_t packet[C64U_VIDEO_PACKET_SIZE];
+    make_video_packet(packet, 1, 0, C64U_PAL_HEIGHT);
+    assert(!c64u_core_video_packet(&core, packet, sizeof(packet) - 1, 0));
+    assert(core.stats.video_packets == 0);
+
+    packet[9] = 8; // Unsupported bits per pixel
+    assert(c64u_core_video_packet(&core, packet, sizeof(packet), 0));
+    assert(core.stats.invalid_packets == 1);
+    assert(core.current_frame.received_packets == 0);
+
+    // Line number beyond the largest frame
+    make_video_packet(packet, 1, C64U_MAX_PACKETS_PER_FRAME, 1000);
+    assert(c64u_core_video_packet(&core, packet, sizeof(packet), 0));
+    assert(core.stats.packet_drops == 1);
+
+    // A last packet beyond the largest frame, or reaching past it, must not set the frame height
+    uint32_t formats = out.formats;
+    make_video_packet(packet, 2, 0, C64U_PAL_HEIGHT);
+    c64u_test_put_u16(packet + 4, 0x7FFC | 0x8000);
+    assert(c64u_core_video_packet(&core, packet, sizeof(packet), 0));
+    c64u_test_put_u16(packet + 4, (C64U_PAL_HEIGHT - 2) | 0x8000);
+    assert(c64u_core_video_packet(&core, packet, sizeof(packet), 0));
+    assert(core.stats.packet_drops == 3 && core.current_frame.expected_packets == 0);
+    assert(out.formats == formats && !core.format_detected);
+
+    struct c64u_video_header header;
+    make_video_packet(packet, 0x1234, 67, C64U_PAL_HEIGHT);
+    assert(c64u_core_parse_video_header(packet, sizeof(packet), &header));
+    assert(header.frame_num == 0x1234 && header.line_num == 268 && header.last_packet);
+    assert(header.pixels_per_line == C64U_PIXELS_PER_LINE && header.lines_per_packet == 4);
+
+    printf("Invalid packet test PASSED\n\n");
+}
+
+static void test_rgba(void)
+{
+    printf("Testing RGBA and BGR24 conversion...\n");
+    uint8_t src[2] = {0x10, 0x3A};
+    uint32_t dst[4];
+    c64u_core_line_to_rgba(src, dst, 4);
+    assert(dst[0] == vic_colors[0] && dst[1] == vic_colors[1]);
+    assert(dst[2] == vic_colors[10] && dst[3] == vic_colors[3]);
+
+    uint8_t bgr[12];
+    c64u_core_line_to_bgr24(src, bgr, 4);
+    assert(bgr[3] == ((vic_colors[1] >> 16) & 0xFF) && bgr[4] == ((vic_colors[1] >> 8) & 0xFF));
+    assert(bgr[5] == (vic_colors[1] & 0xFF));
+    assert(bgr[6] == ((vic_colors[10] >> 16) & 0xFF) && bgr[8] == (vic_colors[10] & 0xFF));
+
+    printf("Conversion test PASSED\n\n");
+}
+
+static void test_delay_queue(void)
+{
+    printf("Testing render delay queue...\n");
+    struct c64u_delay_queue queue = {0};
+    assert(c64u_delay_queue_alloc(&queue, 4));
+
+    struct frame_assembly *frame = malloc(sizeof(*frame));
+    uint32_t *rgba = malloc((size_t)C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT * sizeof(uint32_t));
+    uint8_t packet[C64U_VIDEO_PACKET_SIZE];
+
+    // Frames 1..6 with only their first packet: the queue of 4 drops 1 and 2
+    for (uint16_t f = 1; f <= 6; f++) {
+        memset(frame, 0, sizeof(*frame));
+        make_video_packet(packet, f, 0, C64U_PAL_HEIGHT);
+        frame->packets[0].lines_per_packet = 4;
+        frame->packets[0].received = true;
+        memcpy(frame->packets[0].packet_data, packet + C64U_VIDEO_HEADER_SIZE, sizeof(frame->packets[0].packet_data));
+        c64u_delay_queue_push(&queue, frame, C64U_PAL_HEIGHT, f);
+        if (f == 2) {
+            assert(!c64u_delay_queue_pop(&queue, 3, rgba, C64U_PIXELS_PER_LINE)); // Delay not reached yet
+        }
+    }
+    assert(queue.size == 4);
+
+    for (uint16_t f = 3; f <= 4; f++) {
+        assert(c64u_delay_queue_pop(&queue, 3, rgba, (size_t)C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT));
+        uint8_t pair = c64u_test_pixel_byte(f, 0, 0);
+        assert(rgba[0] == vic_colors[pair & 0x0F] && rgba[1] == vic_colors[pair >> 4]);
+        assert(rgba[4 * C64U_PIXELS_PER_LINE] == 0); // Missing packet: cleared slot
+    }
+    assert(!c64u_delay_queue_pop(&queue, 3, rgba, C64U_PIXELS_PER_LINE));
+    assert(c64u_delay_queue_pop(&queue, 0, rgba, C64U_PIXELS_PER_LINE));
+
+    // Sized to the delay, as the plugin allocates it: a pop after every push releases each frame 3 frames later
+    assert(c64u_delay_queue_alloc(&queue, 3));
+    assert(c64u_delay_queue_bytes(3) ==
+           3 * ((size_t)C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT * sizeof(uint32_t) + sizeof(uint16_t)));
+    for (uint16_t f = 1; f <= 8; f++) {
+        memset(frame, 0, sizeof(*frame));
+        make_video_packet(packet, f, 0, C64U_PAL_HEIGHT);
+        frame->packets[0].lines_per_packet = 4;
+        frame->packets[0].received = true;
+        memcpy(frame->packets[0].packet_data, packet + C64U_VIDEO_HEADER_SIZE, sizeof(frame->packets[0].packet_data));
+        c64u_delay_queue_push(&queue, frame, C64U_PAL_HEIGHT, f);
+        bool popped = c64u_delay_queue_pop(&queue, 3, rgba, C64U_PIXELS_PER_LINE);
+        assert(popped == (f >= 3));
+        if (popped) {
+            uint8_t pair = c64u_test_pixel_byte((uint16_t)(f - 2), 0, 0);
+            assert(rgba[0] == vic_colors[pair & 0x0F] && rgba[1] == vic_colors[pair >> 4]);
+        }
+    }
+
+    c64u_delay_queue_free(&queue);
+    assert(queue.frames == NULL && queue.capacity == 0);
+    free(rgba);
+    free(frame);
+
+    printf("Delay queue test PASSED\n\n");
+}
+
+struct output_events {
+    uint32_t swaps;
+    uint64_t time;
+    uint32_t locks; // Lock callbacks taken and not yet released
+    bool refuse;    // Buffer lock fails
+};
+
+static bool output_lock(void *user)
+{
+    struct output_events *e = user;
+    if (e->refuse) {
+        return false;
+    }
+    e->locks++;
+    return true;
+}
+
+static void output_unlock(void *user)
+{
+    struct output_events *e = user;
+    assert(e->locks > 0);
+    e->locks--;
+}
+
+static bool output_lock_buffers(void *user)
+{
+    struct output_events *e = user;
+    assert(e->locks == 0 || e->locks == 1); // Inside the queue lock, if any
+    return output_lock(user);
+}
+
+static void output_swapped(void *user, uint64_t time)
+{
+    struct output_events *e = user;
+    assert(e->locks > 0); // Buffers locked
+    e->swaps++;
+    e->time = time;
+}
+
+// The top-left pixel pair of the front buffer is that of frame_num
+static void check_front(const struct c64u_frame_output *output, uint16_t frame_num)
+{
+    uint8_t pair = c64u_test_pixel_byte(frame_num, 0, 0);
+    assert(output->front[0] == vic_colors[pair & 0x0F] && output->front[1] == vic_colors[pair >> 4]);
+}
+
+static void test_frame_output(void)
+{
+    printf("Testing frame output...\n");
+    struct c64u_core core;
+    struct c64u_frame_output output;
+    struct output_events events = {0};
+    size_t pixels = (size_t)C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT;
+    uint32_t *front = calloc(pixels, sizeof(uint32_t));
+    uint32_t *back = calloc(pixels, sizeof(uint32_t));
+    struct c64u_frame_output_callbacks callbacks = {output_lock,   output_unlock, output_lock_buffers,
+                                                    output_unlock, output_swapped, &events};
+    init_core(&core);
+    c64u_frame_output_init(&output, &callbacks, front, back);
+    core.output = &output;
+
+    // No delay: every frame goes straight to the front, after the frame callback saw it
+    feed_frame(&core, 1, C64U_PAL_HEIGHT, 10 * MS);
+    assert(out.frames == 1 && events.swaps == 1 && events.time == 10 * MS && events.locks == 0);
+    assert(output.front == back && output.back == front && output.queue.frames == NULL);
+    check_front(&output, 1);
+
+    // A delay of 2: the queue is allocated for it on the next frame, which shows two frames later
+    output.delay = 2;
+    for (uint16_t f = 2; f <= 5; f++) {
+        feed_frame(&core, f, C64U_PAL_HEIGHT, f * 20 * MS);
+        assert(output.queue.capacity == 2 && events.locks == 0);
+        assert(events.swaps == (f >= 3 ? f - 1u : 1u));
+        check_front(&output, f >= 3 ? (uint16_t)(f - 1) : 1);
+    }
+    assert(events.time == 100 * MS); // The swap belongs to the frame that released it
+
+    // A queue for a smaller delay is full at its capacity; freed, it is reallocated for the new delay
+    output.delay = 3;
+    feed_frame(&core, 6, C64U_PAL_HEIGHT, 120 * MS);
+    assert(events.swaps == 5 && output.queue.capacity == 2);
+    check_front(&output, 5);
+    c64u_frame_output_free(&output);
+    feed_frame(&core, 7, C64U_PAL_HEIGHT, 140 * MS);
+    assert(events.swaps == 5 && output.queue.capacity == 3 && output.queue.size == 1);
+
+    // A refused lock skips the frame without swapping
+    output.delay = 0;
+    events.refuse = true;
+    feed_frame(&core, 8, C64U_PAL_HEIGHT, 160 * MS);
+    assert(events.swaps == 5 && out.frames == 8);
+    events.refuse = false;
+    feed_frame(&core, 9, C64U_PAL_HEIGHT, 180 * MS);
+    assert(events.swaps == 6);
+    check_front(&output, 9);
+
+    c64u_frame_output_free(&output);
+    free(front);
+    free(back);
+
+    printf("Frame output test PASSED\n\n");
+}
+
+static void test_audio(void)
+{
+    printf("Testing audio packets...\n");
+    struct c64u_core core;
+    init_core(&core);
+
+    uint8_t packet[C64U_AUDIO_PACKET_SIZE] = {0};
+    for (int i = 0; i < 3; i++) {
+        c64u_test_put_u16(packet, audio_seq);
+        audio_seq += i == 1 ? 2 : 1; // Lose the fourth packet
+        c64u_test_put_u16(packet + C64U_AUDIO_HEADER_SIZE, (uint16_t)(-100 - i));
+        assert(c64u_core_audio_packet(&core, packet, sizeof(packet)));
+    }
+    c64u_test_put_u16(packet, audio_seq);
+    assert(c64u_core_audio_packet(&core, packet, sizeof(packet)));
+    assert(!c64u_core_audio_packet(&core, packet, 100));
+
+    // Samples at an odd address reach the callback aligned
+    uint8_t unaligned[C64U_AUDIO_PACKET_SIZE + 1];
+    memcpy(unaligned + 1, packet, sizeof(packet));
+    c64u_test_put_u16(unaligned + 1, ++audio_seq);
+    assert(c64u_core_audio_packet(&core, unaligned + 1, sizeof(packet)));
+
+    // Parsing hands back the sample bytes in place
+    uint16_t seq_num;
+    const uint8_t *samples;
+    uint32_t count;
+    assert(c64u_core_parse_audio_packet(unaligned + 1, sizeof(packet), &seq_num, &samples, &count));
+    assert(seq_num == audio_seq && count == 192);
+    assert(samples == unaligned + 1 + C64U_AUDIO_HEADER_SIZE);
+    assert(c64u_test_read_u16(samples) == (uint16_t)-102);
+
+    assert(out.audio_packets == 5);
+    assert(out.audio_count == 192);
+    assert(out.first_sample == -102);
+    assert(core.stats.audio_packets == 5);
+    assert(core.stats.audio_seq_gaps == 1);
+
+    printf("Audio test PASSED\n\n");
+}
+
+static void test_latency_stamp(void)
+{
+    printf("Testing latency stamp and histogram...\n");
+    uint8_t lines[C64U_STAMP_LINES * C64U_BYTES_PER_LINE];
+    uint32_t rgba[C64U_STAMP_LINES * C64U_PIXELS_PER_LINE];
+    uint32_t counter;
+    uint64_t send_time;
+
+    memset(lines, 0x66, sizeof(lines)); // Blue border around the cells
+    c64u_stamp_encode(lines, 0xDEADBEEF, 0x0123456789ABCDEFULL);
+    for (uint32_t line = 0; line < C64U_STAMP_LINES; line++) {
+        c64u_core_line_to_rgba(lines + line * C64U_BYTES_PER_LINE, rgba + line * C64U_PIXELS_PER_LINE,
+                               C64U_PIXELS_PER_LINE);
+    }
+    assert(c64u_stamp_decode(rgba, &counter, &send_time));
+    assert(counter == 0xDEADBEEF && send_time == 0x0123456789ABCDEFULL);
+
+    // A damaged time line fails the check word, a plain border has no magic number
+    rgba[C64U_PIXELS_PER_LINE + C64U_STAMP_CELL_PIXELS / 2] ^= 0x00FFFFFF;
+    assert(!c64u_stamp_decode(rgba, &counter, &send_time));
+    memset(rgba, 0, sizeof(rgba));
+    assert(!c64u_stamp_decode(rgba, &counter, &send_time));
+
+    static struct c64u_latency latency;
+    c64u_latency_reset(&latency);
+    assert(c64u_latency_percentile(&latency, 50) == 0);
+    for (uint64_t ms = 1; ms <= 100; ms++) {
+        c64u_latency_add(&latency, ms * MS);
+    }
+    c64u_latency_add(&latency, 2000 * MS); // Beyond the last bucket
+    assert(latency.count == 101 && latency.min_ns == MS && latency.max_ns == 2000 * MS);
+    assert(c64u_latency_percentile(&latency, 50) >= 50 * MS && c64u_latency_percentile(&latency, 50) <= 52 * MS);
+    assert(c64u_latency_percentile(&latency, 99) >= 99 * MS && c64u_latency_percentile(&latency, 99) <= 101 * MS);
+    assert(c64u_latency_percentile(&latency, 100) == 2000 * MS);
+
+    printf("Latency stamp test PASSED\n\n");
+}
+
+// One PAL frame of continuity pattern bands, band b from frame counters[b]
+static void pattern_frame(uint32_t *rgba, const uint32_t *counters)
+{
+    static uint8_t lines[C64U_PAL_HEIGHT * C64U_BYTES_PER_LINE];
+    for (uint32_t band = 0; band < PAL_BANDS; band++) {
+        c64u_pattern_encode(lines + band * C64U_LINES_PER_PACKET * C64U_BYTES_PER_LINE, counters[band]);
+    }
+    for (uint32_t line = 0; line < C64U_PAL_HEIGHT; line++) {
+        c64u_core_line_to_rgba(lines + line * C64U_BYTES_PER_LINE, rgba + line * C64U_PIXELS_PER_LINE,
+                               C64U_PIXELS_PER_LINE);
+    }
+}
+
+static enum c64u_continuity_class check_counter(struct c64u_continuity *continuity, uint32_t *rgba, uint32_t counter)
+{
+    uint32_t counters[PAL_BANDS];
+    for (uint32_t band = 0; band < PAL_BANDS; band++) {
+        counters[band] = counter;
+    }
+    pattern_frame(rgba, counters);
+    return c64u_continuity_check(continuity, rgba, C64U_PAL_HEIGHT);
+}
+
+static void test_continuity(void)
+{
+    printf("Testing frame continuity verifier...\n");
+    uint32_t *rgba = malloc((size_t)C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT * sizeof(uint32_t));
+    uint32_t counters[PAL_BANDS];
+    struct c64u_continuity continuity;
+    c64u_continuity_reset(&continuity);
+    assert(c64u_continuity_score(&continuity) == 0.0);
+
+    assert(check_counter(&continuity, rgba, 0xFFFFFFFE) == C64U_CONTINUITY_IN_ORDER);
+    assert(check_counter(&continuity, rgba, 0xFFFFFFFF) == C64U_CONTINUITY_IN_ORDER);
+    assert(check_counter(&continuity, rgba, 0) == C64U_CONTINUITY_IN_ORDER); // Counter wraps
+    assert(check_counter(&continuity, rgba, 0) == C64U_CONTINUITY_REPEATED);
+    assert(check_counter(&continuity, rgba, 3) == C64U_CONTINUITY_SKIPPED);
+    assert(continuity.skipped_frames == 2);
+
+    // The top of frame 4 over stale lines of frame 3
+    for (uint32_t band = 0; band < PAL_BANDS; band++) {
+        counters[band] = band < 40 ? 4 : 3;
+    }
+    pattern_frame(rgba, counters);
+    assert(c64u_continuity_check(&continuity, rgba, C64U_PAL_HEIGHT) == C64U_CONTINUITY_TORN);
+
+    // Frame 5 with a cleared band, like a missing packet in the indexed copy
+    assert(check_counter(&continuity, rgba, 5) == C64U_CONTINUITY_IN_ORDER);
+    for (uint32_t band = 0; band < PAL_BANDS; band++) {
+        counters[band] = 6;
+    }
+    pattern_frame(rgba, counters);
+    memset(rgba + 10 * C64U_LINES_PER_PACKET * C64U_PIXELS_PER_LINE, 0,
+           C64U_LINES_PER_PACKET * C64U_PIXELS_PER_LINE * sizeof(uint32_t));
+    assert(c64u_continuity_check(&continuity, rgba, C64U_PAL_HEIGHT) == C64U_CONTINUITY_CONCEALED);
+
+    // A real C64U picture has no pattern and is not scored
+    memset(rgba, 0, (size_t)C64U_PIXELS_PER_LINE * C64U_PAL_HEIGHT * sizeof(uint32_t));
+    assert(c64u_continuity_check(&continuity, rgba, C64U_PAL_HEIGHT) == C64U_CONTINUITY_UNMARKED);
+
+    // 4 in order out of 8 delivered pattern frames plus 2 never delivered
+    assert(continuity.counts[C64U_CONTINUITY_IN_ORDER] == 4 && continuity.counts[C64U_CONTINUITY_UNMARKED] == 1);
+    assert(c64u_continuity_score(&continuity) == 40.0);
+    assert(strcmp(c64u_continuity_class_name(C64U_CONTINUITY_TORN), "torn") == 0);
+
+    free(rgba);
+    printf("Continuity test PASSED\n\n");
+}
+
+static void test_avsync(void)
+{
+    printf("Testing A/V sync marks...\n");
+    uint8_t lines[C64U_LINES_PER_PACKET * C64U_BYTES_PER_LINE];
+    uint32_t rgba[C64U_LINES_PER_PACKET * C64U_PIXELS_PER_LINE];
+    uint32_t mark;
+
+    memset(lines, 0x11, sizeof(lines)); // White flash
+    c64u_avsync_flash_encode(lines, 7);
+    for (uint32_t line = 0; line < C64U_LINES_PER_PACKET; line++) {
+        c64u_core_line_to_rgba(lines + line * C64U_BYTES_PER_LINE, rgba + line * C64U_PIXELS_PER_LINE,
+                               C64U_PIXELS_PER_LINE);
+    }
+    assert(c64u_avsync_flash_decode(rgba, &mark) && mark == 7);
+    memset(rgba, 0xFF, sizeof(rgba)); // A plain white frame is no flash frame
+    assert(!c64u_avsync_flash_decode(rgba, &mark));
+
+    // The click is found where it was put, also at the end of a packet, and not in loud audio
+    int16_t samples[192 * 2];
+    for (uint32_t i = 0; i < 192 * 2; i++) {
+        samples[i] = (int16_t)(i / 4 % 2 ? INT16_MIN : INT16_MAX); // Full scale square wave at 12kHz
+    }
+    assert(c64u_avsync_click_find(samples, 192) == -1);
+    memset(samples, 0, sizeof(samples));
+    c64u_avsync_click_encode(samples, 192, 100);
+    assert(c64u_avsync_click_find(samples, 192) == 100);
+    memset(samples, 0, sizeof(samples));
+    c64u_avsync_click_encode(samples, 192, 190);
+    assert(c64u_avsync_click_find(samples, 192) == 192 - C64U_AVSYNC_CLICK_SAMPLES);
+
+    // Audio 10ms late, then 1ms later per mark (one mark per second = 60ms/min of drift)
+    struct c64u_avsync avsync;
+    c64u_avsync_reset(&avsync);
+    for (uint64_t s = 0; s < 10; s++) {
+        uint64_t video = (s + 1) * 1000 * MS;
+        uint64_t audio = video + (10 + s) * MS;
+        assert(!c64u_avsync_video_mark(&avsync, video));
+        assert(c64u_avsync_audio_mark(&avsync, audio));
+    }
+    assert(avsync.count == 10 && avsync.unpaired == 0);
+    assert(c64u_avsync_mean_ms(&avsync) > 14.49 && c64u_avsync_mean_ms(&avsync) < 14.51);
+    assert(avsync.min_ms > 9.99 && avsync.max_ms < 19.01);
+    assert(c64u_avsync_drift_ms_per_min(&avsync) > 59.9 && c64u_avsync_drift_ms_per_min(&avsync) < 60.1);
+
+    // A click whose flash frame was dropped does not pair with the next flash
+    assert(!c64u_avsync_audio_mark(&avsync, 20000 * MS));
+    assert(!c64u_avsync_video_mark(&avsync, 21000 * MS));
+    assert(c64u_avsync_audio_mark(&avsync, 21000 * MS - 5 * MS));
+    assert(avsync.count == 11 && avsync.unpaired == 1 && avsync.last_ms < -4.99 && avsync.last_ms > -5.01);
+
+    printf("A/V sync test PASSED\n\n");
+}
+
+int main()
+{
+    printf("Running stream core tests...\n\n");
+
+    test_in_order_frames();
+    test_reordered_and_duplicate();
+    test_loss_and_timeout();
+    test_format_switch();
+    test_invalid_packets();
+    test_rgba();
+    test_delay_queue();
+    test_frame_output();
+    test_audio();
+    test_latency_stamp();
+    test_continuity();
+    test_avsync();
+
+    printf("All stream core tests PASSED!\n");
+    return 0;
+}
@@ -0,0 +1,305 @@
+/*
+FLAC Encoder Tests
+Copyright (C) 2025 Chris Gleissner
+
+Round-trip tests for the FLAC encoder used for recorded audio.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "../src/c64u-flac.h"
+
+#define SAMPLE_RATE 48000
+
+static int16_t samples[C64U_FLAC_BLOCK_SIZE * 2];
+static int32_t decoded[2][C64U_FLAC_BLOCK_SIZE];
+static uint8_t encoded[C64U_FLAC_MAX_FRAME_SIZE(C64U_FLAC_BLOCK_SIZE)];
+
+// MSB-first bit reader for the reference decoder
+struct bit_reader {
+    const uint8_t *data;
+    size_t size;
+    size_t pos; // In bits
+};
+
+static uint32_t get_bits(struct bit_reader *br, uint32_t count)
+{
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        assert(br->pos / 8 < br->size);
+        value = (value << 1) | ((br->data[br->pos / 8] >> (7 - br->pos % 8)) & 1);
+        br->pos++;
+    }
+    return value;
+}
+
+static int32_t get_signed(struct bit_reader *br, uint32_t count)
+{
+    uint32_t value = get_bits(br, count);
+    return (int32_t)(value << (32 - count)) >> (32 - count);
+}
+
+static uint16_t crc16(const uint8_t *data, size_t size)
+{
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= (uint16_t)(data[i] << 8);
+        for (int b = 0; b < 8; b++) {
+            crc = (uint16_t)((crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Reference subframe decoder (constant, verbatim and fixed predictor subframes, the subset the encoder uses)
+static void decode_subframe(struct bit_reader *br, int32_t *out, uint32_t count, uint32_t bps)
+{
+    assert(get_bits(br, 1) == 0);
+    uint32_t type = get_bits(br, 6);
+    assert(get_bits(br, 1) == 0); // No wasted bits
+
+    if (type == 0) {
+        int32_t value = get_signed(br, bps);
+        for (uint32_t i = 0; i < count; i++) {
+            out[i] = value;
+        }
+        return;
+    }
+    if (type == 1) {
+        for (uint32_t i = 0; i < count; i++) {
+            out[i] = get_signed(br, bps);
+        }
+        return;
+    }
+
+    assert(type >= 8 && type <= 12);
+    uint32_t order = type - 8;
+    for (uint32_t i = 0; i < order; i++) {
+        out[i] = get_signed(br, bps);
+    }
+
+    assert(get_bits(br, 2) == 0);
+    uint32_t partition_order = get_bits(br, 4);
+    uint32_t partition_size = count >> partition_order;
+    assert(partition_size << partition_order == count);
+    assert(partition_size > order);
+    uint32_t i = order;
+    for (uint32_t p = 0; p < (1u << partition_order); p++) {
+        uint32_t param = get_bits(br, 4);
+        assert(param != 15); // Escape code is not used
+        for (; i < (p + 1) * partition_size; i++) {
+            uint32_t quotient = 0;
+            while (get_bits(br, 1) == 0) {
+                quotient++;
+            }
+            uint32_t folded = (quotient << param) | get_bits(br, param);
+            int32_t residual = (folded & 1) ? -(int32_t)(folded >> 1) - 1 : (int32_t)(folded >> 1);
+
+            static const int32_t coefs[5][4] = {{0}, {1}, {2, -1}, {3, -3, 1}, {4, -6, 4, -1}};
+            int32_t prediction = 0;
+            for (uint32_t c = 0; c < order; c++) {
+                prediction += coefs[order][c] * out[i - 1 - c];
+            }
+            out[i] = prediction + residual;
+        }
+    }
+}
+
+// Decode one frame and check the header fields and CRC. Returns the number of bytes consumed.
+static size_t decode_frame(const uint8_t *data, size_t size, uint32_t expected_count, uint32_t expected_number)
+{
+    struct bit_reader br = {data, size, 0};
+    assert(get_bits(&br, 16) == 0xFFF8);
+    uint32_t block_size_code = get_bits(&br, 4);
+    assert(get_bits(&br, 4) == 10); // 48kHz
+    uint32_t channels = get_bits(&br, 4);
+    assert(get_bits(&br, 3) == 4); // 16 bits
+    assert(get_bits(&br, 1) == 0);
+
+    // UTF-8 coded frame number
+    uint32_t lead = get_bits(&br, 8);
+    uint32_t continuation = 0;
+    while (lead & (0x80 >> continuation)) {
+        continuation++;
+    }
+    uint32_t number = continuation == 0 ? lead : lead & (0x7F >> continuation);
+    for (uint32_t i = 1; i < continuation; i++) {
+        uint32_t next = get_bits(&br, 8);
+        assert((next & 0xC0) == 0x80);
+        number = (number << 6) | (next & 0x3F);
+    }
+    assert(number == expected_number);
+
+    uint32_t count = block_size_code == 12  ? 4096
+                     : block_size_code == 6 ? get_bits(&br, 8) + 1
+                                            : get_bits(&br, 16) + 1;
+    assert(block_size_code == 12 || block_size_code == 6 || block_size_code == 7);
+    assert(count == expected_count);
+    get_bits(&br, 8); // Header CRC-8
+
+    uint32_t bps0 = channels == 9 ? 17 : 16;
+    uint32_t bps1 = channels == 8 || channels == 10 ? 17 : 16;
+    decode_subframe(&br, decoded[0], count, bps0);
+    decode_subframe(&br, decoded[1], count, bps1);
+
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t a = decoded[0][i];
+        int32_t b = decoded[1][i];
+        switch (channels) {
+        case 1:
+            break;
+        case 8: // left, side
+            decoded[1][i] = a - b;
+            break;
+        case 9: // side, right
+            decoded[0][i] = a + b;
+            break;
+        case 10: { // mid, side
+            int32_t mid = (a * 2) | (b & 1);
+            decoded[0][i] = (mid + b) >> 1;
+            decoded[1][i] = (mid - b) >> 1;
+            break;
+        }
+        default:
+            assert(!"unexpected channel assignment");
+        }
+    }
+
+    br.pos = (br.pos + 7) / 8 * 8;
+    size_t crc_pos = br.pos / 8;
+    uint16_t crc = (uint16_t)get_bits(&br, 16);
+    assert(crc == crc16(data, crc_pos));
+    return br.pos / 8;
+}
+
+static size_t roundtrip(uint32_t count, uint32_t frame_number)
+{
+    size_t size = c64u_flac_encode_frame(encoded, samples, count, frame_number, SAMPLE_RATE);
+    assert(size <= C64U_FLAC_MAX_FRAME_SIZE(count));
+    assert(decode_frame(encoded, size, count, frame_number) == size);
+    for (uint32_t i = 0; i < count; i++) {
+        assert(decoded[0][i] == samples[i * 2]);
+        assert(decoded[1][i] == samples[i * 2 + 1]);
+    }
+    return size;
+}
+
+// SID-like content: a pulse wave on the left, a triangle with a little noise on the right
+static void make_tones(uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        samples[i * 2] = (i / 55) & 1 ? 8000 : -8000;
+        samples[i * 2 + 1] = (int16_t)(6000.0 * sin(i * 0.031) + (rand() % 64) - 32);
+    }
+}
+
+static void make_noise(uint32_t count)
+{
+    for (uint32_t i = 0; i < count * 2; i++) {
+        samples[i] = (int16_t)(rand() & 0xFFFF);
+    }
+}
+
+void test_frames(void)
+{
+    printf("Testing FLAC frames...\n");
+    size_t raw_size = (size_t)C64U_FLAC_BLOCK_SIZE * 4;
+    srand(1);
+
+    memset(samples, 0, sizeof(samples));
+    size_t size = roundtrip(C64U_FLAC_BLOCK_SIZE, 0);
+    printf("  Silence: %zu bytes (raw %zu)\n", size, raw_size);
+    assert(size < 32);
+
+    make_tones(C64U_FLAC_BLOCK_SIZE);
+    size = roundtrip(C64U_FLAC_BLOCK_SIZE, 1);
+    printf("  Tones: %zu bytes (raw %zu)\n", size, raw_size);
+    assert(size * 2 < raw_size);
+
+    // Same signal on both channels: side channel is constant
+    for (uint32_t i = 0; i < C64U_FLAC_BLOCK_SIZE; i++) {
+        samples[i * 2 + 1] = samples[i * 2 + 1] == -32768 ? 0 : samples[i * 2 + 1];
+        samples[i * 2] = samples[i * 2 + 1];
+    }
+    size = roundtrip(C64U_FLAC_BLOCK_SIZE, 2);
+    printf("  Mono: %zu bytes (raw %zu)\n", size, raw_size);
+
+    // Full scale noise falls back to verbatim subframes, including a 17-bit side channel
+    make_noise(C64U_FLAC_BLOCK_SIZE);
+    size = roundtrip(C64U_FLAC_BLOCK_SIZE, 3);
+    printf("  Noise: %zu bytes (raw %zu)\n", size, raw_size);
+    assert(size < raw_size + 64);
+
+    // Extremes exercise the widest residuals
+    for (uint32_t i = 0; i < C64U_FLAC_BLOCK_SIZE; i++) {
+        samples[i * 2] = (i & 1) ? 32767 : -32768;
+        samples[i * 2 + 1] = (i & 1) ? -32768 : 32767;
+    }
+    roundtrip(C64U_FLAC_BLOCK_SIZE, 4);
+
+    printf("FLAC frame test PASSED\n\n");
+}
+
+void test_last_frames(void)
+{
+    printf("Testing short last frames and frame numbers...\n");
+
+    // Short blocks use 8-bit and 16-bit block sizes and smaller (or no) partitions
+    static const uint32_t counts[] = {1, 2, 5, 16, 100, 256, 257, 1000, 4095};
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        make_tones(counts[i]);
+        roundtrip(counts[i], 5);
+    }
+
+    // Multi-byte frame numbers (about 97 days of audio at the largest one)
+    static const uint32_t numbers[] = {0x7F, 0x80, 0x7FF, 0x800, 0xFFFF, 0x10000, 0x1FFFFF, 0x200000, 1000000};
+    make_tones(C64U_FLAC_BLOCK_SIZE);
+    for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++) {
+        roundtrip(C64U_FLAC_BLOCK_SIZE, numbers[i]);
+    }
+
+    printf("Short frame test PASSED\n\n");
+}
+
+void test_header(void)
+{
+    printf("Testing STREAMINFO header...\n");
+    uint8_t header[C64U_FLAC_HEADER_SIZE];
+    c64u_flac_write_header(header, SAMPLE_RATE, 14, 16400, 0x123456789ull);
+
+    struct bit_reader br = {header, sizeof(header), 0};
+    assert(get_bits(&br, 32) == 0x664C6143); // "fLaC"
+    assert(get_bits(&br, 1) == 1);            // Last metadata block
+    assert(get_bits(&br, 7) == 0);            // STREAMINFO
+    assert(get_bits(&br, 24) == 34);
+    assert(get_bits(&br, 16) == C64U_FLAC_BLOCK_SIZE);
+    assert(get_bits(&br, 16) == C64U_FLAC_BLOCK_SIZE);
+    assert(get_bits(&br, 24) == 14);
+    assert(get_bits(&br, 24) == 16400);
+    assert(get_bits(&br, 20) == SAMPLE_RATE);
+    assert(get_bits(&br, 3) == 1);
+    assert(get_bits(&br, 5) == 15);
+    assert(get_bits(&br, 4) == 0x1);
+    assert(get_bits(&br, 32) == 0x23456789);
+    assert(br.pos + 128 == sizeof(header) * 8); // MD5 follows
+
+    printf("STREAMINFO test PASSED\n\n");
+}
+
+int main()
+{
+    printf("Running FLAC encoder tests...\n\n");
+
+    test_header();
+    test_frames();
+    test_last_frames();
+
+    printf("All FLAC tests PASSED!\n");
+    return 0;
+}
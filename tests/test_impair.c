@@ -0,0 +1,309 @@
+/*
+Network Impairment Tests
+Copyright (C) 2025 Chris Gleissner
+
+Loss, burst loss, reordering, duplication, jitter, rate limiting and seed determinism of the mock server's
+impairment engine, driven with a simulated clock.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "c64u_impair.h"
+
+#define MS 1000000ULL
+#define MAX_PACKETS 20000
+#define PACKET_SIZE 64
+
+struct delivery {
+    uint32_t count;
+    uint32_t index[MAX_PACKETS * 2];
+    uint64_t time[MAX_PACKETS * 2];
+};
+
+static struct delivery out;
+
+static void drain_until(struct impair *im, uint64_t until)
+{
+    uint8_t packet[IMPAIR_MAX_PACKET];
+    uint64_t due;
+
+    while ((due = impair_next_due(im)) <= until) {
+        size_t size = impair_poll(im, due, packet);
+        assert(size == PACKET_SIZE);
+        memcpy(&out.index[out.count], packet, sizeof(uint32_t));
+        out.time[out.count] = due;
+        out.count++;
+    }
+}
+
+// Submit packets numbered 0..count-1 every interval ns and collect everything that comes out
+static void run(const struct impair_config *config, uint64_t seed, uint32_t count, uint64_t interval,
+                struct impair_stats *stats)
+{
+    struct impair im;
+    uint8_t packet[PACKET_SIZE] = {0};
+
+    assert(impair_init(&im, config, seed));
+    memset(&out, 0, sizeof(out));
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t now = i * interval;
+        drain_until(&im, now);
+        memcpy(packet, &i, sizeof(i));
+        impair_submit(&im, packet, sizeof(packet), now);
+        drain_until(&im, now);
+    }
+    impair_flush(&im, count * interval);
+    drain_until(&im, UINT64_MAX - 1);
+    assert(im.count == 0);
+
+    *stats = im.stats;
+    impair_free(&im);
+}
+
+static void test_passthrough(void)
+{
+    printf("Testing passthrough...\n");
+    struct impair_config config;
+    struct impair_stats stats;
+    impair_config_defaults(&config);
+    assert(!impair_config_active(&config));
+
+    run(&config, 1, 1000, MS, &stats);
+    assert(out.count == 1000 && stats.sent == 1000);
+    for (uint32_t i = 0; i < out.count; i++) {
+        assert(out.index[i] == i);
+        assert(out.time[i] == i * MS);
+    }
+
+    printf("Passthrough test PASSED\n\n");
+}
+
+static void test_random_loss(void)
+{
+    printf("Testing random loss...\n");
+    struct impair_config config;
+    struct impair_stats stats;
+    impair_config_defaults(&config);
+    assert(impair_config_set(&config, "loss", "0.1"));
+
+    run(&config, 1, MAX_PACKETS, MS, &stats);
+    assert(stats.lost_random > MAX_PACKETS * 0.08 && stats.lost_random < MAX_PACKETS * 0.12);
+    assert(stats.lost_burst == 0 && stats.bursts == 0);
+    assert(out.count == MAX_PACKETS - stats.lost_random);
+    for (uint32_t i = 1; i < out.count; i++) {
+        assert(out.index[i] > out.index[i - 1]);
+    }
+
+    printf("Random loss test PASSED\n\n");
+}
+
+static void test_burst_loss(void)
+{
+    printf("Testing Gilbert-Elliott burst loss...\n");
+    struct impair_config config;
+    struct impair_stats stats;
+    impair_config_defaults(&config);
+    assert(impair_config_set(&config, "burst-enter", "0.01"));
+    assert(impair_config_set(&config, "burst-exit", "0.25"));
+
+    run(&config, 1, MAX_PACKETS, MS, &stats);
+    assert(stats.bursts > 100 && stats.lost_random == 0);
+
+    // Losses come in runs: mean burst length 1 / burst-exit = 4 packets
+    uint32_t runs = 0;
+    uint32_t lost = 0;
+    uint32_t expected = 0;
+    for (uint32_t i = 0; i < out.count; i++) {
+        if (out.index[i] != expected) {
+            runs++;
+            lost += out.index[i] - expected;
+        }
+        expected = out.index[i] + 1;
+    }
+    if (expected < MAX_PACKETS) {
+        runs++;
+        lost += MAX_PACKETS - expected;
+    }
+    assert(lost == stats.lost_burst);
+    double mean_run = (double)lost / runs;
+    printf("  %u bursts, mean length %.2f packets\n", runs, mean_run);
+    assert(mean_run > 3.0 && mean_run < 5.0);
+
+    printf("Burst loss test PASSED\n\n");
+}
+
+static void test_reorder(void)
+{
+    printf("Testing bounded reordering...\n");
+    struct impair_config config;
+    struct impair_stats stats;
+    impair_config_defaults(&config);
+    assert(impair_config_set(&config, "reorder", "0.1"));
+    assert(impair_config_set(&config, "reorder-depth", "3"));
+    assert(!impair_config_set(&config, "reorder-depth", "0"));
+    assert(!impair_config_set(&config, "reorder-depth", "17"));
+
+    run(&config, 1, MAX_PACKETS, MS, &stats);
+    assert(stats.reordered > MAX_PACKETS * 0.08);
+    assert(out.count == MAX_PACKETS);
+
+    // Every packet arrives exactly once, overtaken by at most the later packets that passed while it was held
+    // (depth) and later packets that were held after it but released first (depth again)
+    static bool seen[MAX_PACKETS];
+    memset(seen, 0, sizeof(seen));
+    uint32_t max_overtaken = 0;
+    for (uint32_t i = 0; i < out.count; i++) {
+        assert(!seen[out.index[i]]);
+        seen[out.index[i]] = true;
+        uint32_t overtaken = i > out.index[i] ? i - out.index[i] : 0;
+        if (overtaken > max_overtaken) {
+            max_overtaken = overtaken;
+        }
+    }
+    printf("  %llu reordered, largest displacement %u\n", (unsigned long long)stats.reordered, max_overtaken);
+    assert(max_overtaken >= 1 && max_overtaken <= 2 * config.reorder_depth);
+
+    printf("Reorder test PASSED\n\n");
+}
+
+static void test_duplicate(void)
+{
+    printf("Testing duplication...\n");
+    struct impair_config config;
+    struct impair_stats stats;
+    impair_config_defaults(&config);
+    assert(impair_config_set(&config, "duplicate", "0.05"));
+
+    run(&config, 1, MAX_PACKETS, MS, &stats);
+    assert(stats.duplicated > MAX_PACKETS * 0.04 && stats.duplicated < MAX_PACKETS * 0.06);
+    assert(out.count == MAX_PACKETS + stats.duplicated);
+    for (uint32_t i = 1; i < out.count; i++) {
+        assert(out.index[i] == out.index[i - 1] || out.index[i] == out.index[i - 1] + 1);
+    }
+
+    printf("Duplicate test PASSED\n\n");
+}
+
+static void test_jitter(void)
+{
+    printf("Testing delay and jitter...\n");
+    const char *dists[] = {"uniform", "normal", "exponential"};
+
+    for (int d = 0; d < 3; d++) {
+        struct impair_config config;
+        struct impair_stats stats;
+        impair_config_defaults(&config);
+        assert(impair_config_set(&config, "delay", "20"));
+        assert(impair_config_set(&config, "jitter", "10"));
+        assert(impair_config_set(&config, "jitter-dist", dists[d]));
+
+        run(&config, 1, 5000, MS, &stats);
+        assert(out.count == 5000);
+
+        // Jitter delays, but never reorders
+        uint64_t total_delay = 0;
+        for (uint32_t i = 0; i < out.count; i++) {
+            assert(out.index[i] == i);
+            assert(out.time[i] >= i * MS + 20 * MS);
+            assert(i == 0 || out.time[i] >= out.time[i - 1]);
+            total_delay += out.time[i] - i * MS;
+        }
+        printf("  %s: mean delay %.2f ms\n", dists[d], (double)total_delay / out.count / MS);
+    }
+    struct impair_config config;
+    impair_config_defaults(&config);
+    assert(!impair_config_set(&config, "jitter-dist", "pareto"));
+
+    printf("Jitter test PASSED\n\n");
+}
+
+static void test_rate_limit(void)
+{
+    printf("Testing token bucket and aggregation...\n");
+    struct impair_config config;
+    struct impair_stats stats;
+    impair_config_defaults(&config);
+    assert(impair_config_set(&config, "rate", "1000"));
+    assert(impair_config_set(&config, "bucket", "5"));
+
+    // 100 packets at once: a burst of 5, then one per millisecond
+    run(&config, 1, 100, 0, &stats);
+    assert(out.count == 100);
+    for (uint32_t i = 0; i < out.count; i++) {
+        assert(out.index[i] == i);
+        uint64_t expected = i < 5 ? 0 : (i - 4) * MS;
+        assert(out.time[i] >= expected && out.time[i] <= expected + 1000);
+    }
+
+    // Aggregation releases packets only on 5 ms boundaries
+    impair_config_defaults(&config);
+    assert(impair_config_set(&config, "aggregate", "5"));
+    run(&config, 1, 1000, MS, &stats);
+    assert(out.count == 1000);
+    for (uint32_t i = 0; i < out.count; i++) {
+        assert(out.time[i] % (5 * MS) == 0);
+        assert(out.time[i] >= out.index[i] * MS && out.time[i] < out.index[i] * MS + 5 * MS);
+    }
+
+    // Tail drop beyond the queue limit
+    impair_config_defaults(&config);
+    assert(impair_config_set(&config, "delay", "100"));
+    assert(impair_config_set(&config, "queue", "10"));
+    run(&config, 1, 20, 0, &stats);
+    assert(out.count == 10 && stats.queue_dropped == 10);
+
+    printf("Rate limit test PASSED\n\n");
+}
+
+static void test_determinism(void)
+{
+    printf("Testing seed determinism...\n");
+    struct impair_config config;
+    struct impair_stats stats;
+    impair_config_defaults(&config);
+    assert(impair_config_set(&config, "loss", "0.02"));
+    assert(impair_config_set(&config, "burst-enter", "0.005"));
+    assert(impair_config_set(&config, "reorder", "0.05"));
+    assert(impair_config_set(&config, "duplicate", "0.01"));
+    assert(impair_config_set(&config, "jitter", "3"));
+    assert(impair_config_set(&config, "jitter-dist", "exponential"));
+    assert(!impair_config_set(&config, "loss", "1.5"));
+    assert(!impair_config_set(&config, "bogus", "1"));
+
+    static struct delivery first;
+    run(&config, 42, 5000, MS, &stats);
+    first = out;
+
+    run(&config, 42, 5000, MS, &stats);
+    assert(out.count == first.count);
+    assert(memcmp(out.index, first.index, out.count * sizeof(uint32_t)) == 0);
+    assert(memcmp(out.time, first.time, out.count * sizeof(uint64_t)) == 0);
+
+    run(&config, 43, 5000, MS, &stats);
+    assert(out.count != first.count || memcmp(out.index, first.index, out.count * sizeof(uint32_t)) != 0);
+
+    printf("Determinism test PASSED\n\n");
+}
+
+int main()
+{
+    printf("Running network impairment tests...\n\n");
+
+    test_passthrough();
+    test_random_loss();
+    test_burst_loss();
+    test_reorder();
+    test_duplicate();
+    test_jitter();
+    test_rate_limit();
+    test_determinism();
+
+    printf("All network impairment tests PASSED!\n");
+    return 0;
+}
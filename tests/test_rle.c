@@ -0,0 +1,199 @@
+/*
+RLE Encoder Tests
+Copyright (C) 2025 Chris Gleissner
+
+Round-trip tests for the BI_RLE8/BI_RLE4 frame encoder used by the AVI recorder.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "../src/c64u-rle.h"
+
+#define WIDTH 384
+#define HEIGHT 272
+#define BYTES_PER_LINE (WIDTH / 2)
+
+static uint8_t frame_a[BYTES_PER_LINE * HEIGHT];
+static uint8_t frame_b[BYTES_PER_LINE * HEIGHT];
+static uint8_t encoded[C64U_RLE_MAX_FRAME_SIZE(WIDTH, HEIGHT)];
+static uint8_t decoded[WIDTH * HEIGHT]; // One byte per pixel, top line first
+
+static uint8_t get_pixel(const uint8_t *frame, uint32_t x, uint32_t y)
+{
+    return (frame[y * BYTES_PER_LINE + x / 2] >> ((x & 1) * 4)) & 0x0F;
+}
+
+static void set_pixel(uint8_t *frame, uint32_t x, uint32_t y, uint8_t color)
+{
+    uint8_t *p = &frame[y * BYTES_PER_LINE + x / 2];
+    if (x & 1) {
+        *p = (uint8_t)((*p & 0x0F) | (color << 4));
+    } else {
+        *p = (uint8_t)((*p & 0xF0) | color);
+    }
+}
+
+// Reference decoder following the Microsoft RLE bitmap specification. Pixels that are not
+// written (delta frames) keep their previous value in the decoded buffer.
+static void decode_rle(const uint8_t *data, size_t size, uint16_t bit_count)
+{
+    size_t i = 0;
+    uint32_t x = 0;
+    uint32_t row = 0; // Bitmap row, 0 = bottom line
+
+    while (i + 1 < size) {
+        uint8_t count = data[i++];
+        uint8_t value = data[i++];
+
+        if (count > 0) {
+            for (uint32_t n = 0; n < count; n++) {
+                uint8_t color = bit_count == 4 ? ((n & 1) ? (value & 0x0F) : (value >> 4)) : value;
+                assert(x < WIDTH && row < HEIGHT);
+                decoded[(HEIGHT - 1 - row) * WIDTH + x++] = color;
+            }
+        } else if (value == 0) {
+            x = 0;
+            row++;
+        } else if (value == 1) {
+            assert(i == size); // End of bitmap must be the last code
+            return;
+        } else if (value == 2) {
+            x += data[i++];
+            row += data[i++];
+        } else {
+            uint32_t bytes = bit_count == 4 ? (value + 1u) / 2 : value;
+            for (uint32_t n = 0; n < value; n++) {
+                uint8_t color = bit_count == 4 ? ((n & 1) ? (data[i + n / 2] & 0x0F) : (data[i + n / 2] >> 4))
+                                               : data[i + n];
+                assert(x < WIDTH && row < HEIGHT);
+                decoded[(HEIGHT - 1 - row) * WIDTH + x++] = color;
+            }
+            i += bytes + (bytes & 1);
+        }
+    }
+    assert(!"missing end of bitmap");
+}
+
+static void assert_decoded_equals(const uint8_t *frame)
+{
+    for (uint32_t y = 0; y < HEIGHT; y++) {
+        for (uint32_t x = 0; x < WIDTH; x++) {
+            assert(decoded[y * WIDTH + x] == get_pixel(frame, x, y));
+        }
+    }
+}
+
+// C64-like content: solid border, background, a few text lines
+static void make_c64_screen(uint8_t *frame, uint8_t border, uint8_t background)
+{
+    for (uint32_t y = 0; y < HEIGHT; y++) {
+        for (uint32_t x = 0; x < WIDTH; x++) {
+            bool inside = x >= 32 && x < 352 && y >= 36 && y < 236;
+            set_pixel(frame, x, y, inside ? background : border);
+        }
+    }
+    for (uint32_t y = 40; y < 72; y++) {
+        for (uint32_t x = 40; x < 300; x++) {
+            if (((x / 3) ^ (y / 2)) & 1) {
+                set_pixel(frame, x, y, 14);
+            }
+        }
+    }
+}
+
+static void make_noise(uint8_t *frame, unsigned seed)
+{
+    srand(seed);
+    for (size_t i = 0; i < sizeof(frame_a); i++) {
+        frame[i] = (uint8_t)rand();
+    }
+}
+
+static size_t roundtrip(const uint8_t *frame, const uint8_t *previous, uint16_t bit_count)
+{
+    size_t size = c64u_rle_encode_frame(encoded, frame, previous, WIDTH, HEIGHT, BYTES_PER_LINE, bit_count);
+    assert(size <= sizeof(encoded));
+    assert(size % 2 == 0);
+    decode_rle(encoded, size, bit_count);
+    assert_decoded_equals(frame);
+    return size;
+}
+
+void test_keyframes(uint16_t bit_count)
+{
+    printf("Testing RLE%u keyframes...\n", bit_count);
+    size_t raw_size = (size_t)WIDTH * HEIGHT * bit_count / 8;
+
+    make_c64_screen(frame_a, 14, 6);
+    size_t size = roundtrip(frame_a, NULL, bit_count);
+    printf("  C64 screen: %zu bytes (raw %zu)\n", size, raw_size);
+    assert(size * 5 < raw_size);
+
+    make_noise(frame_a, 1);
+    size = roundtrip(frame_a, NULL, bit_count);
+    printf("  Noise: %zu bytes (raw %zu)\n", size, raw_size);
+    assert(size < raw_size + raw_size / 16); // Literal fallback keeps noise close to raw size
+
+    memset(frame_a, 0x11, sizeof(frame_a));
+    size = roundtrip(frame_a, NULL, bit_count);
+    printf("  Solid: %zu bytes\n", size);
+
+    printf("RLE%u keyframe test PASSED\n\n", bit_count);
+}
+
+void test_delta_frames(uint16_t bit_count)
+{
+    printf("Testing RLE%u delta frames...\n", bit_count);
+
+    make_c64_screen(frame_a, 14, 6);
+    roundtrip(frame_a, NULL, bit_count);
+
+    // Unchanged frame: only the end-of-bitmap marker
+    memcpy(frame_b, frame_a, sizeof(frame_b));
+    size_t size = roundtrip(frame_b, frame_a, bit_count);
+    assert(size == 2);
+
+    // Blinking cursor and a sprite moving near the right border
+    for (uint32_t y = 100; y < 108; y++) {
+        for (uint32_t x = 48; x < 56; x++) {
+            set_pixel(frame_b, x, y, 1);
+        }
+        for (uint32_t x = 370; x < 384; x++) {
+            set_pixel(frame_b, x, y + 100, 2);
+        }
+    }
+    size = roundtrip(frame_b, frame_a, bit_count);
+    printf("  Cursor + sprite: %zu bytes\n", size);
+    assert(size < 400);
+
+    // Change in the very first and very last pixel of the frame
+    memcpy(frame_a, frame_b, sizeof(frame_a));
+    set_pixel(frame_b, 0, 0, 7);
+    set_pixel(frame_b, WIDTH - 1, HEIGHT - 1, 7);
+    roundtrip(frame_b, frame_a, bit_count);
+
+    // Completely different frame as delta
+    memcpy(frame_a, frame_b, sizeof(frame_a));
+    make_noise(frame_b, 2);
+    roundtrip(frame_b, frame_a, bit_count);
+
+    printf("RLE%u delta frame test PASSED\n\n", bit_count);
+}
+
+int main()
+{
+    printf("Running RLE encoder tests...\n\n");
+
+    test_keyframes(8);
+    test_keyframes(4);
+    test_delta_frames(8);
+    test_delta_frames(4);
+
+    printf("All RLE tests PASSED!\n");
+    return 0;
+}